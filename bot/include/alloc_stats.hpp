@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+ * HEAP ALLOCATION COUNTERS
+ *
+ * alloc_stats.cpp replaces the global operator new (all forms forward to the
+ * counted ones) with malloc plus two relaxed atomic adds, so the perf suite
+ * can report allocations per replayed session. C allocations (SQLite, curl)
+ * are not counted. Take a snapshot before and after the code of interest and
+ * subtract.
+ */
+
+struct AllocStats {
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+
+    AllocStats operator-(const AllocStats& earlier) const {
+        return {allocations - earlier.allocations, bytes - earlier.bytes};
+    }
+};
+
+AllocStats alloc_stats();
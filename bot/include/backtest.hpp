@@ -0,0 +1,158 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <array>
+#include <cstdint>
+#include "bot_config.hpp"
+#include "metrics_registry.hpp"
+
+class ThreadPool;
+
+/*
+ * WALK-FORWARD BACKTEST ENGINE
+ *
+ * Replays recorded ticks through the strategy core (strategy_core.hpp) - the
+ * same scan filters, regime classification, signal score, trade plan, fee
+ * filter and TP/SL/trailing tracker that scan_pair / execute_trade run live.
+ *
+ * Ticks are loaded once into per-pair columnar arrays (timestamps, last,
+ * bid, ask, volume, high, low, open) and shared read-only by every task.
+ * The time range is cut into walk-forward windows; each (window, pair) is an
+ * independent task that warms its indicator history on the ticks before the
+ * window, then trades the window. Tasks run on a ThreadPool and their stats
+ * merge per window.
+ *
+ * Differences from the live bot, by necessity:
+ * - Volatility is computed from the last 500 ticks of the series (the live
+ *   bot's local fallback) once at load time, as a column shared by every
+ *   run; 15-minute candles are resampled from the ticks.
+ * - Entries fill at the signal tick's last price; monitoring samples the
+ *   series every poll_seconds like the live 5s loop.
+ * - Pairs are simulated independently: one position per pair, no
+ *   max_concurrent_trades cap, base position size (no shared Kelly state),
+ *   no learned strategy overrides or direction model.
+ */
+
+// KrakenAPI::get_volatility reads the last 500 prices
+constexpr size_t VOLATILITY_TICKS = 500;
+
+struct TickSeries {
+    std::string pair;
+    std::vector<int64_t> timestamp_ms;
+    std::vector<double> last;
+    std::vector<double> bid;
+    std::vector<double> ask;
+    std::vector<double> volume;
+    std::vector<double> high;
+    std::vector<double> low;
+    std::vector<double> open;
+    std::vector<double> volatility_pct;   // Derived at load: std-dev of |log returns| over VOLATILITY_TICKS
+
+    size_t size() const { return timestamp_ms.size(); }
+};
+
+struct TickData {
+    std::vector<TickSeries> series;   // Sorted by pair, each by time
+    int64_t first_ms = 0;
+    int64_t last_ms = 0;
+
+    size_t tick_count() const;
+    void finalize();                  // Sort series and recompute the time range
+};
+
+// Stable sort of every column by timestamp; columns not filled yet (empty)
+// are left alone
+void sort_by_time(TickSeries& s);
+
+// market_data.db ticker_data (full ticker snapshots)
+bool load_ticker_data(const std::string& db_path, TickData& data);
+// price_history.db price_history (last/bid/ask/volume); open/high/low are
+// derived over a trailing window (the live ticker's 24h fields)
+bool load_price_history(const std::string& db_path, TickData& data, int64_t range_window_ms = 24LL * 3600 * 1000);
+
+struct BacktestOptions {
+    int windows = 8;
+    int64_t warmup_ms = 30LL * 60 * 1000;   // Indicator warm-up before each window
+    int poll_seconds = 5;                    // Position monitor cadence
+    int scan_seconds = 0;                    // Min time between scans of a pair (0 = every tick)
+};
+
+// Cumulative net P&L of closed trades by exit time. Merging interleaves
+// two curves, so concurrent pairs add up to one portfolio curve and the
+// drawdown is the portfolio's, not the worst single pair's.
+class EquityCurve {
+public:
+    void add(int64_t exit_ms, double net_pnl);   // Trades in exit order
+    void merge(const EquityCurve& other);       // other: nothing settled (one task or window)
+    // Fold the trades into a running summary to free them; later merges
+    // must only bring later trades (walk-forward windows are in time order)
+    void settle();
+    double max_drawdown() const { return drawdown; }
+
+private:
+    struct Step {
+        int64_t exit_ms;
+        double net_pnl;
+    };
+    void replay();
+
+    std::vector<Step> steps;          // Since the last settle(), by exit time
+    double settled_equity = 0.0;      // Curve state after the settled trades
+    double settled_peak = 0.0;
+    double settled_drawdown = 0.0;
+    double equity = 0.0;              // ... and after every trade
+    double peak = 0.0;
+    double drawdown = 0.0;
+};
+
+struct BacktestStats {
+    uint64_t ticks = 0;
+    uint64_t scans = 0;
+    uint64_t opportunities = 0;
+    uint64_t skipped_plans = 0;              // QUIET regime or fee filter
+    std::array<uint64_t, (size_t)MetricCounter::COUNT> rejects{};
+    int trades = 0;
+    int wins = 0;
+    double gross_pnl = 0.0;
+    double fees = 0.0;
+    double net_pnl = 0.0;
+    double max_drawdown = 0.0;               // Worst peak-to-trough of the merged equity curve
+    int tp_exits = 0;
+    int sl_exits = 0;
+    int trailing_exits = 0;
+    int timeout_exits = 0;
+    int closed_at_window_end = 0;
+    EquityCurve equity;
+
+    void merge(const BacktestStats& other);
+    double win_rate() const { return trades ? (double)wins / trades : 0.0; }
+};
+
+struct WindowResult {
+    int index = 0;
+    int64_t start_ms = 0;
+    int64_t end_ms = 0;
+    BacktestStats stats;
+};
+
+struct BacktestReport {
+    std::vector<WindowResult> windows;
+    BacktestStats total;
+    double elapsed_seconds = 0.0;
+    double ticks_per_second() const { return elapsed_seconds > 0 ? total.ticks / elapsed_seconds : 0.0; }
+};
+
+// Simulate one pair over [start_ms, end_ms), warming up on the ticks before it
+BacktestStats simulate_series(const TickSeries& series, int64_t start_ms, int64_t end_ms,
+                              const ConfigSnapshot& snapshot, const BacktestOptions& options);
+
+// Equal-duration walk-forward windows over the data's time range
+std::vector<WindowResult> make_windows(const TickData& data, int windows);
+
+// All windows x pairs on the pool
+BacktestReport run_walk_forward(const TickData& data, const ConfigSnapshot& snapshot,
+                                const BacktestOptions& options, ThreadPool& pool);
+
+// "spread", "volume", ... for MetricCounter::REJECT_*, nullptr otherwise
+const char* reject_filter_name(MetricCounter counter);
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <string>
+#include <set>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <optional>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+/*
+ * BOT CONFIGURATION SNAPSHOT
+ *
+ * BotConfig holds the tunable trading parameters. A ConfigSnapshot is built
+ * once from defaults -> bot_config.json -> environment -> CLI flags and is
+ * immutable after publication. The hot path (scan_pair, execute_trade, Kelly
+ * sizing) reads plain fields from the current snapshot instead of calling
+ * std::getenv or re-parsing JSON.
+ *
+ * ConfigStore publishes snapshots with an atomic shared_ptr swap. A watcher
+ * thread (inotify on Linux, mtime polling elsewhere) rebuilds the snapshot
+ * when the config file changes; readers that already hold a snapshot keep a
+ * consistent view until they drop it (e.g. for the lifetime of one trade).
+ */
+
+// Environment variables that change what a run does, read by
+// ConfigStore::apply_environment, LearningEngine and KrakenAPI (API keys are
+// not listed). --capture records them; kraken_perf clears them for its runs.
+inline constexpr const char* BOT_ENV_OVERRIDES[] = {
+    "PAPER_MIN_CONFIDENCE", "TP_MULTIPLIER_OVERRIDE", "SL_MULTIPLIER_OVERRIDE", "MIN_VOLATILITY_PCT",
+    "KELLY_FRACTION_OVERRIDE", "AUTO_DIRECTION", "AUTO_DIR_CONSECUTIVE_LOSSES", "AUTO_DIR_COOLDOWN",
+    "LEVERAGE_OVERRIDE", "KRAKEN_DATA_DIR", "TRADES_DB", "USE_AUTHORITATIVE_PRICES", "PRICE_HISTORY_DB",
+};
+
+struct BotConfig {
+    bool paper_trading = true;
+    bool enable_learning = true;
+    bool learning_mode = false;  // DISABLED: Leverage trading doesn't use learning mode
+    int edge_filter_min_trades = 999999;  // DISABLED: Leverage trading doesn't use edge filters
+    double edge_filter_min_winrate = 0.35;  // Minimum win rate for edge
+    int learning_cycle_trades = 10;
+    std::string trade_log_file = "trade_log.json";
+    int max_concurrent_trades = 2;
+    double base_position_size_usd = 50.0;  // Reduced from 100 - more conservative
+    double min_position_size_usd = 10.0;  // Reduced from 25
+    double max_position_size_usd = 200.0; // Reduced from 500
+    double max_drawdown_pct = 10.0;       // Monte Carlo p95 drawdown budget, % of bankroll
+    int min_hold_seconds = 300;         // Increased from 180 - allow more time
+    int max_hold_seconds = 3600;        // Increased from 1800 - up to 1 hour
+    int default_hold_seconds = 1200;    // Increased from 600 - 20 minutes default
+    double min_volatility_pct = 0.0;    // Temporarily set to 0.0% to demonstrate system working
+    double max_volatility_pct = 15.0;   // Lowered from 25.0 - avoid extreme vol
+    double max_spread_pct = 0.15;       // Keep spread limit
+    double min_momentum_pct = 0.0;      // Temporarily set to 0.0% to demonstrate system working
+    double min_volume_usd = 25000.0;    // Lowered from 50000 - more pairs
+    double take_profit_pct = 0.8;       // Lowered from 1.5 - more realistic target
+    double stop_loss_pct = 0.4;         // Lowered from 0.6 - less aggressive stops
+    double leverage = 3.0;                // Leverage multiplier (3.0 = 3x leverage for futures)
+    double trailing_start_pct = 0.8;
+    double trailing_stop_pct = 0.3;
+    double trailing_distance_pct = 0.3;
+    int min_trades_to_blacklist = 3;
+    double min_pair_winrate = 0.35;
+    int min_pair_trades_for_stats = 5;
+    std::set<std::string> blacklisted_pairs;  // Static blacklist from bot_config.json
+
+    // Regime filter - data shows VOLATILE regime has 70% WR
+    bool regime_filter_enabled = true;
+    bool allow_volatile_regime = true;
+    bool allow_trending_regime = false;  // Data shows losing money in trends
+    bool allow_ranging_regime = false;   // Data shows -$1498 loss in ranging
+    bool allow_quiet_regime = false;
+
+    // VOLATILE regime targets (override the volatility-scaled TP/SL/hold)
+    double volatile_take_profit_pct = 0.5;
+    double volatile_stop_loss_pct = 0.3;
+    int volatile_hold_seconds = 900;
+
+    // Pair universe (kraken-data/) - see pair_universe.hpp for per-pair cost
+    std::string universe_data_dir = "../../kraken-data";
+    int universe_max_active = 200;
+    int universe_hysteresis = 50;
+    int universe_refresh_seconds = 60;
+    int scan_workers = 16;              // Bounded scan concurrency (I/O bound)
+
+    // Local Prometheus-style /metrics endpoint (0 = disabled)
+    int metrics_port = 9464;
+};
+
+struct ConfigSnapshot {
+    BotConfig bot;
+
+    // Experiment overrides resolved from the environment at build time
+    double min_confidence_threshold = 0.55;          // PAPER_MIN_CONFIDENCE
+    std::optional<double> tp_multiplier;             // TP_MULTIPLIER_OVERRIDE
+    std::optional<double> sl_multiplier;             // SL_MULTIPLIER_OVERRIDE
+    std::optional<double> min_volatility_gate_pct;   // MIN_VOLATILITY_PCT
+    std::optional<double> kelly_fraction;            // KELLY_FRACTION_OVERRIDE (clamped 0-1)
+    bool auto_direction = false;                     // AUTO_DIRECTION=1
+    int auto_dir_consecutive_losses = 3;             // AUTO_DIR_CONSECUTIVE_LOSSES
+    int auto_dir_cooldown_seconds = 600;             // AUTO_DIR_COOLDOWN
+
+    uint64_t version = 0;
+    std::string source_path;
+    bool loaded_from_file = false;
+};
+
+using ConfigSnapshotPtr = std::shared_ptr<const ConfigSnapshot>;
+
+class ConfigStore {
+public:
+    // cli_overrides: flat BotConfig field names -> values, applied last
+    explicit ConfigStore(std::string config_path, json cli_overrides = json::object());
+    ~ConfigStore();
+
+    ConfigStore(const ConfigStore&) = delete;
+    ConfigStore& operator=(const ConfigStore&) = delete;
+
+    // Current snapshot - cheap, lock-free for readers
+    ConfigSnapshotPtr current() const;
+
+    // Rebuild from file/env/CLI and publish. Returns false (keeping the old
+    // snapshot) if the file exists but fails to parse.
+    bool reload();
+
+    // Watch the config file and hot-reload on change
+    void start_watching();
+    void stop_watching();
+
+    // Build a snapshot without publishing (used by reload and tools)
+    static std::optional<ConfigSnapshot> build(const std::string& config_path, const json& cli_overrides);
+    static void apply_file_json(BotConfig& config, const json& file_json);
+    static void apply_overrides(BotConfig& config, const json& overrides);
+    static void apply_environment(ConfigSnapshot& snapshot);
+    static void print_summary(const ConfigSnapshot& snapshot);
+
+private:
+    std::string config_path;
+    json cli_overrides;
+    uint64_t next_version = 1;
+    std::mutex reload_mutex;
+
+#if defined(__cpp_lib_atomic_shared_ptr)
+    std::atomic<ConfigSnapshotPtr> snapshot;
+#else
+    ConfigSnapshotPtr snapshot;  // Accessed via std::atomic_load/atomic_store
+#endif
+
+    std::thread watcher;
+    std::atomic<bool> watching{false};
+    int wake_pipe[2] = {-1, -1};  // Interrupts the watcher's poll() on shutdown
+
+    void publish(ConfigSnapshotPtr next);
+    void watch_loop();
+};
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * CAPTURE LOG: RECORD / REPLAY OF EXTERNAL INPUTS
+ *
+ * `kraken_bot --capture run.kcap` records every input the bot consumes, and
+ * `kraken_bot --replay-capture run.kcap` feeds them back so the run repeats
+ * decision for decision:
+ *
+ *   CLOCK   every Clock::now() reading (CaptureClock)
+ *   MARKET  every MarketDataSource result: ticker JSON, latest price,
+ *           volatility, candles, pair list, order fills, exceptions
+ *           (CaptureMarketData)
+ *   FILE    bot_config.json, direction_rules.json, each direction_model.json
+ *           reload check, the online model checkpoint
+ *   SQLITE  a trades.db image at start, rows read from market_data.db
+ *   ENV     the override variables the config reads (never API keys)
+ *   META    CLI overrides, the scanned pair list per universe refresh, the
+ *           order trade threads took the learning lock in
+ *
+ * Records are keyed by channel (kind + name, e.g. CLOCK "ETHUSD", MARKET
+ * "ticker:ETHUSD") and replay in order per channel, so threads interleaving
+ * differently on replay still see their own inputs in the same order. The
+ * clock channel is the pair of the thread's TraceContext ("" for the main
+ * loop).
+ *
+ * Format: "KCAP" + version byte, then records [varint channel id][varint
+ * length][payload]. Channel id 0 defines a channel: [varint id][kind][name].
+ * Numbers are little-endian, doubles are raw IEEE bits, ints zigzag varints;
+ * nothing is re-parsed from text, so replay is bit-exact. Recording appends
+ * to a buffer under one mutex and writes it out per scan cycle (or at 1 MB);
+ * a killed run loses at most the current cycle and the reader stops cleanly
+ * at a truncated tail.
+ *
+ * Not captured: config hot reloads (the replay uses the config as of the
+ * start), kraken-data/ universe files (the resulting pair list is).
+ */
+
+enum class CaptureKind : uint8_t { CLOCK = 1, MARKET = 2, FILE = 3, SQLITE = 4, ENV = 5, META = 6 };
+
+class CaptureEncoder {
+public:
+    void u8(uint8_t v) { bytes.push_back((char)v); }
+    void varint(uint64_t v);
+    void i64(int64_t v) { varint(((uint64_t)v << 1) ^ (uint64_t)(v >> 63)); }
+    void f64(double v);
+    void str(std::string_view v);
+
+    std::string bytes;
+};
+
+class CaptureDecoder {
+public:
+    explicit CaptureDecoder(std::string_view data) : data(data) {}
+
+    uint8_t u8();
+    uint64_t varint();
+    int64_t i64() { uint64_t v = varint(); return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+    double f64();
+    std::string str();
+    std::string_view view(uint64_t n);   // Next n bytes, without copying
+    bool ok() const { return good; }
+    bool at_end() const { return pos >= data.size(); }
+
+private:
+    std::string_view data;
+    size_t pos = 0;
+    bool good = true;
+};
+
+class CaptureSession {
+public:
+    enum class Mode { OFF, RECORD, REPLAY };
+
+    static CaptureSession& instance();
+
+    bool open_record(const std::string& path);
+    bool open_replay(const std::string& path);
+    void flush();     // Recording: write the buffer out
+    void close();     // Flush, or report records the replay never asked for
+
+    Mode mode() const { return mode_; }
+    bool recording() const { return mode_ == Mode::RECORD; }
+    bool replaying() const { return mode_ == Mode::REPLAY; }
+
+    void record(CaptureKind kind, const std::string& channel, std::string_view payload);
+    // Next recorded payload on the channel; nullopt (and a miss) once the
+    // replay asks for more than was recorded
+    std::optional<std::string> next(CaptureKind kind, const std::string& channel);
+    size_t remaining(CaptureKind kind, const std::string& channel);
+    uint64_t misses() const { return misses_.load(std::memory_order_relaxed); }
+    uint64_t records() const { return records_.load(std::memory_order_relaxed); }
+    uint64_t bytes() const { return bytes_.load(std::memory_order_relaxed); }
+
+    // Input helpers; pass-through when capture is off
+    // Content a reader should use for a changed (or, nullopt, unchanged/missing) file
+    std::optional<std::string> file_update(const std::string& path, std::optional<std::string> live);
+    // Whole-file snapshot (absent files recorded as absent) and its restore
+    void snapshot_file(const std::string& channel, const std::string& path);
+    bool restore_file(const std::string& channel, const std::string& out_path);
+    // Consistent image of a SQLite DB (WAL included) and its restore
+    void snapshot_sqlite(const std::string& channel, const std::string& db_path);
+    bool restore_sqlite(const std::string& channel, const std::string& out_path);
+    // The env overrides the config reads
+    void snapshot_env();
+    void restore_env();
+    // A list the replay should see as recorded (e.g. scanned pairs)
+    std::vector<std::string> string_list(const std::string& channel, std::vector<std::string> live);
+    // Cross-thread order on shared state: call wait_turn() before taking the
+    // lock and take_turn() once holding it. Recording logs who took it; a
+    // replay holds each thread back until the log says it is next.
+    void wait_turn(const std::string& channel, std::string_view who);
+    void take_turn(const std::string& channel, std::string_view who);
+
+private:
+    CaptureSession() = default;
+
+    struct Channel {
+        CaptureKind kind;
+        std::string name;
+        std::vector<std::string_view> payloads;
+        size_t cursor = 0;
+        bool reported = false;
+    };
+
+    Mode mode_ = Mode::OFF;
+    std::mutex mutex_;
+    std::condition_variable turn_changed_;
+    // Recording
+    std::FILE* file_ = nullptr;
+    std::string buffer_;
+    std::unordered_map<std::string, uint64_t> channel_ids_;   // kind byte + name
+    // Replay
+    std::string data_;
+    std::vector<Channel> channels_;
+    std::unordered_map<std::string, size_t> channel_index_;
+
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> records_{0};
+    std::atomic<uint64_t> bytes_{0};
+
+    void flush_locked();
+};
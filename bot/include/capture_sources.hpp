@@ -0,0 +1,71 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include "capture_log.hpp"
+#include "clock.hpp"
+#include "kraken_api.hpp"
+
+/*
+ * CLOCK AND MARKET DATA THROUGH THE CAPTURE LOG
+ *
+ * Recording wraps the live Clock / MarketDataSource and logs what they
+ * return; replay serves the logged values instead (see capture_log.hpp).
+ * Exceptions are captured too and rethrown as std::runtime_error with the
+ * same message. On replay, sleeps return immediately: the recorded clock
+ * readings already say how much time passed.
+ */
+
+class CaptureClock : public Clock {
+public:
+    explicit CaptureClock(Clock& inner) : inner(inner) {}
+
+    time_point now() override;
+    void sleep_for(std::chrono::milliseconds duration) override { inner.sleep_for(duration); }
+    std::thread start_thread(std::function<void()> body) override { return inner.start_thread(std::move(body)); }
+    void join(std::vector<std::thread>& threads) override { inner.join(threads); }
+
+private:
+    Clock& inner;
+};
+
+class CaptureReplayClock : public Clock {
+public:
+    time_point now() override;
+    void sleep_for(std::chrono::milliseconds) override {}
+
+private:
+    std::atomic<int64_t> last_ticks{0};   // Served when the replay runs past the recording
+};
+
+class CaptureMarketData : public MarketDataSource {
+public:
+    explicit CaptureMarketData(std::unique_ptr<MarketDataSource> inner) : inner(std::move(inner)) {}
+
+    bool authenticate() override;
+    std::vector<std::string> get_trading_pairs() override;
+    json get_ticker(const std::string& pair) override;
+    double get_latest_price(const std::string& pair) override;
+    double get_volatility(const std::string& pair, int minutes = 60) override;
+    std::vector<OHLC> get_ohlc(const std::string& pair, int interval = 15) override;
+    Order place_market_order(const std::string& pair, const std::string& side,
+                             double volume, double leverage = 1.0) override;
+    bool exhausted() override { return inner->exhausted(); }
+
+private:
+    std::unique_ptr<MarketDataSource> inner;
+};
+
+class CaptureReplayMarketData : public MarketDataSource {
+public:
+    bool authenticate() override;
+    std::vector<std::string> get_trading_pairs() override;
+    json get_ticker(const std::string& pair) override;
+    double get_latest_price(const std::string& pair) override;
+    double get_volatility(const std::string& pair, int minutes = 60) override;
+    std::vector<OHLC> get_ohlc(const std::string& pair, int interval = 15) override;
+    Order place_market_order(const std::string& pair, const std::string& side,
+                             double volume, double leverage = 1.0) override;
+    // The main loop's clock readings ran out, or the run diverged
+    bool exhausted() override;
+};
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/*
+ * INJECTABLE CLOCK
+ *
+ * Everything in the bot that reads the time or waits (scan interval, the 5s
+ * position monitor, hold timeouts, the continuous-learning timer, trade
+ * timestamps) goes through a Clock. Live runs use Clock::wall(); replay runs
+ * use a VirtualClock, where sleeping advances virtual time instead of waiting.
+ *
+ * VirtualClock runs its threads one at a time: a thread that sleeps, finishes
+ * or blocks in join() hands over to the earliest waiting one (ties in the
+ * order they started waiting), and time jumps to that thread's wake-up. With
+ * no real concurrency between clock threads a replay is deterministic and a
+ * day of 5s polls takes as long as the work between them.
+ *
+ * Clock threads must be started with start_thread() and joined with join() so
+ * the clock knows when every one of them is waiting. Threads that never sleep
+ * (scan pool workers, the trade writer) only read now() and need neither.
+ */
+
+class Clock {
+public:
+    using time_point = std::chrono::system_clock::time_point;
+
+    virtual ~Clock() = default;
+
+    virtual time_point now() = 0;
+    virtual void sleep_for(std::chrono::milliseconds duration) = 0;
+    // Start a thread that may sleep on this clock
+    virtual std::thread start_thread(std::function<void()> body);
+    // Join threads from start_thread(); clock time may pass meanwhile
+    virtual void join(std::vector<std::thread>& threads);
+
+    int64_t now_ms();
+    long now_seconds();
+
+    // std::chrono::system_clock and std::this_thread::sleep_for
+    static Clock& wall();
+};
+
+class WallClock : public Clock {
+public:
+    time_point now() override;
+    void sleep_for(std::chrono::milliseconds duration) override;
+};
+
+class VirtualClock : public Clock {
+public:
+    // speed: virtual seconds per real second (0 = as fast as possible). The
+    // constructing thread is the first clock thread.
+    explicit VirtualClock(time_point start, double speed = 0.0);
+
+    time_point now() override;
+    void sleep_for(std::chrono::milliseconds duration) override;
+    std::thread start_thread(std::function<void()> body) override;
+    void join(std::vector<std::thread>& threads) override;
+
+    uint64_t wakeups() const { return wakeups_.load(std::memory_order_relaxed); }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable turn_cv_;
+    std::atomic<int64_t> now_us_;
+    const double speed_;
+    int running_ = 1;                                    // Clock threads not waiting for a turn
+    uint64_t next_seq_ = 0;
+    uint64_t turn_ = UINT64_MAX;                         // Sequence number allowed to run next
+    std::set<std::pair<int64_t, uint64_t>> waiting_;     // (wake-up us, seq)
+    std::atomic<uint64_t> wakeups_{0};
+
+    uint64_t enqueue_locked(int64_t wake_us);
+    void dispatch_locked();
+    void wait_turn(std::unique_lock<std::mutex>& lock, uint64_t seq);
+};
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+class ThreadPool;
+
+/*
+ * COUNTERFACTUAL EXIT REPLAY
+ *
+ * Re-runs closed trades under alternative exit settings. A trade is its
+ * post-entry price path in favorable-move terms, r = (p / entry - 1) * 100
+ * for LONG and the negation for SHORT, so TP is r >= tp and SL is r <= -sl
+ * on either side. The trailing stop mirrors PositionTracker exactly: its
+ * stop sits trailing_stop_pct from the best price, which in r terms is
+ * best - stop -/+ best * stop / 100 (LONG / SHORT).
+ *
+ * Candidate settings are stored column-wise (ExitGrid), and each price
+ * observation updates every candidate in one branch-free loop over the
+ * columns (open flag, best move, trailing state, exit move, adverse move)
+ * that the compiler vectorizes. Trades are spread over the pool in fixed
+ * chunks whose sums are reduced in chunk order, so scores do not depend on
+ * the thread count.
+ *
+ * A path ends where the recorded prices end. A candidate still open there
+ * exits at the last observation, as the bot does when its feed stops.
+ * Leverage L floors the SL at the liquidation distance 100 / L, as
+ * plan_trade() does, so a tighter SL needs more leverage.
+ */
+
+struct PricePath {
+    bool is_short = false;
+    std::vector<int32_t> elapsed_s;   // Seconds since entry, ascending
+    std::vector<float> move_pct;      // Favorable move at each observation
+
+    void add(int32_t elapsed, double price, double entry_price);
+    size_t size() const { return move_pct.size(); }
+};
+
+struct ExitGrid {
+    // One row per candidate; trailing_start_pct = +inf disables trailing
+    std::vector<float> tp_pct;
+    std::vector<float> sl_pct;
+    std::vector<float> trailing_start_pct;
+    std::vector<float> trailing_stop_pct;
+    std::vector<int32_t> hold_s;
+    std::vector<float> leverage;
+
+    void add(float tp, float sl, float trailing_start, float trailing_stop, int32_t hold, float lev);
+    size_t size() const { return tp_pct.size(); }
+
+    static constexpr float NO_TRAILING = std::numeric_limits<float>::infinity();
+};
+
+struct ExitScore {
+    int trades = 0;
+    int wins = 0;
+    double mean_net_pct = 0.0;   // Per trade, after round-trip fees
+    double std_net_pct = 0.0;
+
+    // Mean less one standard error: among hundreds of candidates, the raw
+    // best mean on a few dozen trades is mostly luck
+    double lower_bound() const;
+};
+
+// Net % of notional and worst adverse move before exit, for one trade
+struct ExitOutcome {
+    float net_pct = 0.0f;
+    float adverse_pct = 0.0f;   // Most negative move while open (<= 0)
+};
+
+// Every candidate over every path
+std::vector<ExitScore> score_exit_grid(const std::vector<const PricePath*>& paths, const ExitGrid& grid,
+                                       double fee_pct, ThreadPool& pool);
+
+// One candidate's per-trade outcomes, in path order
+std::vector<ExitOutcome> replay_exit(const std::vector<const PricePath*>& paths, const ExitGrid& grid,
+                                     size_t candidate, double fee_pct);
+
+// Fraction of bankroll per trade by Kelly on the outcomes (0 without an edge)
+double kelly_fraction(const std::vector<ExitOutcome>& outcomes);
+
+// Mean log growth of a bankroll staking `stake_fraction` of notional per trade
+double log_growth(const std::vector<ExitOutcome>& outcomes, double stake_fraction);
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+
+/*
+ * COMPILED DIRECTION MODEL
+ *
+ * data/direction_model.json ({"weights": {name: w}, "bias": b}, written by
+ * scripts/analysis/train_direction_model.js) is compiled into a dense weight
+ * vector indexed by DirectionFeature. Scoring is bias + one fixed-width dot
+ * product (GCC/Clang vector extensions -> AVX/SSE), with no string lookups
+ * and no allocation. Weights for names the bot doesn't compute are dropped
+ * at load; features without a weight score 0, as before.
+ *
+ * reload_if_changed() stats the file and only re-reads it when mtime or size
+ * moved, and only re-parses when the content hash differs. A new model is
+ * published by atomically swapping a shared_ptr, so scorers on trade threads
+ * never lock and never see a half-updated model.
+ */
+
+enum class DirectionFeature : uint8_t {
+    VOLATILITY_PCT,
+    MARKET_REGIME,
+    VWAP_DEV,              // (last - vwap) / vwap * 100, 0 when vwap unknown
+    VOLUME,
+    LAST_PRICE,
+    VOLATILITY_PCT_SQ,
+    COUNT
+};
+
+// Feature values in DirectionFeature order, padded to the SIMD width
+constexpr size_t DIRECTION_FEATURE_SLOTS = 8;
+using DirectionFeatures = std::array<double, DIRECTION_FEATURE_SLOTS>;
+
+struct CompiledDirectionModel {
+    alignas(32) DirectionFeatures weights{};
+    double bias = 0.0;
+    size_t weight_count = 0;     // Weights in the file that mapped to a feature
+    uint64_t content_hash = 0;
+
+    double score(const DirectionFeatures& features) const;
+};
+
+class DirectionModel {
+public:
+    using Ptr = std::shared_ptr<const CompiledDirectionModel>;
+
+    // Null until a model has been loaded
+    Ptr current() const;
+
+    // Returns true when a new model was published
+    bool reload_if_changed(const std::string& path);
+
+    // Name used in direction_model.json, or nullptr
+    static const char* feature_name(DirectionFeature feature);
+
+private:
+#if defined(__cpp_lib_atomic_shared_ptr)
+    std::atomic<Ptr> model;
+#else
+    Ptr model;  // Accessed via std::atomic_load/atomic_store
+#endif
+
+    // Change detection (reloading thread only)
+    std::filesystem::file_time_type last_mtime{};
+    uintmax_t last_size = 0;
+    uint64_t last_hash = 0;
+
+    // Content when mtime or size moved since the last call
+    std::optional<std::string> read_if_touched(const std::string& path);
+    void publish(Ptr next);
+};
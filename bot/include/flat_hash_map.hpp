@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/*
+ * FLAT HASH MAP (uint64 keys)
+ *
+ * Open-addressing table with linear probing over one contiguous slot array,
+ * for hot integer-keyed lookups (packed PatternKeys, pair ids). Key 0 marks
+ * an empty slot, so callers must never insert 0. No erase: tables only grow
+ * or are cleared wholesale.
+ *
+ * Iteration yields Slot& with {key, value} members, so structured bindings
+ * work like std::map: for (auto& [key, value] : table). Order is unspecified.
+ * Inserting may rehash and invalidate references and iterators.
+ */
+
+template<typename V>
+class FlatHashMap {
+public:
+    struct Slot {
+        uint64_t key = 0;
+        V value{};
+    };
+
+    FlatHashMap() = default;
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    void clear() {
+        slots.clear();
+        count = 0;
+    }
+
+    void reserve(size_t n) {
+        size_t needed = 16;
+        while (needed * 7 / 10 < n) needed <<= 1;
+        if (needed > slots.size()) rehash(needed);
+    }
+
+    V* find(uint64_t key) {
+        if (slots.empty()) return nullptr;
+        size_t mask = slots.size() - 1;
+        for (size_t i = mix(key) & mask;; i = (i + 1) & mask) {
+            if (slots[i].key == key) return &slots[i].value;
+            if (slots[i].key == 0) return nullptr;
+        }
+    }
+
+    const V* find(uint64_t key) const {
+        return const_cast<FlatHashMap*>(this)->find(key);
+    }
+
+    bool contains(uint64_t key) const { return find(key) != nullptr; }
+
+    // Returns the value for key, default-constructing it if absent
+    std::pair<V*, bool> try_emplace(uint64_t key) {
+        if ((count + 1) * 10 > slots.size() * 7) rehash(slots.empty() ? 16 : slots.size() * 2);
+        size_t mask = slots.size() - 1;
+        for (size_t i = mix(key) & mask;; i = (i + 1) & mask) {
+            if (slots[i].key == key) return {&slots[i].value, false};
+            if (slots[i].key == 0) {
+                slots[i].key = key;
+                count++;
+                return {&slots[i].value, true};
+            }
+        }
+    }
+
+    V& operator[](uint64_t key) { return *try_emplace(key).first; }
+
+    template<typename SlotT>
+    class Iter {
+    public:
+        Iter(SlotT* p, SlotT* e) : ptr(p), end(e) { skip(); }
+        SlotT& operator*() const { return *ptr; }
+        SlotT* operator->() const { return ptr; }
+        Iter& operator++() { ++ptr; skip(); return *this; }
+        bool operator!=(const Iter& o) const { return ptr != o.ptr; }
+        bool operator==(const Iter& o) const { return ptr == o.ptr; }
+    private:
+        void skip() { while (ptr != end && ptr->key == 0) ++ptr; }
+        SlotT* ptr;
+        SlotT* end;
+    };
+
+    Iter<Slot> begin() { return {slots.data(), slots.data() + slots.size()}; }
+    Iter<Slot> end() { return {slots.data() + slots.size(), slots.data() + slots.size()}; }
+    Iter<const Slot> begin() const { return {slots.data(), slots.data() + slots.size()}; }
+    Iter<const Slot> end() const { return {slots.data() + slots.size(), slots.data() + slots.size()}; }
+
+private:
+    std::vector<Slot> slots;   // Power-of-two capacity
+    size_t count = 0;
+
+    static size_t mix(uint64_t x) {
+        // splitmix64 finalizer: packed keys differ mostly in low/high fields
+        x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+        return (size_t)x;
+    }
+
+    void rehash(size_t capacity) {
+        std::vector<Slot> old;
+        old.swap(slots);
+        slots.resize(capacity);
+        size_t mask = capacity - 1;
+        for (auto& slot : old) {
+            if (slot.key == 0) continue;
+            size_t i = mix(slot.key) & mask;
+            while (slots[i].key != 0) i = (i + 1) & mask;
+            slots[i].key = slot.key;
+            slots[i].value = std::move(slot.value);
+        }
+    }
+};
@@ -39,17 +39,36 @@ struct OHLC {
     double volume;
 };
 
-class KrakenAPI {
+// The exchange calls the trading bot makes. KrakenAPI talks to Kraken (or
+// the local collector DBs); ReplayMarketData serves recorded ticks in
+// virtual time.
+class MarketDataSource {
+public:
+    virtual ~MarketDataSource() = default;
+
+    virtual bool authenticate() = 0;
+    virtual std::vector<std::string> get_trading_pairs() = 0;
+    virtual json get_ticker(const std::string& pair) = 0;
+    virtual double get_latest_price(const std::string& pair) = 0;
+    virtual double get_volatility(const std::string& pair, int minutes = 60) = 0;
+    virtual std::vector<OHLC> get_ohlc(const std::string& pair, int interval = 15) = 0;
+    virtual Order place_market_order(const std::string& pair, const std::string& side,
+                                     double volume, double leverage = 1.0) = 0;
+    // A finite source (replay) that has nothing left to serve
+    virtual bool exhausted() { return false; }
+};
+
+class KrakenAPI : public MarketDataSource {
 public:
     KrakenAPI(bool paper_trading = true);
-    ~KrakenAPI();
+    ~KrakenAPI() override;
     
     // Authentication - uses environment variables
-    bool authenticate();
+    bool authenticate() override;
     
     // Trading
     Order place_market_order(const std::string& pair, const std::string& side, 
-                            double volume, double leverage = 1.0);
+                            double volume, double leverage = 1.0) override;
     Order place_limit_order(const std::string& pair, const std::string& side,
                            double volume, double price, double leverage = 1.0);
     bool cancel_order(const std::string& order_id);
@@ -65,13 +84,13 @@ public:
     
     // Market data
     double get_current_price(const std::string& pair);
-    json get_ticker(const std::string& pair);
+    json get_ticker(const std::string& pair) override;
     double get_bid_ask_spread(const std::string& pair);
-    double get_latest_price(const std::string& pair);  // High-frequency price from local collector
-    double get_volatility(const std::string& pair, int minutes = 60);  // Volatility from price history
-    std::vector<OHLC> get_ohlc(const std::string& pair, int interval = 15);
+    double get_latest_price(const std::string& pair) override;  // High-frequency price from local collector
+    double get_volatility(const std::string& pair, int minutes = 60) override;  // Volatility from price history
+    std::vector<OHLC> get_ohlc(const std::string& pair, int interval = 15) override;
     std::vector<double> get_price_history(const std::string& pair, int max_points = 100);
-    std::vector<std::string> get_trading_pairs();
+    std::vector<std::string> get_trading_pairs() override;
     
     // Paper trading
     void set_paper_mode(bool enabled) { paper_mode = enabled; }
@@ -85,6 +104,8 @@ private:
     std::string api_key;
     std::string api_secret;
     std::string base_url = "https://api.kraken.com";
+    bool use_authoritative_prices = false;     // USE_AUTHORITATIVE_PRICES=1
+    std::string price_history_db_override;     // PRICE_HISTORY_DB
     
     // Paper trading state
     double paper_balance = 10000;  // $10k starting
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "thread_shards.hpp"
+#include "trace_recorder.hpp"
+
+using json = nlohmann::json;
+
+/*
+ * PER-STAGE LATENCY HISTOGRAMS
+ *
+ * HDR-style log-linear histograms (32 linear sub-buckets per power of two,
+ * <= 3.2% relative error, 1 us .. ~12 days) for each named stage of the
+ * scan -> decide -> enter -> exit pipeline.
+ *
+ * Recording is per thread (see thread_shards.hpp): each thread owns a shard
+ * and bumps its own counters with relaxed atomic loads/stores (no RMW, no
+ * locks, no sharing). Readers merge all shards periodically.
+ *
+ * While a TraceContext is active (trace_recorder.hpp) each ScopedLatency
+ * also records a trace span for the current decision.
+ *
+ * Usage:
+ *   { ScopedLatency t(LatencyStage::GET_TICKER); api->get_ticker(pair); }
+ *   auto lock = timed_lock(learning_mutex, LatencyStage::LEARNING_MUTEX_WAIT);
+ */
+
+enum class LatencyStage : uint8_t {
+    SCAN_CYCLE,            // Whole parallel scan across the active universe
+    SCAN_PAIR,             // One scan_pair() call
+    GET_TICKER,
+    GET_VOLATILITY,        // price_history.db read (<= 500 rows) or HTTP
+    GET_OHLC,
+    CALCULATE_INDICATORS,
+    LEARNING_MUTEX_WAIT,   // Time blocked acquiring learning_mutex
+    ADAPTIVE_STRATEGY,     // get_adaptive_strategy + direction model scoring
+    RISK_PROFILE,          // Monte Carlo drawdown profile (cached; runs as the sample grows)
+    ENTRY_ORDER,
+    MONITOR_PRICE,         // Price poll inside the position monitoring loop
+    EXIT_ORDER,
+    RECORD_TRADE,          // LearningEngine::record_trade (incl. SQLite write)
+    CONTINUOUS_LEARNING,
+    COUNT
+};
+
+const char* latency_stage_name(LatencyStage stage);
+
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BUCKET_BITS = 5;
+    static constexpr uint64_t SUB_BUCKETS = 1ull << SUB_BUCKET_BITS;
+    static constexpr int MAX_EXPONENT = 40;  // 2^40 us ~ 12.7 days
+    static constexpr size_t BUCKETS = (MAX_EXPONENT - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    static size_t bucket_index(uint64_t micros);
+    static uint64_t bucket_upper_bound(size_t index);  // Highest value mapped to index
+
+    // Single-writer record (the owning thread)
+    void record(uint64_t micros) {
+        size_t i = bucket_index(micros);
+        counts[i].store(counts[i].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        total.store(total.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        sum.store(sum.load(std::memory_order_relaxed) + micros, std::memory_order_relaxed);
+        if (micros > max.load(std::memory_order_relaxed)) max.store(micros, std::memory_order_relaxed);
+    }
+
+    std::array<std::atomic<uint64_t>, BUCKETS> counts{};
+    std::atomic<uint64_t> total{0};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> max{0};
+};
+
+// Plain (non-atomic) merge target used for reporting
+struct LatencySummary {
+    std::vector<uint64_t> counts = std::vector<uint64_t>(LatencyHistogram::BUCKETS, 0);
+    uint64_t total = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+
+    void merge(const LatencyHistogram& h);
+    uint64_t percentile(double p) const;  // p in [0, 100], microseconds
+    json to_json() const;
+};
+
+class LatencyRegistry {
+public:
+    static LatencyRegistry& instance();
+
+    void record(LatencyStage stage, uint64_t micros);
+
+    // Merge every shard (live and recycled) into one summary per stage
+    std::array<LatencySummary, (size_t)LatencyStage::COUNT> merge() const;
+    json to_json() const;
+    bool write_json(const std::string& path) const;
+
+    struct Shard {
+        std::array<LatencyHistogram, (size_t)LatencyStage::COUNT> stages;
+    };
+
+private:
+    LatencyRegistry() = default;
+
+    ThreadShards<Shard> shards;
+    std::chrono::system_clock::time_point started = std::chrono::system_clock::now();
+};
+
+class ScopedLatency {
+public:
+    explicit ScopedLatency(LatencyStage s) : stage(s), start(std::chrono::steady_clock::now()) {}
+    ~ScopedLatency() {
+        auto end = std::chrono::steady_clock::now();
+        LatencyRegistry::instance().record(stage,
+            (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+        // Inside a traced decision the stage also becomes a trace span
+        if (TraceRecorder::current_id() != 0) {
+            TraceRecorder::instance().record(latency_stage_name(stage),
+                TraceRecorder::to_trace_ns(start), TraceRecorder::to_trace_ns(end));
+        }
+    }
+    ScopedLatency(const ScopedLatency&) = delete;
+    ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+private:
+    LatencyStage stage;
+    std::chrono::steady_clock::time_point start;
+};
+
+// Acquire a mutex and record how long the caller was blocked
+template<typename Mutex>
+std::unique_lock<Mutex> timed_lock(Mutex& m, LatencyStage stage) {
+    ScopedLatency wait(stage);
+    return std::unique_lock<Mutex>(m);
+}
@@ -3,13 +3,29 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <memory>
+#include <mutex>
 #include <nlohmann/json.hpp>
 #include <chrono>
 #include <deque>
 #include <cmath>
 #include <algorithm>
+#include <array>
+#include <functional>
 #include <sqlite3.h>
+#include "pattern_key.hpp"
+#include "flat_hash_map.hpp"
+#include "pattern_correlation.hpp"
+#include "trade_store.hpp"
+#include "direction_model.hpp"
+#include "online_direction_model.hpp"
+#include "clock.hpp"
+#include "trade_risk.hpp"
+#include "counterfactual.hpp"
+#include "strategy_ensemble.hpp"
+#include "change_point.hpp"
+#include "regime_engine.hpp"
 
 using json = nlohmann::json;
 using namespace std::chrono;
@@ -45,10 +61,10 @@ struct TradeRecord {
     std::string exit_reason;  // "take_profit", "stop_loss", "timeout", "manual"
     double volatility_at_entry;  // % volatility of pair
     double bid_ask_spread;       // At entry time
-    int bars_high;         // Bars since entry until peak
+    int bars_high;         // Bars since entry until peak (monitor observations, PositionPath)
     int bars_low;          // Bars since entry until trough
-    double max_profit;     // Peak unrealized profit
-    double max_loss;       // Peak unrealized loss
+    double max_profit;     // Peak unrealized profit, % of entry (MFE, >= 0)
+    double max_loss;       // Peak unrealized loss, % of entry (MAE, <= 0)
     double trend_direction; // 1.0 = up, -1.0 = down, 0.0 = neutral
     
     // NEW: Technical indicators at entry (from awesome-systematic-trading research)
@@ -61,7 +77,9 @@ struct TradeRecord {
     double order_flow_imbalance = 0.0; // Buy vs sell pressure (-1 to 1)
     double atr_pct = 0.0;            // Average True Range as % of price
     double vwap_deviation = 0.0;     // Price deviation from VWAP
-    int market_regime = 0;           // 0=consolidation, 1=uptrend, -1=downtrend
+    int market_regime = 0;           // regime_code(): -2 quiet, 0 ranging, +/-1 trending up/down, 2 volatile
+    
+    std::vector<uint8_t> price_path;  // Compressed post-entry path (position_path.hpp), empty if not recorded
     
     bool is_win() const { return pnl > 0; }
     double roi() const { return (pnl / position_size) * 100; }
@@ -100,6 +118,42 @@ struct PatternMetrics {
     std::map<std::string, double> correlations;
 };
 
+// Running per-pattern aggregates, folded in O(1) per trade by record_trade().
+// PatternMetrics are derived from these instead of re-scanning trade history.
+struct PatternAggregate {
+    PatternKey key;
+    
+    int total_trades = 0;
+    int winning_trades = 0;
+    int losing_trades = 0;
+    double total_pnl = 0;
+    double total_fees = 0;
+    double gross_wins = 0;
+    double gross_losses = 0;
+    
+    // Welford moments of per-trade ROI (%)
+    double return_mean = 0;
+    double return_m2 = 0;
+    double downside_sq_sum = 0;  // Sum of squared negative ROIs (Sortino)
+    
+    // Running peak / max drawdown of per-trade ROI
+    double return_peak = 0;
+    double max_drawdown = 0;
+    
+    void add(double pnl, double gross_pnl, double fees_paid, double roi);
+    // Combine disjoint aggregates (Chan et al. for the moments). The merged
+    // peak/drawdown is only a bound, as the interleaving order is unknown.
+    void merge(const PatternAggregate& other);
+    double return_std_dev() const { return total_trades > 0 ? std::sqrt(return_m2 / total_trades) : 0; }
+};
+
+// Running win/P&L totals for one indicator bucket (e.g. RSI "oversold")
+struct IndicatorAggregate {
+    int total_trades = 0;
+    int winning_trades = 0;
+    double total_pnl = 0;
+};
+
 struct StrategyConfig {
     std::string name;
     double min_volatility;     // Only trade if vol > this
@@ -113,22 +167,53 @@ struct StrategyConfig {
     // Adaptive parameters
     bool use_trailing_stop = true;
     double trailing_stop_pct = 0.5;
+    double trailing_start_pct = 0;  // Trailing activation, set with exits_learned
     bool use_partial_exits = true;
+    bool exits_learned = false;     // TP/SL/trailing/hold/leverage from counterfactual replay
     
     // Validation
     bool is_validated = false;
     double estimated_edge = 0;
+    PatternKey pattern;  // Source pattern for learned strategies (0 otherwise)
+    int ensemble_members = 0;  // Learned strategies blended into this one (create_ensemble_strategy)
+};
+
+class TradeWriter;
+struct PatternStatsRow;
+
+// Where the engine keeps its state. Replay runs use an isolated trades DB and
+// leave the live checkpoints, pattern file and market feed alone.
+struct LearningEngineOptions {
+    std::string trades_db_path;        // Empty: TRADES_DB env, else ../../data/trades.db
+    bool persist_models = true;        // Online direction checkpoint and pattern_database.json
+    bool ingest_market_data = true;    // perform_continuous_learning() reads market_data.db
+    // Online direction checkpoint to restore (and save, with persist_models);
+    // empty: warm start from the trade window
+    std::string online_model_path = "data/direction_model_online.json";
+    Clock* clock = &Clock::wall();     // "Recent" market data windows and the ingestion start
+    // The bot's per-pair regime filters, fed by its scans; the engine only
+    // reads them. Null: private filters fed by market data points.
+    RegimeEngine* regimes = nullptr;
+
+    static std::string default_trades_db_path();
 };
 
 class LearningEngine {
 public:
-    LearningEngine();
+    explicit LearningEngine(const LearningEngineOptions& options = {});
     ~LearningEngine();
     
-    // Add trade for analysis
-    void record_trade(const TradeRecord& trade);
+    // Add trade for analysis. In-memory state updates immediately; the DB
+    // write is queued to the trade writer, and on_durable (if given) runs on
+    // the writer thread once it has committed (true) or failed (false).
+    void record_trade(const TradeRecord& trade, std::function<void(bool)> on_durable = nullptr);
+    
+    // Block until every queued trade write has committed
+    void flush_writes();
     
-    // Analyze patterns after N trades (default 25, but robust at any count)
+    // Full offline re-analysis: rebuilds every pattern aggregate from trade
+    // history, then runs the winner/correlation/regime/indicator reports.
+    // The live path keeps aggregates current in record_trade() instead.
     void analyze_patterns();
     
     // Get best strategy based on current data
@@ -138,14 +223,24 @@ public:
     void update_strategy_database();
     
     // Statistics queries
-    PatternMetrics get_pattern_metrics(const std::string& pair, double leverage, int timeframe_bucket) const;
-    
-    // Regime detection
-    std::string detect_market_regime() const;
-    
-    // Risk assessment
-    double estimate_drawdown_risk() const;
-    double estimate_win_rate_at_confidence(double confidence_level) const;
+    PatternMetrics get_pattern_metrics(const std::string& pair, const std::string& direction,
+                                       double leverage, int timeframe_bucket) const;
+    
+    // Risk assessment: Monte Carlo bootstrap of trade ROI over the next
+    // RiskOptions::horizon trades (see trade_risk.hpp). A pattern with fewer
+    // than RISK_MIN_TRADES in the window uses every trade; no pattern means
+    // every trade. Profiles are cached until the sample grows by a quarter.
+    RiskProfile get_risk_profile(PatternKey pattern = PatternKey()) const;
+    double estimate_drawdown_risk(PatternKey pattern = PatternKey()) const;   // 95th pct max drawdown, ROI %
+    double estimate_win_rate_at_confidence(double confidence_level, PatternKey pattern = PatternKey()) const;
+    
+    // Regime shifts: streaming Page-Hinkley detectors on trade ROI, one per
+    // pattern and one over every trade (see change_point.hpp). A detected
+    // drop halves the weight (down to SHIFT_MIN_WEIGHT); it recovers by
+    // doubling every SHIFT_RECOVERY_TRADES trades without another drop, or
+    // at once on a detected rise. The result is the pattern's weight times
+    // the global weight, 1.0 when nothing has shifted.
+    double shift_weight(PatternKey pattern = PatternKey()) const;
     
     // Load/save
     void save_to_file(const std::string& filepath);
@@ -155,7 +250,10 @@ public:
     // NEW: Backup and validation
     void backup_trade_log(const std::string& filepath);
     static bool validate_trade(const TradeRecord& trade);
-    int get_trade_count() const { return trade_history.size(); }
+    // Trades the aggregates and window learn from: leveraged, as trades.db
+    // stores leverage (INTEGER). The DB loaders select the same rows.
+    static bool is_learned(const TradeRecord& trade) { return static_cast<int>(trade.leverage) > 1; }
+    int get_trade_count() const { return overall.total_trades; }
     
     // Debug/monitoring
     json get_statistics_json() const;
@@ -185,7 +283,8 @@ public:
         double vwap;
         int64_t timestamp;
         double volatility_pct;  // Calculated volatility
-        int market_regime;      // 0=consolidation, 1=uptrend, -1=downtrend
+        int market_regime;      // regime_code(): -2 quiet, 0 ranging, +/-1 trending up/down, 2 volatile
+        RegimeEstimate regime;  // The scan's regime filter, if it came from one (observations > 0)
     };
 
     // Real-time market data access
@@ -199,13 +298,20 @@ public:
     
     // Real-time volatility and regime detection
     double calculate_real_time_volatility(const std::string& pair) const;
-    int detect_real_time_regime(const std::string& pair) const;
-    // Score the direction model (logit score) if loaded
+    // Regime filter over the pair's ingested market data (regime_engine.hpp)
+    RegimeEstimate detect_real_time_regime(const std::string& pair) const;
+    // Score the direction model (logit score) if loaded; lock-free, safe
+    // from any thread while the model is hot-swapped
     double score_direction_model(const MarketDataPoint& current_data) const;
     
-    // NEW: Load real-time market data directly from SQLite database
+    // NEW: Load real-time market data directly from SQLite database. Keeps the
+    // connection open and reads only ticker_data rows past the last id seen
+    // (first call: last 5 minutes), oldest first.
     void load_market_data_from_sqlite(const std::string& db_path = "../../data/market_data.db");
     
+    // Pre-size per-pair market data maps for the active pair universe
+    void reserve_pairs(size_t pair_count);
+    
     // Continuous learning: update strategies every N seconds
     void perform_continuous_learning();
     std::chrono::seconds continuous_learning_interval = std::chrono::seconds(30);
@@ -216,24 +322,110 @@ public:
     void load_market_data_from_cache(const std::string& cache_file);
     
 private:
-    // Trade history
-    std::deque<TradeRecord> trade_history;
-    std::map<std::string, std::vector<TradeRecord>> trades_by_pair;
-    std::map<std::string, std::vector<TradeRecord>> trades_by_strategy;  // pattern key
+    // Recent trade window (columnar) and membership as row indices into it.
+    // Full-history statistics live in the aggregates below, which are
+    // persisted to pattern_stats / indicator_stats in trades.db.
+    TradeStore trades;
+    FlatHashMap<std::vector<uint32_t>> trades_by_pair;      // Pair id -> rows
+    FlatHashMap<std::vector<uint32_t>> trades_by_strategy;  // PatternKey bits -> rows
     
     // Price history for indicator calculation (per pair)
-    std::map<std::string, std::deque<double>> price_history;
-    std::map<std::string, std::deque<double>> volume_history;
+    std::unordered_map<std::string, std::deque<double>> price_history;
+    std::unordered_map<std::string, std::deque<double>> volume_history;
     static const size_t MAX_HISTORY_SIZE = 200;  // Store last 200 data points
     
     // NEW: Real-time market data cache
-    std::map<std::string, std::deque<MarketDataPoint>> real_time_market_data;
-    std::map<std::string, MarketDataPoint> latest_market_data;
+    std::unordered_map<std::string, std::deque<MarketDataPoint>> real_time_market_data;
+    std::unordered_map<std::string, MarketDataPoint> latest_market_data;
     static const size_t MAX_MARKET_DATA_SIZE = 1000;  // Store last 1000 data points per pair
     mutable std::mutex market_data_mutex;  // Thread-safe access
+    RegimeEngine own_regimes;              // Without options_.regimes: fed by append_market_point
+    RegimeEngine& market_regimes;          // options_.regimes, else own_regimes
+    // Appends if newer than the pair's latest point (caller holds market_data_mutex)
+    bool append_market_point(const MarketDataPoint& point);
+    
+    // Incremental ticker_data ingestion: persistent read-only connection,
+    // one prepared statement, id watermark (per-pair order is enforced by
+    // append_market_point's timestamp check)
+    sqlite3* market_db_ = nullptr;
+    std::string market_db_path_;
+    sqlite3_stmt* market_data_stmt = nullptr;
+    int64_t market_data_last_id = 0;
+    static const int MARKET_DATA_ROWS_PER_LOAD = 20000;  // Backlog beyond this continues next cycle
+    void close_market_db();
+    // New ticker_data rows (a capture replay serves the recorded ones)
+    std::vector<MarketDataPoint> read_market_data(const std::string& db_path);
     
     // Learned patterns
-    std::map<std::string, PatternMetrics> pattern_database;  // key = "pair_leverage_timeframe"
+    // All pattern tables are keyed by PatternKey bits (pair ids from
+    // trades.pairs); patterns_by_pair is the per-pair secondary index
+    // (pair id -> basic and enhanced keys)
+    FlatHashMap<PatternAggregate> pattern_aggregates;
+    FlatHashMap<PatternMetrics> pattern_database;  // Patterns with 5+ trades
+    FlatHashMap<std::vector<PatternKey>> patterns_by_pair;
+    PatternCorrelations pattern_correlations;  // Time-aligned win/loss correlation of edge patterns
+    PatternAggregate overall;                  // Every trade (no peak/drawdown after a reload)
+
+    // Monte Carlo risk profiles, keyed by the sample size they were built from.
+    // Paths scale with the sample (a 20-trade bootstrap gains nothing from
+    // 100k paths), so early refreshes on the trade path stay cheap.
+    static constexpr size_t RISK_MIN_TRADES = 10;
+    static constexpr uint32_t RISK_PATHS_PER_TRADE = 1000;
+    struct CachedRisk {
+        size_t sample_size = 0;
+        RiskProfile profile;
+    };
+    mutable std::mutex risk_mutex;
+    mutable FlatHashMap<CachedRisk> risk_by_pattern;   // PatternKey bits
+    mutable CachedRisk overall_risk;
+    
+    // Change-point state behind shift_weight(), updated by add_to_history()
+    static constexpr double SHIFT_MIN_WEIGHT = 0.25;
+    static constexpr uint32_t SHIFT_RECOVERY_TRADES = 20;
+    static constexpr size_t SHIFT_LOG_CAPACITY = 256;
+    struct ShiftState {
+        PageHinkley detector;
+        double weight = 1.0;
+        uint32_t trades_since_drop = 0;
+    };
+    struct ShiftEvent {
+        int64_t timestamp_ms = 0;      // Trade that raised the alarm
+        PatternKey pattern;            // Empty: the global detector
+        ChangePoint change;
+        double weight = 1.0;           // Pattern weight after the event
+    };
+    FlatHashMap<ShiftState> shift_by_pattern;   // PatternKey bits
+    ShiftState overall_shift;
+    std::deque<ShiftEvent> shift_log;           // Newest last, SHIFT_LOG_CAPACITY at most
+    uint64_t shift_events_total = 0;
+    void track_regime_shifts(PatternKey pattern, ShiftState& state, double roi, int64_t timestamp_ms);
+    void reset_regime_shifts();
+    json shift_event_json(const ShiftEvent& event) const;
+    
+    // Counterfactual winners per edge pattern (PatternKey bits)
+    struct LearnedExit {
+        std::vector<PricePath> paths;       // Trades with post-entry prices
+        float tp_pct = 0, sl_pct = 0;
+        float trailing_start_pct = ExitGrid::NO_TRAILING, trailing_stop_pct = 0;
+        int32_t hold_s = 0;
+        float leverage = 1;
+        double position_size_usd = 0;
+        ExitScore score;
+        std::vector<ExitOutcome> outcomes;  // Winner per trade, in paths order
+        std::vector<const PricePath*> path_view() const;
+    };
+    FlatHashMap<LearnedExit> learned_exits;
+    static constexpr int COUNTERFACTUAL_MIN_TRADES = 5;
+    static constexpr int32_t COUNTERFACTUAL_HORIZON_S = 3600;
+    static constexpr double SIZING_BANKROLL = 1000.0;   // Paper bankroll, as execute_trade
+    static constexpr double SIZING_KELLY_FRACTION = 0.25;
+    
+    // Indicator buckets: RSI oversold/neutral/overbought, MACD negative/positive,
+    // BB near_lower/middle/near_upper
+    static constexpr int INDICATOR_SLOTS = 8;
+    static const char* const INDICATOR_NAMES[INDICATOR_SLOTS][2];  // {indicator, bucket}
+    IndicatorAggregate indicator_aggregates[INDICATOR_SLOTS];
+    static std::array<int, 3> indicator_slots_for(double rsi, double macd_histogram, double bb_position);
     std::vector<StrategyConfig> strategy_configs;
     
     // Statistical helpers
@@ -241,9 +433,16 @@ private:
     double calculate_sharpe_ratio(const std::vector<double>& returns) const;
     double calculate_sortino_ratio(const std::vector<double>& returns) const;
     // Direction model (linear) for adaptive entry direction
-    std::map<std::string, double> direction_model_weights;
-    double direction_model_bias = 0.0;
-    bool direction_model_loaded = false;
+    DirectionModel direction_model;
+    static constexpr const char* DIRECTION_MODEL_PATH = "data/direction_model.json";
+    static DirectionFeatures direction_features_for(const MarketDataPoint& data);
+    
+    // Online FTRL direction model, shadow mode: learns per record_trade and
+    // is scored against the static model above, but never drives trading
+    OnlineDirectionModel online_direction;
+    OnlineDirectionModel::Score static_direction_score;  // Static model on the same trades
+    void init_online_direction_model();
+    void shadow_direction_models(const TradeRecord& trade);
     double calculate_max_drawdown(const std::vector<double>& returns) const;
     double calculate_confidence_score(const PatternMetrics& metrics) const;
     
@@ -259,13 +458,17 @@ private:
     double calculate_sma(const std::vector<double>& prices, int period) const;
     
     // Pattern matching
-    std::string generate_pattern_key(const std::string& pair, const std::string& direction, double leverage, int timeframe) const;
-    std::string generate_enhanced_pattern_key(const std::string& pair, const std::string& direction, 
-                                               double leverage, int timeframe, 
-                                               double volatility, int regime) const;
-    PatternMetrics get_pattern_metrics(const std::string& pattern_key) const;  // Get metrics for a specific pattern
+    std::pair<PatternKey, PatternKey> pattern_keys_for(const TradeRecord& trade);  // {basic, enhanced}
+    std::string pattern_name(PatternKey key) const { return key.to_string(trades.pairs); }
+    PatternMetrics get_pattern_metrics(PatternKey key) const;  // Get metrics for a specific pattern
+    static int timeframe_bucket_for(int timeframe_seconds);
+    void add_to_history(const TradeRecord& trade);  // Window row + pair/pattern indices + correlation bits
+    std::pair<PatternKey, PatternKey> fold_into_aggregates(const TradeRecord& trade);  // O(1), returns touched keys
+    void reset_aggregates();
+    PatternMetrics derive_pattern_metrics(const PatternAggregate& agg) const;
     void identify_winning_patterns();
     void correlate_patterns();
+    void refresh_pattern_correlations();  // Incremental: only patterns traded since last refresh
     void detect_regime_shifts();
     
     // Indicator-based pattern analysis
@@ -275,13 +478,35 @@ private:
     std::vector<double> remove_outliers(std::vector<double> values) const;
     bool is_outlier(double value, const std::vector<double>& values) const;
     
-    // Strategy optimization
+    // Strategy optimization: counterfactual replay of each edge pattern's
+    // trades over their post-entry prices (see counterfactual.hpp). Run by
+    // update_strategy_database() as exits, then leverage, then sizing.
     void optimize_position_sizing();
     void optimize_exit_targets();
     void optimize_leverage_allocation();
-    
-    // Ensemble methods
+    // Prices after a trade's entry up to horizon_s: the path recorded while
+    // the position was open, continued from the pair's market data (empty
+    // when neither covers it)
+    PricePath post_entry_path(uint32_t row, int32_t horizon_s) const;
+    
+    // Ensemble methods: bootstrap-bagged scores of each candidate's returns
+    // (see strategy_ensemble.hpp), blended by variance-aware weights. The
+    // heaviest candidate supplies pattern and leverage; exits, hold and size
+    // are weighted averages. Scores are cached per pattern until its sample
+    // changes, so only patterns that traded since the last cycle re-bag.
     StrategyConfig create_ensemble_strategy(const std::vector<StrategyConfig>& candidates) const;
+    std::vector<BaggedScore> bagged_scores(const std::vector<StrategyConfig>& candidates) const;
+    std::vector<double> strategy_returns(const StrategyConfig& config) const;   // Net % per trade, oldest first
+    void refresh_ensembles();   // ensemble_by_pair from strategy_configs
+    static constexpr size_t ENSEMBLE_MAX_SAMPLE = 512;   // Most recent returns per candidate
+    struct CachedBag {
+        size_t sample_size = 0;
+        double sample_sum = 0;
+        BaggedScore score;
+    };
+    mutable std::mutex ensemble_mutex;
+    mutable FlatHashMap<CachedBag> bagged_by_pattern;   // PatternKey bits
+    FlatHashMap<StrategyConfig> ensemble_by_pair;       // Pair id -> blended learned strategy
     
     // Configuration
     const int MIN_TRADES_FOR_ANALYSIS = 25;
@@ -293,9 +518,23 @@ private:
     sqlite3* db_ = nullptr;
     std::string db_path_;
     
+    // Startup keeps only this many recent trades in memory
+    const size_t RECENT_TRADE_WINDOW = 5000;
+    
     // SQLite helpers
     void init_database(const std::string& db_path);
-    void save_trade_to_db(const TradeRecord& trade);
-    void load_trades_from_db();
+    void load_trades_from_db();            // Aggregates + recent window
+    bool load_aggregates_from_db();        // false if tables are empty or pre-date the aggregate columns / STATS_VERSION
+    static constexpr int STATS_VERSION = 2;   // trades.db user_version: 1 = regime bits from regime_engine.hpp, 2 = is_learned() trades only
+    void rebuild_aggregates_from_db();     // Full scan of trades; rewrites both stats tables
+    void load_recent_trades_from_db(size_t limit);
+    PatternStatsRow pattern_stats_row(const PatternAggregate& agg) const;
+    void persist_all_aggregates();         // Replaces both stats tables (and stamps STATS_VERSION) via the writer, then waits
+    static TradeRecord read_trade_row(sqlite3_stmt* stmt);
     int get_db_trade_count() const;
+    
+    // Sole writer to trades.db (own connection and thread); db_ only reads
+    // once the schema is set up
+    LearningEngineOptions options_;
+    std::unique_ptr<TradeWriter> writer;
 };
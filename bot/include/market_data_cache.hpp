@@ -9,6 +9,7 @@
 #include <chrono>
 #include <sqlite3.h>
 #include "learning_engine.hpp"
+#include "regime_engine.hpp"
 
 /*
  * SHARED MARKET DATA CACHE
@@ -34,7 +35,7 @@ public:
         double vwap;
         int64_t timestamp;
         double volatility_pct;
-        int market_regime;
+        int market_regime;      // regime_code(); set from the attached regime engine on update
     };
 
     // Update market data (called by collector)
@@ -51,7 +52,11 @@ public:
 
     // Calculate real-time metrics
     double calculateVolatility(const std::string& pair, int minutes = 30) const;
-    int detectRegime(const std::string& pair, int minutes = 60) const;
+    MarketRegime detectRegime(const std::string& pair) const;   // RANGING without an engine or estimate
+
+    // The bot's per-pair regime filters (it feeds them; the cache only
+    // reads). nullptr detaches; the owner must detach before it goes away.
+    void setRegimeEngine(const RegimeEngine* engine);
 
     // Database persistence for market data
     void initDatabase(const std::string& db_path = "../../data/market_data.db");
@@ -67,6 +72,7 @@ private:
     std::map<std::string, std::deque<MarketDataPoint>> market_data_;
     std::map<std::string, MarketDataPoint> latest_data_;
     mutable std::mutex data_mutex_;
+    const RegimeEngine* regimes_ = nullptr;
 
     // Database
     sqlite3* db_ = nullptr;
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include "thread_shards.hpp"
+
+/*
+ * OPERATIONAL METRICS
+ *
+ * Counters are recorded per thread (relaxed single-writer atomics in a
+ * ThreadShards pool) and summed at scrape time. Gauges are single atomics
+ * written by whoever owns the value (run loop, trade threads). Neither path
+ * takes metrics_mutex or any lock a trading thread holds, so a scrape can
+ * never stall a scan or an open position.
+ *
+ * render_prometheus() produces the Prometheus text exposition format
+ * (counters, gauges, and the per-stage latency percentiles from
+ * LatencyRegistry as summaries) for MetricsServer's /metrics route.
+ */
+
+enum class MetricCounter : uint8_t {
+    SCANS,                    // Scan cycles
+    PAIRS_SCANNED,
+    OPPORTUNITIES,
+    // Per-filter rejections in scan_pair
+    REJECT_BLACKLIST,
+    REJECT_PAIR_WINRATE,
+    REJECT_SPREAD,
+    REJECT_VOLUME,
+    REJECT_MOMENTUM,
+    REJECT_VOLATILITY_CEILING,
+    REJECT_NO_DIRECTION,
+    REJECT_CONFIDENCE,
+    REJECT_MIN_VOLATILITY,
+    REJECT_REGIME,
+    SCAN_ERRORS,
+    PRICE_BARS_OUT_OF_ORDER,  // Scan prices older than the pair's newest bar (dropped)
+    // Trade lifecycle
+    TRADES_OPENED,
+    TRADES_CLOSED,
+    TRADES_WON,
+    TRADES_LOST,
+    EXIT_TAKE_PROFIT,
+    EXIT_STOP_LOSS,
+    EXIT_TRAILING_STOP,
+    EXIT_TIMEOUT,
+    CONFIG_RELOADS,
+    // Trade writer
+    TRADES_PERSISTED,
+    TRADE_WRITE_BATCHES,      // Group commits
+    TRADE_WRITE_ERRORS,       // Writes not committed after retries
+    // Learning engine change-point alarms
+    REGIME_SHIFTS_DOWN,
+    REGIME_SHIFTS_UP,
+    COUNT
+};
+
+enum class MetricGauge : uint8_t {
+    OPEN_POSITIONS,
+    REALIZED_PNL_USD,
+    FEES_USD,
+    WIN_RATE,
+    ACTIVE_PAIRS,
+    UNIVERSE_PAIRS,
+    SCAN_PENDING_PAIRS,       // Scan queue depth: pairs not yet scanned this cycle
+    SCAN_WORKERS,
+    PRICE_HISTORY_PAIRS,      // Bot indicator cache size
+    LEARNING_TRADES,          // Trades held by the learning engine
+    CONFIG_VERSION,
+    TRADE_WRITE_QUEUE,        // Writes waiting for the trade writer
+    COUNT
+};
+
+class MetricsRegistry {
+public:
+    static MetricsRegistry& instance();
+
+    void increment(MetricCounter counter, uint64_t n = 1) {
+        auto& c = counters.local().values[(size_t)counter];
+        c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    void set(MetricGauge gauge, double value) {
+        gauges[(size_t)gauge].store(value, std::memory_order_relaxed);
+    }
+
+    void add(MetricGauge gauge, double delta) {
+        auto& g = gauges[(size_t)gauge];
+        double current = g.load(std::memory_order_relaxed);
+        while (!g.compare_exchange_weak(current, current + delta, std::memory_order_relaxed)) {}
+    }
+
+    uint64_t counter_value(MetricCounter counter) const;
+    double gauge_value(MetricGauge gauge) const {
+        return gauges[(size_t)gauge].load(std::memory_order_relaxed);
+    }
+
+    std::string render_prometheus() const;
+
+    struct CounterShard {
+        std::array<std::atomic<uint64_t>, (size_t)MetricCounter::COUNT> values{};
+    };
+
+private:
+    MetricsRegistry() = default;
+
+    ThreadShards<CounterShard> counters;
+    std::array<std::atomic<double>, (size_t)MetricGauge::COUNT> gauges{};
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <string>
+#include <thread>
+
+/*
+ * EMBEDDED METRICS HTTP SERVER
+ *
+ * Minimal blocking HTTP/1.0 listener on 127.0.0.1 for local scrapers and
+ * debugging tools. Handles one request per connection on a single thread;
+ * route handlers must be cheap and must not take trading locks.
+ *
+ * Routes are registered before start(), e.g.
+ *   server.add_route("/metrics", [] { return MetricsServer::Response{...}; });
+ */
+
+class MetricsServer {
+public:
+    struct Response {
+        int status = 200;
+        std::string content_type = "text/plain; version=0.0.4";
+        std::string body;
+    };
+    using Handler = std::function<Response(const std::string& query)>;
+
+    explicit MetricsServer(int port);
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    void add_route(const std::string& path, Handler handler);
+    bool start();
+    void stop();
+    int port() const { return listen_port; }
+
+private:
+    int listen_port;
+    int listen_fd = -1;
+    int wake_pipe[2] = {-1, -1};
+    std::atomic<bool> running{false};
+    std::thread server_thread;
+    std::map<std::string, Handler> routes;
+
+    void serve_loop();
+    void handle_connection(int client_fd);
+};
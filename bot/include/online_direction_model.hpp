@@ -0,0 +1,109 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+struct TradeRecord;
+
+/*
+ * ONLINE DIRECTION MODEL (FTRL-PROXIMAL LOGISTIC REGRESSION)
+ *
+ * Learns P(price goes up over the trade) from the entry features recorded
+ * with every closed trade, one O(features) update per record_trade(), so it
+ * tracks the market without waiting for train_direction_model.js to rerun.
+ *
+ * Label: exit_price > entry_price (independent of the side actually taken).
+ * Features are standardized online (running mean/variance, clipped to +-5)
+ * so RSI, MACD and volume ratios share one learning rate. FTRL-Proximal
+ * (McMahan et al. 2013) gives per-coordinate adaptive rates with L1 (sparse
+ * weights) and L2 regularization.
+ *
+ * Every update is predict-then-learn, so the running log loss / accuracy
+ * are honest out-of-sample numbers (progressive validation). The engine
+ * logs them next to the static JSON model's in shadow mode; the online
+ * model does not drive trading.
+ *
+ * State (weights, FTRL accumulators, feature stats) checkpoints to JSON.
+ * Not thread-safe; owned by LearningEngine under the bot's learning mutex.
+ */
+
+enum class OnlineFeature : uint8_t {
+    BIAS,
+    VOLATILITY,
+    MARKET_REGIME,
+    RSI,
+    MACD_HISTOGRAM,
+    MACD_SIGNAL,
+    BB_POSITION,
+    VOLUME_RATIO,
+    MOMENTUM,
+    ATR_PCT,
+    TREND,
+    SPREAD,
+    ORDER_FLOW,
+    VWAP_DEVIATION,
+    COUNT
+};
+
+class OnlineDirectionModel {
+public:
+    static constexpr size_t N = (size_t)OnlineFeature::COUNT;
+    using Features = std::array<double, N>;
+
+    struct Params {
+        double alpha = 0.05;   // Learning rate scale
+        double beta = 1.0;     // Learning rate smoothing
+        double l1 = 0.5;
+        double l2 = 1.0;
+    };
+
+    // Running progressive-validation score for one model
+    struct Score {
+        uint64_t count = 0;
+        double log_loss_sum = 0;
+        uint64_t correct = 0;
+        void add(double p, bool up);
+        double log_loss() const { return count ? log_loss_sum / count : 0; }
+        double accuracy() const { return count ? (double)correct / count : 0; }
+    };
+
+    OnlineDirectionModel() = default;
+    explicit OnlineDirectionModel(Params params) : params(params) {}
+
+    // Raw (unstandardized) features of a closed trade's entry
+    static Features raw_features(const TradeRecord& trade);
+    static bool label(const TradeRecord& trade);  // exit_price > entry_price
+
+    // P(up) for raw features
+    double predict(const Features& raw) const;
+
+    // Predict, score, then learn from one trade. Returns the pre-update P(up).
+    double update(const TradeRecord& trade);
+
+    uint64_t updates() const { return online_score.count; }
+    const Score& score() const { return online_score; }
+    double weight(OnlineFeature feature) const { return weights[(size_t)feature]; }
+
+    bool save(const std::string& path) const;   // Atomic (temp file + rename)
+    bool load(const std::string& path);
+
+    static const char* feature_name(OnlineFeature feature);
+
+private:
+    Params params;
+    Features z{};         // FTRL accumulated (adjusted) gradients
+    Features n{};         // FTRL accumulated squared gradients
+    Features weights{};   // Lazily derived from z, n
+
+    // Feature standardization (Welford)
+    std::array<uint64_t, N> feature_count{};
+    Features feature_mean{};
+    Features feature_m2{};
+
+    Score online_score;
+
+    Features standardize(const Features& raw) const;
+    void observe(const Features& raw);
+    void refresh_weight(size_t i);
+};
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include "backtest.hpp"
+
+/*
+ * PARAMETER SEARCH OVER THE BACKTEST ENGINE
+ *
+ * Grid or random search over ConfigSnapshot variants (VOLATILE-regime
+ * TP/SL/hold, trailing start/stop, leverage, confidence threshold, regime
+ * flags, ...). Ticks are loaded once (TickData) and shared read-only by all
+ * workers; each config is a task on the pool that replays every pair over
+ * its walk-forward windows with simulate_series().
+ *
+ * Windows are evaluated in rungs (e.g. the first third, then two thirds,
+ * then all). After each rung a config that is dominated - a lower score on
+ * the rank objective and a higher or equal drawdown - by at least `top`
+ * other live configs cannot reach the top list on the evidence so far and
+ * is pruned (window_sharpe waits for two windows). Windows are independent,
+ * so surviving configs just continue from where they stopped; their final
+ * numbers equal a full run.
+ *
+ * Drawdown is the portfolio's: every pair's closed trades merged by exit
+ * time (EquityCurve), so pnl_per_drawdown divides total P&L by the drawdown
+ * of the same equity.
+ *
+ * Results are handed to a callback as they are decided (pruned configs after
+ * their rung, finished ones at the end) so kraken_optimizer can stream rows,
+ * and returned ranked by the chosen objective.
+ */
+
+struct ParamAxis {
+    std::string name;
+    std::vector<double> values;
+};
+
+struct ParamSpace {
+    std::vector<ParamAxis> axes;
+
+    uint64_t grid_size() const;
+    std::vector<double> point(uint64_t index) const;   // Mixed-radix decode, first axis slowest
+};
+
+// Parse "name=v1,v2,..." or "name=lo:hi:step"; false (with a message) on error
+bool parse_param_axis(const std::string& spec, ParamAxis& axis, std::string& error);
+bool is_known_param(const std::string& name);
+std::vector<std::string> known_params();
+// Apply one parameter (bools take 0/1); false for an unknown name
+bool apply_param(ConfigSnapshot& snapshot, const std::string& name, double value);
+
+enum class RankObjective { NET_PNL, PNL_PER_DRAWDOWN, WINDOW_SHARPE, WIN_RATE };
+bool parse_rank_objective(const std::string& name, RankObjective& objective);
+const char* rank_objective_name(RankObjective objective);
+
+struct OptimizerOptions {
+    BacktestOptions backtest;
+    uint64_t random_samples = 0;   // 0 = full grid
+    uint64_t seed = 1;
+    int rungs = 3;                 // Pruning checkpoints (1 = no pruning)
+    size_t top = 20;               // Dominated by this many configs -> pruned
+    int min_trades = 1;            // Fewer trades ranks below every config that traded enough
+    RankObjective rank_by = RankObjective::NET_PNL;
+};
+
+struct ConfigResult {
+    uint64_t id = 0;               // Grid index
+    std::vector<double> params;    // In ParamSpace axis order
+    BacktestStats stats;
+    std::vector<double> window_pnl;
+    int windows_evaluated = 0;
+    bool pruned = false;
+    int pruned_at_rung = -1;
+    double score = 0.0;
+
+    int positive_windows() const;
+    double window_sharpe() const;  // Mean / std-dev of per-window net P&L
+};
+
+struct OptimizerReport {
+    std::vector<ConfigResult> ranked;   // Finished configs by score, then pruned ones
+    uint64_t grid_size = 0;
+    uint64_t evaluated = 0;
+    uint64_t pruned = 0;
+    uint64_t simulated_ticks = 0;
+    double elapsed_seconds = 0.0;
+};
+
+using ResultCallback = std::function<void(const ConfigResult&)>;
+
+OptimizerReport run_optimizer(const TickData& data, const ConfigSnapshot& base, const ParamSpace& space,
+                              const OptimizerOptions& options, ThreadPool& pool,
+                              const ResultCallback& on_result = nullptr);
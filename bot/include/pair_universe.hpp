@@ -0,0 +1,108 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+/*
+ * PAIR UNIVERSE
+ *
+ * Loads the tradable USD pairs from kraken-data/ and maintains the active
+ * scan set:
+ * - usd_pairs_details.json / assetpairs.json: full USD-quoted pair list
+ * - usd_pairs_top_filtered.json: curated top crypto pairs (ranking bonus)
+ * - usd_pairs_filtered.json: stablecoin/fiat pairs (excluded - no volatility)
+ *
+ * kraken-data lists spot pairs, but KrakenAPI quotes Kraken Futures symbols,
+ * so each spot altname is scanned as its linear perpetual, PF_<altname>
+ * (SOLUSD -> PF_SOLUSD). A base already pinned as an inverse perpetual
+ * (PI_XBTUSD) is not added twice. Not every spot pair has a perpetual: a
+ * symbol that has never returned a quote after max_unresolved_observations
+ * scans is marked unresolved and leaves the active set for good (until the
+ * next load), instead of being polled forever.
+ *
+ * Pairs are ranked by a liquidity score: a static prior from the exchange
+ * metadata (margin availability, max leverage, curated list) plus an EWMA of
+ * the quote volume observed by the scanner. Pairs whose data feed is missing
+ * decay out of the active set.
+ *
+ * Hysteresis: a pair enters the active set once it ranks inside max_active,
+ * but is only dropped after ranking outside max_active + hysteresis_band for
+ * drop_after_refreshes consecutive refreshes. Pinned pairs (the high-frequency
+ * collector pairs) are always active.
+ *
+ * Cost per active pair at the default 10s scan interval:
+ *   memory  ~110 KB  LearningEngine market data (1000 pts x ~96 B) ~96 KB,
+ *                    indicator price/volume history (200 x 16 B) ~3 KB,
+ *                    bot PriceBar history (100 x 48 B) ~5 KB,
+ *                    universe entry ~0.2 KB
+ *           +190 KB  when the shared MarketDataCache is fed (2000 pts x ~96 B)
+ *   CPU     one ticker fetch, one volatility read (<= 500 rows from
+ *           price_history.db), one OHLC fetch and O(100) indicator math per
+ *           scan; ~1-3 ms of CPU, dominated by I/O wait on the scan pool.
+ * 200 active pairs therefore cost ~22 MB resident (~60 MB with the shared
+ * cache) and ~0.5 s of CPU per scan spread across the scan workers.
+ */
+
+struct UniversePair {
+    std::string symbol;         // Symbol KrakenAPI quotes, e.g. "PF_SOLUSD" or pinned "PI_XBTUSD"
+    std::string altname;        // kraken-data spot name, e.g. "SOLUSD" (empty when pinned)
+    std::string wsname;         // e.g. "SOL/USD"
+    double static_score = 0.0;  // Prior from exchange metadata
+    double volume_ewma_usd = 0.0;
+    double score = 0.0;
+    int observations = 0;
+    int missed_observations = 0;  // Consecutive scans without data
+    int refreshes_outside = 0;    // Consecutive refreshes ranked outside exit band
+    size_t rank = 0;
+    bool pinned = false;
+    bool active = false;
+    bool unresolved = false;    // Never quoted by the market API: not scanned
+};
+
+struct UniverseConfig {
+    size_t max_active = 200;            // Target active set size
+    size_t hysteresis_band = 50;        // Drop only when rank > max_active + band
+    int drop_after_refreshes = 3;       // ...for this many consecutive refreshes
+    int max_missed_observations = 6;    // Scans without data before score decays to floor
+    int max_unresolved_observations = 3; // Scans without any quote before a symbol counts as unknown
+    double volume_ewma_alpha = 0.2;     // Weight of newest volume observation
+};
+
+class PairUniverse {
+public:
+    explicit PairUniverse(UniverseConfig cfg = UniverseConfig());
+
+    // Load pair metadata from a kraken-data directory. Returns number of pairs loaded.
+    size_t load(const std::string& data_dir);
+
+    // Pairs that are always scanned (e.g. high-frequency collector pairs)
+    void pin(const std::vector<std::string>& symbols);
+
+    // Feedback from the scanner: quote volume seen and whether data was available
+    void record_observation(const std::string& symbol, double volume_usd, bool has_data);
+
+    // Re-rank and apply hysteresis. Returns the new active set (ranked).
+    std::vector<std::string> refresh();
+
+    std::vector<std::string> active_pairs() const;
+    size_t size() const;
+    size_t active_count() const;
+    json to_json(size_t top_n = 25) const;
+
+private:
+    UniverseConfig config;
+    std::vector<UniversePair> pairs;
+    std::unordered_map<std::string, size_t> index;
+    std::vector<std::string> active;
+    size_t unresolved_count = 0;
+    std::vector<std::string> newly_unresolved;   // Reported by the next refresh()
+    mutable std::mutex universe_mutex;
+
+    UniversePair& get_or_add(const std::string& symbol);
+    double compute_score(const UniversePair& p) const;
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include "pattern_key.hpp"
+#include "flat_hash_map.hpp"
+
+class ThreadPool;
+
+/*
+ * PATTERN CORRELATION MATRIX
+ *
+ * "Do these two patterns win and lose together?" is measured over time, not
+ * over trade index: each pattern keeps two bitsets over a sliding window of
+ * hourly buckets (bit set = pattern had a win / a loss in that hour). For a
+ * pair of patterns, only hours where both traded count; the phi coefficient
+ * of "won that hour" over the shared hours comes straight out of popcounts:
+ *
+ *   n = |shared|, x = |win1 & shared|, y = |win2 & shared|, a = |win1 & win2 & shared|
+ *   phi = (n*a - x*y) / sqrt(x(n-x) * y(n-y))
+ *
+ * The matrix over the tracked patterns is cached. add_trade() marks the
+ * pattern's row dirty; update() recomputes only dirty rows (two per trade,
+ * so microseconds even with thousands of patterns) and fans full rebuilds
+ * (first run, window slide, membership change) across a ThreadPool.
+ *
+ * Not thread-safe; owned by LearningEngine under the bot's learning mutex.
+ */
+
+class PatternCorrelations {
+public:
+    static constexpr int64_t BUCKET_SECONDS = 3600;
+    static constexpr size_t WINDOW_WORDS = 16;                 // 1024 hourly buckets (~6 weeks)
+    static constexpr size_t WINDOW_BUCKETS = WINDOW_WORDS * 64;
+    static constexpr int MIN_SHARED_BUCKETS = 5;
+
+    struct Entry {
+        PatternKey a;
+        PatternKey b;
+        double correlation;
+    };
+
+    void add_trade(PatternKey key, std::chrono::system_clock::time_point timestamp, bool win);
+
+    // Track exactly these patterns; recompute rows that changed since last call
+    void update(const std::vector<PatternKey>& patterns, ThreadPool& pool);
+
+    // NaN when either pattern is untracked or they share too few buckets
+    double correlation(PatternKey a, PatternKey b) const;
+
+    // Strongest |phi| >= min_abs pairs among tracked patterns, strongest first
+    std::vector<Entry> top(size_t limit, double min_abs) const;
+
+    size_t tracked() const { return members.size(); }
+    void clear();
+
+private:
+    struct Bits {
+        std::array<uint64_t, WINDOW_WORDS> wins{};
+        std::array<uint64_t, WINDOW_WORDS> losses{};
+        bool dirty = true;
+    };
+
+    FlatHashMap<Bits> bits;            // Every pattern seen, keyed by PatternKey bits
+    int64_t base_bucket = -1;          // Absolute bucket of bit 0
+
+    std::vector<PatternKey> members;   // Matrix rows/columns
+    FlatHashMap<uint32_t> row_of;      // PatternKey bits -> row + 1
+    std::vector<float> matrix;         // members.size()^2, symmetric, NaN = undefined
+
+    void slide_window(int64_t bucket);
+    static float phi(const Bits& a, const Bits& b);
+};
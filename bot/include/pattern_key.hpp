@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * PACKED PATTERN KEYS
+ *
+ * A learned pattern is identified by (pair, direction, leverage, hold-time
+ * bucket) and, for enhanced patterns, volatility bucket and regime. These
+ * pack into one 64-bit integer so pattern tables are flat integer-keyed
+ * hashes and per-pair lookups never scan or parse strings:
+ *
+ *   bits  0-31  pair id (PairRegistry, 1-based; 0 is never a valid key)
+ *   bits 32-33  direction (0 = LONG, 1 = SHORT)
+ *   bits 34-41  leverage (integer, capped at 255)
+ *   bits 42-44  timeframe bucket (0-3)
+ *   bits 45-47  volatility bucket (0-3, 7 = any -> basic pattern)
+ *   bits 48-50  regime (0-3 = Q/R/T/V as MarketRegime, 4 = unknown, 7 = any -> basic pattern)
+ *
+ * to_string() renders the legacy human-readable form for logs and
+ * pattern_database.json, e.g. "PI_XBTUSD_LONG_3x_2_V1_T".
+ */
+
+class PairRegistry {
+public:
+    // Returns the pair's id, assigning the next one on first sight
+    uint32_t intern(const std::string& pair);
+    // 0 if the pair has never been interned
+    uint32_t find(const std::string& pair) const;
+    const std::string& name(uint32_t id) const;
+    size_t size() const { return names.size(); }
+
+private:
+    std::unordered_map<std::string, uint32_t> ids;
+    std::vector<std::string> names;  // names[id - 1]
+};
+
+struct PatternKey {
+    static constexpr uint32_t ANY = 7;
+
+    uint64_t bits = 0;
+
+    PatternKey() = default;
+    explicit PatternKey(uint64_t packed) : bits(packed) {}
+
+    static PatternKey basic(uint32_t pair_id, bool is_short, double leverage, int timeframe_bucket);
+    static PatternKey enhanced(uint32_t pair_id, bool is_short, double leverage, int timeframe_bucket,
+                               int volatility_bucket, int regime_code);
+
+    uint32_t pair_id() const { return (uint32_t)(bits & 0xFFFFFFFFULL); }
+    bool is_short() const { return (bits >> 32) & 0x3; }
+    int leverage() const { return (int)((bits >> 34) & 0xFF); }
+    int timeframe_bucket() const { return (int)((bits >> 42) & 0x7); }
+    int volatility_bucket() const { return (int)((bits >> 45) & 0x7); }
+    int regime_code() const { return (int)((bits >> 48) & 0x7); }
+    bool is_enhanced() const { return volatility_bucket() != (int)ANY; }
+    const char* direction() const { return is_short() ? "SHORT" : "LONG"; }
+
+    // Same pattern without the volatility/regime refinement
+    PatternKey basic_key() const;
+
+    std::string to_string(const PairRegistry& pairs) const;
+
+    bool operator==(const PatternKey& o) const { return bits == o.bits; }
+    bool operator!=(const PatternKey& o) const { return bits != o.bits; }
+    bool operator<(const PatternKey& o) const { return bits < o.bits; }
+
+    // Volatility buckets: 0=low(<2%), 1=med(2-5%), 2=high(5-10%), 3=extreme(>10%)
+    static int volatility_bucket_for(double volatility_pct);
+    // Regime bits for a persisted regime_code() (TradeRecord::market_regime):
+    // MarketRegime order, 0=quiet, 1=ranging, 2=trending, 3=volatile; 4=unknown
+    static int regime_code_for(int market_regime);
+};
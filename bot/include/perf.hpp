@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+/*
+ * PERFORMANCE REGRESSION SUITE
+ *
+ * kraken_perf replays the sessions listed in perf/sessions.json through the
+ * real bot at max speed, one kraken_bot child process per run:
+ *
+ *   capture  a --capture log, rerun with --replay-capture (exact inputs)
+ *   ticks    a ticker_data / price_history DB, rerun with --replay
+ *
+ * Every session pins the child's working directory and, for ticks, its
+ * config file; the child's environment has BOT_ENV_OVERRIDES removed. So
+ * a run does the same work wherever kraken_perf is started from, and a
+ * baseline comparison measures the code, not the caller's setup.
+ *
+ * Each child writes a --perf-report (per-stage latency percentiles, ticks
+ * served, ticks/s, operator new count and bytes, scans and trades); the
+ * parent adds peak RSS from wait4(). A session runs `warmup` + `repeat`
+ * times and each metric keeps the median of the measured runs.
+ *
+ * Samples are compared with perf/baseline.json. A metric regresses when it
+ * is worse than baseline by more than its relative tolerance (throughput
+ * lower, everything else higher); stage latencies must also be worse by
+ * more than stage_floor_us, so microsecond noise on cheap stages does not
+ * fail the suite. Tolerances come from the baseline's "tolerances" object,
+ * then --tolerance flags.
+ *
+ * A capture session whose replay diverged (the bot now decides differently
+ * than when it was recorded) is reported and skipped, not failed: its
+ * numbers would describe a different, shorter run. Re-record it.
+ */
+
+struct PerfSession {
+    std::string name;
+    std::string capture;   // Path of a --capture log, or
+    std::string ticks;     // path of a tick DB for --replay
+    std::string config;    // bot_config.json for a ticks session (a capture carries its own)
+    std::string cwd;       // The child's working directory
+};
+
+struct PerfSample {
+    double wall_seconds = 0.0;
+    double ticks_per_second = 0.0;
+    uint64_t ticks = 0;
+    uint64_t allocations = 0;
+    uint64_t allocated_bytes = 0;
+    uint64_t peak_rss_kb = 0;
+    uint64_t scans = 0;
+    uint64_t trades = 0;
+    bool diverged = false;   // Capture replay left the recording
+    json stages = json::object();   // Stage -> {count, mean_us, p50_us, ...}
+};
+
+struct PerfTolerances {
+    double ticks_per_second = 0.25;   // Fractions of the baseline value
+    double allocations = 0.05;
+    double allocated_bytes = 0.10;
+    double peak_rss_kb = 0.20;
+    double stage = 0.50;              // Per-stage mean_us and p99_us
+    double stage_floor_us = 50.0;
+
+    // Set one tolerance by name; false for an unknown name
+    bool set(const std::string& name, double value);
+    void merge(const json& tolerances);
+    json to_json() const;
+};
+
+struct PerfCheck {
+    std::string session;
+    std::string metric;     // e.g. "allocations", "stages.SCAN_PAIR.p99_us"
+    double baseline = 0.0;
+    double measured = 0.0;
+    double limit = 0.0;     // Regression beyond this value
+    bool regression = false;
+};
+
+struct PerfRunOptions {
+    std::string bot_path;
+    std::string work_dir;   // Scratch: child logs, reports, trade DBs
+    int warmup = 1;
+    int repeat = 5;
+    bool keep_logs = false;
+};
+
+// Sessions from the manifest; relative paths resolve against its directory
+// and come back absolute
+bool load_perf_sessions(const std::string& manifest_path, std::vector<PerfSession>& sessions, std::string& error);
+
+// Run one session (warmup + repeat children), median per metric
+bool run_perf_session(const PerfSession& session, const PerfRunOptions& options,
+                      PerfSample& sample, std::string& error);
+
+json perf_sample_json(const PerfSample& sample);
+PerfSample perf_sample_from_json(const json& j);
+
+// Checks of one session's sample against its baseline entry
+std::vector<PerfCheck> compare_perf_sample(const std::string& session, const PerfSample& measured,
+                                           const PerfSample& baseline, const PerfTolerances& tolerances);
+json perf_check_json(const PerfCheck& check);
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct PricePath;
+
+/*
+ * POSITION PRICE PATHS
+ *
+ * Every open position records what its monitor loop saw: one sample per
+ * price observation, (seconds since entry, move from entry in basis
+ * points), 4 bytes each. The samples go into a fixed-size slot taken from
+ * a process-wide pool of preallocated slabs, so opening a position does
+ * not allocate; slots go back to the pool when the position closes. The
+ * pool only grows (by a slab) if more positions are open at once than it
+ * has slots.
+ *
+ * A full slot drops every other sample and from then on keeps every 2nd
+ * (then 4th, ...) observation, so any hold fits. The last observation is
+ * always kept, so the path ends at the exit price.
+ *
+ * MFE / MAE (best and worst unrealized move, % of entry, in the trade's
+ * favor) and the observation at which each was first reached are updated
+ * on every price from the unquantized value, independent of sampling.
+ *
+ * compress() packs the path for the trades table: a format byte, then per
+ * sample a varint of the elapsed delta and a zigzag varint of the move
+ * delta. A 5 s monitor interval and small moves make most samples 2 bytes,
+ * ~1.5 KB for an hour. decode_price_path() turns it back into the
+ * counterfactual replay's PricePath.
+ */
+
+struct PathSample {
+    uint16_t elapsed_s;   // Since entry, saturating
+    int16_t move_bp;      // (price / entry - 1) * 10000, clamped; not direction-adjusted
+};
+
+class PathPool {
+public:
+    static constexpr size_t SLOT_SAMPLES = 1024;   // ~85 minutes at one sample per 5 s
+    static constexpr size_t SLAB_SLOTS = 8;
+
+    static PathPool& instance();
+
+    // Never fails: grows by a slab when every slot is out
+    PathSample* acquire();
+    void release(PathSample* slot);
+
+    size_t capacity() const;   // Slots allocated
+    size_t in_use() const;
+
+private:
+    PathPool();
+    void add_slab();
+
+    mutable std::mutex mutex;
+    std::vector<std::unique_ptr<PathSample[]>> slabs;
+    std::vector<PathSample*> free_slots;
+};
+
+class PositionPath {
+public:
+    PositionPath(bool is_short, double entry_price);
+    ~PositionPath();
+
+    PositionPath(const PositionPath&) = delete;
+    PositionPath& operator=(const PositionPath&) = delete;
+
+    // Feed one price observation, elapsed seconds since entry
+    void on_price(double price, long elapsed_seconds);
+
+    double max_profit_pct() const { return mfe_pct; }   // >= 0
+    double max_loss_pct() const { return mae_pct; }     // <= 0
+    int bars_high() const { return mfe_bar; }           // Observation (1-based) of the MFE, 0 = never above entry
+    int bars_low() const { return mae_bar; }            // Observation of the MAE, 0 = never below entry
+    int observations() const { return observed; }
+
+    size_t size() const { return count + (has_tail() ? 1 : 0); }
+    std::vector<uint8_t> compress() const;   // Empty before the first observation
+
+private:
+    bool has_tail() const { return observed > 0 && (observed - 1) % stride != 0; }
+    static PathSample quantize(double price, double entry_price, long elapsed_seconds);
+
+    bool is_short;
+    double entry_price;
+    PathSample* samples;
+    size_t count = 0;
+    int stride = 1;              // Observations per kept sample
+    int observed = 0;
+    PathSample last{};           // Latest observation, kept even between strides
+    double mfe_pct = 0.0;
+    double mae_pct = 0.0;
+    int mfe_bar = 0;
+    int mae_bar = 0;
+};
+
+// False if the bytes are not a compressed path (the PricePath is then empty)
+bool decode_price_path(const uint8_t* data, size_t size, bool is_short, PricePath& out);
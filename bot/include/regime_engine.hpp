@@ -0,0 +1,112 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/*
+ * ONLINE MARKET REGIME ENGINE
+ *
+ * The one market regime classification: scan filters, trade plans,
+ * enhanced pattern keys and the learning engine's strategy adaptation all
+ * read MarketRegime from a RegimeFilter.
+ *
+ * Each pair runs a four-state Gaussian HMM forward filter over two
+ * features per observation:
+ *
+ *   log volatility   the caller's volatility % (realized_volatility_pct
+ *                    scale), else the filter's own estimate from the prices
+ *   trend strength   |EWMA of log returns| in standard errors: about 0.8
+ *                    (half-normal) when prices drift nowhere
+ *
+ *   p(s | obs) = normalize( L(obs | s) * sum_i p_prev(i) A(i, s) )
+ *
+ * O(K^2) per observation with K = 4 and no history kept. Callers get the
+ * posterior with its most likely state; the persistence of the transition
+ * matrix is the hysteresis, so one odd tick does not flip the regime.
+ *
+ * The default emissions keep the volatility boundary the old scan
+ * thresholds used: above ~0.02% is VOLATILE. Below it, QUIET under ~0.005%,
+ * otherwise RANGING or TRENDING by trend strength (crossover ~1.8 standard
+ * errors, once MIN_TREND_RETURNS returns are in).
+ */
+
+enum class MarketRegime : uint8_t { QUIET, RANGING, TRENDING, VOLATILE };
+constexpr size_t REGIME_COUNT = 4;
+
+std::string regime_to_string(MarketRegime regime);   // "QUIET", "RANGING", ...
+
+// Persisted code (TradeRecord and MarketDataPoint market_regime): -2 quiet,
+// 0 ranging, 1 / -1 trending up / down, 2 volatile
+int regime_code(MarketRegime regime, bool trend_up);
+MarketRegime regime_from_code(int code);   // Out-of-range codes: RANGING
+
+struct RegimeModel {
+    // Diagonal Gaussian, kept as the constants the filter needs (gaussian())
+    struct Emission {
+        double log_vol_mean;      // ln(volatility %)
+        double log_vol_precision; // 1 / std
+        double trend_mean;        // |trend|, standard errors
+        double trend_precision;
+        double log_vol_norm;      // -ln(std)
+        double trend_norm;
+
+        static Emission gaussian(double log_vol_mean, double log_vol_std, double trend_mean, double trend_std);
+    };
+    std::array<Emission, REGIME_COUNT> emission;
+    std::array<std::array<double, REGIME_COUNT>, REGIME_COUNT> transition;   // [from][to], rows sum to 1
+    double trend_span = 20.0;     // EWMA span of returns, observations
+
+    static const RegimeModel& defaults();
+};
+
+struct RegimeEstimate {
+    MarketRegime regime = MarketRegime::RANGING;
+    std::array<float, REGIME_COUNT> probability{};   // Posterior, indexed by MarketRegime
+    float trend = 0.0f;           // Signed trend strength, standard errors
+    uint32_t observations = 0;    // 0: nothing filtered yet
+
+    double p(MarketRegime r) const { return probability[(size_t)r]; }
+    bool trend_up() const { return trend >= 0.0f; }
+};
+
+class RegimeFilter {
+public:
+    static constexpr uint32_t MIN_TREND_RETURNS = 10;   // Volatility only before this
+
+    explicit RegimeFilter(const RegimeModel& model = RegimeModel::defaults());
+
+    // One observation. volatility_pct <= 0: estimated from the prices seen.
+    const RegimeEstimate& update(double price, double volatility_pct = 0.0);
+    const RegimeEstimate& estimate() const { return current; }
+
+private:
+    const RegimeModel* model;
+    std::array<double, REGIME_COUNT> posterior;
+    double last_price = 0.0;
+    double drift = 0.0;           // EWMA of log returns
+    double power = 0.0;           // EWMA of squared log returns
+    uint32_t returns = 0;
+    RegimeEstimate current;
+};
+
+// Per-pair filters for a stream observed from several threads. The bot owns
+// one and is its only feeder (one observation per scan); the learning engine
+// and MarketDataCache read the same estimates from it.
+class RegimeEngine {
+public:
+    explicit RegimeEngine(const RegimeModel& model = RegimeModel::defaults()) : model(model) {}
+
+    RegimeEstimate update(const std::string& pair, double price, double volatility_pct = 0.0);
+    RegimeEstimate estimate(const std::string& pair) const;   // Unseen pair: observations == 0
+    std::array<size_t, REGIME_COUNT> pair_counts() const;     // Pairs by most likely regime
+    void reserve(size_t pairs);
+
+private:
+    const RegimeModel model;      // The filters point here
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, RegimeFilter> filters;
+};
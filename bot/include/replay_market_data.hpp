@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include "kraken_api.hpp"
+#include "backtest.hpp"
+#include "clock.hpp"
+
+/*
+ * RECORDED MARKET DATA FOR REPLAY
+ *
+ * Serves the MarketDataSource calls from ticks loaded once (the backtester's
+ * TickData), as of the injected clock's time: the ticker is the last tick at
+ * or before now, volatility is the precomputed 500-tick column, candles are
+ * resampled from the ticks, and market orders fill at the latest price.
+ *
+ * With a VirtualClock this runs the real KrakenTradingBot over a recording:
+ * `kraken_bot --replay ../../data/market_data.db --speed max`.
+ */
+
+class ReplayMarketData : public MarketDataSource {
+public:
+    ReplayMarketData(TickData data, Clock& clock);
+
+    // market_data.db (ticker_data) or price_history.db (price_history)
+    static bool load(const std::string& db_path, TickData& data);
+
+    bool authenticate() override { return true; }
+    std::vector<std::string> get_trading_pairs() override;
+    json get_ticker(const std::string& pair) override;
+    double get_latest_price(const std::string& pair) override;
+    double get_volatility(const std::string& pair, int minutes = 60) override;
+    std::vector<OHLC> get_ohlc(const std::string& pair, int interval = 15) override;
+    Order place_market_order(const std::string& pair, const std::string& side,
+                             double volume, double leverage = 1.0) override;
+    bool exhausted() override;
+
+    const TickData& data() const { return data_; }
+    uint64_t orders() const { return orders_.load(std::memory_order_relaxed); }
+
+private:
+    TickData data_;
+    Clock& clock_;
+    std::atomic<uint64_t> orders_{0};
+
+    const TickSeries* find(const std::string& pair) const;
+    // Index of the last tick at or before now, -1 before the first
+    long current_index(const TickSeries& series) const;
+};
@@ -0,0 +1,350 @@
+#pragma once
+
+#include <string>
+#include <deque>
+#include <tuple>
+#include <vector>
+#include <optional>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include "bot_config.hpp"
+#include "metrics_registry.hpp"
+#include "regime_engine.hpp"
+
+using json = nlohmann::json;
+
+struct StrategyConfig;
+
+/*
+ * STRATEGY CORE
+ *
+ * The entry, sizing and exit rules of the bot, with no I/O: scan filters,
+ * the regime filter, signal scoring, TP/SL/hold planning, the fee filter,
+ * and the TP/SL/trailing-stop state machine of an open position. The
+ * regime itself comes from the caller's per-pair RegimeFilter
+ * (regime_engine.hpp).
+ *
+ * KrakenTradingBot::scan_pair / execute_trade feed these from the live API;
+ * kraken_backtest feeds them from recorded ticks. Keeping one copy of the
+ * rules means a backtest result describes the bot that actually trades.
+ * Logging, metrics and order placement stay with the callers.
+ */
+
+struct ScanResult {
+    std::string pair;
+    double current_price = 0.0;
+    double spread_pct = 0.0;
+    double volatility_pct = 0.0;
+    double momentum_pct = 0.0;
+    double volume_usd = 0.0;
+    double range_position = 0.0;
+    bool is_bullish = false;
+    bool is_bearish = false;   // NEW: Support SHORT trades
+    std::string direction = "LONG";  // NEW: "LONG" or "SHORT"
+    double signal_strength = 0.0;
+    int suggested_hold_seconds = 600;
+    double suggested_tp_pct = 1.5;
+    double suggested_sl_pct = 0.5;
+    MarketRegime regime = MarketRegime::RANGING;  // Most likely state of regime_estimate
+    RegimeEstimate regime_estimate;                // Pair's regime filter after this scan
+    bool valid = false;
+    uint64_t trace_id = 0;          // Correlation id for tick-to-trade tracing
+    uint64_t tick_ns = 0;           // When the ticker read started (trace clock)
+
+    // Technical indicators (populated from price history)
+    double rsi = 50.0;              // RSI (0-100), 50 = neutral
+    double macd_histogram = 0.0;    // MACD histogram
+    double macd_line = 0.0;         // MACD line
+    double macd_signal = 0.0;       // MACD signal line
+    double sma_20 = 0.0;            // 20-period SMA
+    double sma_50 = 0.0;            // 50-period SMA
+    double ema_12 = 0.0;            // 12-period EMA (for MACD)
+    double ema_26 = 0.0;            // 26-period EMA (for MACD)
+    double atr = 0.0;               // Average True Range
+    double atr_pct = 0.0;           // ATR as % of price
+};
+
+// TradeRecord::market_regime code for an entry signal
+int regime_code(const ScanResult& opp);
+
+// Take the regime from the pair's filter, updated with this scan
+void apply_regime(ScanResult& result, const RegimeEstimate& estimate);
+
+// Price History Buffer for calculating indicators
+struct PriceBar {
+    double open;
+    double high;
+    double low;
+    double close;
+    double volume;
+    long timestamp;
+};
+
+class TechnicalIndicators {
+public:
+    // Calculate RSI (Relative Strength Index)
+    // Uses Wilder's smoothing method (standard RSI)
+    static double calculate_rsi(const std::deque<PriceBar>& bars, int period = 14) {
+        if (bars.size() < period + 1) return 50.0;  // Not enough data
+
+        double avg_gain = 0.0, avg_loss = 0.0;
+
+        // Calculate initial average gain/loss
+        for (size_t i = bars.size() - period; i < bars.size(); i++) {
+            double change = bars[i].close - bars[i-1].close;
+            if (change > 0) avg_gain += change;
+            else avg_loss += std::abs(change);
+        }
+        avg_gain /= period;
+        avg_loss /= period;
+
+        if (avg_loss == 0) return 100.0;  // All gains
+        double rs = avg_gain / avg_loss;
+        return 100.0 - (100.0 / (1.0 + rs));
+    }
+
+    // Calculate EMA (Exponential Moving Average)
+    static double calculate_ema(const std::deque<PriceBar>& bars, int period) {
+        if (bars.size() < (size_t)period) return bars.back().close;
+
+        double multiplier = 2.0 / (period + 1.0);
+        double ema = bars[bars.size() - period].close;  // Start with SMA of first period
+
+        for (size_t i = bars.size() - period + 1; i < bars.size(); i++) {
+            ema = (bars[i].close - ema) * multiplier + ema;
+        }
+        return ema;
+    }
+
+    // Calculate SMA (Simple Moving Average)
+    static double calculate_sma(const std::deque<PriceBar>& bars, int period) {
+        if (bars.size() < (size_t)period) return bars.back().close;
+
+        double sum = 0.0;
+        for (size_t i = bars.size() - period; i < bars.size(); i++) {
+            sum += bars[i].close;
+        }
+        return sum / period;
+    }
+
+    // Calculate MACD (Moving Average Convergence Divergence)
+    // Returns: {macd_line, signal_line, histogram}
+    static std::tuple<double, double, double> calculate_macd(const std::deque<PriceBar>& bars,
+                                                              int fast = 12, int slow = 26, int signal = 9) {
+        if (bars.size() < (size_t)slow + signal) {
+            return {0.0, 0.0, 0.0};  // Not enough data
+        }
+
+        double ema_fast = calculate_ema(bars, fast);
+        double ema_slow = calculate_ema(bars, slow);
+        double macd_line = ema_fast - ema_slow;
+
+        // Calculate signal line (EMA of MACD line)
+        // This is a simplification - proper MACD needs historical MACD values
+        // For now, use the current MACD as a proxy
+        double signal_line = macd_line * 0.9;  // Simplified signal
+        double histogram = macd_line - signal_line;
+
+        return {macd_line, signal_line, histogram};
+    }
+
+    // Calculate ATR (Average True Range)
+    static double calculate_atr(const std::deque<PriceBar>& bars, int period = 14) {
+        if (bars.size() < (size_t)period + 1) return 0.0;
+
+        double atr_sum = 0.0;
+        for (size_t i = bars.size() - period; i < bars.size(); i++) {
+            double high_low = bars[i].high - bars[i].low;
+            double high_prev_close = std::abs(bars[i].high - bars[i-1].close);
+            double low_prev_close = std::abs(bars[i].low - bars[i-1].close);
+            double tr = std::max({high_low, high_prev_close, low_prev_close});
+            atr_sum += tr;
+        }
+        return atr_sum / period;
+    }
+
+    // Calculate Bollinger Band position (0 = lower band, 1 = upper band)
+    static double calculate_bb_position(const std::deque<PriceBar>& bars, int period = 20, double std_dev = 2.0) {
+        if (bars.size() < (size_t)period) return 0.5;
+
+        double sma = calculate_sma(bars, period);
+
+        // Calculate standard deviation
+        double sum_sq = 0.0;
+        for (size_t i = bars.size() - period; i < bars.size(); i++) {
+            double diff = bars[i].close - sma;
+            sum_sq += diff * diff;
+        }
+        double std = std::sqrt(sum_sq / period);
+
+        double upper_band = sma + (std_dev * std);
+        double lower_band = sma - (std_dev * std);
+
+        if (upper_band == lower_band) return 0.5;
+        return (bars.back().close - lower_band) / (upper_band - lower_band);
+    }
+};
+
+// Synthetic bars kept per pair for the indicators
+constexpr size_t MAX_PRICE_HISTORY_BARS = 100;
+
+enum class BarAppend : uint8_t {
+    APPENDED,
+    MERGED,         // Same second as the newest bar: its high/low/close updated
+    OUT_OF_ORDER    // Older than the newest bar: dropped
+};
+
+// Append a scan-time price as a bar (all OHLC = price), one bar per second
+BarAppend append_realtime_bar(std::deque<PriceBar>& history, double price, long timestamp);
+
+// Fill the indicator fields of a scan from the pair's price history
+void calculate_indicators(ScanResult& result, const std::deque<PriceBar>& history);
+
+// Ticker fields the scan reads (futures ticker JSON or a recorded tick)
+struct TickerQuote {
+    double price = 0.0;
+    double bid = 0.0;
+    double ask = 0.0;
+    double volume = 0.0;   // Base-currency volume (volumeQuote in the futures API)
+    double high = 0.0;
+    double low = 0.0;
+    double open = 0.0;
+
+    static TickerQuote from_json(const json& ticker);
+};
+
+// Volatility % from the quote's range - used when no high-frequency volatility is available
+double range_volatility_pct(const TickerQuote& quote);
+
+// Std-dev of absolute log returns over a price series, in % (KrakenAPI::get_volatility)
+double realized_volatility_pct(const double* prices, size_t count);
+
+// Trend read from the last four 15-minute candles
+struct CandleTrend {
+    double score = 0.0;
+    int bullish_candles = 0;
+    int bearish_candles = 0;
+};
+
+template <typename Candle>
+CandleTrend candle_trend(const std::vector<Candle>& ohlc, double price) {
+    CandleTrend trend;
+    if (ohlc.size() < 4) return trend;
+
+    // Check last 4 candles (1 hour of 15-min data)
+    for (size_t i = ohlc.size() - 4; i < ohlc.size(); i++) {
+        if (ohlc[i].close > ohlc[i].open) trend.bullish_candles++;
+        else if (ohlc[i].close < ohlc[i].open) trend.bearish_candles++;
+    }
+
+    // Bonus for bullish trend, penalty for bearish (but don't block)
+    if (trend.bullish_candles >= 3) trend.score = 0.15;  // Strong uptrend
+    else if (trend.bullish_candles >= 2) trend.score = 0.08;  // Moderate uptrend
+    else if (trend.bearish_candles >= 3) trend.score = -0.1;  // Penalty but allow
+
+    // Also check if price is above recent lows (support)
+    double recent_low = ohlc[ohlc.size()-1].low;
+    for (size_t i = ohlc.size() - 4; i < ohlc.size(); i++) {
+        if (ohlc[i].low < recent_low) recent_low = ohlc[i].low;
+    }
+    if (price > recent_low * 1.01) trend.score += 0.05;  // Price holding above support
+    return trend;
+}
+
+// Per-pair results learned at runtime (pair win-rate filter, blacklist, history bonus)
+struct PairTradeStats {
+    int trades = 0;
+    double win_rate = 0.5;
+    int consecutive_losses = 0;
+    bool blacklisted = false;
+
+    bool rejected_by_winrate(const BotConfig& config) const;
+    double history_bonus() const;
+    // Returns true when this trade got the pair blacklisted
+    bool record(bool is_win, const BotConfig& config);
+};
+
+// Quote-only filters: spread, volume, momentum. Fills price/spread/volume/
+// momentum/range fields; returns the rejecting filter, if any.
+std::optional<MetricCounter> screen_quote(const BotConfig& config, const TickerQuote& quote, ScanResult& result);
+
+// Volatility above which a pair is skipped as too chaotic
+double volatility_ceiling(const BotConfig& config);
+
+// Direction, scoring, confidence, suggested TP/SL/hold and the regime
+// filter. Expects screen_quote() fields, volatility_pct, indicators and the
+// regime (apply_regime) set.
+std::optional<MetricCounter> evaluate_signal(const ConfigSnapshot& snapshot, const CandleTrend& trend,
+                                             double history_bonus, ScanResult& result);
+
+// 0.4% round-trip: 0.20% maker entry + 0.20% maker exit (Gemini ActiveTrader)
+constexpr double ROUND_TRIP_FEE_RATE = 0.004;
+
+// TP/SL/hold for an entry after learned overrides, liquidation protection,
+// regime adjustments and the fee filter
+struct TradePlan {
+    double tp_pct = 0.0;
+    double sl_pct = 0.0;
+    int hold_seconds = 0;
+    double leverage = 1.0;
+    double trailing_start_pct = 0.0;     // +inf: no trailing stop
+    double trailing_stop_pct = 0.0;
+    bool sl_liquidation_floor = false;   // SL was widened to the liquidation distance
+    bool skip_quiet_regime = false;
+    double expected_fees_pct = 0.0;
+    double min_required_tp_pct = 0.0;
+    double expected_profit_pct = 0.0;
+    bool passes_fee_filter = false;
+    bool skip = false;                   // Don't enter (QUIET regime, or fee filter outside learning mode)
+};
+
+TradePlan plan_trade(const BotConfig& config, const ScanResult& opp, const StrategyConfig& learned);
+
+enum class ExitReason { NONE, TAKE_PROFIT, STOP_LOSS, TRAILING_STOP, TIMEOUT };
+
+const char* exit_reason_name(ExitReason reason);   // "take_profit", ..., "timeout"
+
+// TP / SL / trailing stop state of one open position, LONG or SHORT
+class PositionTracker {
+public:
+    PositionTracker(bool is_short, double entry_price, double tp_pct, double sl_pct,
+                    double trailing_start_pct, double trailing_stop_pct, int hold_seconds);
+
+    struct Update {
+        bool trailing_activated = false;
+        ExitReason exit = ExitReason::NONE;
+    };
+
+    // Feed one price observation, elapsed seconds since entry
+    Update on_price(double current, long elapsed_seconds);
+
+    bool short_side() const { return is_short; }
+    double entry() const { return entry_price; }
+    double tp() const { return tp_price; }
+    double sl() const { return sl_price; }
+    double best() const { return best_price; }
+
+private:
+    bool is_short;
+    double entry_price;
+    double tp_price;
+    double sl_price;
+    double trailing_start;
+    double trailing_stop_pct;
+    int hold_seconds;
+    double best_price;  // Highest for long, lowest for short
+    bool trailing_active = false;
+    double trailing_stop = 0;
+};
+
+struct TradePnl {
+    double pnl_pct = 0.0;
+    double gross_usd = 0.0;
+    double fees_usd = 0.0;
+    double net_usd = 0.0;
+    bool is_win = false;
+};
+
+TradePnl trade_pnl(bool is_short, double entry_price, double exit_price, double position_usd);
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+/*
+ * BAGGED STRATEGY EVALUATION
+ *
+ * Each candidate strategy is judged by its sample of per-trade net returns
+ * (% of notional): the counterfactual replay's outcomes when its exits were
+ * learned, otherwise the pattern's realized trades. Bootstrap replicates
+ * resample that sample with replacement; the spread of the replicate means
+ * is how far the candidate's edge can be trusted, which a point estimate
+ * (the old max of estimated_edge) ignores.
+ *
+ * Ensemble weights are mean / variance of the bagged mean over candidates
+ * with a positive bagged mean, normalized: the mean-variance optimal mix
+ * for independent strategies, so a noisy candidate with a high mean counts
+ * less than a steady one.
+ *
+ * Cost is bounded per candidate: replicates x sample size stays within
+ * max_draws (fewer replicates for large samples, never fewer than
+ * min_replicates). Candidates run as parallel tasks on the shared pool;
+ * replicate r of a candidate draws from a splitmix64 stream seeded by
+ * (seed, r), so scores do not depend on the thread count.
+ */
+
+struct BaggingOptions {
+    uint32_t max_draws = 65536;       // Per candidate
+    uint32_t min_replicates = 32;
+    uint32_t max_replicates = 256;
+    uint32_t min_sample = 5;          // Smaller samples get no weight
+};
+
+struct BaggedScore {
+    uint32_t sample_size = 0;
+    uint32_t replicates = 0;
+    double mean = 0.0;                // Mean of replicate means
+    double variance = 0.0;            // Variance of replicate means
+};
+
+// One score per sample; seeds[i] keys sample i's streams (e.g. its pattern)
+std::vector<BaggedScore> bag_sample_means(const std::vector<const std::vector<double>*>& samples,
+                                          const std::vector<uint64_t>& seeds, const BaggingOptions& options,
+                                          ThreadPool& pool);
+
+// Normalized mean / variance weights (all zero if no candidate has an edge)
+std::vector<double> ensemble_weights(const std::vector<BaggedScore>& scores, const BaggingOptions& options);
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <atomic>
+#include <type_traits>
+
+/*
+ * FIXED-SIZE WORKER POOL
+ *
+ * Replaces per-pair std::async/std::thread spawning in the scan loop. With
+ * 200+ pairs a thread-per-pair scan would create hundreds of threads every
+ * cycle; the pool keeps the thread count bounded and reuses workers.
+ *
+ * parallel_for() runs inline when called from one of the pool's own workers,
+ * so nested parallel sections can't deadlock the pool.
+ */
+
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t num_threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Queue a task and get a future for its result
+    template<typename Func>
+    auto submit(Func&& func) -> std::future<std::invoke_result_t<std::decay_t<Func>>> {
+        using Result = std::invoke_result_t<std::decay_t<Func>>;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Func>(func));
+        std::future<Result> result = task->get_future();
+        enqueue([task]() { (*task)(); });
+        return result;
+    }
+
+    // Run fn(i) for i in [0, count) across the pool and wait for completion
+    void parallel_for(size_t count, const std::function<void(size_t)>& fn);
+
+    size_t size() const { return workers.size(); }
+    size_t queue_depth() const;
+    bool in_worker_thread() const;
+
+    // Shared pool for CPU-bound analytics (sized to hardware concurrency)
+    static ThreadPool& shared();
+
+private:
+    void enqueue(std::function<void()> job);
+    void worker_loop();
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> jobs;
+    mutable std::mutex jobs_mutex;
+    std::condition_variable jobs_cv;
+    bool stopping = false;
+};
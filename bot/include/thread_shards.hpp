@@ -0,0 +1,74 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/*
+ * PER-THREAD SHARDS
+ *
+ * Gives every thread its own instance of Shard for contention-free
+ * recording (latency histograms, counters, trace rings). A thread grabs a
+ * shard on first use and hands it back to a free list when it exits, so
+ * short-lived trade threads reuse shards instead of growing memory. Shards
+ * are never freed and keep their contents, so readers see totals from
+ * threads that have already exited.
+ *
+ * Readers visit shards under the pool mutex; writers only take it once per
+ * thread (first use). Intended for process-wide registries: the thread's
+ * handle is per Shard type, so use one pool per Shard type and never
+ * destroy it (registries are leaked singletons).
+ */
+
+template<typename Shard>
+class ThreadShards {
+public:
+    Shard& local() {
+        thread_local Handle handle;
+        if (!handle.shard) {
+            handle.owner = this;
+            handle.shard = acquire();
+        }
+        return *handle.shard;
+    }
+
+    template<typename Func>
+    void for_each(Func&& fn) const {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        for (const auto& shard : shards) fn(*shard);
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        return shards.size();
+    }
+
+private:
+    struct Handle {
+        ThreadShards* owner = nullptr;
+        Shard* shard = nullptr;
+        ~Handle() {
+            if (owner && shard) owner->release(shard);
+        }
+    };
+
+    Shard* acquire() {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        if (!free_shards.empty()) {
+            Shard* shard = free_shards.back();
+            free_shards.pop_back();
+            return shard;
+        }
+        shards.push_back(std::make_unique<Shard>());
+        return shards.back().get();
+    }
+
+    void release(Shard* shard) {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        free_shards.push_back(shard);
+    }
+
+    mutable std::mutex pool_mutex;
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::vector<Shard*> free_shards;
+};
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <nlohmann/json.hpp>
+#include "thread_shards.hpp"
+
+using json = nlohmann::json;
+
+/*
+ * TICK-TO-TRADE TRACING
+ *
+ * Every scan_pair() decision gets a correlation id that travels with the
+ * ScanResult into execute_trade(). While a TraceContext is active on a
+ * thread, each ScopedLatency stage (get_ticker, get_volatility, learning
+ * mutex wait, adaptive strategy, entry order, ...) also records a span
+ * tagged with that id.
+ *
+ * Spans go into a fixed-size per-thread ring (single writer, per-slot
+ * sequence numbers so readers can copy without locking the writer). The
+ * oldest spans are overwritten; at ~100 spans/s across the scan pool a
+ * 4096-slot ring per thread holds several minutes of history.
+ *
+ * export_chrome_json() emits Chrome trace_event JSON (open in Perfetto or
+ * chrome://tracing): one "X" event per span on its thread track plus one
+ * async "decision" slice per correlation id spanning all of its spans.
+ */
+
+struct TraceEvent {
+    uint64_t correlation_id = 0;
+    uint64_t start_ns = 0;         // Since process start (steady clock)
+    uint64_t duration_ns = 0;
+    const char* name = nullptr;    // Static string (stage name)
+    char pair[24] = {0};
+};
+
+class TraceRecorder {
+public:
+    static constexpr size_t RING_CAPACITY = 4096;
+
+    static TraceRecorder& instance();
+
+    static uint64_t next_correlation_id();
+    static uint64_t now_ns();
+    static uint64_t to_trace_ns(std::chrono::steady_clock::time_point t);
+
+    // Correlation id / pair of the decision the current thread is working on (0 = none)
+    static uint64_t current_id();
+    static const char* current_pair();
+
+    void record(const char* name, uint64_t start_ns, uint64_t end_ns);
+    void record(uint64_t correlation_id, const char* pair, const char* name, uint64_t start_ns, uint64_t end_ns);
+
+    // correlation_id = 0 exports every span still in the rings
+    json export_chrome_json(uint64_t correlation_id = 0) const;
+    bool write_chrome_json(const std::string& path, uint64_t correlation_id = 0) const;
+
+    struct Slot {
+        std::atomic<uint64_t> sequence{0};  // Odd while being written
+        TraceEvent event;
+    };
+    struct Ring {
+        Ring();
+        uint32_t tid;
+        std::atomic<uint64_t> head{0};      // Total spans written
+        std::array<Slot, RING_CAPACITY> slots;
+    };
+
+private:
+    TraceRecorder() = default;
+    ThreadShards<Ring> rings;
+
+    friend class TraceContext;
+};
+
+// Binds a correlation id (and pair) to the current thread for its lifetime
+class TraceContext {
+public:
+    TraceContext(uint64_t correlation_id, const std::string& pair);
+    ~TraceContext();
+    TraceContext(const TraceContext&) = delete;
+    TraceContext& operator=(const TraceContext&) = delete;
+
+private:
+    uint64_t previous_id;
+    const char* previous_pair;
+    char pair_buf[24];
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+class ThreadPool;
+
+/*
+ * MONTE CARLO TRADE RISK
+ *
+ * Bootstrap of a trade return distribution: each simulated path draws
+ * `horizon` trades with replacement from the sample of per-trade ROI (%)
+ * and tracks its cumulative return, running peak, max drawdown and wins.
+ * Drawdowns are in the same ROI % units as PatternAggregate::max_drawdown
+ * (percent of one position's size, summed over trades).
+ *
+ * The draw for (path, step) is Philox4x32-10 of the counter (path, step/4)
+ * under the seed: a pure function, so a profile is identical for any thread
+ * count or scheduling and the live bot's decisions stay replayable. Paths
+ * run in blocks of LANES in structure-of-arrays form, so the per-step
+ * update (index, gather, add, max, max, count) is a straight loop across
+ * lanes that the compiler vectorizes; blocks spread over the shared pool.
+ * 100k paths x 100 trades is ~10M steps, a few tens of ms on one core.
+ *
+ * The win-count histogram keeps every path's result, so the win rate bound
+ * at any confidence level is exact for the simulation without rerunning.
+ */
+
+struct RiskOptions {
+    uint32_t paths = 100000;
+    uint32_t horizon = 100;          // Trades per path
+    uint64_t seed = 0x6b72616b656eULL;
+};
+
+struct RiskProfile {
+    uint32_t sample_size = 0;        // Trades resampled (0 = no profile)
+    uint32_t paths = 0;
+    uint32_t horizon = 0;
+
+    // Max drawdown over the horizon, ROI %
+    double drawdown_mean = 0.0;
+    double drawdown_p50 = 0.0;
+    double drawdown_p90 = 0.0;
+    double drawdown_p95 = 0.0;
+    double drawdown_p99 = 0.0;
+
+    // Cumulative return at the end of the horizon, ROI %
+    double return_p05 = 0.0;
+    double return_p50 = 0.0;
+
+    std::vector<uint32_t> win_histogram;   // [k] = paths with k wins, k = 0..horizon
+
+    bool empty() const { return sample_size == 0; }
+
+    // Win rate w such that a fraction `confidence` of paths won at least w
+    // of their trades (a lower bound on the next `horizon` trades' win rate)
+    double win_rate_at_confidence(double confidence) const;
+
+    json to_json() const;
+};
+
+// Resample roi_pct; an empty sample gives an empty profile
+RiskProfile simulate_trade_risk(const std::vector<double>& roi_pct, const RiskOptions& options, ThreadPool& pool);
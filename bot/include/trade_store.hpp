@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "pattern_key.hpp"
+
+struct TradeRecord;
+
+/*
+ * COLUMNAR TRADE STORE
+ *
+ * The learning engine's in-memory trade history: one contiguous array per
+ * field instead of a deque of TradeRecords (three std::strings + ~30
+ * numbers each) that was then copied again per pair and twice per pattern.
+ * Strings are coded: pair -> PairRegistry id, direction -> 0/1, exit reason
+ * -> small interned code. Per-pair and per-pattern membership elsewhere are
+ * lists of row indices into this store.
+ *
+ * ~220 bytes per trade in one copy, versus ~320 bytes x 4 copies before,
+ * plus the trade's compressed price path (~2 bytes per monitor sample) in
+ * one shared byte arena indexed by row.
+ * Aggregations (win rate, P&L, indicator buckets) are straight loops over
+ * one or two columns, which the compiler vectorizes.
+ *
+ * Rows are append-only; columns are public for scans, but only append()
+ * and clear() may change their length. Not thread-safe (owned by
+ * LearningEngine under the bot's learning mutex).
+ */
+
+class TradeStore {
+public:
+    // Pair ids survive clear(), so PatternKeys stay valid across rebuilds
+    PairRegistry pairs;
+
+    // Coded strings
+    std::vector<uint32_t> pair_id;
+    std::vector<uint8_t> is_short;          // 0 = LONG (also legacy ""), 1 = SHORT
+    std::vector<uint8_t> exit_reason;       // exit_reason_name(code)
+
+    // Numeric columns (same meaning as the TradeRecord fields)
+    std::vector<int64_t> timestamp_ms;
+    std::vector<double> entry_price;
+    std::vector<double> exit_price;
+    std::vector<double> leverage;
+    std::vector<int32_t> timeframe_seconds;
+    std::vector<double> position_size;
+    std::vector<double> pnl;
+    std::vector<double> gross_pnl;
+    std::vector<double> fees_paid;
+    std::vector<double> volatility_at_entry;
+    std::vector<double> bid_ask_spread;
+    std::vector<int32_t> bars_high;
+    std::vector<int32_t> bars_low;
+    std::vector<double> max_profit;
+    std::vector<double> max_loss;
+    std::vector<double> trend_direction;
+    std::vector<double> rsi;
+    std::vector<double> macd_histogram;
+    std::vector<double> macd_signal;
+    std::vector<double> bb_position;
+    std::vector<double> volume_ratio;
+    std::vector<double> momentum_score;
+    std::vector<double> order_flow_imbalance;
+    std::vector<double> atr_pct;
+    std::vector<double> vwap_deviation;
+    std::vector<int32_t> market_regime;
+
+    // Compressed price paths, concatenated: row i is
+    // path_bytes[path_offset[i], path_offset[i + 1]) (or to the end)
+    std::vector<uint32_t> path_offset;
+    std::vector<uint8_t> path_bytes;
+
+    size_t size() const { return pnl.size(); }
+    bool empty() const { return pnl.empty(); }
+
+    // Appends a row and returns its index
+    uint32_t append(const TradeRecord& trade);
+    // Materializes a row (allocates the string fields)
+    TradeRecord get(size_t index) const;
+
+    void reserve(size_t n);
+    void clear();
+
+    bool is_win(size_t i) const { return pnl[i] > 0; }
+    double roi(size_t i) const { return (pnl[i] / position_size[i]) * 100; }
+
+    const std::string& exit_reason_name(uint8_t code) const;
+
+    // Row i's compressed path (size 0 if none was recorded)
+    const uint8_t* path_data(size_t i) const { return path_bytes.data() + path_offset[i]; }
+    size_t path_size(size_t i) const {
+        return (i + 1 < size() ? path_offset[i + 1] : path_bytes.size()) - path_offset[i];
+    }
+
+private:
+    std::vector<std::string> exit_reason_names;  // Interned on first use
+    uint8_t exit_reason_code(const std::string& reason);
+};
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sqlite3.h>
+#include "learning_engine.hpp"
+
+/*
+ * ASYNC TRADE WRITER (GROUP COMMIT)
+ *
+ * All writes to trades.db go through one persistence thread with its own
+ * connection. record_trade() hands over a TradeWrite (the trade row plus the
+ * absolute pattern_stats / indicator_stats state it produced) and returns;
+ * the trade thread never touches disk while holding learning_mutex.
+ *
+ * The writer drains everything queued since its last commit into a single
+ * transaction (up to MAX_BATCH), so a burst of N closes costs one commit
+ * instead of N. Statements are prepared once. The DB runs in WAL mode with
+ * synchronous=NORMAL: a commit is an append to the WAL, and fsyncs happen at
+ * checkpoints, amortized over many batches.
+ *
+ * on_durable fires on the writer thread once the write's trade row has
+ * committed (true), or could not be stored (false). Under synchronous=NORMAL
+ * a committed batch survives a process crash; only an OS crash or power loss
+ * before the next checkpoint can lose it.
+ *
+ * A failed batch is retried while the error is transient (busy, locked,
+ * I/O), then re-run one write per transaction so a bad row only fails
+ * itself. A trade that is not stored - failed, or a duplicate INSERT OR
+ * IGNORE skipped - is still counted in the engine's in-memory aggregates,
+ * so its stats rows and every later one would count a trade the table does
+ * not hold. From then on the writer skips stats rows and sets
+ * user_version = 0, and the next load rebuilds pattern_stats from trades;
+ * a replace_stats write (that rebuild) clears the state.
+ *
+ * The queue is bounded (QUEUE_CAPACITY). submit() only blocks when the disk
+ * has fallen that far behind, which is preferable to dropping trades.
+ */
+
+// Absolute state for one pattern_stats row
+struct PatternStatsRow {
+    std::string pattern_key;   // PatternKey::to_string
+    PatternAggregate agg;
+    PatternMetrics metrics;    // Derived from agg (pair, win rate, sharpe, ...)
+};
+
+// Absolute state for one indicator_stats row
+struct IndicatorStatsRow {
+    const char* indicator;
+    const char* bucket;
+    IndicatorAggregate agg;
+};
+
+struct TradeWrite {
+    std::optional<TradeRecord> trade;
+    std::vector<PatternStatsRow> patterns;
+    std::vector<IndicatorStatsRow> indicators;
+    bool replace_stats = false;                  // DELETE both stats tables first (full rebuild)
+    int stats_version = -1;                      // >= 0: stamp as user_version (with replace_stats)
+    bool learned = true;                         // trade is counted in the engine's aggregates
+    std::function<void(bool)> on_durable;        // Optional; runs on the writer thread
+};
+
+class TradeWriter {
+public:
+    static constexpr size_t QUEUE_CAPACITY = 4096;
+    static constexpr size_t MAX_BATCH = 256;
+    static constexpr int MAX_ATTEMPTS = 3;          // Per transaction, transient errors only
+    static constexpr int RETRY_BACKOFF_MS = 50;     // Doubles per attempt
+
+    explicit TradeWriter(const std::string& db_path);
+    ~TradeWriter();  // Commits everything still queued
+
+    TradeWriter(const TradeWriter&) = delete;
+    TradeWriter& operator=(const TradeWriter&) = delete;
+
+    bool ok() const { return db_ != nullptr; }
+
+    void submit(TradeWrite write);
+
+    // Block until every write submitted before the call has committed
+    void flush();
+
+    size_t queue_depth() const;
+
+private:
+    void writer_loop();
+    // One transaction over batch[begin, end), retried on transient errors;
+    // on commit stored[i] says whether write i's trade row was inserted
+    bool commit_writes(std::vector<TradeWrite>& batch, size_t begin, size_t end);
+    int try_commit(std::vector<TradeWrite>& batch, size_t begin, size_t end);
+    bool apply_write(const TradeWrite& write, int64_t now_ms, bool& stale, bool& inserted);
+    void mark_stats_stale();
+    bool insert_trade(const TradeRecord& trade);
+    bool upsert_pattern_stats(const PatternStatsRow& row, int64_t now_ms);
+    bool upsert_indicator_stats(const IndicatorStatsRow& row);
+    sqlite3_stmt* prepare(const char* sql);
+
+    sqlite3* db_ = nullptr;
+    sqlite3_stmt* insert_trade_stmt = nullptr;
+    sqlite3_stmt* upsert_pattern_stmt = nullptr;
+    sqlite3_stmt* upsert_indicator_stmt = nullptr;
+    std::vector<char> stored;             // Per write of the current batch
+    bool stats_stale = false;             // Stats rows skipped until the next replace_stats
+
+    std::deque<TradeWrite> queue;
+    mutable std::mutex queue_mutex;
+    std::condition_variable queue_cv;     // Writer: work available / stopping
+    std::condition_variable space_cv;     // Producers: room in the queue
+    std::condition_variable done_cv;      // flush(): a batch committed
+    uint64_t submitted = 0;               // Writes accepted so far
+    uint64_t completed = 0;               // Writes committed or rolled back
+    bool stopping = false;
+
+    std::thread worker;
+};
@@ -0,0 +1,487 @@
+#include "backtest.hpp"
+#include "strategy_core.hpp"
+#include "learning_engine.hpp"
+#include "thread_pool.hpp"
+#include <sqlite3.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <optional>
+
+namespace {
+
+constexpr int64_t CANDLE_MS = 15LL * 60 * 1000;   // get_ohlc(pair, 15)
+constexpr size_t TREND_CANDLES = 8;
+
+// 15-minute candles resampled from ticks; the last one is still forming
+struct CandleBuilder {
+    std::vector<PriceBar> candles;
+    int64_t bucket = -1;
+
+    void add(int64_t timestamp_ms, double price) {
+        int64_t b = timestamp_ms / CANDLE_MS;
+        if (b != bucket) {
+            if (candles.size() == TREND_CANDLES) candles.erase(candles.begin());
+            candles.push_back({price, price, price, price, 0.0, (long)(b * CANDLE_MS / 1000)});
+            bucket = b;
+            return;
+        }
+        PriceBar& c = candles.back();
+        c.high = std::max(c.high, price);
+        c.low = std::min(c.low, price);
+        c.close = price;
+    }
+};
+
+struct OpenPosition {
+    PositionTracker tracker;
+    int64_t entry_ms;
+    int64_t next_poll_ms;
+    double last_price;
+    int price_updates = 0;
+};
+
+TickSeries& series_for(std::map<std::string, TickSeries>& by_pair, const std::string& pair) {
+    TickSeries& s = by_pair[pair];
+    s.pair = pair;
+    return s;
+}
+
+// Rolling std-dev of |log returns| over the last VOLATILITY_TICKS prices -
+// realized_volatility_pct() per tick in O(1) (sums kept in long double)
+void compute_volatility(TickSeries& s) {
+    size_t n = s.size();
+    s.volatility_pct.assign(n, 0.0);
+    std::vector<double> abs_returns(n, 0.0);
+    long double sum = 0, sum_sq = 0;
+    for (size_t i = 1; i < n; i++) {
+        double r = std::abs(std::log(s.last[i] / s.last[i-1]));
+        abs_returns[i] = r;
+        sum += r;
+        sum_sq += (long double)r * r;
+        // Window of VOLATILITY_TICKS prices holds VOLATILITY_TICKS - 1 returns
+        if (i >= VOLATILITY_TICKS) {
+            double old = abs_returns[i - VOLATILITY_TICKS + 1];
+            sum -= old;
+            sum_sq -= (long double)old * old;
+        }
+        size_t count = std::min(i, VOLATILITY_TICKS - 1);
+        long double mean = sum / count;
+        long double variance = sum_sq / count - mean * mean;
+        s.volatility_pct[i] = variance > 0 ? (double)std::sqrt(variance) * 100.0 : 0.0;
+    }
+}
+
+void add_series(TickData& data, std::map<std::string, TickSeries>& by_pair) {
+    for (auto& [pair, s] : by_pair) {
+        bool duplicate = std::any_of(data.series.begin(), data.series.end(),
+                                     [&pair](const TickSeries& existing) { return existing.pair == pair; });
+        if (duplicate) {
+            std::cerr << "⚠️ Backtest: " << pair << " already loaded from another source, skipping" << std::endl;
+            continue;
+        }
+        sort_by_time(s);
+        compute_volatility(s);
+        data.series.push_back(std::move(s));
+    }
+    data.finalize();
+}
+
+sqlite3* open_readonly(const std::string& db_path) {
+    sqlite3* db = nullptr;
+    if (sqlite3_open_v2(db_path.c_str(), &db, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+        std::cerr << "❌ Cannot open " << db_path << ": " << (db ? sqlite3_errmsg(db) : "out of memory") << std::endl;
+        sqlite3_close(db);
+        return nullptr;
+    }
+    return db;
+}
+
+}  // namespace
+
+void sort_by_time(TickSeries& s) {
+    if (std::is_sorted(s.timestamp_ms.begin(), s.timestamp_ms.end())) return;
+    std::vector<size_t> order(s.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = i;
+    std::stable_sort(order.begin(), order.end(),
+                     [&s](size_t a, size_t b) { return s.timestamp_ms[a] < s.timestamp_ms[b]; });
+    // Derived columns (high/low/open of price_history) may not be filled yet
+    auto permute = [&order](auto& column) {
+        if (column.empty()) return;
+        auto copy = column;
+        for (size_t i = 0; i < order.size(); i++) column[i] = copy[order[i]];
+    };
+    permute(s.timestamp_ms);
+    permute(s.last);
+    permute(s.bid);
+    permute(s.ask);
+    permute(s.volume);
+    permute(s.high);
+    permute(s.low);
+    permute(s.open);
+}
+
+size_t TickData::tick_count() const {
+    size_t n = 0;
+    for (const auto& s : series) n += s.size();
+    return n;
+}
+
+void TickData::finalize() {
+    std::sort(series.begin(), series.end(),
+              [](const TickSeries& a, const TickSeries& b) { return a.pair < b.pair; });
+    first_ms = 0;
+    last_ms = 0;
+    bool any = false;
+    for (const auto& s : series) {
+        if (s.size() == 0) continue;
+        first_ms = any ? std::min(first_ms, s.timestamp_ms.front()) : s.timestamp_ms.front();
+        last_ms = any ? std::max(last_ms, s.timestamp_ms.back()) : s.timestamp_ms.back();
+        any = true;
+    }
+}
+
+bool load_ticker_data(const std::string& db_path, TickData& data) {
+    sqlite3* db = open_readonly(db_path);
+    if (!db) return false;
+
+    const char* sql = "SELECT pair, timestamp, last, bid, ask, volume, high, low, open FROM ticker_data ORDER BY pair, timestamp";
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "❌ Cannot read ticker_data from " << db_path << ": " << sqlite3_errmsg(db) << std::endl;
+        sqlite3_close(db);
+        return false;
+    }
+
+    std::map<std::string, TickSeries> by_pair;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const unsigned char* pair = sqlite3_column_text(stmt, 0);
+        double last = sqlite3_column_double(stmt, 2);
+        if (!pair || last <= 0) continue;
+        TickSeries& s = series_for(by_pair, reinterpret_cast<const char*>(pair));
+        s.timestamp_ms.push_back(sqlite3_column_int64(stmt, 1));
+        s.last.push_back(last);
+        s.bid.push_back(sqlite3_column_double(stmt, 3));
+        s.ask.push_back(sqlite3_column_double(stmt, 4));
+        s.volume.push_back(sqlite3_column_double(stmt, 5));
+        // Missing range fields behave like the live ticker fallback (= last)
+        double high = sqlite3_column_double(stmt, 6);
+        double low = sqlite3_column_double(stmt, 7);
+        double open = sqlite3_column_double(stmt, 8);
+        s.high.push_back(high > 0 ? high : last);
+        s.low.push_back(low > 0 ? low : last);
+        s.open.push_back(open > 0 ? open : last);
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+
+    add_series(data, by_pair);
+    return true;
+}
+
+bool load_price_history(const std::string& db_path, TickData& data, int64_t range_window_ms) {
+    sqlite3* db = open_readonly(db_path);
+    if (!db) return false;
+
+    const char* sql = "SELECT pair, timestamp, price, bid, ask, volume FROM price_history ORDER BY pair, timestamp";
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "❌ Cannot read price_history from " << db_path << ": " << sqlite3_errmsg(db) << std::endl;
+        sqlite3_close(db);
+        return false;
+    }
+
+    std::map<std::string, TickSeries> by_pair;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const unsigned char* pair = sqlite3_column_text(stmt, 0);
+        double price = sqlite3_column_double(stmt, 2);
+        if (!pair || price <= 0) continue;
+        TickSeries& s = series_for(by_pair, reinterpret_cast<const char*>(pair));
+        s.timestamp_ms.push_back(sqlite3_column_int64(stmt, 1));
+        s.last.push_back(price);
+        double bid = sqlite3_column_double(stmt, 3);
+        double ask = sqlite3_column_double(stmt, 4);
+        s.bid.push_back(bid > 0 ? bid : price);
+        s.ask.push_back(ask > 0 ? ask : price);
+        s.volume.push_back(sqlite3_column_double(stmt, 5));
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+
+    // Trailing open/high/low: monotonic deques give O(1) amortized per tick
+    for (auto& [pair, s] : by_pair) {
+        sort_by_time(s);
+        size_t n = s.size();
+        s.high.resize(n);
+        s.low.resize(n);
+        s.open.resize(n);
+        std::deque<size_t> max_q, min_q;
+        size_t window_start = 0;
+        for (size_t i = 0; i < n; i++) {
+            while (s.timestamp_ms[i] - s.timestamp_ms[window_start] > range_window_ms) window_start++;
+            while (!max_q.empty() && s.last[max_q.back()] <= s.last[i]) max_q.pop_back();
+            while (!min_q.empty() && s.last[min_q.back()] >= s.last[i]) min_q.pop_back();
+            max_q.push_back(i);
+            min_q.push_back(i);
+            while (max_q.front() < window_start) max_q.pop_front();
+            while (min_q.front() < window_start) min_q.pop_front();
+            s.high[i] = s.last[max_q.front()];
+            s.low[i] = s.last[min_q.front()];
+            s.open[i] = s.last[window_start];
+        }
+    }
+
+    add_series(data, by_pair);
+    return true;
+}
+
+void EquityCurve::add(int64_t exit_ms, double net_pnl) {
+    steps.push_back({exit_ms, net_pnl});
+    equity += net_pnl;
+    peak = std::max(peak, equity);
+    drawdown = std::max(drawdown, peak - equity);
+}
+
+void EquityCurve::merge(const EquityCurve& other) {
+    if (other.steps.empty()) return;
+    std::vector<Step> merged;
+    merged.reserve(steps.size() + other.steps.size());
+    std::merge(steps.begin(), steps.end(), other.steps.begin(), other.steps.end(), std::back_inserter(merged),
+               [](const Step& a, const Step& b) { return a.exit_ms < b.exit_ms; });
+    steps = std::move(merged);
+    replay();
+}
+
+void EquityCurve::settle() {
+    settled_equity = equity;
+    settled_peak = peak;
+    settled_drawdown = drawdown;
+    steps.clear();
+    steps.shrink_to_fit();
+}
+
+void EquityCurve::replay() {
+    equity = settled_equity;
+    peak = settled_peak;
+    drawdown = settled_drawdown;
+    for (const Step& s : steps) {
+        equity += s.net_pnl;
+        peak = std::max(peak, equity);
+        drawdown = std::max(drawdown, peak - equity);
+    }
+}
+
+void BacktestStats::merge(const BacktestStats& other) {
+    ticks += other.ticks;
+    scans += other.scans;
+    opportunities += other.opportunities;
+    skipped_plans += other.skipped_plans;
+    for (size_t i = 0; i < rejects.size(); i++) rejects[i] += other.rejects[i];
+    trades += other.trades;
+    wins += other.wins;
+    gross_pnl += other.gross_pnl;
+    fees += other.fees;
+    net_pnl += other.net_pnl;
+    equity.merge(other.equity);
+    max_drawdown = equity.max_drawdown();
+    tp_exits += other.tp_exits;
+    sl_exits += other.sl_exits;
+    trailing_exits += other.trailing_exits;
+    timeout_exits += other.timeout_exits;
+    closed_at_window_end += other.closed_at_window_end;
+}
+
+BacktestStats simulate_series(const TickSeries& series, int64_t start_ms, int64_t end_ms,
+                              const ConfigSnapshot& snapshot, const BacktestOptions& options) {
+    const BotConfig& config = snapshot.bot;
+    const StrategyConfig no_learned_strategy{};
+    BacktestStats stats;
+
+    const auto& ts = series.timestamp_ms;
+    size_t begin = std::lower_bound(ts.begin(), ts.end(), start_ms - options.warmup_ms) - ts.begin();
+    size_t end = std::lower_bound(ts.begin(), ts.end(), end_ms) - ts.begin();
+    if (begin >= end) return stats;
+
+    std::deque<PriceBar> history;
+    RegimeFilter regime;
+    CandleBuilder candles;
+    PairTradeStats pair_record;
+    std::optional<OpenPosition> position;
+    int64_t next_scan_ms = 0;
+    int64_t auto_dir_cooldown_until = 0;
+    const int64_t poll_ms = (int64_t)options.poll_seconds * 1000;
+    const int64_t scan_ms = (int64_t)options.scan_seconds * 1000;
+    auto close_position = [&](int64_t exit_ms, double exit_price, ExitReason reason) {
+        OpenPosition& p = *position;
+        // Live never records a trade that saw no price update
+        if (p.price_updates > 0) {
+            TradePnl pnl = trade_pnl(p.tracker.short_side(), p.tracker.entry(), exit_price,
+                                     config.base_position_size_usd);
+            stats.trades++;
+            stats.wins += pnl.is_win;
+            stats.gross_pnl += pnl.gross_usd;
+            stats.fees += pnl.fees_usd;
+            stats.net_pnl += pnl.net_usd;
+            stats.equity.add(exit_ms, pnl.net_usd);
+            stats.max_drawdown = stats.equity.max_drawdown();
+            switch (reason) {
+                case ExitReason::TAKE_PROFIT: stats.tp_exits++; break;
+                case ExitReason::STOP_LOSS: stats.sl_exits++; break;
+                case ExitReason::TRAILING_STOP: stats.trailing_exits++; break;
+                default: stats.timeout_exits++; break;
+            }
+            pair_record.record(pnl.is_win, config);
+        }
+        position.reset();
+    };
+
+    for (size_t i = begin; i < end; i++) {
+        const int64_t now_ms = ts[i];
+        const double price = series.last[i];
+        const bool warming_up = now_ms < start_ms;
+        stats.ticks++;
+
+        // The collector keeps writing prices whether or not the bot scans
+        candles.add(now_ms, price);
+
+        if (position) {
+            if (now_ms < position->next_poll_ms) continue;
+            position->price_updates++;
+            position->last_price = price;
+            position->next_poll_ms = now_ms + poll_ms;
+            long elapsed = (long)((now_ms - position->entry_ms) / 1000);
+            PositionTracker::Update update = position->tracker.on_price(price, elapsed);
+            if (update.exit != ExitReason::NONE) close_position(now_ms, price, update.exit);
+            continue;
+        }
+
+        if (now_ms < next_scan_ms) continue;
+        next_scan_ms = now_ms + scan_ms;
+        if (!warming_up) stats.scans++;
+
+        auto reject = [&stats, warming_up](MetricCounter filter) {
+            if (!warming_up) stats.rejects[(size_t)filter]++;
+        };
+        if (config.blacklisted_pairs.count(series.pair) || pair_record.blacklisted) {
+            reject(MetricCounter::REJECT_BLACKLIST);
+            continue;
+        }
+        if (pair_record.rejected_by_winrate(config)) {
+            reject(MetricCounter::REJECT_PAIR_WINRATE);
+            continue;
+        }
+
+        ScanResult result;
+        result.pair = series.pair;
+        TickerQuote quote;
+        quote.price = price;
+        quote.bid = series.bid[i];
+        quote.ask = series.ask[i];
+        quote.volume = series.volume[i];
+        quote.high = series.high[i];
+        quote.low = series.low[i];
+        quote.open = series.open[i];
+        if (auto filter = screen_quote(config, quote, result)) {
+            reject(*filter);
+            continue;
+        }
+
+        double vol_pct = series.volatility_pct[i];
+        result.volatility_pct = vol_pct > 0.0 ? vol_pct : range_volatility_pct(quote);
+        append_realtime_bar(history, price, (long)(now_ms / 1000));
+        const RegimeEstimate& estimate = regime.update(price, result.volatility_pct);
+        if (warming_up) continue;
+
+        calculate_indicators(result, history);
+        apply_regime(result, estimate);
+        CandleTrend trend = candle_trend(candles.candles, price);
+        if (auto filter = evaluate_signal(snapshot, trend, pair_record.history_bonus(), result)) {
+            reject(*filter);
+            continue;
+        }
+        stats.opportunities++;
+
+        // Dynamic auto-direction (execute_trade): invert after a losing streak
+        bool is_short = result.direction == "SHORT";
+        if (snapshot.auto_direction && config.paper_trading &&
+            pair_record.consecutive_losses >= snapshot.auto_dir_consecutive_losses &&
+            now_ms / 1000 >= auto_dir_cooldown_until) {
+            is_short = !is_short;
+            auto_dir_cooldown_until = now_ms / 1000 + snapshot.auto_dir_cooldown_seconds;
+        }
+
+        TradePlan plan = plan_trade(config, result, no_learned_strategy);
+        if (plan.skip) {
+            stats.skipped_plans++;
+            continue;
+        }
+        position.emplace(OpenPosition{
+            PositionTracker(is_short, price, plan.tp_pct, plan.sl_pct,
+                            plan.trailing_start_pct, plan.trailing_stop_pct, plan.hold_seconds),
+            now_ms, now_ms + poll_ms, price});
+    }
+
+    if (position) {
+        stats.closed_at_window_end++;
+        close_position(ts[end - 1], position->last_price, ExitReason::TIMEOUT);
+    }
+    return stats;
+}
+
+std::vector<WindowResult> make_windows(const TickData& data, int windows) {
+    std::vector<WindowResult> out;
+    windows = std::max(1, windows);
+    int64_t span = data.last_ms + 1 - data.first_ms;
+    for (int w = 0; w < windows; w++) {
+        WindowResult window;
+        window.index = w;
+        window.start_ms = data.first_ms + span * w / windows;
+        window.end_ms = data.first_ms + span * (w + 1) / windows;
+        out.push_back(window);
+    }
+    return out;
+}
+
+BacktestReport run_walk_forward(const TickData& data, const ConfigSnapshot& snapshot,
+                                const BacktestOptions& options, ThreadPool& pool) {
+    BacktestReport report;
+    report.windows = make_windows(data, options.windows);
+    size_t windows = report.windows.size();
+
+    // One task per (window, pair); stats merge per window afterwards
+    size_t pairs = data.series.size();
+    std::vector<BacktestStats> task_stats(windows * pairs);
+    auto started = std::chrono::steady_clock::now();
+    pool.parallel_for(task_stats.size(), [&](size_t task) {
+        const WindowResult& window = report.windows[task / pairs];
+        task_stats[task] = simulate_series(data.series[task % pairs], window.start_ms, window.end_ms,
+                                           snapshot, options);
+    });
+    report.elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    for (size_t task = 0; task < task_stats.size(); task++) {
+        report.windows[task / pairs].stats.merge(task_stats[task]);
+    }
+    for (const auto& window : report.windows) report.total.merge(window.stats);
+    return report;
+}
+
+const char* reject_filter_name(MetricCounter counter) {
+    switch (counter) {
+        case MetricCounter::REJECT_BLACKLIST: return "blacklist";
+        case MetricCounter::REJECT_PAIR_WINRATE: return "pair_winrate";
+        case MetricCounter::REJECT_SPREAD: return "spread";
+        case MetricCounter::REJECT_VOLUME: return "volume";
+        case MetricCounter::REJECT_MOMENTUM: return "momentum";
+        case MetricCounter::REJECT_VOLATILITY_CEILING: return "volatility_ceiling";
+        case MetricCounter::REJECT_NO_DIRECTION: return "no_direction";
+        case MetricCounter::REJECT_CONFIDENCE: return "confidence";
+        case MetricCounter::REJECT_MIN_VOLATILITY: return "min_volatility";
+        case MetricCounter::REJECT_REGIME: return "regime";
+        default: return nullptr;
+    }
+}
@@ -0,0 +1,164 @@
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <string>
+#include <ctime>
+#include "backtest.hpp"
+#include "bot_config.hpp"
+#include "thread_pool.hpp"
+
+/*
+ * kraken_backtest - walk-forward backtest of the live strategy over recorded
+ * ticks (see backtest.hpp). Runs from bot/build/ like kraken_bot.
+ *
+ *   kraken_backtest [--market-db PATH] [--prices-db PATH] [--source both|market|prices]
+ *                   [--config PATH] [--set field=value ...]
+ *                   [--windows N] [--warmup-minutes M] [--poll-seconds S]
+ *                   [--scan-seconds S] [--threads N] [--json]
+ */
+
+static std::string format_time(int64_t ms) {
+    std::time_t t = ms / 1000;
+    char buf[32];
+    std::strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", std::gmtime(&t));
+    return buf;
+}
+
+static json stats_json(const BacktestStats& s) {
+    json out = {
+        {"ticks", s.ticks},
+        {"scans", s.scans},
+        {"opportunities", s.opportunities},
+        {"skipped_plans", s.skipped_plans},
+        {"trades", s.trades},
+        {"wins", s.wins},
+        {"win_rate", s.win_rate()},
+        {"gross_pnl", s.gross_pnl},
+        {"fees", s.fees},
+        {"net_pnl", s.net_pnl},
+        {"max_drawdown", s.max_drawdown},
+        {"exits", {{"take_profit", s.tp_exits}, {"stop_loss", s.sl_exits},
+                   {"trailing_stop", s.trailing_exits}, {"timeout", s.timeout_exits},
+                   {"window_end", s.closed_at_window_end}}}
+    };
+    json rejects = json::object();
+    for (size_t i = 0; i < s.rejects.size(); i++) {
+        const char* name = reject_filter_name((MetricCounter)i);
+        if (name && s.rejects[i]) rejects[name] = s.rejects[i];
+    }
+    out["rejects"] = rejects;
+    return out;
+}
+
+int main(int argc, char* argv[]) {
+    std::string market_db = "../../data/market_data.db";
+    std::string prices_db = "../../data/price_history.db";
+    std::string source = "both";
+    std::string config_path = "../../config/bot_config.json";
+    json cli_overrides = json::object();
+    BacktestOptions options;
+    size_t threads = 0;
+    bool as_json = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--market-db" && i+1 < argc) market_db = argv[++i];
+        else if (arg == "--prices-db" && i+1 < argc) prices_db = argv[++i];
+        else if (arg == "--source" && i+1 < argc) source = argv[++i];
+        else if (arg == "--config" && i+1 < argc) config_path = argv[++i];
+        else if (arg == "--windows" && i+1 < argc) options.windows = std::stoi(argv[++i]);
+        else if (arg == "--warmup-minutes" && i+1 < argc) options.warmup_ms = std::stoll(argv[++i]) * 60 * 1000;
+        else if (arg == "--poll-seconds" && i+1 < argc) options.poll_seconds = std::stoi(argv[++i]);
+        else if (arg == "--scan-seconds" && i+1 < argc) options.scan_seconds = std::stoi(argv[++i]);
+        else if (arg == "--threads" && i+1 < argc) threads = std::stoul(argv[++i]);
+        else if (arg == "--json") as_json = true;
+        else if (arg == "--set" && i+1 < argc) {
+            // field=value; value parsed as JSON when possible (numbers, bools), else string
+            std::string kv = argv[++i];
+            size_t eq = kv.find('=');
+            if (eq == std::string::npos) {
+                std::cerr << "❌ --set expects field=value, got " << kv << std::endl;
+                return 2;
+            }
+            std::string value = kv.substr(eq + 1);
+            json parsed = json::parse(value, nullptr, false);
+            cli_overrides[kv.substr(0, eq)] = parsed.is_discarded() ? json(value) : parsed;
+        } else {
+            std::cerr << "❌ Unknown argument: " << arg << std::endl;
+            return 2;
+        }
+    }
+
+    auto snapshot = ConfigStore::build(config_path, cli_overrides);
+    if (!snapshot) {
+        std::cerr << "❌ Could not build config from " << config_path << std::endl;
+        return 1;
+    }
+
+    TickData data;
+    bool loaded = false;
+    if (source == "both" || source == "market") loaded |= load_ticker_data(market_db, data);
+    if (source == "both" || source == "prices") loaded |= load_price_history(prices_db, data);
+    if (!loaded || data.tick_count() == 0) {
+        std::cerr << "❌ No ticks loaded" << std::endl;
+        return 1;
+    }
+
+    std::unique_ptr<ThreadPool> own_pool;
+    if (threads > 0) own_pool = std::make_unique<ThreadPool>(threads);
+    ThreadPool& pool = own_pool ? *own_pool : ThreadPool::shared();
+
+    BacktestReport report = run_walk_forward(data, *snapshot, options, pool);
+
+    if (as_json) {
+        json out;
+        out["pairs"] = data.series.size();
+        out["ticks_loaded"] = data.tick_count();
+        out["start"] = data.first_ms;
+        out["end"] = data.last_ms;
+        out["threads"] = pool.size();
+        out["elapsed_seconds"] = report.elapsed_seconds;
+        out["ticks_per_second"] = report.ticks_per_second();
+        out["total"] = stats_json(report.total);
+        for (const auto& w : report.windows) {
+            json jw = stats_json(w.stats);
+            jw["index"] = w.index;
+            jw["start"] = w.start_ms;
+            jw["end"] = w.end_ms;
+            out["windows"].push_back(jw);
+        }
+        std::cout << out.dump(2) << std::endl;
+        return 0;
+    }
+
+    std::cout << "📼 Backtest: " << data.series.size() << " pairs, " << data.tick_count() << " ticks, "
+              << format_time(data.first_ms) << " -> " << format_time(data.last_ms) << " UTC" << std::endl;
+    std::cout << std::string(78, '-') << std::endl;
+    std::cout << std::left << std::setw(4) << "#" << std::setw(21) << "Window start" << std::right
+              << std::setw(9) << "Ticks" << std::setw(8) << "Opps" << std::setw(8) << "Trades"
+              << std::setw(8) << "WR%" << std::setw(11) << "Net P&L" << std::setw(9) << "MaxDD" << std::endl;
+    auto row = [](const std::string& label, const std::string& start, const BacktestStats& s) {
+        std::cout << std::left << std::setw(4) << label << std::setw(21) << start << std::right
+                  << std::setw(9) << s.ticks << std::setw(8) << s.opportunities << std::setw(8) << s.trades
+                  << std::setw(8) << std::fixed << std::setprecision(1) << s.win_rate() * 100
+                  << std::setw(11) << std::setprecision(2) << s.net_pnl
+                  << std::setw(9) << s.max_drawdown << std::endl;
+    };
+    for (const auto& w : report.windows) row(std::to_string(w.index), format_time(w.start_ms), w.stats);
+    std::cout << std::string(78, '-') << std::endl;
+    row("all", "", report.total);
+
+    const BacktestStats& t = report.total;
+    std::cout << "  Exits: TP:" << t.tp_exits << " SL:" << t.sl_exits << " Trail:" << t.trailing_exits
+              << " TO:" << t.timeout_exits << " (window end: " << t.closed_at_window_end << ")" << std::endl;
+    std::cout << "  Rejects:";
+    for (size_t i = 0; i < t.rejects.size(); i++) {
+        const char* name = reject_filter_name((MetricCounter)i);
+        if (name && t.rejects[i]) std::cout << " " << name << "=" << t.rejects[i];
+    }
+    std::cout << " | plan skipped=" << t.skipped_plans << std::endl;
+    std::cout << "  ⚡ " << std::setprecision(0) << report.ticks_per_second() << " ticks/s ("
+              << t.ticks << " ticks in " << std::setprecision(3) << report.elapsed_seconds * 1000 << "ms on "
+              << pool.size() << " threads)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,345 @@
+#include "bot_config.hpp"
+#include "metrics_registry.hpp"
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+#include <chrono>
+#include <cstdlib>
+#include <unistd.h>
+#include <poll.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+namespace {
+
+std::optional<double> env_double(const char* name) {
+    const char* env = std::getenv(name);
+    if (!env || !*env) return std::nullopt;
+    try {
+        return std::stod(env);
+    } catch (...) {
+        std::cerr << "⚠️ Ignoring invalid " << name << "=" << env << std::endl;
+        return std::nullopt;
+    }
+}
+
+std::optional<int> env_int(const char* name) {
+    const char* env = std::getenv(name);
+    if (!env || !*env) return std::nullopt;
+    try {
+        return std::stoi(env);
+    } catch (...) {
+        std::cerr << "⚠️ Ignoring invalid " << name << "=" << env << std::endl;
+        return std::nullopt;
+    }
+}
+
+// Positive values override the default, zero/missing keeps it (same rule as the
+// old hand-rolled parser)
+template<typename T>
+void set_if_positive(const json& section, const char* key, T& field) {
+    if (!section.is_object() || !section.contains(key) || !section[key].is_number()) return;
+    T value = section[key].get<T>();
+    if (value > 0) field = value;
+}
+
+std::filesystem::file_time_type config_mtime(const std::string& path) {
+    std::error_code ec;
+    auto t = std::filesystem::last_write_time(path, ec);
+    return ec ? std::filesystem::file_time_type::min() : t;
+}
+
+const int POLL_INTERVAL_MS = 2000;     // mtime fallback / watcher shutdown latency
+const int RELOAD_DEBOUNCE_MS = 200;    // Editors emit several events per save
+
+}  // namespace
+
+ConfigStore::ConfigStore(std::string path, json overrides)
+    : config_path(std::move(path)), cli_overrides(std::move(overrides)) {
+    auto initial = std::make_shared<ConfigSnapshot>();
+    apply_environment(*initial);
+    initial->source_path = config_path;
+    publish(std::move(initial));
+}
+
+ConfigStore::~ConfigStore() {
+    stop_watching();
+}
+
+ConfigSnapshotPtr ConfigStore::current() const {
+#if defined(__cpp_lib_atomic_shared_ptr)
+    return snapshot.load(std::memory_order_acquire);
+#else
+    return std::atomic_load_explicit(&snapshot, std::memory_order_acquire);
+#endif
+}
+
+void ConfigStore::publish(ConfigSnapshotPtr next) {
+#if defined(__cpp_lib_atomic_shared_ptr)
+    snapshot.store(std::move(next), std::memory_order_release);
+#else
+    std::atomic_store_explicit(&snapshot, std::move(next), std::memory_order_release);
+#endif
+}
+
+void ConfigStore::apply_file_json(BotConfig& config, const json& file_json) {
+    if (!file_json.is_object()) return;
+
+    const json learning = file_json.value("learning", json::object());
+    if (learning.contains("learning_mode") && learning["learning_mode"].is_boolean()) {
+        config.learning_mode = learning["learning_mode"].get<bool>();
+    }
+    set_if_positive(learning, "edge_filter_min_trades", config.edge_filter_min_trades);
+    set_if_positive(learning, "edge_filter_min_winrate", config.edge_filter_min_winrate);
+
+    // Risk management parameters
+    const json risk = file_json.value("risk_management", json::object());
+    set_if_positive(risk, "take_profit_pct", config.take_profit_pct);
+    set_if_positive(risk, "stop_loss_pct", config.stop_loss_pct);
+    set_if_positive(risk, "leverage", config.leverage);
+    set_if_positive(risk, "trailing_start_pct", config.trailing_start_pct);
+    set_if_positive(risk, "trailing_stop_pct", config.trailing_stop_pct);
+    set_if_positive(risk, "max_drawdown_pct", config.max_drawdown_pct);
+    set_if_positive(risk, "volatile_take_profit_pct", config.volatile_take_profit_pct);
+    set_if_positive(risk, "volatile_stop_loss_pct", config.volatile_stop_loss_pct);
+    set_if_positive(risk, "volatile_hold_seconds", config.volatile_hold_seconds);
+
+    // Pair universe sizing
+    const json universe = file_json.value("universe", json::object());
+    set_if_positive(universe, "max_active_pairs", config.universe_max_active);
+    set_if_positive(universe, "hysteresis_band", config.universe_hysteresis);
+    set_if_positive(universe, "refresh_seconds", config.universe_refresh_seconds);
+    set_if_positive(universe, "scan_workers", config.scan_workers);
+
+    const json metrics = file_json.value("metrics", json::object());
+    if (metrics.contains("port") && metrics["port"].is_number_integer()) {
+        config.metrics_port = metrics["port"].get<int>();
+    }
+
+    // Format: "blacklisted_pairs": ["BONKUSD", "ADAUSD", ...]
+    if (file_json.contains("blacklisted_pairs") && file_json["blacklisted_pairs"].is_array()) {
+        for (const auto& p : file_json["blacklisted_pairs"]) {
+            if (p.is_string() && !p.get<std::string>().empty()) {
+                config.blacklisted_pairs.insert(p.get<std::string>());
+            }
+        }
+    }
+}
+
+void ConfigStore::apply_overrides(BotConfig& config, const json& overrides) {
+    if (!overrides.is_object()) return;
+    for (const auto& [key, value] : overrides.items()) {
+        if (key == "paper_trading") config.paper_trading = value.get<bool>();
+        else if (key == "learning_mode") config.learning_mode = value.get<bool>();
+        else if (key == "base_position_size_usd") config.base_position_size_usd = value.get<double>();
+        else if (key == "take_profit_pct") config.take_profit_pct = value.get<double>();
+        else if (key == "stop_loss_pct") config.stop_loss_pct = value.get<double>();
+        else if (key == "min_hold_seconds") config.min_hold_seconds = value.get<int>();
+        else if (key == "max_hold_seconds") config.max_hold_seconds = value.get<int>();
+        else if (key == "max_concurrent_trades") config.max_concurrent_trades = value.get<int>();
+        else if (key == "universe_max_active") config.universe_max_active = value.get<int>();
+        else if (key == "scan_workers") config.scan_workers = value.get<int>();
+        else if (key == "metrics_port") config.metrics_port = value.get<int>();
+        // Strategy knobs (kraken_backtest --set)
+        else if (key == "default_hold_seconds") config.default_hold_seconds = value.get<int>();
+        else if (key == "leverage") config.leverage = value.get<double>();
+        else if (key == "trailing_start_pct") config.trailing_start_pct = value.get<double>();
+        else if (key == "trailing_stop_pct") config.trailing_stop_pct = value.get<double>();
+        else if (key == "max_drawdown_pct") config.max_drawdown_pct = value.get<double>();
+        else if (key == "max_spread_pct") config.max_spread_pct = value.get<double>();
+        else if (key == "min_momentum_pct") config.min_momentum_pct = value.get<double>();
+        else if (key == "min_volume_usd") config.min_volume_usd = value.get<double>();
+        else if (key == "min_pair_winrate") config.min_pair_winrate = value.get<double>();
+        else if (key == "regime_filter_enabled") config.regime_filter_enabled = value.get<bool>();
+        else if (key == "allow_volatile_regime") config.allow_volatile_regime = value.get<bool>();
+        else if (key == "allow_trending_regime") config.allow_trending_regime = value.get<bool>();
+        else if (key == "allow_ranging_regime") config.allow_ranging_regime = value.get<bool>();
+        else if (key == "allow_quiet_regime") config.allow_quiet_regime = value.get<bool>();
+        else if (key == "volatile_take_profit_pct") config.volatile_take_profit_pct = value.get<double>();
+        else if (key == "volatile_stop_loss_pct") config.volatile_stop_loss_pct = value.get<double>();
+        else if (key == "volatile_hold_seconds") config.volatile_hold_seconds = value.get<int>();
+        else std::cerr << "⚠️ Unknown config override: " << key << std::endl;
+    }
+}
+
+void ConfigStore::apply_environment(ConfigSnapshot& snapshot) {
+    // Paper-mode experiment knobs - read once per snapshot, never per scan
+    if (auto v = env_double("PAPER_MIN_CONFIDENCE")) {
+        snapshot.min_confidence_threshold = std::max(0.0, std::min(1.0, *v));
+    }
+    snapshot.tp_multiplier = env_double("TP_MULTIPLIER_OVERRIDE");
+    snapshot.sl_multiplier = env_double("SL_MULTIPLIER_OVERRIDE");
+    snapshot.min_volatility_gate_pct = env_double("MIN_VOLATILITY_PCT");
+    if (auto v = env_double("KELLY_FRACTION_OVERRIDE")) {
+        snapshot.kelly_fraction = std::max(0.0, std::min(1.0, *v));
+    }
+
+    const char* auto_dir = std::getenv("AUTO_DIRECTION");
+    snapshot.auto_direction = auto_dir && std::string(auto_dir) == "1";
+    if (auto v = env_int("AUTO_DIR_CONSECUTIVE_LOSSES")) snapshot.auto_dir_consecutive_losses = *v;
+    if (auto v = env_int("AUTO_DIR_COOLDOWN")) snapshot.auto_dir_cooldown_seconds = *v;
+
+    if (auto v = env_double("LEVERAGE_OVERRIDE")) snapshot.bot.leverage = std::max(1.0, *v);
+    const char* data_dir = std::getenv("KRAKEN_DATA_DIR");
+    if (data_dir && *data_dir) snapshot.bot.universe_data_dir = data_dir;
+}
+
+std::optional<ConfigSnapshot> ConfigStore::build(const std::string& path, const json& overrides) {
+    ConfigSnapshot snapshot;
+    snapshot.source_path = path;
+
+    std::ifstream config_file(path);
+    if (config_file.is_open()) {
+        try {
+            json file_json;
+            config_file >> file_json;
+            apply_file_json(snapshot.bot, file_json);
+            snapshot.loaded_from_file = true;
+        } catch (const std::exception& e) {
+            std::cerr << "❌ Error parsing config " << path << ": " << e.what() << std::endl;
+            return std::nullopt;
+        }
+    }
+
+    apply_environment(snapshot);
+    try {
+        apply_overrides(snapshot.bot, overrides);
+    } catch (const std::exception& e) {
+        std::cerr << "❌ Invalid config override: " << e.what() << std::endl;
+        return std::nullopt;
+    }
+    return snapshot;
+}
+
+bool ConfigStore::reload() {
+    std::lock_guard<std::mutex> lock(reload_mutex);
+    auto built = build(config_path, cli_overrides);
+    if (!built) {
+        auto active = current();
+        std::cerr << "⚠️ Keeping config v" << (active ? active->version : 0) << std::endl;
+        return false;
+    }
+    built->version = next_version++;
+    publish(std::make_shared<const ConfigSnapshot>(std::move(*built)));
+    return true;
+}
+
+void ConfigStore::print_summary(const ConfigSnapshot& snapshot) {
+    const BotConfig& config = snapshot.bot;
+    if (snapshot.loaded_from_file) {
+        std::cout << "Loaded config from " << snapshot.source_path << " (v" << snapshot.version << ")" << std::endl;
+    } else {
+        std::cout << "No config file found at " << snapshot.source_path << ", using defaults" << std::endl;
+    }
+    std::cout << "  learning_mode: " << (config.learning_mode ? "true" : "false") << std::endl;
+    std::cout << "  edge_filter_min_trades: " << config.edge_filter_min_trades << std::endl;
+    std::cout << "  edge_filter_min_winrate: " << config.edge_filter_min_winrate << std::endl;
+    std::cout << "  take_profit_pct: " << config.take_profit_pct << "%" << std::endl;
+    std::cout << "  stop_loss_pct: " << config.stop_loss_pct << "%" << std::endl;
+    std::cout << "  leverage: " << config.leverage << "x" << std::endl;
+    std::cout << "  trailing_start_pct: " << config.trailing_start_pct << "%" << std::endl;
+    std::cout << "  trailing_stop_pct: " << config.trailing_stop_pct << "%" << std::endl;
+    std::cout << "  max_drawdown_pct: " << config.max_drawdown_pct << "% of bankroll (p95)" << std::endl;
+    std::cout << "  universe: " << config.universe_max_active << " active pairs (+"
+              << config.universe_hysteresis << " hysteresis), " << config.scan_workers << " scan workers" << std::endl;
+    std::cout << "  regime_filter: VOLATILE only (RANGING/TRENDING blocked)" << std::endl;
+    if (!config.blacklisted_pairs.empty()) {
+        std::cout << "  blacklisted_pairs: " << config.blacklisted_pairs.size() << " pairs (";
+        int count = 0;
+        for (const auto& p : config.blacklisted_pairs) {
+            if (count++ > 0) std::cout << ", ";
+            std::cout << p;
+            if (count >= 5) { std::cout << "..."; break; }
+        }
+        std::cout << ")" << std::endl;
+    }
+    std::cout << "  min_confidence: " << snapshot.min_confidence_threshold
+              << (snapshot.auto_direction ? " | AUTO_DIRECTION on" : "") << std::endl;
+}
+
+void ConfigStore::start_watching() {
+    if (watching.exchange(true)) return;
+    if (pipe(wake_pipe) != 0) {
+        std::cerr << "⚠️ Config watcher disabled (pipe failed)" << std::endl;
+        wake_pipe[0] = wake_pipe[1] = -1;
+        watching = false;
+        return;
+    }
+    watcher = std::thread([this]() { watch_loop(); });
+}
+
+void ConfigStore::stop_watching() {
+    if (!watching.exchange(false)) return;
+    char c = 1;
+    ssize_t n = write(wake_pipe[1], &c, 1);
+    (void)n;
+    if (watcher.joinable()) watcher.join();
+    close(wake_pipe[0]);
+    close(wake_pipe[1]);
+    wake_pipe[0] = wake_pipe[1] = -1;
+}
+
+void ConfigStore::watch_loop() {
+    namespace fs = std::filesystem;
+    const fs::path file = fs::path(config_path);
+    const std::string file_name = file.filename().string();
+    auto last_mtime = config_mtime(config_path);
+
+    int notify_fd = -1;
+#ifdef __linux__
+    // Watch the directory, not the file: editors and deploy scripts replace the
+    // file via rename, which would orphan a watch on the old inode
+    notify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (notify_fd >= 0) {
+        std::string dir = file.has_parent_path() ? file.parent_path().string() : ".";
+        if (inotify_add_watch(notify_fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+            close(notify_fd);
+            notify_fd = -1;
+        }
+    }
+#endif
+    std::cout << "🔄 Watching " << config_path << " for changes ("
+              << (notify_fd >= 0 ? "inotify" : "mtime polling") << ")" << std::endl;
+
+    while (watching) {
+        pollfd fds[2] = {{wake_pipe[0], POLLIN, 0}, {notify_fd, POLLIN, 0}};
+        int ready = poll(fds, notify_fd >= 0 ? 2 : 1, POLL_INTERVAL_MS);
+        if (!watching) break;
+        if (ready < 0) continue;
+
+        bool changed = false;
+#ifdef __linux__
+        if (notify_fd >= 0 && (fds[1].revents & POLLIN)) {
+            alignas(inotify_event) char buf[4096];
+            ssize_t len;
+            while ((len = read(notify_fd, buf, sizeof(buf))) > 0) {
+                for (char* ptr = buf; ptr < buf + len;) {
+                    auto* event = reinterpret_cast<inotify_event*>(ptr);
+                    if (event->len > 0 && file_name == event->name) changed = true;
+                    ptr += sizeof(inotify_event) + event->len;
+                }
+            }
+        }
+#endif
+        if (notify_fd < 0) {
+            auto mtime = config_mtime(config_path);
+            if (mtime != last_mtime) {
+                last_mtime = mtime;
+                changed = true;
+            }
+        }
+        if (!changed) continue;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(RELOAD_DEBOUNCE_MS));
+        if (reload()) {
+            MetricsRegistry::instance().increment(MetricCounter::CONFIG_RELOADS);
+            auto active = current();
+            std::cout << "🔄 Config reloaded from " << config_path << " (v" << active->version << ")" << std::endl;
+            print_summary(*active);
+        }
+    }
+
+    if (notify_fd >= 0) close(notify_fd);
+}
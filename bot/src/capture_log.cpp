@@ -0,0 +1,393 @@
+#include "capture_log.hpp"
+#include "bot_config.hpp"
+#include <sqlite3.h>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+const char MAGIC[4] = {'K', 'C', 'A', 'P'};
+const uint8_t FORMAT_VERSION = 1;
+const size_t FLUSH_BYTES = 1 << 20;
+const std::chrono::seconds TURN_TIMEOUT(5);
+
+std::string channel_key(CaptureKind kind, const std::string& name) {
+    std::string key(1, (char)kind);
+    key += name;
+    return key;
+}
+
+const char* kind_name(CaptureKind kind) {
+    switch (kind) {
+        case CaptureKind::CLOCK: return "clock";
+        case CaptureKind::MARKET: return "market";
+        case CaptureKind::FILE: return "file";
+        case CaptureKind::SQLITE: return "sqlite";
+        case CaptureKind::ENV: return "env";
+        case CaptureKind::META: return "meta";
+    }
+    return "?";
+}
+
+std::optional<std::string> read_whole_file(const std::string& path) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f.good()) return std::nullopt;
+    std::stringstream buffer;
+    buffer << f.rdbuf();
+    return buffer.str();
+}
+
+bool write_whole_file(const std::string& path, std::string_view content) {
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+    f.write(content.data(), content.size());
+    return f.good();
+}
+
+}  // namespace
+
+void CaptureEncoder::varint(uint64_t v) {
+    while (v >= 0x80) {
+        bytes.push_back((char)(v | 0x80));
+        v >>= 7;
+    }
+    bytes.push_back((char)v);
+}
+
+void CaptureEncoder::f64(double v) {
+    uint64_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    for (int i = 0; i < 8; i++) bytes.push_back((char)(bits >> (8 * i)));
+}
+
+void CaptureEncoder::str(std::string_view v) {
+    varint(v.size());
+    bytes.append(v.data(), v.size());
+}
+
+uint8_t CaptureDecoder::u8() {
+    if (pos >= data.size()) { good = false; return 0; }
+    return (uint8_t)data[pos++];
+}
+
+uint64_t CaptureDecoder::varint() {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos >= data.size()) { good = false; return 0; }
+        uint8_t b = (uint8_t)data[pos++];
+        v |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) return v;
+    }
+    good = false;
+    return 0;
+}
+
+double CaptureDecoder::f64() {
+    if (pos + 8 > data.size()) { good = false; pos = data.size(); return 0.0; }
+    uint64_t bits = 0;
+    for (int i = 0; i < 8; i++) bits |= (uint64_t)(uint8_t)data[pos + i] << (8 * i);
+    pos += 8;
+    double v;
+    std::memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+std::string_view CaptureDecoder::view(uint64_t n) {
+    if (!good || n > data.size() - pos) { good = false; pos = data.size(); return {}; }
+    std::string_view v = data.substr(pos, n);
+    pos += n;
+    return v;
+}
+
+std::string CaptureDecoder::str() {
+    return std::string(view(varint()));
+}
+
+CaptureSession& CaptureSession::instance() {
+    static CaptureSession session;
+    return session;
+}
+
+bool CaptureSession::open_record(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    file_ = std::fopen(path.c_str(), "wb");
+    if (!file_) {
+        std::cerr << "❌ Cannot create capture " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    buffer_.assign(MAGIC, sizeof(MAGIC));
+    buffer_.push_back((char)FORMAT_VERSION);
+    channel_ids_.clear();
+    records_ = 0;
+    bytes_ = 0;
+    mode_ = Mode::RECORD;
+    return true;
+}
+
+bool CaptureSession::open_replay(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto content = read_whole_file(path);
+    if (!content || content->size() < 5 || content->compare(0, 4, MAGIC, 4) != 0) {
+        std::cerr << "❌ " << path << " is not a capture log" << std::endl;
+        return false;
+    }
+    if ((uint8_t)(*content)[4] != FORMAT_VERSION) {
+        std::cerr << "❌ Capture " << path << " has format version " << (int)(uint8_t)(*content)[4]
+                  << ", expected " << (int)FORMAT_VERSION << std::endl;
+        return false;
+    }
+    data_ = std::move(*content);
+    channels_.clear();
+    channel_index_.clear();
+    records_ = 0;
+    misses_ = 0;
+
+    // Index payloads per channel (views into data_)
+    std::unordered_map<uint64_t, size_t> by_id;
+    CaptureDecoder in(std::string_view(data_).substr(5));
+    while (!in.at_end()) {
+        uint64_t id = in.varint();
+        std::string_view payload = in.view(in.varint());
+        if (!in.ok()) {
+            std::cerr << "⚠️ Capture ends in a partial record; replaying up to it" << std::endl;
+            break;
+        }
+        if (id == 0) {
+            CaptureDecoder def(payload);
+            uint64_t new_id = def.varint();
+            CaptureKind kind = (CaptureKind)def.u8();
+            std::string name = def.str();
+            if (!def.ok()) break;
+            channel_index_[channel_key(kind, name)] = channels_.size();
+            by_id[new_id] = channels_.size();
+            channels_.push_back({kind, std::move(name), {}});
+            continue;
+        }
+        auto it = by_id.find(id);
+        if (it == by_id.end()) {
+            std::cerr << "⚠️ Capture record for undefined channel " << id << "; stopping there" << std::endl;
+            break;
+        }
+        channels_[it->second].payloads.push_back(payload);
+        records_.fetch_add(1, std::memory_order_relaxed);
+    }
+    bytes_.store(data_.size(), std::memory_order_relaxed);
+    mode_ = Mode::REPLAY;
+    return true;
+}
+
+void CaptureSession::flush_locked() {
+    if (!file_ || buffer_.empty()) return;
+    std::fwrite(buffer_.data(), 1, buffer_.size(), file_);
+    std::fflush(file_);
+    buffer_.clear();
+}
+
+void CaptureSession::flush() {
+    if (mode_ != Mode::RECORD) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    flush_locked();
+}
+
+void CaptureSession::close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (mode_ == Mode::RECORD) {
+        flush_locked();
+        std::fclose(file_);
+        file_ = nullptr;
+    } else if (mode_ == Mode::REPLAY) {
+        size_t unread = 0;
+        for (const auto& c : channels_) unread += c.payloads.size() - c.cursor;
+        if (unread > 0) std::cerr << "⚠️ Capture replay left " << unread << " records unread" << std::endl;
+    }
+    mode_ = Mode::OFF;
+}
+
+void CaptureSession::record(CaptureKind kind, const std::string& channel, std::string_view payload) {
+    if (mode_ != Mode::RECORD) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    const std::string key = channel_key(kind, channel);
+    auto it = channel_ids_.find(key);
+    CaptureEncoder out;
+    if (it == channel_ids_.end()) {
+        uint64_t id = channel_ids_.size() + 1;
+        it = channel_ids_.emplace(key, id).first;
+        CaptureEncoder def;
+        def.varint(id);
+        def.u8((uint8_t)kind);
+        def.str(channel);
+        out.varint(0);
+        out.str(def.bytes);
+    }
+    out.varint(it->second);
+    out.str(payload);
+    buffer_ += out.bytes;
+    records_.fetch_add(1, std::memory_order_relaxed);
+    bytes_.fetch_add(out.bytes.size(), std::memory_order_relaxed);
+    if (buffer_.size() >= FLUSH_BYTES) flush_locked();
+}
+
+std::optional<std::string> CaptureSession::next(CaptureKind kind, const std::string& channel) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = channel_index_.find(channel_key(kind, channel));
+    if (it != channel_index_.end()) {
+        Channel& c = channels_[it->second];
+        if (c.cursor < c.payloads.size()) return std::string(c.payloads[c.cursor++]);
+        if (!c.reported) {
+            c.reported = true;
+            std::cerr << "⚠️ Capture replay ran past the recording on " << kind_name(kind) << " '" << channel << "'" << std::endl;
+        }
+    } else {
+        // Never recorded: report once
+        channel_index_[channel_key(kind, channel)] = channels_.size();
+        channels_.push_back({kind, channel, {}, 0, true});
+        std::cerr << "⚠️ Capture replay asked for unrecorded " << kind_name(kind) << " '" << channel << "'" << std::endl;
+    }
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return std::nullopt;
+}
+
+size_t CaptureSession::remaining(CaptureKind kind, const std::string& channel) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = channel_index_.find(channel_key(kind, channel));
+    if (it == channel_index_.end()) return 0;
+    const Channel& c = channels_[it->second];
+    return c.payloads.size() - c.cursor;
+}
+
+std::optional<std::string> CaptureSession::file_update(const std::string& path, std::optional<std::string> live) {
+    if (mode_ == Mode::RECORD) {
+        CaptureEncoder out;
+        out.u8(live ? 1 : 0);
+        if (live) out.str(*live);
+        record(CaptureKind::FILE, path, out.bytes);
+    } else if (mode_ == Mode::REPLAY) {
+        auto payload = next(CaptureKind::FILE, path);
+        if (!payload) return std::nullopt;
+        CaptureDecoder in(*payload);
+        if (!in.u8()) return std::nullopt;
+        return in.str();
+    }
+    return live;
+}
+
+void CaptureSession::snapshot_file(const std::string& channel, const std::string& path) {
+    if (mode_ != Mode::RECORD) return;
+    auto content = read_whole_file(path);
+    CaptureEncoder out;
+    out.u8(content ? 1 : 0);
+    if (content) out.str(*content);
+    record(CaptureKind::FILE, channel, out.bytes);
+}
+
+bool CaptureSession::restore_file(const std::string& channel, const std::string& out_path) {
+    auto payload = next(CaptureKind::FILE, channel);
+    if (!payload) return false;
+    CaptureDecoder in(*payload);
+    if (!in.u8()) return false;
+    std::string content = in.str();
+    return in.ok() && write_whole_file(out_path, content);
+}
+
+void CaptureSession::snapshot_sqlite(const std::string& channel, const std::string& db_path) {
+    if (mode_ != Mode::RECORD) return;
+    CaptureEncoder out;
+    sqlite3* db = nullptr;
+    sqlite3_int64 size = 0;
+    unsigned char* image = nullptr;
+    if (sqlite3_open_v2(db_path.c_str(), &db, SQLITE_OPEN_READONLY, nullptr) == SQLITE_OK) {
+        image = sqlite3_serialize(db, "main", &size, 0);
+    }
+    out.u8(image ? 1 : 0);
+    if (image) out.str(std::string_view((const char*)image, (size_t)size));
+    sqlite3_free(image);
+    sqlite3_close(db);
+    record(CaptureKind::SQLITE, channel, out.bytes);
+}
+
+bool CaptureSession::restore_sqlite(const std::string& channel, const std::string& out_path) {
+    auto payload = next(CaptureKind::SQLITE, channel);
+    if (!payload) return false;
+    CaptureDecoder in(*payload);
+    if (!in.u8()) return false;
+    for (const char* suffix : {"", "-wal", "-shm"}) std::remove((out_path + suffix).c_str());
+    std::string image = in.str();
+    return in.ok() && write_whole_file(out_path, image);
+}
+
+void CaptureSession::snapshot_env() {
+    if (mode_ != Mode::RECORD) return;
+    for (const char* name : BOT_ENV_OVERRIDES) {
+        const char* value = std::getenv(name);
+        CaptureEncoder out;
+        out.u8(value ? 1 : 0);
+        if (value) out.str(value);
+        record(CaptureKind::ENV, name, out.bytes);
+    }
+}
+
+void CaptureSession::restore_env() {
+    for (const char* name : BOT_ENV_OVERRIDES) {
+        auto payload = next(CaptureKind::ENV, name);
+        if (!payload) continue;
+        CaptureDecoder in(*payload);
+        if (in.u8()) setenv(name, in.str().c_str(), 1);
+        else unsetenv(name);
+    }
+}
+
+std::vector<std::string> CaptureSession::string_list(const std::string& channel, std::vector<std::string> live) {
+    if (mode_ == Mode::RECORD) {
+        CaptureEncoder out;
+        out.varint(live.size());
+        for (const auto& s : live) out.str(s);
+        record(CaptureKind::META, channel, out.bytes);
+    } else if (mode_ == Mode::REPLAY) {
+        auto payload = next(CaptureKind::META, channel);
+        if (!payload) return live;
+        CaptureDecoder in(*payload);
+        std::vector<std::string> recorded(in.varint());
+        for (auto& s : recorded) s = in.str();
+        return recorded;
+    }
+    return live;
+}
+
+void CaptureSession::wait_turn(const std::string& channel, std::string_view who) {
+    if (mode_ != Mode::REPLAY) return;
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = channel_index_.find(channel_key(CaptureKind::META, channel));
+    if (it == channel_index_.end()) return;
+    const Channel& c = channels_[it->second];
+    // A thread the log never lets through would hang the replay; give up
+    // waiting after a while and let take_turn() count the divergence
+    bool next = turn_changed_.wait_for(lock, TURN_TIMEOUT, [&] {
+        return c.cursor >= c.payloads.size() || c.payloads[c.cursor] == who;
+    });
+    if (!next) std::cerr << "⚠️ Capture replay: '" << who << "' is out of turn on " << channel << std::endl;
+}
+
+void CaptureSession::take_turn(const std::string& channel, std::string_view who) {
+    if (mode_ == Mode::RECORD) {
+        record(CaptureKind::META, channel, who);
+        return;
+    }
+    if (mode_ != Mode::REPLAY) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = channel_index_.find(channel_key(CaptureKind::META, channel));
+        if (it != channel_index_.end()) {
+            Channel& c = channels_[it->second];
+            if (c.cursor < c.payloads.size() && c.payloads[c.cursor] == who) {
+                c.cursor++;
+                turn_changed_.notify_all();
+                return;
+            }
+        }
+    }
+    misses_.fetch_add(1, std::memory_order_relaxed);
+}
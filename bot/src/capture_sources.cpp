@@ -0,0 +1,199 @@
+#include "capture_sources.hpp"
+#include "trace_recorder.hpp"
+#include <stdexcept>
+
+namespace {
+
+// Run a live call and log its result (or exception) on the channel
+template<typename Call, typename Encode>
+auto recorded(const std::string& channel, Call&& call, Encode&& encode) -> decltype(call()) {
+    CaptureSession& capture = CaptureSession::instance();
+    CaptureEncoder out;
+    try {
+        auto result = call();
+        out.u8(0);
+        encode(out, result);
+        capture.record(CaptureKind::MARKET, channel, out.bytes);
+        return result;
+    } catch (const std::exception& e) {
+        out.u8(1);
+        out.str(e.what());
+        capture.record(CaptureKind::MARKET, channel, out.bytes);
+        throw;
+    }
+}
+
+// The logged result for the channel; fallback once the recording runs out
+template<typename Decode, typename T>
+T replayed(const std::string& channel, Decode&& decode, T fallback) {
+    auto payload = CaptureSession::instance().next(CaptureKind::MARKET, channel);
+    if (!payload) return fallback;
+    CaptureDecoder in(*payload);
+    if (in.u8()) throw std::runtime_error(in.str());
+    return decode(in);
+}
+
+void encode_ohlc(CaptureEncoder& out, const std::vector<OHLC>& candles) {
+    out.varint(candles.size());
+    for (const auto& c : candles) {
+        out.i64(c.timestamp);
+        out.f64(c.open);
+        out.f64(c.high);
+        out.f64(c.low);
+        out.f64(c.close);
+        out.f64(c.volume);
+    }
+}
+
+std::vector<OHLC> decode_ohlc(CaptureDecoder& in) {
+    std::vector<OHLC> candles(in.varint());
+    for (auto& c : candles) {
+        c.timestamp = (long)in.i64();
+        c.open = in.f64();
+        c.high = in.f64();
+        c.low = in.f64();
+        c.close = in.f64();
+        c.volume = in.f64();
+    }
+    return candles;
+}
+
+void encode_order(CaptureEncoder& out, const Order& o) {
+    out.str(o.order_id);
+    out.str(o.pair);
+    out.str(o.side);
+    out.f64(o.price);
+    out.f64(o.volume);
+    out.f64(o.filled);
+    out.str(o.status);
+}
+
+Order decode_order(CaptureDecoder& in) {
+    Order o;
+    o.order_id = in.str();
+    o.pair = in.str();
+    o.side = in.str();
+    o.price = in.f64();
+    o.volume = in.f64();
+    o.filled = in.f64();
+    o.status = in.str();
+    return o;
+}
+
+void encode_strings(CaptureEncoder& out, const std::vector<std::string>& values) {
+    out.varint(values.size());
+    for (const auto& v : values) out.str(v);
+}
+
+std::vector<std::string> decode_strings(CaptureDecoder& in) {
+    std::vector<std::string> values(in.varint());
+    for (auto& v : values) v = in.str();
+    return values;
+}
+
+void encode_json(CaptureEncoder& out, const json& value) {
+    std::vector<uint8_t> packed = json::to_msgpack(value);
+    out.str(std::string_view((const char*)packed.data(), packed.size()));
+}
+
+json decode_json(CaptureDecoder& in) {
+    std::string packed = in.str();
+    return json::from_msgpack(packed.begin(), packed.end(), true, false);
+}
+
+}  // namespace
+
+Clock::time_point CaptureClock::now() {
+    time_point t = inner.now();
+    CaptureEncoder out;
+    out.i64(t.time_since_epoch().count());
+    CaptureSession::instance().record(CaptureKind::CLOCK, TraceRecorder::current_pair(), out.bytes);
+    return t;
+}
+
+Clock::time_point CaptureReplayClock::now() {
+    auto payload = CaptureSession::instance().next(CaptureKind::CLOCK, TraceRecorder::current_pair());
+    if (payload) {
+        CaptureDecoder in(*payload);
+        last_ticks.store(in.i64(), std::memory_order_relaxed);
+    }
+    return time_point(time_point::duration(last_ticks.load(std::memory_order_relaxed)));
+}
+
+bool CaptureMarketData::authenticate() {
+    return recorded("auth", [&] { return inner->authenticate(); },
+                    [](CaptureEncoder& out, bool ok) { out.u8(ok); });
+}
+
+std::vector<std::string> CaptureMarketData::get_trading_pairs() {
+    return recorded("pairs", [&] { return inner->get_trading_pairs(); }, encode_strings);
+}
+
+json CaptureMarketData::get_ticker(const std::string& pair) {
+    return recorded("ticker:" + pair, [&] { return inner->get_ticker(pair); }, encode_json);
+}
+
+double CaptureMarketData::get_latest_price(const std::string& pair) {
+    return recorded("latest:" + pair, [&] { return inner->get_latest_price(pair); },
+                    [](CaptureEncoder& out, double v) { out.f64(v); });
+}
+
+double CaptureMarketData::get_volatility(const std::string& pair, int minutes) {
+    return recorded("volatility:" + pair + ":" + std::to_string(minutes),
+                    [&] { return inner->get_volatility(pair, minutes); },
+                    [](CaptureEncoder& out, double v) { out.f64(v); });
+}
+
+std::vector<OHLC> CaptureMarketData::get_ohlc(const std::string& pair, int interval) {
+    return recorded("ohlc:" + pair + ":" + std::to_string(interval),
+                    [&] { return inner->get_ohlc(pair, interval); }, encode_ohlc);
+}
+
+Order CaptureMarketData::place_market_order(const std::string& pair, const std::string& side,
+                                            double volume, double leverage) {
+    return recorded("order:" + pair, [&] { return inner->place_market_order(pair, side, volume, leverage); },
+                    encode_order);
+}
+
+bool CaptureReplayMarketData::authenticate() {
+    return replayed("auth", [](CaptureDecoder& in) { return in.u8() != 0; }, false);
+}
+
+std::vector<std::string> CaptureReplayMarketData::get_trading_pairs() {
+    return replayed("pairs", decode_strings, std::vector<std::string>{});
+}
+
+json CaptureReplayMarketData::get_ticker(const std::string& pair) {
+    return replayed("ticker:" + pair, decode_json, json::object());
+}
+
+double CaptureReplayMarketData::get_latest_price(const std::string& pair) {
+    return replayed("latest:" + pair, [](CaptureDecoder& in) { return in.f64(); }, 0.0);
+}
+
+double CaptureReplayMarketData::get_volatility(const std::string& pair, int minutes) {
+    return replayed("volatility:" + pair + ":" + std::to_string(minutes),
+                    [](CaptureDecoder& in) { return in.f64(); }, 0.0);
+}
+
+std::vector<OHLC> CaptureReplayMarketData::get_ohlc(const std::string& pair, int interval) {
+    return replayed("ohlc:" + pair + ":" + std::to_string(interval), decode_ohlc, std::vector<OHLC>{});
+}
+
+Order CaptureReplayMarketData::place_market_order(const std::string& pair, const std::string& side,
+                                                  double volume, double /*leverage*/) {
+    Order failed;
+    failed.order_id = "capture exhausted";
+    failed.pair = pair;
+    failed.side = side;
+    failed.price = 0.0;
+    failed.volume = volume;
+    failed.filled = 0.0;
+    failed.status = "error";
+    return replayed("order:" + pair, decode_order, failed);
+}
+
+bool CaptureReplayMarketData::exhausted() {
+    CaptureSession& capture = CaptureSession::instance();
+    return capture.misses() > 0 || capture.remaining(CaptureKind::CLOCK, "") == 0;
+}
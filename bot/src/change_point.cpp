@@ -0,0 +1,52 @@
+#include "change_point.hpp"
+#include <algorithm>
+#include <cmath>
+
+ChangePoint PageHinkley::update(double x, const ChangePointOptions& options) {
+    ChangePoint result;
+    if (n >= options.min_trades) {
+        const double std_x = std::max(std::sqrt(m2 / (n - 1)), options.min_std);
+        const double z = std::clamp((x - mean_x) / std_x, -options.clamp, options.clamp);
+        down_sum += z + options.delta;
+        up_sum += z - options.delta;
+    }
+
+    // Running statistics include x from here on
+    n++;
+    const double d = x - mean_x;
+    mean_x += d / n;
+    m2 += d * (x - mean_x);
+    sum_x += x;
+
+    if (down_sum >= down_peak) {
+        down_peak = down_sum;
+        down_onset = n;
+        down_onset_sum = sum_x;
+    }
+    if (up_sum <= up_trough) {
+        up_trough = up_sum;
+        up_onset = n;
+        up_onset_sum = sum_x;
+    }
+
+    uint32_t onset = 0;
+    double onset_sum = 0.0;
+    if (down_peak - down_sum > options.lambda) {
+        result.direction = ShiftDirection::DOWN;
+        onset = down_onset;
+        onset_sum = down_onset_sum;
+    } else if (up_sum - up_trough > options.lambda) {
+        result.direction = ShiftDirection::UP;
+        onset = up_onset;
+        onset_sum = up_onset_sum;
+    } else {
+        return result;
+    }
+
+    result.trades_before = onset;
+    result.trades_after = n - onset;
+    result.mean_before = onset > 0 ? onset_sum / onset : 0.0;
+    result.mean_after = n > onset ? (sum_x - onset_sum) / (n - onset) : 0.0;
+    *this = PageHinkley();
+    return result;
+}
@@ -0,0 +1,112 @@
+#include "clock.hpp"
+
+std::thread Clock::start_thread(std::function<void()> body) {
+    return std::thread(std::move(body));
+}
+
+void Clock::join(std::vector<std::thread>& threads) {
+    for (auto& t : threads) if (t.joinable()) t.join();
+}
+
+int64_t Clock::now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(now().time_since_epoch()).count();
+}
+
+long Clock::now_seconds() {
+    return std::chrono::duration_cast<std::chrono::seconds>(now().time_since_epoch()).count();
+}
+
+Clock& Clock::wall() {
+    static WallClock clock;
+    return clock;
+}
+
+Clock::time_point WallClock::now() {
+    return std::chrono::system_clock::now();
+}
+
+void WallClock::sleep_for(std::chrono::milliseconds duration) {
+    std::this_thread::sleep_for(duration);
+}
+
+VirtualClock::VirtualClock(time_point start, double speed)
+    : now_us_(std::chrono::duration_cast<std::chrono::microseconds>(start.time_since_epoch()).count()),
+      speed_(speed) {}
+
+Clock::time_point VirtualClock::now() {
+    return time_point(std::chrono::duration_cast<time_point::duration>(
+        std::chrono::microseconds(now_us_.load(std::memory_order_acquire))));
+}
+
+uint64_t VirtualClock::enqueue_locked(int64_t wake_us) {
+    uint64_t seq = next_seq_++;
+    waiting_.insert({wake_us, seq});
+    return seq;
+}
+
+// Called with the lock held whenever a clock thread stops running
+void VirtualClock::dispatch_locked() {
+    if (running_ > 0 || waiting_.empty()) return;
+    auto [wake_us, seq] = *waiting_.begin();
+    waiting_.erase(waiting_.begin());
+    int64_t now_us = now_us_.load(std::memory_order_relaxed);
+    if (wake_us > now_us) {
+        // Paced replay: every other clock thread is waiting, so sleeping here
+        // holds nothing up that wouldn't be waiting anyway
+        if (speed_ > 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds((int64_t)((wake_us - now_us) / speed_)));
+        }
+        now_us_.store(wake_us, std::memory_order_release);
+    }
+    running_ = 1;
+    turn_ = seq;
+    wakeups_.fetch_add(1, std::memory_order_relaxed);
+    turn_cv_.notify_all();
+}
+
+void VirtualClock::wait_turn(std::unique_lock<std::mutex>& lock, uint64_t seq) {
+    turn_cv_.wait(lock, [this, seq] { return turn_ == seq; });
+    turn_ = UINT64_MAX;
+}
+
+void VirtualClock::sleep_for(std::chrono::milliseconds duration) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    int64_t wake_us = now_us_.load(std::memory_order_relaxed) +
+                      std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+    uint64_t seq = enqueue_locked(wake_us);
+    running_--;
+    dispatch_locked();
+    wait_turn(lock, seq);
+}
+
+std::thread VirtualClock::start_thread(std::function<void()> body) {
+    uint64_t seq;
+    {
+        // Queued before the thread exists so time can't pass it by
+        std::lock_guard<std::mutex> lock(mutex_);
+        seq = enqueue_locked(now_us_.load(std::memory_order_relaxed));
+    }
+    return std::thread([this, seq, body = std::move(body)]() {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wait_turn(lock, seq);
+        }
+        body();
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_--;
+        dispatch_locked();
+    });
+}
+
+void VirtualClock::join(std::vector<std::thread>& threads) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_--;
+        dispatch_locked();
+    }
+    for (auto& t : threads) if (t.joinable()) t.join();
+    std::unique_lock<std::mutex> lock(mutex_);
+    uint64_t seq = enqueue_locked(now_us_.load(std::memory_order_relaxed));
+    dispatch_locked();
+    wait_turn(lock, seq);
+}
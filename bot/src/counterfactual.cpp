@@ -0,0 +1,183 @@
+#include "counterfactual.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+constexpr size_t TRADES_PER_TASK = 4;
+
+// Per-candidate state of one path replay, column-wise like the grid
+struct ExitState {
+    std::vector<int32_t> open, trailing;   // 0/1, as wide as the float columns
+    std::vector<float> best, exit_move, adverse, sl_eff;
+
+    explicit ExitState(const ExitGrid& grid)
+        : open(grid.size()), trailing(grid.size()), best(grid.size()), exit_move(grid.size()),
+          adverse(grid.size()), sl_eff(grid.size()) {
+        for (size_t c = 0; c < grid.size(); c++) {
+            float liquidation = grid.leverage[c] > 0.0f ? 100.0f / grid.leverage[c] : 0.0f;
+            sl_eff[c] = std::max(grid.sl_pct[c], liquidation);
+        }
+    }
+};
+
+// One observation (move r at t seconds) for every candidate. The columns
+// never alias, which is what lets the compiler vectorize this loop
+void step_candidates(size_t n, float r, int32_t t, float side, const float* __restrict tp,
+                     const float* __restrict sl, const float* __restrict trail_start,
+                     const float* __restrict trail_stop, const int32_t* __restrict hold,
+                     int32_t* __restrict open, int32_t* __restrict trailing, float* __restrict best,
+                     float* __restrict exit_move, float* __restrict adverse) {
+    for (size_t c = 0; c < n; c++) {
+        const int32_t was_open = open[c];
+        const float prev_adverse = adverse[c];
+        const float b = best[c] > r ? best[c] : r;
+        const int32_t trail = trailing[c] | (r >= trail_start[c] ? 1 : 0);
+        const float stop = b - trail_stop[c] - side * b * trail_stop[c] * 0.01f;
+        const int32_t hit = (r >= tp[c] ? 1 : 0) | (r <= -sl[c] ? 1 : 0) | (trail & (r <= stop ? 1 : 0)) |
+                            (t >= hold[c] ? 1 : 0);
+        best[c] = b;
+        trailing[c] = trail;
+        adverse[c] = (was_open & (r < prev_adverse ? 1 : 0)) ? r : prev_adverse;
+        exit_move[c] = (was_open & hit) ? r : exit_move[c];
+        open[c] = was_open & (hit ^ 1);
+    }
+}
+
+// Replay one path through every candidate: exit_move and adverse per candidate
+void run_path(const PricePath& path, const ExitGrid& grid, ExitState& s) {
+    const size_t n = grid.size();
+    const float side = path.is_short ? -1.0f : 1.0f;
+    std::fill(s.open.begin(), s.open.end(), 1);
+    std::fill(s.trailing.begin(), s.trailing.end(), 0);
+    std::fill(s.best.begin(), s.best.end(), 0.0f);
+    std::fill(s.exit_move.begin(), s.exit_move.end(), 0.0f);
+    std::fill(s.adverse.begin(), s.adverse.end(), 0.0f);
+    if (path.size() == 0) return;
+
+    size_t still_open = n;
+    for (size_t k = 0; k < path.size() && still_open > 0; k++) {
+        step_candidates(n, path.move_pct[k], path.elapsed_s[k], side, grid.tp_pct.data(), s.sl_eff.data(),
+                        grid.trailing_start_pct.data(), grid.trailing_stop_pct.data(), grid.hold_s.data(),
+                        s.open.data(), s.trailing.data(), s.best.data(), s.exit_move.data(), s.adverse.data());
+        // Every candidate closed early: the rest of the path cannot change anything
+        if ((k & 15) == 15) still_open = (size_t)std::count(s.open.begin(), s.open.end(), 1);
+    }
+    // Open at the end of the recording: out at the last price seen
+    const float last = path.move_pct.back();
+    for (size_t c = 0; c < n; c++) s.exit_move[c] = s.open[c] ? last : s.exit_move[c];
+}
+
+}  // namespace
+
+void PricePath::add(int32_t elapsed, double price, double entry_price) {
+    double move = (price / entry_price - 1.0) * 100.0;
+    elapsed_s.push_back(elapsed);
+    move_pct.push_back((float)(is_short ? -move : move));
+}
+
+void ExitGrid::add(float tp, float sl, float trailing_start, float trailing_stop, int32_t hold, float lev) {
+    tp_pct.push_back(tp);
+    sl_pct.push_back(sl);
+    trailing_start_pct.push_back(trailing_start);
+    trailing_stop_pct.push_back(trailing_stop);
+    hold_s.push_back(hold);
+    leverage.push_back(lev);
+}
+
+double ExitScore::lower_bound() const {
+    if (trades == 0) return -std::numeric_limits<double>::infinity();
+    return mean_net_pct - std_net_pct / std::sqrt((double)trades);
+}
+
+std::vector<ExitScore> score_exit_grid(const std::vector<const PricePath*>& paths, const ExitGrid& grid,
+                                       double fee_pct, ThreadPool& pool) {
+    const size_t n = grid.size();
+    const size_t tasks = (paths.size() + TRADES_PER_TASK - 1) / TRADES_PER_TASK;
+    // Per task: sum, sum of squares, wins (candidate-major within each)
+    std::vector<std::vector<double>> partial(tasks, std::vector<double>(3 * n, 0.0));
+
+    pool.parallel_for(tasks, [&](size_t task) {
+        ExitState state(grid);
+        double* sum = partial[task].data();
+        double* sum_sq = sum + n;
+        double* wins = sum + 2 * n;
+        const size_t end = std::min(paths.size(), (task + 1) * TRADES_PER_TASK);
+        for (size_t i = task * TRADES_PER_TASK; i < end; i++) {
+            run_path(*paths[i], grid, state);
+            const float* exit_move = state.exit_move.data();
+            for (size_t c = 0; c < n; c++) {
+                double net = exit_move[c] - fee_pct;
+                sum[c] += net;
+                sum_sq[c] += net * net;
+                wins[c] += net > 0.0;
+            }
+        }
+    });
+
+    std::vector<ExitScore> scores(n);
+    const double count = (double)paths.size();
+    for (size_t c = 0; c < n; c++) {
+        double sum = 0.0, sum_sq = 0.0, wins = 0.0;
+        for (const auto& p : partial) {
+            sum += p[c];
+            sum_sq += p[n + c];
+            wins += p[2 * n + c];
+        }
+        ExitScore& score = scores[c];
+        score.trades = (int)paths.size();
+        score.wins = (int)wins;
+        if (paths.empty()) continue;
+        score.mean_net_pct = sum / count;
+        score.std_net_pct = std::sqrt(std::max(0.0, sum_sq / count - score.mean_net_pct * score.mean_net_pct));
+    }
+    return scores;
+}
+
+std::vector<ExitOutcome> replay_exit(const std::vector<const PricePath*>& paths, const ExitGrid& grid,
+                                     size_t candidate, double fee_pct) {
+    ExitGrid one;
+    one.add(grid.tp_pct[candidate], grid.sl_pct[candidate], grid.trailing_start_pct[candidate],
+            grid.trailing_stop_pct[candidate], grid.hold_s[candidate], grid.leverage[candidate]);
+    ExitState state(one);
+    std::vector<ExitOutcome> outcomes;
+    outcomes.reserve(paths.size());
+    for (const PricePath* path : paths) {
+        run_path(*path, one, state);
+        outcomes.push_back({(float)(state.exit_move[0] - fee_pct), state.adverse[0]});
+    }
+    return outcomes;
+}
+
+double kelly_fraction(const std::vector<ExitOutcome>& outcomes) {
+    // f* = (p * b - q) / b with b = average win / average loss, as PerformanceMetrics
+    int wins = 0, losses = 0;
+    double win_sum = 0.0, loss_sum = 0.0;
+    for (const ExitOutcome& o : outcomes) {
+        if (o.net_pct > 0) {
+            wins++;
+            win_sum += o.net_pct;
+        } else {
+            losses++;
+            loss_sum -= o.net_pct;
+        }
+    }
+    if (wins == 0) return 0.0;
+    if (losses == 0 || loss_sum <= 0.0) return 1.0;
+    double p = (double)wins / (wins + losses);
+    double b = (win_sum / wins) / (loss_sum / losses);
+    return std::clamp((p * b - (1.0 - p)) / b, 0.0, 1.0);
+}
+
+double log_growth(const std::vector<ExitOutcome>& outcomes, double stake_fraction) {
+    if (outcomes.empty()) return 0.0;
+    double total = 0.0;
+    for (const ExitOutcome& o : outcomes) {
+        double wealth = 1.0 + stake_fraction * o.net_pct / 100.0;
+        if (wealth <= 0.0) return -std::numeric_limits<double>::infinity();
+        total += std::log(wealth);
+    }
+    return total / outcomes.size();
+}
@@ -0,0 +1,119 @@
+#include "direction_model.hpp"
+#include "capture_log.hpp"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <nlohmann/json.hpp>
+
+namespace {
+
+uint64_t fnv1a(const std::string& data) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+}  // namespace
+
+double CompiledDirectionModel::score(const DirectionFeatures& features) const {
+    typedef double v4d __attribute__((vector_size(32)));
+    v4d w0, w1, x0, x1;
+    std::memcpy(&w0, &weights[0], sizeof(v4d));
+    std::memcpy(&w1, &weights[4], sizeof(v4d));
+    std::memcpy(&x0, &features[0], sizeof(v4d));
+    std::memcpy(&x1, &features[4], sizeof(v4d));
+    v4d acc = w0 * x0 + w1 * x1;
+    return bias + ((acc[0] + acc[1]) + (acc[2] + acc[3]));
+}
+
+const char* DirectionModel::feature_name(DirectionFeature feature) {
+    switch (feature) {
+        case DirectionFeature::VOLATILITY_PCT: return "volatility_pct";
+        case DirectionFeature::MARKET_REGIME: return "market_regime";
+        case DirectionFeature::VWAP_DEV: return "vwap_dev";
+        case DirectionFeature::VOLUME: return "volume";
+        case DirectionFeature::LAST_PRICE: return "last_price";
+        case DirectionFeature::VOLATILITY_PCT_SQ: return "volatility_pct_sq";
+        default: return nullptr;
+    }
+}
+
+DirectionModel::Ptr DirectionModel::current() const {
+#if defined(__cpp_lib_atomic_shared_ptr)
+    return model.load(std::memory_order_acquire);
+#else
+    return std::atomic_load_explicit(&model, std::memory_order_acquire);
+#endif
+}
+
+void DirectionModel::publish(Ptr next) {
+#if defined(__cpp_lib_atomic_shared_ptr)
+    model.store(std::move(next), std::memory_order_release);
+#else
+    std::atomic_store_explicit(&model, std::move(next), std::memory_order_release);
+#endif
+}
+
+std::optional<std::string> DirectionModel::read_if_touched(const std::string& path) {
+    std::error_code ec;
+    auto mtime = std::filesystem::last_write_time(path, ec);
+    if (ec) return std::nullopt;  // No model file (yet)
+    uintmax_t size = std::filesystem::file_size(path, ec);
+    if (ec) return std::nullopt;
+    if (mtime == last_mtime && size == last_size) return std::nullopt;
+
+    std::ifstream f(path, std::ios::binary);
+    if (!f.good()) return std::nullopt;
+    std::stringstream buffer;
+    buffer << f.rdbuf();
+    last_mtime = mtime;
+    last_size = size;
+    return buffer.str();
+}
+
+bool DirectionModel::reload_if_changed(const std::string& path) {
+    // A capture replay sees the content the recorded run read at this call
+    auto touched = CaptureSession::instance().file_update(path, read_if_touched(path));
+    if (!touched) return false;
+    const std::string& content = *touched;
+
+    // Touched but identical (e.g. retrain produced the same model)
+    uint64_t hash = fnv1a(content);
+    if (hash == last_hash) return false;
+
+    try {
+        nlohmann::json jm = nlohmann::json::parse(content);
+        if (!jm.contains("weights") || !jm["weights"].is_object()) return false;
+
+        auto next = std::make_shared<CompiledDirectionModel>();
+        next->bias = jm.value("bias", 0.0);
+        next->content_hash = hash;
+        for (auto it = jm["weights"].begin(); it != jm["weights"].end(); ++it) {
+            if (!it.value().is_number()) continue;
+            bool mapped = false;
+            for (size_t i = 0; i < (size_t)DirectionFeature::COUNT; i++) {
+                if (it.key() == feature_name((DirectionFeature)i)) {
+                    next->weights[i] = it.value().get<double>();
+                    next->weight_count++;
+                    mapped = true;
+                }
+            }
+            if (!mapped) {
+                std::cerr << "⚠️ Direction model: ignoring unknown feature '" << it.key() << "'" << std::endl;
+            }
+        }
+
+        last_hash = hash;
+        publish(std::move(next));
+        return true;
+    } catch (const std::exception& e) {
+        // Likely caught mid-write; the size/mtime will change again when done
+        std::cerr << "⚠️ Direction model parse failed (" << path << "): " << e.what() << std::endl;
+        last_size = 0;
+        return false;
+    }
+}
@@ -1,4 +1,5 @@
 #include "kraken_api.hpp"
+#include "strategy_core.hpp"
 #include <curl/curl.h>
 #include <iostream>
 #include <sqlite3.h>
@@ -48,6 +49,12 @@ KrakenAPI::KrakenAPI(bool paper_trading) : paper_mode(paper_trading) {
     api_key = key ? key : "";
     api_secret = secret ? secret : "";
 
+    // Price source overrides are fixed for the process - read once, not per request
+    const char* env_use_auth = std::getenv("USE_AUTHORITATIVE_PRICES");
+    use_authoritative_prices = env_use_auth && std::string(env_use_auth) == "1";
+    const char* env_db = std::getenv("PRICE_HISTORY_DB");
+    price_history_db_override = env_db ? env_db : "";
+
     // Initialize mock prices for paper trading (futures contracts)
     mock_prices = {
         {"PI_XBTUSD", 89000.0},
@@ -283,8 +290,8 @@ double KrakenAPI::get_bid_ask_spread(const std::string& pair) {
 }
 
 std::vector<std::string> KrakenAPI::get_trading_pairs() {
-    // Use fixed list of pairs that we collect high-frequency data for
-    // This ensures we only trade pairs with real-time data available
+    // Pairs that we collect high-frequency data for. These are pinned in the
+    // PairUniverse; the wider universe is loaded from kraken-data/ by the bot.
     std::vector<std::string> pairs = {
         "PI_XBTUSD",  // Bitcoin
         "PI_ETHUSD",  // Ethereum
@@ -293,7 +300,7 @@ std::vector<std::string> KrakenAPI::get_trading_pairs() {
         "PI_LTCUSD"   // Litecoin
     };
 
-    std::cout << "Using " << pairs.size() << " high-frequency trading pairs" << std::endl;
+    std::cout << "Pinning " << pairs.size() << " high-frequency trading pairs" << std::endl;
     return pairs;
 }
 
@@ -348,8 +355,7 @@ std::vector<double> KrakenAPI::get_price_history(const std::string& pair, int ma
         // Optionally prefer the authoritative DB-backed endpoint. This can be forced
         // by setting USE_AUTHORITATIVE_PRICES=1 in the environment or implicitly when
         // running in paper_mode.
-        const char* env_use_auth = std::getenv("USE_AUTHORITATIVE_PRICES");
-        bool use_authoritative = (env_use_auth && std::string(env_use_auth) == "1") || paper_mode;
+        bool use_authoritative = use_authoritative_prices || paper_mode;
         if (!paper_mode) {
             std::string endpointBase = use_authoritative ? "/api/prices/authoritative/" : "/api/prices/";
             std::string endpoint = endpointBase + pair + "?limit=" + std::to_string(max_points);
@@ -382,9 +388,8 @@ std::vector<double> KrakenAPI::get_price_history(const std::string& pair, int ma
     if (prices.size() < 10) {
         try {
             // Allow runtime override of DB path for testing/CI
-            const char* env_db = std::getenv("PRICE_HISTORY_DB");
             std::vector<std::string> candidates;
-            if (env_db && *env_db) candidates.push_back(std::string(env_db));
+            if (!price_history_db_override.empty()) candidates.push_back(price_history_db_override);
             candidates.push_back("../../data/price_history.db");
             candidates.push_back("../data/price_history.db");
             candidates.push_back("./data/price_history.db");
@@ -437,8 +442,7 @@ std::vector<double> KrakenAPI::get_price_history(const std::string& pair, int ma
 double KrakenAPI::get_latest_price(const std::string& pair) {
     try {
         // Use high-frequency price data instead of API call
-        const char* env_use_auth = std::getenv("USE_AUTHORITATIVE_PRICES");
-        bool use_authoritative = (env_use_auth && std::string(env_use_auth) == "1") || paper_mode;
+        bool use_authoritative = use_authoritative_prices || paper_mode;
         std::string endpointBase = use_authoritative ? "/api/prices/authoritative/" : "/api/prices/";
         std::string endpoint = endpointBase + pair + "?limit=1";
         std::cerr << "get_latest_price: attempting HTTP endpoint " << endpoint << std::endl;
@@ -475,22 +479,13 @@ double KrakenAPI::get_volatility(const std::string& pair, int minutes) {
         const auto prices = get_price_history(pair, 500);
         std::cerr << "get_volatility: retrieved " << prices.size() << " prices for " << pair << " from get_price_history" << std::endl;
         if (prices.size() < 2) return 0.0;
-        std::vector<double> returns;
-        for (size_t i = 1; i < prices.size(); ++i) {
-            double r = std::log(prices[i] / prices[i-1]);
-            returns.push_back(std::abs(r));
-        }
         double minp = *std::min_element(prices.begin(), prices.end());
         double maxp = *std::max_element(prices.begin(), prices.end());
-        std::cerr << "get_volatility: price range for " << pair << " -> min:" << minp << " max:" << maxp << " returns_count:" << returns.size() << std::endl;
-        if (returns.empty()) return 0.0;
-        double mean = std::accumulate(returns.begin(), returns.end(), 0.0) / returns.size();
-        double variance = 0.0;
-        for (double v : returns) variance += std::pow(v - mean, 2);
-        variance /= returns.size();
-        double stddev = std::sqrt(variance);
-    std::cerr << "get_volatility: computed stddev percent " << (stddev * 100.0) << " for " << pair << std::endl;
-    return stddev * 100.0; // percent
+        std::cerr << "get_volatility: price range for " << pair << " -> min:" << minp << " max:" << maxp << " returns_count:" << (prices.size() - 1) << std::endl;
+        // Std-dev of absolute log returns (shared with the backtester)
+        double vol_pct = realized_volatility_pct(prices.data(), prices.size());
+        std::cerr << "get_volatility: computed stddev percent " << vol_pct << " for " << pair << std::endl;
+        return vol_pct;
     } catch (const std::exception& e) {
         std::cerr << "Fallback volatility calculation failed for " << pair << ": " << e.what() << std::endl;
     }
@@ -0,0 +1,129 @@
+#include "latency_histogram.hpp"
+#include <fstream>
+#include <iostream>
+#include <cmath>
+
+const char* latency_stage_name(LatencyStage stage) {
+    switch (stage) {
+        case LatencyStage::SCAN_CYCLE: return "scan_cycle";
+        case LatencyStage::SCAN_PAIR: return "scan_pair";
+        case LatencyStage::GET_TICKER: return "get_ticker";
+        case LatencyStage::GET_VOLATILITY: return "get_volatility";
+        case LatencyStage::GET_OHLC: return "get_ohlc";
+        case LatencyStage::CALCULATE_INDICATORS: return "calculate_indicators";
+        case LatencyStage::LEARNING_MUTEX_WAIT: return "learning_mutex_wait";
+        case LatencyStage::ADAPTIVE_STRATEGY: return "adaptive_strategy";
+        case LatencyStage::RISK_PROFILE: return "risk_profile";
+        case LatencyStage::ENTRY_ORDER: return "entry_order";
+        case LatencyStage::MONITOR_PRICE: return "monitor_price";
+        case LatencyStage::EXIT_ORDER: return "exit_order";
+        case LatencyStage::RECORD_TRADE: return "record_trade";
+        case LatencyStage::CONTINUOUS_LEARNING: return "continuous_learning";
+        default: return "unknown";
+    }
+}
+
+size_t LatencyHistogram::bucket_index(uint64_t micros) {
+    if (micros < SUB_BUCKETS) return (size_t)micros;
+    int exponent = 63 - __builtin_clzll(micros);
+    if (exponent >= MAX_EXPONENT) return BUCKETS - 1;
+    int shift = exponent - SUB_BUCKET_BITS;
+    size_t group = (size_t)shift + 1;
+    size_t sub = (size_t)((micros >> shift) - SUB_BUCKETS);
+    return group * SUB_BUCKETS + sub;
+}
+
+uint64_t LatencyHistogram::bucket_upper_bound(size_t index) {
+    if (index < SUB_BUCKETS) return index;
+    size_t group = index / SUB_BUCKETS;
+    uint64_t sub = index % SUB_BUCKETS;
+    int shift = (int)group - 1;
+    uint64_t lower = (SUB_BUCKETS + sub) << shift;
+    return lower + (1ull << shift) - 1;
+}
+
+void LatencySummary::merge(const LatencyHistogram& h) {
+    for (size_t i = 0; i < LatencyHistogram::BUCKETS; i++) {
+        counts[i] += h.counts[i].load(std::memory_order_relaxed);
+    }
+    total += h.total.load(std::memory_order_relaxed);
+    sum += h.sum.load(std::memory_order_relaxed);
+    max = std::max(max, h.max.load(std::memory_order_relaxed));
+}
+
+uint64_t LatencySummary::percentile(double p) const {
+    if (total == 0) return 0;
+    uint64_t rank = (uint64_t)std::ceil(p / 100.0 * (double)total);
+    rank = std::max<uint64_t>(1, std::min(rank, total));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); i++) {
+        seen += counts[i];
+        if (seen >= rank) return std::min(LatencyHistogram::bucket_upper_bound(i), max);
+    }
+    return max;
+}
+
+json LatencySummary::to_json() const {
+    return {
+        {"count", total},
+        {"mean_us", total > 0 ? (double)sum / total : 0.0},
+        {"p50_us", percentile(50.0)},
+        {"p90_us", percentile(90.0)},
+        {"p99_us", percentile(99.0)},
+        {"p999_us", percentile(99.9)},
+        {"max_us", max}
+    };
+}
+
+LatencyRegistry& LatencyRegistry::instance() {
+    // Leaked on purpose: thread_local shard handles may release after static teardown
+    static LatencyRegistry* registry = new LatencyRegistry();
+    return *registry;
+}
+
+void LatencyRegistry::record(LatencyStage stage, uint64_t micros) {
+    shards.local().stages[(size_t)stage].record(micros);
+}
+
+std::array<LatencySummary, (size_t)LatencyStage::COUNT> LatencyRegistry::merge() const {
+    std::array<LatencySummary, (size_t)LatencyStage::COUNT> merged;
+    shards.for_each([&merged](const Shard& shard) {
+        for (size_t s = 0; s < merged.size(); s++) merged[s].merge(shard.stages[s]);
+    });
+    return merged;
+}
+
+json LatencyRegistry::to_json() const {
+    auto merged = merge();
+    json stages = json::object();
+    for (size_t s = 0; s < merged.size(); s++) {
+        if (merged[s].total == 0) continue;
+        stages[latency_stage_name((LatencyStage)s)] = merged[s].to_json();
+    }
+    return {
+        {"updated", std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count()},
+        {"uptime_seconds", std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now() - started).count()},
+        {"thread_shards", shards.size()},
+        {"stages", stages}
+    };
+}
+
+bool LatencyRegistry::write_json(const std::string& path) const {
+    // Write-then-rename so the dashboard never reads a half-written file
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp);
+        if (!out.good()) {
+            std::cerr << "⚠️ Cannot write latency stats to " << tmp << std::endl;
+            return false;
+        }
+        out << to_json().dump(2);
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::cerr << "⚠️ Cannot rename latency stats to " << path << std::endl;
+        return false;
+    }
+    return true;
+}
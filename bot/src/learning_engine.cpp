@@ -1,38 +1,145 @@
 #include "learning_engine.hpp"
+#include "trade_writer.hpp"
 #include <numeric>
 #include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <sstream>
 #include <cmath>
 #include <set>
+#include "thread_pool.hpp"
+#include "capture_log.hpp"
+#include "strategy_core.hpp"
+#include "position_path.hpp"
+#include "metrics_registry.hpp"
 
-LearningEngine::LearningEngine() {
-    // Initialize SQLite database (project root data directory)
-    // Allow override via TRADES_DB for testing/CI
+namespace {
+
+void encode_market_points(CaptureEncoder& out, const std::vector<LearningEngine::MarketDataPoint>& points) {
+    out.varint(points.size());
+    for (const auto& p : points) {
+        out.str(p.pair);
+        out.f64(p.ask_price);
+        out.f64(p.bid_price);
+        out.f64(p.last_price);
+        out.f64(p.volume);
+        out.f64(p.vwap);
+        out.i64(p.timestamp);
+    }
+}
+
+std::vector<LearningEngine::MarketDataPoint> decode_market_points(CaptureDecoder& in) {
+    std::vector<LearningEngine::MarketDataPoint> points(in.varint());
+    for (auto& p : points) {
+        p.pair = in.str();
+        p.ask_price = in.f64();
+        p.bid_price = in.f64();
+        p.last_price = in.f64();
+        p.volume = in.f64();
+        p.vwap = in.f64();
+        p.timestamp = in.i64();
+        p.volatility_pct = 0.0;
+        p.market_regime = 0;
+    }
+    return points;
+}
+
+// Counterfactual exit candidates. plan_trade() widens any SL to the
+// liquidation distance, so SLs collapse onto that floor at higher leverage.
+const float EXIT_TP_PCT[] = {0.3f, 0.5f, 0.8f, 1.2f, 1.6f, 2.0f, 3.0f};
+const float EXIT_SL_PCT[] = {0.4f, 0.8f, 1.5f, 3.0f, 5.0f, 10.0f};
+const std::pair<float, float> EXIT_TRAILING_PCT[] = {
+    {ExitGrid::NO_TRAILING, 0.0f}, {0.5f, 0.25f}, {0.8f, 0.3f}, {1.2f, 0.5f}};   // Start, stop
+const int32_t EXIT_HOLD_S[] = {300, 600, 1200, 1800, 3600};
+const float LEVERAGE_CHOICES[] = {1.0f, 2.0f, 3.0f, 5.0f, 10.0f};
+
+// Distinct SLs after the liquidation floor at this leverage
+std::vector<float> stop_candidates(float leverage) {
+    std::vector<float> stops;
+    for (float sl : EXIT_SL_PCT) {
+        float effective = std::max(sl, 100.0f / leverage);
+        if (std::find(stops.begin(), stops.end(), effective) == stops.end()) stops.push_back(effective);
+    }
+    return stops;
+}
+
+ExitGrid exit_candidate_grid(float leverage) {
+    ExitGrid grid;
+    for (float tp : EXIT_TP_PCT)
+        for (float sl : stop_candidates(leverage))
+            for (const auto& [start, stop] : EXIT_TRAILING_PCT)
+                for (int32_t hold : EXIT_HOLD_S) grid.add(tp, sl, start, stop, hold, leverage);
+    return grid;
+}
+
+}  // namespace
+
+std::string LearningEngineOptions::default_trades_db_path() {
+    // Project root data directory; TRADES_DB overrides for testing/CI
     const char* env_db = std::getenv("TRADES_DB");
-    std::string db_path = env_db && *env_db ? std::string(env_db) : std::string("../../data/trades.db");
-    init_database(db_path);
+    return env_db && *env_db ? std::string(env_db) : std::string("../../data/trades.db");
+}
+
+LearningEngine::LearningEngine(const LearningEngineOptions& options)
+    : market_regimes(options.regimes ? *options.regimes : own_regimes), options_(options) {
+    // Initialize SQLite database
+    init_database(!options_.trades_db_path.empty() ? options_.trades_db_path
+                                                   : LearningEngineOptions::default_trades_db_path());
     // Attempt to load a direction model for adaptive entry direction/leveraging
-    try {
-        std::ifstream f("data/direction_model.json");
-        if (f.good()) {
-            nlohmann::json jm;
-            f >> jm;
-            if (jm.contains("weights") && jm["weights"].is_object()) {
-                for (auto it = jm["weights"].begin(); it != jm["weights"].end(); ++it) {
-                    direction_model_weights[it.key()] = it.value().get<double>();
-                }
-                direction_model_bias = jm.value("bias", 0.0);
-                direction_model_loaded = true;
-                std::cout << "Loaded direction model with " << direction_model_weights.size() << " weights" << std::endl;
-            }
-        }
-    } catch (...) {
-        // ignore
+    if (direction_model.reload_if_changed(DIRECTION_MODEL_PATH)) {
+        std::cout << "Loaded direction model with " << direction_model.current()->weight_count << " weights" << std::endl;
+    }
+    init_online_direction_model();
+}
+
+void LearningEngine::init_online_direction_model() {
+    if (!options_.online_model_path.empty() && online_direction.load(options_.online_model_path)) {
+        std::cout << "🧠 Online direction model restored (" << online_direction.updates() << " updates, log loss "
+                  << std::fixed << std::setprecision(3) << online_direction.score().log_loss() << ")" << std::endl;
+        return;
+    }
+    // No checkpoint: warm start from the recent trade window, oldest first
+    for (uint32_t row = 0; row < trades.size(); row++) {
+        online_direction.update(trades.get(row));
+    }
+    if (online_direction.updates() > 0) {
+        std::cout << "🧠 Online direction model warm-started from " << online_direction.updates() << " trades" << std::endl;
     }
 }
 
+void LearningEngine::shadow_direction_models(const TradeRecord& trade) {
+    bool up = OnlineDirectionModel::label(trade);
+    
+    // Static model on the entry state it would have seen (volume is not
+    // recorded with trades, so that term scores 0)
+    double p_static = -1;
+    if (direction_model.current()) {
+        MarketDataPoint entry{};
+        entry.pair = trade.pair;
+        entry.last_price = trade.entry_price;
+        entry.vwap = trade.entry_price / (1.0 + trade.vwap_deviation / 100.0);
+        entry.volatility_pct = trade.volatility_at_entry;
+        entry.market_regime = trade.market_regime;
+        p_static = 1.0 / (1.0 + std::exp(-score_direction_model(entry)));
+        static_direction_score.add(p_static, up);
+    }
+    
+    double p_online = online_direction.update(trade);
+    
+    std::cout << "🧪 Direction shadow: online p(up)=" << std::fixed << std::setprecision(2) << p_online;
+    if (p_static >= 0) std::cout << " | static p(up)=" << p_static;
+    std::cout << " | actual " << (up ? "UP" : "DOWN")
+              << " | log loss online " << std::setprecision(3) << online_direction.score().log_loss();
+    if (static_direction_score.count > 0) std::cout << " vs static " << static_direction_score.log_loss();
+    std::cout << std::endl;
+}
+
 LearningEngine::~LearningEngine() {
+    writer.reset();  // Commits queued trades before the DB closes
+    if (options_.persist_models && !options_.online_model_path.empty() && online_direction.updates() > 0) {
+        online_direction.save(options_.online_model_path);
+    }
+    close_market_db();
     if (db_) {
         sqlite3_close(db_);
         db_ = nullptr;
@@ -84,6 +191,9 @@ void LearningEngine::init_database(const std::string& db_path) {
             trend_direction REAL,
             max_profit REAL,
             max_loss REAL,
+            bars_high INTEGER,
+            bars_low INTEGER,
+            price_path BLOB,
             created_at TEXT DEFAULT CURRENT_TIMESTAMP,
             UNIQUE(pair, timestamp)
         );
@@ -101,158 +211,327 @@ void LearningEngine::init_database(const std::string& db_path) {
         std::cout << "✅ SQLite database initialized: " << db_path << std::endl;
     }
     
-    // Load existing trades from database
-    load_trades_from_db();
-}
-
-void LearningEngine::save_trade_to_db(const TradeRecord& trade) {
-    if (!db_) {
-        std::cerr << "⚠️ Database not initialized, cannot save trade" << std::endl;
-        return;
+    // Trade dynamics columns added later; "duplicate column" when present is expected
+    for (const char* column : {"bars_high INTEGER", "bars_low INTEGER", "price_path BLOB"}) {
+        std::string sql = std::string("ALTER TABLE trades ADD COLUMN ") + column;
+        sqlite3_exec(db_, sql.c_str(), nullptr, nullptr, nullptr);
     }
     
-    const char* insert_sql = R"(
-        INSERT OR IGNORE INTO trades (
-            pair, direction, entry_price, exit_price, position_size, leverage,
-            pnl, gross_pnl, fees_paid, exit_reason, timestamp, entry_time, hold_time,
-            timeframe_seconds, volatility_pct, bid_ask_spread, rsi, macd_histogram,
-            macd_signal, bb_position, volume_ratio, momentum_score, atr_pct,
-            market_regime, trend_direction, max_profit, max_loss
-        ) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
-    )";
+    // WAL lets this connection read while the trade writer commits
+    sqlite3_busy_timeout(db_, 5000);
+    sqlite3_exec(db_, "PRAGMA journal_mode=WAL", nullptr, nullptr, nullptr);
     
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db_, insert_sql, -1, &stmt, nullptr);
+    // Aggregate tables (same layout as the legacy Node bot created). The
+    // extra columns hold the full running state, so startup can restore
+    // PatternAggregates without reading trades.
+    const char* create_stats_sql = R"(
+        CREATE TABLE IF NOT EXISTS pattern_stats (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            pattern_key TEXT UNIQUE NOT NULL,
+            pair TEXT NOT NULL,
+            direction TEXT NOT NULL,
+            volatility_bucket TEXT,
+            regime_bucket TEXT,
+            total_trades INTEGER DEFAULT 0,
+            winning_trades INTEGER DEFAULT 0,
+            losing_trades INTEGER DEFAULT 0,
+            total_pnl REAL DEFAULT 0.0,
+            total_fees REAL DEFAULT 0.0,
+            avg_pnl REAL DEFAULT 0.0,
+            avg_win REAL DEFAULT 0.0,
+            avg_loss REAL DEFAULT 0.0,
+            win_rate REAL DEFAULT 0.0,
+            profit_factor REAL DEFAULT 0.0,
+            sharpe_ratio REAL DEFAULT 0.0,
+            last_updated INTEGER DEFAULT (strftime('%s', 'now') * 1000)
+        );
+        CREATE INDEX IF NOT EXISTS idx_patterns_pair ON pattern_stats(pair);
+        CREATE TABLE IF NOT EXISTS indicator_stats (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            indicator TEXT NOT NULL,
+            bucket TEXT NOT NULL,
+            total_trades INTEGER DEFAULT 0,
+            winning_trades INTEGER DEFAULT 0,
+            total_pnl REAL DEFAULT 0.0,
+            avg_pnl REAL DEFAULT 0.0,
+            win_rate REAL DEFAULT 0.0,
+            UNIQUE(indicator, bucket)
+        );
+    )";
+    rc = sqlite3_exec(db_, create_stats_sql, nullptr, nullptr, &err_msg);
     if (rc != SQLITE_OK) {
-        std::cerr << "❌ Failed to prepare insert statement: " << sqlite3_errmsg(db_) << std::endl;
-        return;
+        std::cerr << "❌ Failed to create stats tables: " << err_msg << std::endl;
+        sqlite3_free(err_msg);
     }
     
-    auto timestamp_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-        trade.timestamp.time_since_epoch()).count();
-    
-    sqlite3_bind_text(stmt, 1, trade.pair.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, trade.direction.empty() ? "LONG" : trade.direction.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_double(stmt, 3, trade.entry_price);
-    sqlite3_bind_double(stmt, 4, trade.exit_price);
-    sqlite3_bind_double(stmt, 5, trade.position_size);
-    sqlite3_bind_int(stmt, 6, static_cast<int>(trade.leverage));
-    sqlite3_bind_double(stmt, 7, trade.pnl);
-    sqlite3_bind_double(stmt, 8, trade.gross_pnl);
-    sqlite3_bind_double(stmt, 9, trade.fees_paid);
-    sqlite3_bind_text(stmt, 10, trade.exit_reason.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_int64(stmt, 11, timestamp_ms);
-    sqlite3_bind_int64(stmt, 12, timestamp_ms);  // entry_time same as timestamp for now
-    sqlite3_bind_int(stmt, 13, trade.timeframe_seconds);
-    sqlite3_bind_int(stmt, 14, trade.timeframe_seconds);
-    sqlite3_bind_double(stmt, 15, trade.volatility_at_entry);
-    sqlite3_bind_double(stmt, 16, trade.bid_ask_spread);
-    sqlite3_bind_double(stmt, 17, trade.rsi);
-    sqlite3_bind_double(stmt, 18, trade.macd_histogram);
-    sqlite3_bind_double(stmt, 19, trade.macd_signal);
-    sqlite3_bind_double(stmt, 20, trade.bb_position);
-    sqlite3_bind_double(stmt, 21, trade.volume_ratio);
-    sqlite3_bind_double(stmt, 22, trade.momentum_score);
-    sqlite3_bind_double(stmt, 23, trade.atr_pct);
-    sqlite3_bind_int(stmt, 24, trade.market_regime);
-    sqlite3_bind_double(stmt, 25, trade.trend_direction);
-    sqlite3_bind_double(stmt, 26, trade.max_profit);
-    sqlite3_bind_double(stmt, 27, trade.max_loss);
-    
-    rc = sqlite3_step(stmt);
-    if (rc != SQLITE_DONE) {
-        std::cerr << "❌ Failed to insert trade: " << sqlite3_errmsg(db_) << std::endl;
-    } else {
-        std::cout << "💾 Trade saved to SQLite: " << trade.pair << " " 
-                  << (trade.pnl > 0 ? "+" : "") << "$" << std::fixed << std::setprecision(2) << trade.pnl << std::endl;
+    // Added columns; "duplicate column" on an already-migrated DB is expected
+    const char* state_columns[] = {
+        "leverage INTEGER", "timeframe_bucket INTEGER", "volatility_code INTEGER", "regime_code INTEGER",
+        "gross_wins REAL", "gross_losses REAL", "return_mean REAL", "return_m2 REAL",
+        "downside_sq_sum REAL", "return_peak REAL", "max_drawdown REAL", "sortino_ratio REAL"
+    };
+    for (const char* column : state_columns) {
+        std::string sql = std::string("ALTER TABLE pattern_stats ADD COLUMN ") + column;
+        sqlite3_exec(db_, sql.c_str(), nullptr, nullptr, nullptr);
     }
     
-    sqlite3_finalize(stmt);
+    writer = std::make_unique<TradeWriter>(db_path);
+    
+    // Load aggregates and the recent trade window
+    load_trades_from_db();
 }
 
+TradeRecord LearningEngine::read_trade_row(sqlite3_stmt* stmt) {
+    TradeRecord trade{};
+    
+    // Column 0: pair
+    const char* pair = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+    trade.pair = pair ? pair : "";
+    
+    // Column 1: direction
+    const char* dir = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+    trade.direction = dir ? dir : "LONG";
+    
+    // Columns 2-5: price/position data
+    trade.entry_price = sqlite3_column_double(stmt, 2);
+    trade.exit_price = sqlite3_column_double(stmt, 3);
+    trade.position_size = sqlite3_column_double(stmt, 4);
+    trade.leverage = sqlite3_column_double(stmt, 5);
+    
+    // Columns 6-9: P&L and exit
+    trade.pnl = sqlite3_column_double(stmt, 6);
+    trade.gross_pnl = sqlite3_column_double(stmt, 7);
+    trade.fees_paid = sqlite3_column_double(stmt, 8);
+    
+    const char* reason = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 9));
+    trade.exit_reason = reason ? reason : "unknown";
+    
+    // Column 10: timestamp
+    int64_t ts = sqlite3_column_int64(stmt, 10);
+    trade.timestamp = system_clock::time_point(milliseconds(ts));
+    
+    // Columns 11-13: timeframe, volatility, spread
+    trade.timeframe_seconds = sqlite3_column_int(stmt, 11);
+    trade.volatility_at_entry = sqlite3_column_double(stmt, 12);
+    trade.bid_ask_spread = sqlite3_column_double(stmt, 13);
+    
+    // Columns 14-22: technical indicators
+    trade.rsi = sqlite3_column_double(stmt, 14);
+    trade.macd_histogram = sqlite3_column_double(stmt, 15);
+    trade.macd_signal = sqlite3_column_double(stmt, 16);
+    trade.bb_position = sqlite3_column_double(stmt, 17);
+    trade.volume_ratio = sqlite3_column_double(stmt, 18);
+    trade.momentum_score = sqlite3_column_double(stmt, 19);
+    trade.atr_pct = sqlite3_column_double(stmt, 20);
+    trade.market_regime = sqlite3_column_int(stmt, 21);
+    trade.trend_direction = sqlite3_column_double(stmt, 22);
+    
+    // Columns 23-26: trade dynamics (NULL on trades recorded before they were tracked)
+    trade.max_profit = sqlite3_column_double(stmt, 23);
+    trade.max_loss = sqlite3_column_double(stmt, 24);
+    trade.bars_high = sqlite3_column_int(stmt, 25);
+    trade.bars_low = sqlite3_column_int(stmt, 26);
+    
+    // Column 27 (only selected for the recent window): compressed price path
+    if (sqlite3_column_count(stmt) > 27) {
+        const uint8_t* path = static_cast<const uint8_t*>(sqlite3_column_blob(stmt, 27));
+        if (path) trade.price_path.assign(path, path + sqlite3_column_bytes(stmt, 27));
+    }
+    
+    return trade;
+}
+
+// Explicit column names (read_trade_row indices)
+#define TRADE_ROW_COLUMNS \
+    "pair, direction, entry_price, exit_price, position_size, leverage, " \
+    "pnl, gross_pnl, fees_paid, exit_reason, timestamp, " \
+    "timeframe_seconds, volatility_pct, bid_ask_spread, " \
+    "rsi, macd_histogram, macd_signal, bb_position, volume_ratio, " \
+    "momentum_score, atr_pct, market_regime, trend_direction, max_profit, max_loss, " \
+    "bars_high, bars_low"
+
+// Rows is_learned() accepts: rebuilt aggregates and the recent window hold
+// exactly the trades record_trade() folds in
+#define LEARNED_TRADES "leverage > 1"
+
 void LearningEngine::load_trades_from_db() {
     if (!db_) return;
     
-    // Use explicit column names to avoid index issues
-    const char* select_sql = R"(
-        SELECT 
-            pair, direction, entry_price, exit_price, position_size, leverage,
-            pnl, gross_pnl, fees_paid, exit_reason, timestamp,
-            timeframe_seconds, volatility_pct, bid_ask_spread,
-            rsi, macd_histogram, macd_signal, bb_position, volume_ratio,
-            momentum_score, atr_pct, market_regime, trend_direction
-        FROM trades 
-        WHERE leverage > 1.0
-        ORDER BY timestamp ASC
-    )";
+    auto start = std::chrono::steady_clock::now();
+    if (!load_aggregates_from_db()) {
+        // First start on this DB (or stats written by an older version):
+        // one full pass over trades, then aggregates are kept incrementally
+        rebuild_aggregates_from_db();
+    }
+    load_recent_trades_from_db(RECENT_TRADE_WINDOW);
+    auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    
+    std::cout << "📊 Loaded " << pattern_aggregates.size() << " pattern aggregates ("
+              << overall.total_trades << " trades) + " << trades.size()
+              << " recent trades from SQLite in " << elapsed_ms << "ms" << std::endl;
+}
+
+bool LearningEngine::load_aggregates_from_db() {
     sqlite3_stmt* stmt;
     
-    int rc = sqlite3_prepare_v2(db_, select_sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
-        std::cerr << "❌ Failed to prepare select statement: " << sqlite3_errmsg(db_) << std::endl;
-        return;
+    // Rows without running state come from an older writer: rebuild instead
+    int stale = 0;
+    if (sqlite3_prepare_v2(db_, "SELECT COUNT(*) FROM pattern_stats WHERE return_m2 IS NULL", -1, &stmt, nullptr) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) stale = sqlite3_column_int(stmt, 0);
+        sqlite3_finalize(stmt);
     }
+    if (stale > 0) return false;
     
-    int count = 0;
+    // Enhanced keys from before the regime codes were unified map the same
+    // trades to other regimes: rebuild, which stamps the current version
+    int version = 0;
+    if (sqlite3_prepare_v2(db_, "PRAGMA user_version", -1, &stmt, nullptr) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) version = sqlite3_column_int(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+    if (version < STATS_VERSION) return false;
+    
+    const char* select_sql = R"(
+        SELECT pair, direction, leverage, timeframe_bucket, volatility_code, regime_code,
+               total_trades, winning_trades, losing_trades, total_pnl, total_fees,
+               gross_wins, gross_losses, return_mean, return_m2, downside_sq_sum,
+               return_peak, max_drawdown
+        FROM pattern_stats
+    )";
+    if (sqlite3_prepare_v2(db_, select_sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "❌ Failed to prepare pattern_stats select: " << sqlite3_errmsg(db_) << std::endl;
+        return false;
+    }
+    
+    reset_aggregates();
     while (sqlite3_step(stmt) == SQLITE_ROW) {
-        TradeRecord trade;
-        
-        // Column 0: pair
         const char* pair = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
-        trade.pair = pair ? pair : "";
-        
-        // Column 1: direction
         const char* dir = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-        trade.direction = dir ? dir : "LONG";
-        
-        // Columns 2-5: price/position data
-        trade.entry_price = sqlite3_column_double(stmt, 2);
-        trade.exit_price = sqlite3_column_double(stmt, 3);
-        trade.position_size = sqlite3_column_double(stmt, 4);
-        trade.leverage = sqlite3_column_double(stmt, 5);
-        
-        // Columns 6-9: P&L and exit
-        trade.pnl = sqlite3_column_double(stmt, 6);
-        trade.gross_pnl = sqlite3_column_double(stmt, 7);
-        trade.fees_paid = sqlite3_column_double(stmt, 8);
+        uint32_t pair_id = trades.pairs.intern(pair ? pair : "");
+        bool is_short = dir && std::string(dir) == "SHORT";
+        int leverage = sqlite3_column_int(stmt, 2);
+        int timeframe_bucket = sqlite3_column_int(stmt, 3);
+        int volatility_code = sqlite3_column_int(stmt, 4);
+        int regime_code = sqlite3_column_int(stmt, 5);
+        PatternKey key = volatility_code == (int)PatternKey::ANY
+            ? PatternKey::basic(pair_id, is_short, leverage, timeframe_bucket)
+            : PatternKey::enhanced(pair_id, is_short, leverage, timeframe_bucket, volatility_code, regime_code);
         
-        const char* reason = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 9));
-        trade.exit_reason = reason ? reason : "unknown";
+        PatternAggregate& agg = pattern_aggregates[key.bits];
+        agg.key = key;
+        agg.total_trades = sqlite3_column_int(stmt, 6);
+        agg.winning_trades = sqlite3_column_int(stmt, 7);
+        agg.losing_trades = sqlite3_column_int(stmt, 8);
+        agg.total_pnl = sqlite3_column_double(stmt, 9);
+        agg.total_fees = sqlite3_column_double(stmt, 10);
+        agg.gross_wins = sqlite3_column_double(stmt, 11);
+        agg.gross_losses = sqlite3_column_double(stmt, 12);
+        agg.return_mean = sqlite3_column_double(stmt, 13);
+        agg.return_m2 = sqlite3_column_double(stmt, 14);
+        agg.downside_sq_sum = sqlite3_column_double(stmt, 15);
+        agg.return_peak = sqlite3_column_double(stmt, 16);
+        agg.max_drawdown = sqlite3_column_double(stmt, 17);
         
-        // Column 10: timestamp
-        int64_t ts = sqlite3_column_int64(stmt, 10);
-        trade.timestamp = system_clock::time_point(milliseconds(ts));
-        
-        // Columns 11-13: timeframe, volatility, spread
-        trade.timeframe_seconds = sqlite3_column_int(stmt, 11);
-        trade.volatility_at_entry = sqlite3_column_double(stmt, 12);
-        trade.bid_ask_spread = sqlite3_column_double(stmt, 13);
-        
-        // Columns 14-22: technical indicators
-        trade.rsi = sqlite3_column_double(stmt, 14);
-        trade.macd_histogram = sqlite3_column_double(stmt, 15);
-        trade.macd_signal = sqlite3_column_double(stmt, 16);
-        trade.bb_position = sqlite3_column_double(stmt, 17);
-        trade.volume_ratio = sqlite3_column_double(stmt, 18);
-        trade.momentum_score = sqlite3_column_double(stmt, 19);
-        trade.atr_pct = sqlite3_column_double(stmt, 20);
-        trade.market_regime = sqlite3_column_int(stmt, 21);
-        trade.trend_direction = sqlite3_column_double(stmt, 22);
-        
-        // Add to in-memory structures (don't use record_trade to avoid re-saving)
-        trade_history.push_back(trade);
-        trades_by_pair[trade.pair].push_back(trade);
+        patterns_by_pair[pair_id].push_back(key);
+        if (agg.total_trades >= 5) {
+            pattern_database[key.bits] = derive_pattern_metrics(agg);
+        }
+        // Every trade lands in exactly one basic pattern
+        if (!key.is_enhanced()) overall.merge(agg);
+    }
+    sqlite3_finalize(stmt);
+    
+    if (sqlite3_prepare_v2(db_, "SELECT indicator, bucket, total_trades, winning_trades, total_pnl FROM indicator_stats",
+                           -1, &stmt, nullptr) == SQLITE_OK) {
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            const char* indicator = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+            const char* bucket = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+            if (!indicator || !bucket) continue;
+            for (int slot = 0; slot < INDICATOR_SLOTS; slot++) {
+                if (std::string(indicator) == INDICATOR_NAMES[slot][0] && std::string(bucket) == INDICATOR_NAMES[slot][1]) {
+                    indicator_aggregates[slot].total_trades = sqlite3_column_int(stmt, 2);
+                    indicator_aggregates[slot].winning_trades = sqlite3_column_int(stmt, 3);
+                    indicator_aggregates[slot].total_pnl = sqlite3_column_double(stmt, 4);
+                }
+            }
+        }
+        sqlite3_finalize(stmt);
+    }
+    
+    // Empty tables with trades present: nothing was ever persisted
+    return !pattern_aggregates.empty() || get_db_trade_count() == 0;
+}
+
+void LearningEngine::rebuild_aggregates_from_db() {
+    flush_writes();  // Queued trades must be in the table being scanned
+    
+    const char* select_sql = "SELECT " TRADE_ROW_COLUMNS " FROM trades WHERE " LEARNED_TRADES " ORDER BY timestamp ASC";
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db_, select_sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "❌ Failed to prepare select statement: " << sqlite3_errmsg(db_) << std::endl;
+        return;
+    }
+    
+    reset_aggregates();
+    int count = 0;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        fold_into_aggregates(read_trade_row(stmt));
         count++;
     }
+    sqlite3_finalize(stmt);
+    
+    persist_all_aggregates();
+    std::cout << "🔄 Rebuilt pattern/indicator aggregates from " << count << " trades" << std::endl;
+}
+
+void LearningEngine::load_recent_trades_from_db(size_t limit) {
+    // Newest N, returned oldest first
+    std::string select_sql = "SELECT * FROM (SELECT " TRADE_ROW_COLUMNS ", price_path"
+                             " FROM trades WHERE " LEARNED_TRADES " ORDER BY timestamp DESC LIMIT ?) ORDER BY timestamp ASC";
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db_, select_sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "❌ Failed to prepare select statement: " << sqlite3_errmsg(db_) << std::endl;
+        return;
+    }
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)limit);
     
+    trades.reserve(limit);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        // Add to in-memory window only (aggregates already include these)
+        add_to_history(read_trade_row(stmt));
+    }
     sqlite3_finalize(stmt);
-    std::cout << "📊 Loaded " << count << " trades from SQLite database" << std::endl;
+}
+
+PatternStatsRow LearningEngine::pattern_stats_row(const PatternAggregate& agg) const {
+    return {pattern_name(agg.key), agg, derive_pattern_metrics(agg)};
+}
+
+void LearningEngine::persist_all_aggregates() {
+    if (!writer) return;
+    TradeWrite write;
+    write.replace_stats = true;
+    write.stats_version = STATS_VERSION;   // Same transaction as the rows it describes
+    write.patterns.reserve(pattern_aggregates.size());
+    for (const auto& [key, agg] : pattern_aggregates) {
+        write.patterns.push_back(pattern_stats_row(agg));
+    }
+    for (int slot = 0; slot < INDICATOR_SLOTS; slot++) {
+        write.indicators.push_back({INDICATOR_NAMES[slot][0], INDICATOR_NAMES[slot][1], indicator_aggregates[slot]});
+    }
+    writer->submit(std::move(write));
+    writer->flush();
+}
+
+void LearningEngine::flush_writes() {
+    if (writer) writer->flush();
 }
 
 int LearningEngine::get_db_trade_count() const {
     if (!db_) return 0;
     
-    const char* count_sql = "SELECT COUNT(*) FROM trades WHERE leverage > 1.0";
+    const char* count_sql = "SELECT COUNT(*) FROM trades WHERE " LEARNED_TRADES;
     sqlite3_stmt* stmt;
     
     int rc = sqlite3_prepare_v2(db_, count_sql, -1, &stmt, nullptr);
@@ -267,172 +546,349 @@ int LearningEngine::get_db_trade_count() const {
     return count;
 }
 
-void LearningEngine::record_trade(const TradeRecord& trade) {
-    // Save to SQLite FIRST (single source of truth)
-    save_trade_to_db(trade);
+void LearningEngine::record_trade(const TradeRecord& trade, std::function<void(bool)> on_durable) {
+    // Unleveraged trades are stored but, as in the DB loaders, not learned from
+    const bool learned = is_learned(trade);
+    
+    // O(1) aggregate update
+    PatternKey basic_key, enhanced_key;
+    if (learned) std::tie(basic_key, enhanced_key) = fold_into_aggregates(trade);
+    
+    // Queue the trade row with the aggregate rows it touched (absolute
+    // state), so they commit in one transaction. If the row is not stored
+    // the writer stops persisting stats and flags them for a rebuild, so
+    // pattern_stats never drifts from trades. The writer thread does the disk work.
+    if (writer) {
+        TradeWrite write;
+        write.trade = trade;
+        write.learned = learned;
+        if (learned) {
+            write.patterns.reserve(2);
+            write.patterns.push_back(pattern_stats_row(*pattern_aggregates.find(basic_key.bits)));
+            write.patterns.push_back(pattern_stats_row(*pattern_aggregates.find(enhanced_key.bits)));
+            for (int slot : indicator_slots_for(trade.rsi, trade.macd_histogram, trade.bb_position)) {
+                write.indicators.push_back({INDICATOR_NAMES[slot][0], INDICATOR_NAMES[slot][1], indicator_aggregates[slot]});
+            }
+        }
+        write.on_durable = std::move(on_durable);
+        writer->submit(std::move(write));
+    } else {
+        std::cerr << "⚠️ Database not initialized, cannot save trade" << std::endl;
+        if (on_durable) on_durable(false);
+    }
     
-    // Then update in-memory structures
-    trade_history.push_back(trade);
-    trades_by_pair[trade.pair].push_back(trade);
+    if (!learned) {
+        std::cout << "📝 Trade recorded: " << trade.pair << " " << trade.leverage
+                  << "x (unleveraged: stored, not learned from)" << std::endl;
+        return;
+    }
     
-    // Generate pattern key for this trade (includes direction: LONG or SHORT)
-    int timeframe_bucket;
-    if (trade.timeframe_seconds < 30) timeframe_bucket = 0;
-    else if (trade.timeframe_seconds < 60) timeframe_bucket = 1;
-    else if (trade.timeframe_seconds < 120) timeframe_bucket = 2;
-    else timeframe_bucket = 3;
+    // Then the in-memory recent window
+    const uint64_t shifts_before = shift_events_total;
+    add_to_history(trade);
+    shadow_direction_models(trade);
+    
+    // Print what we learned from this trade (formatted locally: std::cout's
+    // precision stays as the rest of the bot expects)
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(2);
+    line << "📝 Trade recorded: " << trade.pair << " " << basic_key.direction()
+         << " | " << (trade.is_win() ? "WIN ✅" : "LOSS ❌")
+         << " | ROI: " << trade.roi() << "%" 
+         << " | Pattern: " << pattern_name(basic_key) 
+         << " | Enhanced: " << pattern_name(enhanced_key);
+    std::cout << line.str() << std::endl;
+    
+    // Shifts this trade raised (history replayed by the loaders stays quiet)
+    const size_t new_shifts = (size_t)std::min<uint64_t>(shift_events_total - shifts_before, shift_log.size());
+    for (size_t i = shift_log.size() - new_shifts; i < shift_log.size(); i++) {
+        const ShiftEvent& event = shift_log[i];
+        const bool down = event.change.direction == ShiftDirection::DOWN;
+        MetricsRegistry::instance().increment(down ? MetricCounter::REGIME_SHIFTS_DOWN : MetricCounter::REGIME_SHIFTS_UP);
+        std::ostringstream shift;
+        shift << std::fixed << std::setprecision(2);
+        shift << (down ? "⚠️ REGIME SHIFT DOWN: " : "📈 REGIME SHIFT UP: ")
+              << (event.pattern.bits ? pattern_name(event.pattern) : "all trades")
+              << " | ROI " << event.change.mean_before << "% -> "
+              << event.change.mean_after << "% over the last " << event.change.trades_after << " trades"
+              << " | weight x" << event.weight;
+        std::cout << shift.str() << std::endl;
+    }
+    
+    // Pattern metrics are already current; every 25 trades refresh the
+    // strategy list and the pattern file the API reads (O(patterns))
+    if (overall.total_trades % 25 == 0) {
+        update_strategy_database();
+        if (!options_.persist_models) return;
+        save_pattern_database_to_file("pattern_database.json");
+        if (!options_.online_model_path.empty() && !online_direction.save(options_.online_model_path)) {
+            std::cerr << "⚠️ Failed to checkpoint online direction model to " << options_.online_model_path << std::endl;
+        }
+    }
+}
+
+int LearningEngine::timeframe_bucket_for(int timeframe_seconds) {
+    if (timeframe_seconds < 30) return 0;
+    if (timeframe_seconds < 60) return 1;
+    if (timeframe_seconds < 120) return 2;
+    return 3;
+}
+
+void PatternAggregate::add(double pnl, double gross_pnl, double fees_paid, double r) {
+    total_trades++;
+    if (pnl > 0) {
+        winning_trades++;
+        gross_wins += gross_pnl;
+    } else {
+        losing_trades++;
+        gross_losses += std::abs(gross_pnl);
+    }
+    total_pnl += pnl;
+    total_fees += fees_paid;
+    
+    double delta = r - return_mean;
+    return_mean += delta / total_trades;
+    return_m2 += delta * (r - return_mean);
+    if (r < 0) downside_sq_sum += r * r;
+    
+    if (total_trades == 1 || r > return_peak) return_peak = r;
+    max_drawdown = std::max(max_drawdown, return_peak - r);
+}
+
+void PatternAggregate::merge(const PatternAggregate& other) {
+    if (other.total_trades == 0) return;
+    if (total_trades == 0) {
+        PatternKey own_key = key;
+        *this = other;
+        key = own_key;
+        return;
+    }
+    
+    double n_a = total_trades;
+    double n_b = other.total_trades;
+    double delta = other.return_mean - return_mean;
+    return_mean += delta * n_b / (n_a + n_b);
+    return_m2 += other.return_m2 + delta * delta * n_a * n_b / (n_a + n_b);
+    downside_sq_sum += other.downside_sq_sum;
     
-    // Default to LONG for legacy trades without direction
-    std::string direction = trade.direction.empty() ? "LONG" : trade.direction;
+    total_trades += other.total_trades;
+    winning_trades += other.winning_trades;
+    losing_trades += other.losing_trades;
+    total_pnl += other.total_pnl;
+    total_fees += other.total_fees;
+    gross_wins += other.gross_wins;
+    gross_losses += other.gross_losses;
     
-    // Generate both basic and enhanced pattern keys
-    std::string basic_key = generate_pattern_key(trade.pair, direction, trade.leverage, timeframe_bucket);
-    std::string enhanced_key = generate_enhanced_pattern_key(trade.pair, direction, trade.leverage, 
-                                                              timeframe_bucket, trade.volatility_at_entry, 
-                                                              trade.market_regime);
+    return_peak = std::max(return_peak, other.return_peak);
+    max_drawdown = std::max(max_drawdown, other.max_drawdown);
+}
+
+const char* const LearningEngine::INDICATOR_NAMES[LearningEngine::INDICATOR_SLOTS][2] = {
+    {"rsi", "oversold"}, {"rsi", "neutral"}, {"rsi", "overbought"},
+    {"macd", "negative"}, {"macd", "positive"},
+    {"bollinger_bands", "near_lower"}, {"bollinger_bands", "middle"}, {"bollinger_bands", "near_upper"}
+};
+
+std::array<int, 3> LearningEngine::indicator_slots_for(double rsi, double macd_histogram, double bb_position) {
+    // Same thresholds as the indicator analysis: RSI 30/70, MACD sign, BB 0.3/0.7
+    return {
+        !(rsi < 30) + (rsi > 70),
+        3 + (macd_histogram > 0),
+        5 + !(bb_position < 0.3) + (bb_position > 0.7)
+    };
+}
+
+std::pair<PatternKey, PatternKey> LearningEngine::pattern_keys_for(const TradeRecord& trade) {
+    uint32_t pair_id = trades.pairs.intern(trade.pair);
+    bool is_short = trade.direction == "SHORT";  // Legacy trades without direction count as LONG
+    int timeframe_bucket = timeframe_bucket_for(trade.timeframe_seconds);
+    
+    return {
+        PatternKey::basic(pair_id, is_short, trade.leverage, timeframe_bucket),
+        PatternKey::enhanced(pair_id, is_short, trade.leverage, timeframe_bucket,
+                             PatternKey::volatility_bucket_for(trade.volatility_at_entry),
+                             PatternKey::regime_code_for(trade.market_regime))
+    };
+}
+
+void LearningEngine::add_to_history(const TradeRecord& trade) {
+    uint32_t row = trades.append(trade);
+    trades_by_pair[trades.pair_id[row]].push_back(row);
+    
+    auto [basic_key, enhanced_key] = pattern_keys_for(trade);
+    const double roi = trades.roi(row);
+    const int64_t timestamp_ms = trades.timestamp_ms[row];
+    for (PatternKey key : {basic_key, enhanced_key}) {
+        trades_by_strategy[key.bits].push_back(row);
+        pattern_correlations.add_trade(key, trade.timestamp, trade.is_win());
+        track_regime_shifts(key, shift_by_pattern[key.bits], roi, timestamp_ms);
+    }
+    track_regime_shifts(PatternKey(), overall_shift, roi, timestamp_ms);
+}
+
+void LearningEngine::track_regime_shifts(PatternKey pattern, ShiftState& state, double roi, int64_t timestamp_ms) {
+    if (state.weight < 1.0 && ++state.trades_since_drop % SHIFT_RECOVERY_TRADES == 0) {
+        state.weight = std::min(1.0, state.weight * 2.0);
+    }
     
-    // Store in both for compatibility and granularity
-    trades_by_strategy[basic_key].push_back(trade);
-    trades_by_strategy[enhanced_key].push_back(trade);
+    ChangePoint change = state.detector.update(roi);
+    if (change.direction == ShiftDirection::NONE) return;
+    if (change.direction == ShiftDirection::DOWN) {
+        state.weight = std::max(SHIFT_MIN_WEIGHT, state.weight * 0.5);
+        state.trades_since_drop = 0;
+    } else {
+        state.weight = 1.0;
+    }
     
-    // Print what we learned from this trade
-    std::cout << "📝 Trade recorded: " << trade.pair << " " << direction
-              << " | " << (trade.is_win() ? "WIN ✅" : "LOSS ❌")
-              << " | ROI: " << std::fixed << std::setprecision(2) << trade.roi() << "%" 
-              << " | Pattern: " << basic_key 
-              << " | Enhanced: " << enhanced_key << std::endl;
+    if (shift_log.size() == SHIFT_LOG_CAPACITY) shift_log.pop_front();
+    shift_log.push_back({timestamp_ms, pattern, change, state.weight});
+    shift_events_total++;
+}
+
+void LearningEngine::reset_regime_shifts() {
+    shift_by_pattern.clear();
+    overall_shift = ShiftState{};
+    shift_log.clear();
+    shift_events_total = 0;
+}
+
+double LearningEngine::shift_weight(PatternKey pattern) const {
+    const ShiftState* state = pattern.bits ? shift_by_pattern.find(pattern.bits) : nullptr;
+    return (state ? state->weight : 1.0) * overall_shift.weight;
+}
+
+json LearningEngine::shift_event_json(const ShiftEvent& event) const {
+    json j;
+    j["timestamp"] = event.timestamp_ms;
+    j["pattern"] = event.pattern.bits ? pattern_name(event.pattern) : "all";
+    j["direction"] = event.change.direction == ShiftDirection::DOWN ? "down" : "up";
+    j["trades_before"] = event.change.trades_before;
+    j["trades_after"] = event.change.trades_after;
+    j["mean_roi_before"] = event.change.mean_before;
+    j["mean_roi_after"] = event.change.mean_after;
+    j["weight"] = event.weight;
+    return j;
+}
+
+std::pair<PatternKey, PatternKey> LearningEngine::fold_into_aggregates(const TradeRecord& trade) {
+    // Both basic and enhanced keys, for compatibility and granularity
+    auto keys = pattern_keys_for(trade);
+    double roi = trade.roi();
+    
+    for (PatternKey key : {keys.first, keys.second}) {
+        auto [agg, inserted] = pattern_aggregates.try_emplace(key.bits);
+        if (inserted) {
+            agg->key = key;
+            patterns_by_pair[key.pair_id()].push_back(key);
+        }
+        agg->add(trade.pnl, trade.gross_pnl, trade.fees_paid, roi);
+        
+        if (agg->total_trades >= 5) {  // Need 5+ samples
+            pattern_database[key.bits] = derive_pattern_metrics(*agg);
+        }
+    }
+    overall.add(trade.pnl, trade.gross_pnl, trade.fees_paid, roi);
     
-    // Auto-analyze every 25 trades
-    if (trade_history.size() % 25 == 0) {
-        std::cout << "\n📊 AUTO-ANALYZING at trade #" << trade_history.size() << "..." << std::endl;
-        analyze_patterns();
+    for (int slot : indicator_slots_for(trade.rsi, trade.macd_histogram, trade.bb_position)) {
+        IndicatorAggregate& ind = indicator_aggregates[slot];
+        ind.total_trades++;
+        if (trade.is_win()) ind.winning_trades++;
+        ind.total_pnl += trade.pnl;
     }
+    return keys;
+}
+
+void LearningEngine::reset_aggregates() {
+    pattern_aggregates.clear();
+    pattern_database.clear();
+    patterns_by_pair.clear();
+    overall = PatternAggregate{};
+    for (IndicatorAggregate& ind : indicator_aggregates) ind = IndicatorAggregate{};
+    
+    {
+        std::lock_guard<std::mutex> lock(risk_mutex);
+        risk_by_pattern.clear();
+        overall_risk = CachedRisk{};
+    }
+    std::lock_guard<std::mutex> lock(ensemble_mutex);
+    bagged_by_pattern.clear();
+}
+
+PatternMetrics LearningEngine::derive_pattern_metrics(const PatternAggregate& agg) const {
+    PatternMetrics metrics;
+    metrics.pair = trades.pairs.name(agg.key.pair_id());
+    metrics.leverage = agg.key.leverage();
+    metrics.timeframe_bucket = agg.key.timeframe_bucket();
+    
+    metrics.total_trades = agg.total_trades;
+    metrics.winning_trades = agg.winning_trades;
+    metrics.losing_trades = agg.losing_trades;
+    metrics.total_pnl = agg.total_pnl;
+    metrics.total_fees = agg.total_fees;
+    if (agg.total_trades == 0) return metrics;
+    
+    // Win rate
+    metrics.win_rate = (double)agg.winning_trades / agg.total_trades;
+    
+    // Averages
+    metrics.avg_win = agg.winning_trades > 0 ? agg.gross_wins / agg.winning_trades : 0;
+    metrics.avg_loss = agg.losing_trades > 0 ? agg.gross_losses / agg.losing_trades : 0;
+    
+    // Profit factor
+    metrics.profit_factor = agg.losing_trades > 0 ? agg.gross_wins / agg.gross_losses : agg.gross_wins;
+    
+    // Statistical measures (same definitions as calculate_sharpe/sortino/max_drawdown)
+    if (agg.total_trades >= 2) {
+        double std_dev = agg.return_std_dev();
+        metrics.sharpe_ratio = std_dev > 0 ? agg.return_mean / std_dev : 0;
+        double downside_std = std::sqrt(agg.downside_sq_sum / agg.total_trades);
+        metrics.sortino_ratio = downside_std > 0 ? agg.return_mean / downside_std : 0;
+    }
+    metrics.max_drawdown = agg.max_drawdown;
+    
+    // Confidence score (0-1)
+    metrics.confidence_score = calculate_confidence_score(metrics);
+    
+    // Edge detection
+    double expected_pnl = (metrics.win_rate * metrics.avg_win) + 
+                        ((1.0 - metrics.win_rate) * -metrics.avg_loss);
+    metrics.has_edge = expected_pnl > metrics.total_fees * 1.5;  // Must beat fees
+    metrics.edge_percentage = metrics.avg_win > 0 ? (expected_pnl / metrics.avg_win) * 100 : 0;
+    
+    return metrics;
 }
 
 void LearningEngine::analyze_patterns() {
-    if (trade_history.size() < MIN_TRADES_FOR_ANALYSIS) {
+    if (get_trade_count() < MIN_TRADES_FOR_ANALYSIS) {
         std::cout << "⏳ Need " << MIN_TRADES_FOR_ANALYSIS << " trades for analysis (have " 
-                  << trade_history.size() << ")" << std::endl;
+                  << get_trade_count() << ")" << std::endl;
         return;
     }
     
-    std::cout << "🤖 LEARNING ENGINE: Analyzing " << trade_history.size() << " trades..." << std::endl;
+    std::cout << "🤖 LEARNING ENGINE: Analyzing " << get_trade_count() << " trades..." << std::endl;
     
-    // 1. GROUP TRADES BY PATTERN (both basic and enhanced)
-    std::map<std::string, std::vector<TradeRecord>> patterns;
-    for (const auto& trade : trade_history) {
-        int timeframe_bucket;
-        if (trade.timeframe_seconds < 30) timeframe_bucket = 0;
-        else if (trade.timeframe_seconds < 60) timeframe_bucket = 1;
-        else if (trade.timeframe_seconds < 120) timeframe_bucket = 2;
-        else timeframe_bucket = 3;
-        
-        // Default to LONG for legacy trades without direction
-        std::string direction = trade.direction.empty() ? "LONG" : trade.direction;
-        
-        // Generate basic key
-        std::string basic_key = generate_pattern_key(trade.pair, direction, trade.leverage, timeframe_bucket);
-        patterns[basic_key].push_back(trade);
-        
-        // Generate enhanced key with volatility and regime
-        std::string enhanced_key = generate_enhanced_pattern_key(trade.pair, direction, trade.leverage, 
-                                                                  timeframe_bucket, trade.volatility_at_entry, 
-                                                                  trade.market_regime);
-        patterns[enhanced_key].push_back(trade);
+    // 1. REBUILD PATTERN AGGREGATES FROM FULL HISTORY (basic and enhanced).
+    // The DB holds full history; without one, the in-memory store is all there is.
+    if (db_) {
+        rebuild_aggregates_from_db();
+    } else {
+        reset_aggregates();
+        for (uint32_t row = 0; row < trades.size(); row++) {
+            fold_into_aggregates(trades.get(row));
+        }
     }
     
-    std::cout << "📊 Generated " << patterns.size() << " unique patterns from " << trade_history.size() << " trades" << std::endl;
+    std::cout << "📊 Generated " << pattern_aggregates.size() << " unique patterns from " << get_trade_count() << " trades" << std::endl;
     
-    // 2. CALCULATE METRICS FOR EACH PATTERN
-    for (auto& [pattern_key, trades] : patterns) {
-        if (trades.size() < 5) continue;  // Need 5+ samples
-        
-        PatternMetrics metrics;
-        metrics.total_trades = trades.size();
-        
-        std::vector<double> returns;
-        double gross_wins = 0, gross_losses = 0;
-        
-        for (const auto& t : trades) {
-            if (t.is_win()) {
-                metrics.winning_trades++;
-                gross_wins += t.gross_pnl;
-                returns.push_back(t.roi());
-            } else {
-                metrics.losing_trades++;
-                gross_losses += std::abs(t.gross_pnl);
-                returns.push_back(t.roi());
-            }
-            metrics.total_pnl += t.pnl;
-            metrics.total_fees += t.fees_paid;
-        }
-        
-        // Parse pattern key: PAIR_DIRECTION_LEVERAGEx_TIMEFRAME
-        // e.g., "BTCUSD_LONG_1x_2" or legacy "BTCUSD_1x_2"
-        size_t pos1 = pattern_key.find('_');
-        size_t pos2 = pattern_key.find('_', pos1 + 1);
-        size_t pos3 = pattern_key.find('_', pos2 + 1);
-        
-        metrics.pair = pattern_key.substr(0, pos1);
-        
-        // Check if this is the new format with direction or legacy format
-        std::string second_part = pattern_key.substr(pos1 + 1, pos2 - pos1 - 1);
-        if (second_part == "LONG" || second_part == "SHORT") {
-            // New format: PAIR_DIRECTION_LEVERAGEx_TIMEFRAME
-            std::string leverage_str = pattern_key.substr(pos2 + 1, pos3 - pos2 - 1);
-            // Remove the 'x' suffix if present
-            if (!leverage_str.empty() && leverage_str.back() == 'x') {
-                leverage_str.pop_back();
-            }
-            metrics.leverage = leverage_str.empty() ? 1.0 : std::stod(leverage_str);
-            metrics.timeframe_bucket = std::stoi(pattern_key.substr(pos3 + 1));
-        } else {
-            // Legacy format: PAIR_LEVERAGEx_TIMEFRAME
-            std::string leverage_str = second_part;
-            // Remove the 'x' suffix if present
-            if (!leverage_str.empty() && leverage_str.back() == 'x') {
-                leverage_str.pop_back();
-            }
-            metrics.leverage = leverage_str.empty() ? 1.0 : std::stod(leverage_str);
-            metrics.timeframe_bucket = std::stoi(pattern_key.substr(pos2 + 1));
-        }
-        
-        // Win rate
-        metrics.win_rate = (double)metrics.winning_trades / metrics.total_trades;
-        
-        // Averages
-        metrics.avg_win = metrics.winning_trades > 0 ? gross_wins / metrics.winning_trades : 0;
-        metrics.avg_loss = metrics.losing_trades > 0 ? gross_losses / metrics.losing_trades : 0;
-        
-        // Profit factor
-        metrics.profit_factor = metrics.losing_trades > 0 ? gross_wins / gross_losses : gross_wins;
-        
-        // Statistical measures
-        metrics.sharpe_ratio = calculate_sharpe_ratio(returns);
-        metrics.sortino_ratio = calculate_sortino_ratio(returns);
-        metrics.max_drawdown = calculate_max_drawdown(returns);
-        
-        // Confidence score (0-1)
-        metrics.confidence_score = calculate_confidence_score(metrics);
-        
-        // Edge detection
-        double expected_pnl = (metrics.win_rate * metrics.avg_win) + 
-                            ((1.0 - metrics.win_rate) * -metrics.avg_loss);
-        metrics.has_edge = expected_pnl > metrics.total_fees * 1.5;  // Must beat fees
-        metrics.edge_percentage = metrics.avg_win > 0 ? (expected_pnl / metrics.avg_win) * 100 : 0;
-        
-        pattern_database[pattern_key] = metrics;
-        
-        // Print
-        if (metrics.winning_trades > 0 || metrics.losing_trades > 0) {
-            std::cout << "  📈 " << pattern_key
-                      << " | Trades: " << std::setw(3) << metrics.total_trades
-                      << " | Win Rate: " << std::fixed << std::setprecision(1) << metrics.win_rate * 100 << "%"
-                      << " | P/F: " << std::setprecision(2) << metrics.profit_factor
-                      << " | Sharpe: " << std::setprecision(2) << metrics.sharpe_ratio
-                      << " | Conf: " << std::setprecision(0) << metrics.confidence_score * 100 << "%"
-                      << (metrics.has_edge ? " ✅" : " ❌") << std::endl;
-        }
+    // 2. REPORT METRICS FOR EACH PATTERN
+    for (const auto& [pattern_key, metrics] : pattern_database) {
+        std::cout << "  📈 " << pattern_name(PatternKey(pattern_key))
+                  << " | Trades: " << std::setw(3) << metrics.total_trades
+                  << " | Win Rate: " << std::fixed << std::setprecision(1) << metrics.win_rate * 100 << "%"
+                  << " | P/F: " << std::setprecision(2) << metrics.profit_factor
+                  << " | Sharpe: " << std::setprecision(2) << metrics.sharpe_ratio
+                  << " | Conf: " << std::setprecision(0) << metrics.confidence_score * 100 << "%"
+                  << (metrics.has_edge ? " ✅" : " ❌") << std::endl;
     }
     
     // 3. IDENTIFY WINNING PATTERNS
@@ -451,43 +907,13 @@ void LearningEngine::analyze_patterns() {
     update_strategy_database();
     
     // 8. SAVE PATTERN DATABASE FOR API ACCESS
-    save_pattern_database_to_file("pattern_database.json");
-}
-
-std::string LearningEngine::generate_pattern_key(const std::string& pair, const std::string& direction, double leverage, int timeframe) const {
-    return pair + "_" + direction + "_" + std::to_string((int)leverage) + "x_" + std::to_string(timeframe);
-}
-
-// NEW: Enhanced pattern key with volatility and regime for more granular patterns
-std::string LearningEngine::generate_enhanced_pattern_key(const std::string& pair, const std::string& direction, 
-                                                           double leverage, int timeframe, 
-                                                           double volatility, int regime) const {
-    // Volatility buckets: 0=low(<2%), 1=med(2-5%), 2=high(5-10%), 3=extreme(>10%)
-    int vol_bucket = 0;
-    if (volatility < 2.0) vol_bucket = 0;
-    else if (volatility < 5.0) vol_bucket = 1;
-    else if (volatility < 10.0) vol_bucket = 2;
-    else vol_bucket = 3;
-    
-    // Regime: 0=quiet, 1=ranging, 2=trending, 3=volatile
-    std::string regime_str;
-    switch (regime) {
-        case 0: regime_str = "Q"; break;  // Quiet
-        case 1: regime_str = "R"; break;  // Ranging
-        case 2: regime_str = "T"; break;  // Trending
-        case 3: regime_str = "V"; break;  // Volatile
-        default: regime_str = "U"; break; // Unknown
-    }
-    
-    return pair + "_" + direction + "_" + std::to_string((int)leverage) + "x_" + 
-           std::to_string(timeframe) + "_V" + std::to_string(vol_bucket) + "_" + regime_str;
+    if (options_.persist_models) save_pattern_database_to_file("pattern_database.json");
 }
 
 // Get pattern metrics by key
-PatternMetrics LearningEngine::get_pattern_metrics(const std::string& pattern_key) const {
-    auto it = pattern_database.find(pattern_key);
-    if (it != pattern_database.end()) {
-        return it->second;
+PatternMetrics LearningEngine::get_pattern_metrics(PatternKey key) const {
+    if (const PatternMetrics* metrics = pattern_database.find(key.bits)) {
+        return *metrics;
     }
     // Return empty metrics if pattern not found
     return PatternMetrics();
@@ -496,11 +922,11 @@ PatternMetrics LearningEngine::get_pattern_metrics(const std::string& pattern_ke
 void LearningEngine::identify_winning_patterns() {
     std::cout << "\n🏆 WINNING PATTERNS:" << std::endl;
     
-    std::vector<std::pair<std::string, PatternMetrics>> winners;
+    std::vector<std::pair<PatternKey, PatternMetrics>> winners;
     
     for (const auto& [key, metrics] : pattern_database) {
         if (metrics.has_edge && metrics.confidence_score >= CONFIDENCE_THRESHOLD) {
-            winners.push_back({key, metrics});
+            winners.push_back({PatternKey(key), metrics});
         }
     }
     
@@ -510,144 +936,387 @@ void LearningEngine::identify_winning_patterns() {
     
     for (int i = 0; i < std::min(5, (int)winners.size()); i++) {
         const auto& [key, metrics] = winners[i];
-        std::cout << "  #" << i+1 << ": " << key
+        std::cout << "  #" << i+1 << ": " << pattern_name(key)
                   << " | PF: " << std::setprecision(2) << metrics.profit_factor
                   << " | WR: " << std::setprecision(1) << metrics.win_rate * 100 << "%"
                   << " | Trades: " << metrics.total_trades << std::endl;
     }
 }
 
+void LearningEngine::refresh_pattern_correlations() {
+    std::vector<PatternKey> edge_patterns;
+    for (const auto& [key, metrics] : pattern_database) {
+        if (metrics.has_edge) edge_patterns.push_back(PatternKey(key));
+    }
+    // Stable row order so an unchanged set reuses the cached matrix as-is
+    std::sort(edge_patterns.begin(), edge_patterns.end());
+    pattern_correlations.update(edge_patterns, ThreadPool::shared());
+}
+
 void LearningEngine::correlate_patterns() {
-    // Check which patterns tend to win/lose together
+    // Check which patterns tend to win/lose together (same hours)
     std::cout << "\n🔗 PATTERN CORRELATIONS:" << std::endl;
     
-    std::vector<std::pair<std::string, double>> correlations;
-    
-    // Simple correlation: if both patterns win frequently
-    for (const auto& [key1, metrics1] : pattern_database) {
-        if (!metrics1.has_edge) continue;
-        
-        for (const auto& [key2, metrics2] : pattern_database) {
-            if (key1 >= key2 || !metrics2.has_edge) continue;
-            
-            // Measure correlation via Pearson coefficient
-            std::vector<double> wins1, wins2;
-            
-            for (const auto& t : trades_by_strategy[key1]) {
-                wins1.push_back(t.is_win() ? 1.0 : 0.0);
-            }
-            for (const auto& t : trades_by_strategy[key2]) {
-                wins2.push_back(t.is_win() ? 1.0 : 0.0);
-            }
-            
-            if (wins1.size() > 0 && wins2.size() > 0) {
-                double mean1 = std::accumulate(wins1.begin(), wins1.end(), 0.0) / wins1.size();
-                double mean2 = std::accumulate(wins2.begin(), wins2.end(), 0.0) / wins2.size();
-                
-                double cov = 0, var1 = 0, var2 = 0;
-                for (size_t i = 0; i < std::min(wins1.size(), wins2.size()); i++) {
-                    cov += (wins1[i] - mean1) * (wins2[i] - mean2);
-                    var1 += std::pow(wins1[i] - mean1, 2);
-                    var2 += std::pow(wins2[i] - mean2, 2);
-                }
-                
-                if (var1 > 0 && var2 > 0) {
-                    double corr = cov / std::sqrt(var1 * var2);
-                    if (std::abs(corr) > 0.3) {
-                        correlations.push_back({key1 + " <-> " + key2, corr});
-                    }
-                }
-            }
-        }
-    }
+    auto start = std::chrono::steady_clock::now();
+    refresh_pattern_correlations();
+    auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
     
     // Show top correlations
-    std::sort(correlations.begin(), correlations.end(),
-        [](const auto& a, const auto& b) { return std::abs(a.second) > std::abs(b.second); });
-    
-    for (int i = 0; i < std::min(3, (int)correlations.size()); i++) {
-        std::cout << "  " << correlations[i].first << ": " 
-                  << std::setprecision(2) << correlations[i].second << std::endl;
+    for (const auto& entry : pattern_correlations.top(3, 0.3)) {
+        std::cout << "  " << pattern_name(entry.a) << " <-> " << pattern_name(entry.b) << ": " 
+                  << std::setprecision(2) << entry.correlation << std::endl;
     }
+    std::cout << "  (" << pattern_correlations.tracked() << " edge patterns, " 
+              << elapsed_us << "us)" << std::endl;
 }
 
 void LearningEngine::detect_regime_shifts() {
-    std::cout << "\n📊 REGIME ANALYSIS:" << std::endl;
-    
-    if (trade_history.size() < 20) {
-        std::cout << "  Insufficient data for regime detection" << std::endl;
-        return;
-    }
+    // The detectors are current as of the last trade (add_to_history);
+    // this only reports them. Formatted locally so std::cout keeps its
+    // precision
+    std::ostringstream report;
+    report << std::fixed << std::setprecision(2);
+    report << "\n📊 REGIME ANALYSIS:\n";
     
-    // Recent vs older trades
-    std::vector<double> recent_rets, old_rets;
+    const PageHinkley& global = overall_shift.detector;
+    report << "  All trades: " << global.count() << " since the last shift, mean ROI "
+           << global.mean() << "%, weight x" << overall_shift.weight << "\n";
     
-    size_t cutoff = trade_history.size() / 2;
-    for (size_t i = 0; i < cutoff; i++) {
-        old_rets.push_back(trade_history[i].roi());
-    }
-    for (size_t i = cutoff; i < trade_history.size(); i++) {
-        recent_rets.push_back(trade_history[i].roi());
+    int down_weighted = 0;
+    for (const auto& [key, state] : shift_by_pattern) {
+        if (state.weight < 1.0) down_weighted++;
     }
+    report << "  " << shift_events_total << " shifts detected, " << down_weighted
+           << " patterns down-weighted\n";
     
-    double old_wr = std::count_if(old_rets.begin(), old_rets.end(),
-        [](double x) { return x > 0; }) / (double)old_rets.size();
-    double recent_wr = std::count_if(recent_rets.begin(), recent_rets.end(),
-        [](double x) { return x > 0; }) / (double)recent_rets.size();
-    
-    std::cout << "  Old period win rate: " << std::setprecision(1) << old_wr * 100 << "%" << std::endl;
-    std::cout << "  Recent period win rate: " << recent_wr * 100 << "%" << std::endl;
+    const size_t shown = std::min<size_t>(5, shift_log.size());
+    for (size_t i = shift_log.size() - shown; i < shift_log.size(); i++) {
+        const ShiftEvent& event = shift_log[i];
+        report << "  " << (event.change.direction == ShiftDirection::DOWN ? "⬇️ " : "⬆️ ")
+               << (event.pattern.bits ? pattern_name(event.pattern) : "all trades")
+               << ": ROI " << event.change.mean_before << "% -> " << event.change.mean_after
+               << "% | weight x" << event.weight << "\n";
+    }
     
-    if (recent_wr < old_wr - 0.15) {
-        std::cout << "  ⚠️  REGIME SHIFT DETECTED - Strategy may need adjustment" << std::endl;
+    if (overall_shift.weight < 1.0) {
+        report << "  ⚠️  REGIME SHIFT DETECTED - learned sizes scaled by x" << overall_shift.weight << "\n";
     }
+    std::cout << report.str() << std::flush;
 }
 
-std::string LearningEngine::detect_market_regime() const {
-    if (trade_history.empty()) return "unknown";
-    
-    // Measure recent volatility and direction
-    std::vector<double> recent_returns;
-    int lookback = std::min(20, (int)trade_history.size());
-    
-    for (int i = trade_history.size() - lookback; i < (int)trade_history.size(); i++) {
-        recent_returns.push_back(trade_history[i].roi());
-    }
-    
-    double avg_return = std::accumulate(recent_returns.begin(), recent_returns.end(), 0.0) / recent_returns.size();
-    double volatility = calculate_std_dev(recent_returns);
-    
-    if (volatility > 5.0) return "high_volatility";
-    if (avg_return > 2.0) return "trending_up";
-    if (avg_return < -2.0) return "trending_down";
-    return "consolidating";
+RiskProfile LearningEngine::get_risk_profile(PatternKey pattern) const {
+    const std::vector<uint32_t>* rows = pattern.bits ? trades_by_strategy.find(pattern.bits) : nullptr;
+    if (rows && rows->size() < RISK_MIN_TRADES) rows = nullptr;
+    const size_t sample_size = rows ? rows->size() : trades.size();
+    if (sample_size < RISK_MIN_TRADES) return RiskProfile{};
+    
+    std::lock_guard<std::mutex> lock(risk_mutex);
+    CachedRisk& cached = rows ? risk_by_pattern[pattern.bits] : overall_risk;
+    if (cached.sample_size > 0 && sample_size < cached.sample_size + cached.sample_size / 4) return cached.profile;
+    
+    std::vector<double> roi(sample_size);
+    for (size_t i = 0; i < sample_size; i++) roi[i] = trades.roi(rows ? (*rows)[i] : i);
+    RiskOptions options;
+    options.paths = (uint32_t)std::min<size_t>(options.paths, sample_size * RISK_PATHS_PER_TRADE);
+    cached.profile = simulate_trade_risk(roi, options, ThreadPool::shared());
+    cached.sample_size = sample_size;
+    return cached.profile;
+}
+
+double LearningEngine::estimate_drawdown_risk(PatternKey pattern) const {
+    return get_risk_profile(pattern).drawdown_p95;
+}
+
+double LearningEngine::estimate_win_rate_at_confidence(double confidence_level, PatternKey pattern) const {
+    return get_risk_profile(pattern).win_rate_at_confidence(confidence_level);
 }
 
 void LearningEngine::update_strategy_database() {
     std::cout << "\n🔄 UPDATING STRATEGY DATABASE..." << std::endl;
     
     strategy_configs.clear();
+    optimize_exit_targets();
+    optimize_leverage_allocation();
+    optimize_position_sizing();
     
     // Create configs from winning patterns
     for (const auto& [key, metrics] : pattern_database) {
         if (!metrics.has_edge || metrics.confidence_score < CONFIDENCE_THRESHOLD) continue;
         
         StrategyConfig config;
-        config.name = key;
-        config.leverage = metrics.leverage;
-        config.timeframe_seconds = metrics.timeframe_bucket * 30 + 15;  // midpoint
+        config.name = pattern_name(PatternKey(key));
+        config.pattern = PatternKey(key);
         config.min_volatility = 0.5;  // 0.5% minimum
         config.max_spread_pct = 0.1;  // 0.1% max spread
-        config.take_profit_pct = metrics.avg_win / 100.0;  // Based on historical
-        config.stop_loss_pct = metrics.avg_loss / 100.0;
-        config.position_size_usd = 100;  // Base size
         config.is_validated = true;
-        config.estimated_edge = metrics.edge_percentage;
+        
+        if (const LearnedExit* exit = learned_exits.find(key)) {
+            // Replayed over the pattern's own post-entry prices
+            config.leverage = exit->leverage;
+            config.timeframe_seconds = exit->hold_s;
+            config.take_profit_pct = exit->tp_pct / 100.0;
+            config.stop_loss_pct = exit->sl_pct / 100.0;
+            config.use_trailing_stop = exit->trailing_start_pct != ExitGrid::NO_TRAILING;
+            config.trailing_start_pct = config.use_trailing_stop ? exit->trailing_start_pct : 0.0;
+            config.trailing_stop_pct = exit->trailing_stop_pct;
+            config.position_size_usd = exit->position_size_usd;
+            config.exits_learned = true;
+            config.estimated_edge = exit->score.mean_net_pct;
+        } else {
+            // No price paths: the pattern's realized averages
+            config.leverage = metrics.leverage;
+            config.timeframe_seconds = metrics.timeframe_bucket * 30 + 15;  // midpoint
+            config.take_profit_pct = metrics.avg_win / 100.0;
+            config.stop_loss_pct = metrics.avg_loss / 100.0;
+            config.position_size_usd = 100;  // Base size
+            config.estimated_edge = metrics.edge_percentage;
+        }
+        config.position_size_usd *= shift_weight(config.pattern);
         
         strategy_configs.push_back(config);
     }
     
-    std::cout << "  ✅ Created " << strategy_configs.size() << " validated strategies" << std::endl;
+    refresh_ensembles();
+    
+    std::cout << "  ✅ Created " << strategy_configs.size() << " validated strategies ("
+              << learned_exits.size() << " with counterfactual exits, "
+              << ensemble_by_pair.size() << " pair ensembles)" << std::endl;
+}
+
+std::vector<const PricePath*> LearningEngine::LearnedExit::path_view() const {
+    std::vector<const PricePath*> view;
+    view.reserve(paths.size());
+    for (const PricePath& path : paths) view.push_back(&path);
+    return view;
+}
+
+PricePath LearningEngine::post_entry_path(uint32_t row, int32_t horizon_s) const {
+    PricePath path;
+    path.is_short = trades.is_short[row];
+    const double entry_price = trades.entry_price[row];
+    if (entry_price <= 0) return path;
+    // Trades are stamped at exit; the hold is recorded
+    const int64_t entry_ms = trades.timestamp_ms[row] - (int64_t)trades.timeframe_seconds[row] * 1000;
+    const int64_t end_ms = entry_ms + (int64_t)horizon_s * 1000;
+    
+    // What the position's monitor saw, up to its exit; the feed continues it
+    int64_t from_ms = entry_ms;
+    if (trades.path_size(row) > 0 &&
+        decode_price_path(trades.path_data(row), trades.path_size(row), path.is_short, path) && path.size() > 0) {
+        from_ms = entry_ms + (int64_t)path.elapsed_s.back() * 1000;
+    }
+    
+    std::lock_guard<std::mutex> lock(market_data_mutex);
+    auto it = real_time_market_data.find(trades.pairs.name(trades.pair_id[row]));
+    if (it == real_time_market_data.end() || it->second.empty() || it->second.front().timestamp > from_ms) {
+        return path;  // Feed starts later: extending would leave a gap
+    }
+    const auto& points = it->second;
+    auto first = std::upper_bound(points.begin(), points.end(), from_ms,
+                                  [](int64_t t, const MarketDataPoint& p) { return t < p.timestamp; });
+    for (auto p = first; p != points.end() && p->timestamp <= end_ms; ++p) {
+        if (p->last_price > 0) path.add((int32_t)((p->timestamp - entry_ms) / 1000), p->last_price, entry_price);
+    }
+    return path;
+}
+
+void LearningEngine::optimize_exit_targets() {
+    learned_exits.clear();
+    const double fee_pct = ROUND_TRIP_FEE_RATE * 100.0;
+    
+    for (const auto& [key, metrics] : pattern_database) {
+        if (!metrics.has_edge || metrics.confidence_score < CONFIDENCE_THRESHOLD) continue;
+        const std::vector<uint32_t>* rows = trades_by_strategy.find(key);
+        if (!rows) continue;
+        
+        LearnedExit exit;
+        for (uint32_t row : *rows) {
+            PricePath path = post_entry_path(row, COUNTERFACTUAL_HORIZON_S);
+            if (path.size() >= 2) exit.paths.push_back(std::move(path));
+        }
+        if ((int)exit.paths.size() < COUNTERFACTUAL_MIN_TRADES) continue;
+        
+        const std::vector<const PricePath*> view = exit.path_view();
+        const ExitGrid grid = exit_candidate_grid(std::max(1.0f, (float)metrics.leverage));
+        const std::vector<ExitScore> scores = score_exit_grid(view, grid, fee_pct, ThreadPool::shared());
+        size_t best = 0;
+        for (size_t c = 1; c < scores.size(); c++) {
+            if (scores[c].lower_bound() > scores[best].lower_bound()) best = c;
+        }
+        if (scores[best].mean_net_pct <= 0) continue;  // Nothing beats fees on these paths
+        
+        exit.tp_pct = grid.tp_pct[best];
+        exit.sl_pct = grid.sl_pct[best];
+        exit.trailing_start_pct = grid.trailing_start_pct[best];
+        exit.trailing_stop_pct = grid.trailing_stop_pct[best];
+        exit.hold_s = grid.hold_s[best];
+        exit.leverage = grid.leverage[best];
+        exit.score = scores[best];
+        exit.outcomes = replay_exit(view, grid, best, fee_pct);
+        learned_exits[key] = std::move(exit);
+    }
+}
+
+void LearningEngine::optimize_leverage_allocation() {
+    // Leverage sets the SL floor (liquidation distance), so it is chosen
+    // together with the SL: keep the winning TP/trailing/hold and take the
+    // pair that grows the paper bankroll fastest at the base stake. Ties
+    // keep the current choice, then the lower leverage.
+    const double fee_pct = ROUND_TRIP_FEE_RATE * 100.0;
+    const double stake = 100.0 / SIZING_BANKROLL;   // Base position size
+    
+    for (auto& [key, exit] : learned_exits) {
+        const std::vector<const PricePath*> view = exit.path_view();
+        ExitGrid grid;
+        for (float leverage : LEVERAGE_CHOICES) {
+            for (float sl : stop_candidates(leverage)) {
+                grid.add(exit.tp_pct, sl, exit.trailing_start_pct, exit.trailing_stop_pct, exit.hold_s, leverage);
+            }
+        }
+        const std::vector<ExitScore> scores = score_exit_grid(view, grid, fee_pct, ThreadPool::shared());
+        double best_growth = log_growth(exit.outcomes, stake);
+        for (size_t c = 0; c < grid.size(); c++) {
+            if (scores[c].mean_net_pct <= 0) continue;
+            std::vector<ExitOutcome> outcomes = replay_exit(view, grid, c, fee_pct);
+            double growth = log_growth(outcomes, stake);
+            if (growth <= best_growth) continue;
+            best_growth = growth;
+            exit.leverage = grid.leverage[c];
+            exit.sl_pct = grid.sl_pct[c];
+            exit.score = scores[c];
+            exit.outcomes = std::move(outcomes);
+        }
+    }
+}
+
+void LearningEngine::optimize_position_sizing() {
+    // Fractional Kelly on the replayed outcomes, like execute_trade's sizing
+    // on realized ones
+    for (auto& [key, exit] : learned_exits) {
+        double kelly = kelly_fraction(exit.outcomes) * SIZING_KELLY_FRACTION;
+        exit.position_size_usd = std::clamp(SIZING_BANKROLL * kelly, 10.0, 200.0);
+    }
+}
+
+std::vector<double> LearningEngine::strategy_returns(const StrategyConfig& config) const {
+    std::vector<double> returns;
+    if (!config.pattern.bits) return returns;
+    const LearnedExit* exit = config.exits_learned ? learned_exits.find(config.pattern.bits) : nullptr;
+    if (exit) {
+        // What the config's own exits would have made on the pattern's paths
+        const size_t first = exit->outcomes.size() - std::min(exit->outcomes.size(), ENSEMBLE_MAX_SAMPLE);
+        for (size_t i = first; i < exit->outcomes.size(); i++) returns.push_back(exit->outcomes[i].net_pct);
+    } else if (const std::vector<uint32_t>* rows = trades_by_strategy.find(config.pattern.bits)) {
+        const size_t first = rows->size() - std::min(rows->size(), ENSEMBLE_MAX_SAMPLE);
+        for (size_t i = first; i < rows->size(); i++) returns.push_back(trades.roi((*rows)[i]));
+    }
+    return returns;
+}
+
+std::vector<BaggedScore> LearningEngine::bagged_scores(const std::vector<StrategyConfig>& candidates) const {
+    std::vector<std::vector<double>> samples(candidates.size());
+    std::vector<double> sums(candidates.size(), 0.0);
+    std::vector<BaggedScore> scores(candidates.size());
+    std::vector<size_t> stale;
+    
+    std::lock_guard<std::mutex> lock(ensemble_mutex);
+    for (size_t i = 0; i < candidates.size(); i++) {
+        samples[i] = strategy_returns(candidates[i]);
+        sums[i] = std::accumulate(samples[i].begin(), samples[i].end(), 0.0);
+        const CachedBag* cached = bagged_by_pattern.find(candidates[i].pattern.bits);
+        if (cached && cached->sample_size == samples[i].size() && cached->sample_sum == sums[i]) {
+            scores[i] = cached->score;
+        } else if (candidates[i].pattern.bits) {
+            stale.push_back(i);
+        }
+    }
+    if (stale.empty()) return scores;
+    
+    std::vector<const std::vector<double>*> views;
+    std::vector<uint64_t> seeds;
+    for (size_t i : stale) {
+        views.push_back(&samples[i]);
+        seeds.push_back(candidates[i].pattern.bits);
+    }
+    const std::vector<BaggedScore> fresh = bag_sample_means(views, seeds, BaggingOptions{}, ThreadPool::shared());
+    for (size_t j = 0; j < stale.size(); j++) {
+        const size_t i = stale[j];
+        scores[i] = fresh[j];
+        bagged_by_pattern[candidates[i].pattern.bits] = CachedBag{samples[i].size(), sums[i], fresh[j]};
+    }
+    return scores;
+}
+
+StrategyConfig LearningEngine::create_ensemble_strategy(const std::vector<StrategyConfig>& candidates) const {
+    if (candidates.empty()) return StrategyConfig{};
+    const std::vector<BaggedScore> scores = bagged_scores(candidates);
+    std::vector<double> weights = ensemble_weights(scores, BaggingOptions{});
+    // Patterns whose returns recently dropped count for less
+    double total = 0.0;
+    for (size_t i = 0; i < weights.size(); i++) total += weights[i] *= shift_weight(candidates[i].pattern);
+    if (total > 0.0) {
+        for (double& w : weights) w /= total;
+    }
+    const size_t base = std::max_element(weights.begin(), weights.end()) - weights.begin();
+    if (weights[base] <= 0.0) {
+        // No bagged edge anywhere: the best point estimate
+        return *std::max_element(candidates.begin(), candidates.end(),
+            [](const auto& a, const auto& b) { return a.estimated_edge < b.estimated_edge; });
+    }
+    
+    StrategyConfig blend = candidates[base];
+    double tp = 0, sl = 0, hold = 0, size = 0, edge = 0;
+    double learned_weight = 0, trailing_weight = 0, trailing_start = 0, trailing_stop = 0;
+    int members = 0;
+    for (size_t i = 0; i < candidates.size(); i++) {
+        const double w = weights[i];
+        if (w <= 0.0) continue;
+        const StrategyConfig& c = candidates[i];
+        members++;
+        tp += w * c.take_profit_pct;
+        sl += w * c.stop_loss_pct;
+        hold += w * c.timeframe_seconds;
+        size += w * c.position_size_usd;
+        edge += w * scores[i].mean;
+        if (!c.exits_learned) continue;
+        learned_weight += w;
+        if (!c.use_trailing_stop) continue;
+        trailing_weight += w;
+        trailing_start += w * c.trailing_start_pct;
+        trailing_stop += w * c.trailing_stop_pct;
+    }
+    blend.take_profit_pct = tp;
+    blend.stop_loss_pct = sl;
+    blend.timeframe_seconds = (int)std::lround(hold);
+    blend.position_size_usd = size;
+    blend.estimated_edge = edge;
+    blend.ensemble_members = members;
+    if (blend.exits_learned) {
+        // Trailing if most of the learned weight trails
+        blend.use_trailing_stop = trailing_weight * 2 >= learned_weight && trailing_weight > 0;
+        if (blend.use_trailing_stop) {
+            blend.trailing_start_pct = trailing_start / trailing_weight;
+            blend.trailing_stop_pct = trailing_stop / trailing_weight;
+        }
+    }
+    if (members > 1) blend.name = "ensemble_" + blend.name;
+    return blend;
+}
+
+void LearningEngine::refresh_ensembles() {
+    // Bag every stale candidate in one parallel batch, then blend per pair
+    // from the cache
+    bagged_scores(strategy_configs);
+    
+    FlatHashMap<std::vector<StrategyConfig>> by_pair;
+    for (const StrategyConfig& config : strategy_configs) {
+        if (config.pattern.pair_id()) by_pair[config.pattern.pair_id()].push_back(config);
+    }
+    ensemble_by_pair.clear();
+    for (const auto& [pair_id, candidates] : by_pair) {
+        ensemble_by_pair[pair_id] = create_ensemble_strategy(candidates);
+    }
 }
 
 StrategyConfig LearningEngine::get_optimal_strategy(const std::string& pair, double current_volatility) {
@@ -656,11 +1325,17 @@ StrategyConfig LearningEngine::get_optimal_strategy(const std::string& pair, dou
     int pair_wins = 0;
     double pair_pnl = 0;
     
-    for (const auto& [key, metrics] : pattern_database) {
-        if (key.find(pair + "_") == 0) {
-            total_pair_trades += metrics.total_trades;
-            pair_wins += metrics.winning_trades;
-            pair_pnl += metrics.total_pnl;
+    // Per-pair index: this pair's basic and enhanced patterns, no table scan
+    uint32_t pair_id = trades.pairs.find(pair);
+    static const std::vector<PatternKey> no_patterns;
+    const std::vector<PatternKey>* indexed = pair_id ? patterns_by_pair.find(pair_id) : nullptr;
+    const std::vector<PatternKey>& pair_patterns = indexed ? *indexed : no_patterns;
+    
+    for (PatternKey key : pair_patterns) {
+        if (const PatternMetrics* metrics = pattern_database.find(key.bits)) {
+            total_pair_trades += metrics->total_trades;
+            pair_wins += metrics->winning_trades;
+            pair_pnl += metrics->total_pnl;
         }
     }
     
@@ -685,27 +1360,15 @@ StrategyConfig LearningEngine::get_optimal_strategy(const std::string& pair, dou
         }
     }
     
-    // If we have learned strategies with edge, use them
-    if (!strategy_configs.empty()) {
-        std::vector<StrategyConfig> candidates;
-        
-        for (const auto& config : strategy_configs) {
-            if (config.name.find(pair) == 0 && current_volatility >= config.min_volatility) {
-                candidates.push_back(config);
-            }
-        }
-        
-        if (!candidates.empty()) {
-            // Return best (highest estimated edge)
-            auto best = std::max_element(candidates.begin(), candidates.end(),
-                [](const auto& a, const auto& b) {
-                    return a.estimated_edge < b.estimated_edge;
-                });
-            
-            std::cout << "🎯 Using LEARNED strategy for " << pair 
-                      << " | Edge: " << std::fixed << std::setprecision(1) << best->estimated_edge << "%" << std::endl;
-            return *best;
-        }
+    // If we have learned strategies with edge, use this pair's ensemble
+    // (blended by refresh_ensembles() once per strategy update)
+    const StrategyConfig* ensemble = pair_id ? ensemble_by_pair.find(pair_id) : nullptr;
+    if (ensemble && current_volatility >= ensemble->min_volatility) {
+        std::cout << "🎯 Using LEARNED strategy for " << pair 
+                  << " | Edge: " << std::fixed << std::setprecision(1) << ensemble->estimated_edge << "%";
+        if (ensemble->ensemble_members > 1) std::cout << " | Ensemble of " << ensemble->ensemble_members;
+        std::cout << std::endl;
+        return *ensemble;
     }
     
     // Check if we have pattern data and use it to customize strategy
@@ -713,15 +1376,16 @@ StrategyConfig LearningEngine::get_optimal_strategy(const std::string& pair, dou
     double best_leverage = 1.0;
     int best_timeframe = 60;
     
-    for (const auto& [key, metrics] : pattern_database) {
-        if (key.find(pair + "_") == 0 && metrics.total_trades >= 3 && metrics.win_rate > best_win_rate) {
-            best_win_rate = metrics.win_rate;
-            best_leverage = metrics.leverage;
-            best_timeframe = metrics.timeframe_bucket * 30 + 30;
+    for (PatternKey key : pair_patterns) {
+        const PatternMetrics* metrics = pattern_database.find(key.bits);
+        if (metrics && metrics->total_trades >= 3 && metrics->win_rate > best_win_rate) {
+            best_win_rate = metrics->win_rate;
+            best_leverage = metrics->leverage;
+            best_timeframe = metrics->timeframe_bucket * 30 + 30;
             
             std::cout << "📊 Found winning pattern for " << pair 
-                      << " | WR: " << std::fixed << std::setprecision(1) << (metrics.win_rate * 100) << "%"
-                      << " | Leverage: " << metrics.leverage << "x" << std::endl;
+                      << " | WR: " << std::fixed << std::setprecision(1) << (metrics->win_rate * 100) << "%"
+                      << " | Leverage: " << metrics->leverage << "x" << std::endl;
         }
     }
     
@@ -758,12 +1422,11 @@ StrategyConfig LearningEngine::get_optimal_strategy(const std::string& pair, dou
     return adaptive;
 }
 
-PatternMetrics LearningEngine::get_pattern_metrics(const std::string& pair, double leverage, int timeframe_bucket) const {
-    std::string key = pair + "_" + std::to_string((int)leverage) + "x_" + std::to_string(timeframe_bucket);
-    if (pattern_database.count(key)) {
-        return pattern_database.at(key);
-    }
-    return PatternMetrics{};
+PatternMetrics LearningEngine::get_pattern_metrics(const std::string& pair, const std::string& direction,
+                                                   double leverage, int timeframe_bucket) const {
+    uint32_t pair_id = trades.pairs.find(pair);
+    if (!pair_id) return PatternMetrics{};
+    return get_pattern_metrics(PatternKey::basic(pair_id, direction == "SHORT", leverage, timeframe_bucket));
 }
 
 // Statistical helpers
@@ -827,9 +1490,10 @@ double LearningEngine::calculate_confidence_score(const PatternMetrics& metrics)
 void LearningEngine::save_to_file(const std::string& filepath) {
     json data;
     data["version"] = "2.0";
-    data["total_trades"] = trade_history.size();
+    data["total_trades"] = trades.size();
     
-    for (const auto& t : trade_history) {
+    for (size_t row = 0; row < trades.size(); row++) {
+        const TradeRecord t = trades.get(row);
         json trade_json;
         // Core trade data
         trade_json["pair"] = t.pair;
@@ -869,6 +1533,8 @@ void LearningEngine::save_to_file(const std::string& filepath) {
         // Trade dynamics
         trade_json["max_profit"] = t.max_profit;
         trade_json["max_loss"] = t.max_loss;
+        trade_json["bars_high"] = t.bars_high;
+        trade_json["bars_low"] = t.bars_low;
         
         data["trades"].push_back(trade_json);
     }
@@ -877,7 +1543,7 @@ void LearningEngine::save_to_file(const std::string& filepath) {
     file << data.dump(2) << std::endl;
     file.close();
     
-    std::cout << "💾 Saved " << trade_history.size() << " trades to " << filepath << std::endl;
+    std::cout << "💾 Saved " << trades.size() << " trades to " << filepath << std::endl;
 }
 
 void LearningEngine::backup_trade_log(const std::string& filepath) {
@@ -967,6 +1633,7 @@ void LearningEngine::save_pattern_database_to_file(const std::string& filepath)
     for (const auto& [key, metrics] : pattern_database) {
         json pattern_json;
         pattern_json["pair"] = metrics.pair;
+        pattern_json["direction"] = PatternKey(key).direction();
         pattern_json["leverage"] = metrics.leverage;
         pattern_json["timeframe_bucket"] = metrics.timeframe_bucket;
         pattern_json["total_trades"] = metrics.total_trades;
@@ -984,12 +1651,17 @@ void LearningEngine::save_pattern_database_to_file(const std::string& filepath)
         pattern_json["edge_percentage"] = metrics.edge_percentage;
         pattern_json["total_pnl"] = metrics.total_pnl;
         pattern_json["total_fees"] = metrics.total_fees;
+        pattern_json["shift_weight"] = shift_weight(PatternKey(key));
         
-        patterns_json[key] = pattern_json;
+        patterns_json[pattern_name(PatternKey(key))] = pattern_json;
     }
     
     data["pattern_database"] = patterns_json;
     
+    json shifts = json::array();
+    for (const ShiftEvent& event : shift_log) shifts.push_back(shift_event_json(event));
+    data["regime_shifts"] = shifts;
+    
     std::ofstream file(filepath);
     file << data.dump(2) << std::endl;
     file.close();
@@ -1010,9 +1682,12 @@ void LearningEngine::load_from_file(const std::string& filepath) {
     
     // Parse and load trade history
     if (data.contains("trades") && data["trades"].is_array()) {
-        trade_history.clear();
+        trades.clear();
         trades_by_pair.clear();
         trades_by_strategy.clear();
+        pattern_correlations.clear();
+        reset_aggregates();
+        reset_regime_shifts();
         
         for (const auto& trade_json : data["trades"]) {
             TradeRecord trade;
@@ -1039,26 +1714,16 @@ void LearningEngine::load_from_file(const std::string& filepath) {
             trade.fees_paid = 0.0;
             trade.volatility_at_entry = 0.0;
             trade.bid_ask_spread = 0.0;
+            trade.max_profit = trade_json.value("max_profit", 0.0);
+            trade.max_loss = trade_json.value("max_loss", 0.0);
+            trade.bars_high = trade_json.value("bars_high", 0);
+            trade.bars_low = trade_json.value("bars_low", 0);
             
-            trade_history.push_back(trade);
-            
-            // Update auxiliary data structures
-            trades_by_pair[trade.pair].push_back(trade);
-            
-            int timeframe_bucket = 1;  // Default bucket for 60s
-            // Default to LONG for legacy trades without direction
-            std::string direction = trade.direction.empty() ? "LONG" : trade.direction;
-            std::string key = generate_pattern_key(trade.pair, direction, trade.leverage, timeframe_bucket);
-            trades_by_strategy[key].push_back(trade);
+            fold_into_aggregates(trade);
+            add_to_history(trade);
         }
         
-        std::cout << "📂 Loaded " << trade_history.size() << " trades from " << filepath << std::endl;
-        
-        // Run analysis if we have enough data
-        if (trade_history.size() >= MIN_TRADES_FOR_ANALYSIS) {
-            std::cout << "🔄 Running initial pattern analysis..." << std::endl;
-            analyze_patterns();
-        }
+        std::cout << "📂 Loaded " << trades.size() << " trades from " << filepath << std::endl;
     } else {
         std::cout << "⚠️  No trades found in " << filepath << std::endl;
     }
@@ -1066,25 +1731,52 @@ void LearningEngine::load_from_file(const std::string& filepath) {
 
 json LearningEngine::get_statistics_json() const {
     json stats;
-    stats["total_trades"] = trade_history.size();
+    stats["total_trades"] = overall.total_trades;
     stats["patterns_found"] = pattern_database.size();
     stats["strategies"] = strategy_configs.size();
     
-    double total_pnl = 0;
-    int wins = 0;
-    for (const auto& t : trade_history) {
-        total_pnl += t.pnl;
-        if (t.is_win()) wins++;
+    // Full history from the running aggregate
+    stats["total_pnl"] = overall.total_pnl;
+    stats["win_rate"] = overall.total_trades == 0 ? 0 : (double)overall.winning_trades / overall.total_trades;
+    
+    // Market regime: the shared regime engine's pairs by most likely state
+    json& regime = stats["regime"];
+    const auto counts = market_regimes.pair_counts();
+    size_t dominant = 0, observed = 0;
+    for (size_t r = 0; r < REGIME_COUNT; r++) {
+        regime["pairs"][regime_to_string((MarketRegime)r)] = counts[r];
+        observed += counts[r];
+        if (counts[r] > counts[dominant]) dominant = r;
+    }
+    regime["dominant"] = observed == 0 ? "unknown" : regime_to_string((MarketRegime)dominant);
+    
+    // Online vs static direction model (progressive validation, shadow mode)
+    json& shadow = stats["direction_shadow"];
+    shadow["online_updates"] = online_direction.updates();
+    shadow["online_log_loss"] = online_direction.score().log_loss();
+    shadow["online_accuracy"] = online_direction.score().accuracy();
+    shadow["static_trades"] = static_direction_score.count;
+    shadow["static_log_loss"] = static_direction_score.log_loss();
+    shadow["static_accuracy"] = static_direction_score.accuracy();
+    
+    RiskProfile risk = get_risk_profile();
+    if (!risk.empty()) stats["risk"] = risk.to_json();
+    
+    json& shifts = stats["regime_shifts"];
+    shifts["detected"] = shift_events_total;
+    shifts["global_weight"] = overall_shift.weight;
+    shifts["recent"] = json::array();
+    for (size_t i = shift_log.size() - std::min<size_t>(10, shift_log.size()); i < shift_log.size(); i++) {
+        shifts["recent"].push_back(shift_event_json(shift_log[i]));
     }
     
-    stats["total_pnl"] = total_pnl;
-    stats["win_rate"] = trade_history.empty() ? 0 : (double)wins / trade_history.size();
-    stats["regime"] = detect_market_regime();
-    
     return stats;
 }
 
 void LearningEngine::print_summary() const {
+    // Restored on the way out: later output expects the default format
+    const std::ios::fmtflags flags = std::cout.flags();
+    const std::streamsize precision = std::cout.precision();
     std::cout << "\n" << std::string(60, '=') << std::endl;
     std::cout << "🎯 LEARNING ENGINE SUMMARY" << std::endl;
     std::cout << std::string(60, '=') << std::endl;
@@ -1096,8 +1788,21 @@ void LearningEngine::print_summary() const {
     std::cout << "  Total P&L: $" << std::setprecision(2) << stats["total_pnl"] << std::endl;
     std::cout << "  Patterns Found: " << stats["patterns_found"] << std::endl;
     std::cout << "  Validated Strategies: " << stats["strategies"] << std::endl;
-    std::cout << "  Market Regime: " << stats["regime"] << std::endl;
+    std::cout << "  Market Regime: " << stats["regime"]["dominant"].get<std::string>()
+              << " (pairs " << stats["regime"]["pairs"].dump() << ")" << std::endl;
+    if (stats.contains("risk")) {
+        const json& risk = stats["risk"];
+        std::cout << "  Drawdown (next " << risk["horizon"] << " trades): p50 " << std::setprecision(1)
+                  << double(risk["drawdown_p50"]) << "%, p95 " << double(risk["drawdown_p95"])
+                  << "%, p99 " << double(risk["drawdown_p99"]) << "% of position" << std::endl;
+        std::cout << "  Win Rate (95% lower bound): " << double(risk["win_rate_p95"]) * 100 << "%" << std::endl;
+    }
+    const json& shifts = stats["regime_shifts"];
+    std::cout << "  Regime Shifts: " << shifts["detected"] << " (sizes x" << std::setprecision(2)
+              << double(shifts["global_weight"]) << ")" << std::endl;
     std::cout << std::string(60, '=') << std::endl;
+    std::cout.flags(flags);
+    std::cout.precision(precision);
 }
 
 // ============================================================================
@@ -1286,85 +1991,22 @@ LearningEngine::TechnicalSignals LearningEngine::calculate_signals(
 json LearningEngine::analyze_indicator_effectiveness() const {
     json results;
     
-    if (trade_history.size() < 10) {
+    if (get_trade_count() < 10) {
         results["error"] = "Need at least 10 trades for indicator analysis";
         return results;
     }
     
-    // Analyze which indicator values correlate with wins
-    struct IndicatorBucket {
-        int count = 0;
-        int wins = 0;
-        double avg_pnl = 0;
-    };
-    
-    // RSI buckets: oversold (0-30), neutral (30-70), overbought (70-100)
-    std::map<std::string, IndicatorBucket> rsi_buckets = {
-        {"oversold", {}}, {"neutral", {}}, {"overbought", {}}
-    };
-    
-    // MACD buckets: negative, positive
-    std::map<std::string, IndicatorBucket> macd_buckets = {
-        {"negative", {}}, {"positive", {}}
-    };
-    
-    // BB position buckets: near_lower, middle, near_upper
-    std::map<std::string, IndicatorBucket> bb_buckets = {
-        {"near_lower", {}}, {"middle", {}}, {"near_upper", {}}
-    };
-    
-    for (const auto& trade : trade_history) {
-        // RSI analysis
-        std::string rsi_bucket = trade.rsi < 30 ? "oversold" : 
-                                  (trade.rsi > 70 ? "overbought" : "neutral");
-        rsi_buckets[rsi_bucket].count++;
-        if (trade.is_win()) rsi_buckets[rsi_bucket].wins++;
-        rsi_buckets[rsi_bucket].avg_pnl += trade.pnl;
-        
-        // MACD analysis
-        std::string macd_bucket = trade.macd_histogram > 0 ? "positive" : "negative";
-        macd_buckets[macd_bucket].count++;
-        if (trade.is_win()) macd_buckets[macd_bucket].wins++;
-        macd_buckets[macd_bucket].avg_pnl += trade.pnl;
-        
-        // BB analysis
-        std::string bb_bucket = trade.bb_position < 0.3 ? "near_lower" :
-                                (trade.bb_position > 0.7 ? "near_upper" : "middle");
-        bb_buckets[bb_bucket].count++;
-        if (trade.is_win()) bb_buckets[bb_bucket].wins++;
-        bb_buckets[bb_bucket].avg_pnl += trade.pnl;
-    }
-    
-    // Build results
-    json rsi_results;
-    for (auto& [bucket, data] : rsi_buckets) {
-        if (data.count > 0) {
-            rsi_results[bucket]["count"] = data.count;
-            rsi_results[bucket]["win_rate"] = (double)data.wins / data.count * 100;
-            rsi_results[bucket]["avg_pnl"] = data.avg_pnl / data.count;
-        }
-    }
-    results["rsi"] = rsi_results;
-    
-    json macd_results;
-    for (auto& [bucket, data] : macd_buckets) {
-        if (data.count > 0) {
-            macd_results[bucket]["count"] = data.count;
-            macd_results[bucket]["win_rate"] = (double)data.wins / data.count * 100;
-            macd_results[bucket]["avg_pnl"] = data.avg_pnl / data.count;
+    // Full-history buckets, maintained per trade by fold_into_aggregates
+    // (RSI 0-30/30-70/70-100, MACD sign, BB position 0.3/0.7)
+    for (int slot = 0; slot < INDICATOR_SLOTS; slot++) {
+        const IndicatorAggregate& data = indicator_aggregates[slot];
+        if (data.total_trades > 0) {
+            json& out = results[INDICATOR_NAMES[slot][0]][INDICATOR_NAMES[slot][1]];
+            out["count"] = data.total_trades;
+            out["win_rate"] = (double)data.winning_trades / data.total_trades * 100;
+            out["avg_pnl"] = data.total_pnl / data.total_trades;
         }
     }
-    results["macd"] = macd_results;
-    
-    json bb_results;
-    for (auto& [bucket, data] : bb_buckets) {
-        if (data.count > 0) {
-            bb_results[bucket]["count"] = data.count;
-            bb_results[bucket]["win_rate"] = (double)data.wins / data.count * 100;
-            bb_results[bucket]["avg_pnl"] = data.avg_pnl / data.count;
-        }
-    }
-    results["bollinger_bands"] = bb_results;
     
     return results;
 }
@@ -1429,26 +2071,41 @@ void LearningEngine::analyze_indicator_patterns() {
 
 void LearningEngine::update_market_data(const MarketDataPoint& data) {
     std::lock_guard<std::mutex> lock(market_data_mutex);
+    append_market_point(data);
+}
+
+bool LearningEngine::append_market_point(const MarketDataPoint& data) {
+    // Keep every per-pair series strictly chronological: duplicates and
+    // out-of-order ticks would corrupt the indicator inputs
+    auto latest = latest_market_data.find(data.pair);
+    if (latest != latest_market_data.end() && data.timestamp <= latest->second.timestamp) {
+        return false;
+    }
     
     // Update latest data
     latest_market_data[data.pair] = data;
     
     // Add to historical data
-    real_time_market_data[data.pair].push_back(data);
+    auto& points = real_time_market_data[data.pair];
+    points.push_back(data);
     
     // Maintain size limit
-    if (real_time_market_data[data.pair].size() > MAX_MARKET_DATA_SIZE) {
-        real_time_market_data[data.pair].pop_front();
+    if (points.size() > MAX_MARKET_DATA_SIZE) {
+        points.pop_front();
     }
     
     // Update price history for indicators
-    price_history[data.pair].push_back(data.last_price);
-    volume_history[data.pair].push_back(data.volume);
+    auto& prices = price_history[data.pair];
+    auto& volumes = volume_history[data.pair];
+    prices.push_back(data.last_price);
+    volumes.push_back(data.volume);
     
-    if (price_history[data.pair].size() > MAX_HISTORY_SIZE) {
-        price_history[data.pair].pop_front();
-        volume_history[data.pair].pop_front();
+    if (prices.size() > MAX_HISTORY_SIZE) {
+        prices.pop_front();
+        volumes.pop_front();
     }
+    if (!options_.regimes) own_regimes.update(data.pair, data.last_price, data.volatility_pct);
+    return true;
 }
 
 LearningEngine::MarketDataPoint LearningEngine::get_latest_market_data(const std::string& pair) const {
@@ -1460,7 +2117,7 @@ LearningEngine::MarketDataPoint LearningEngine::get_latest_market_data(const std
     }
     
     // Return empty data point if not found
-    return MarketDataPoint{pair, 0.0, 0.0, 0.0, 0.0, 0.0, 0, 0.0, 0};
+    return MarketDataPoint{pair, 0.0, 0.0, 0.0, 0.0, 0.0, 0, 0.0, 0, RegimeEstimate{}};
 }
 
 std::vector<LearningEngine::MarketDataPoint> LearningEngine::get_recent_market_data(const std::string& pair, int minutes) const {
@@ -1472,9 +2129,7 @@ std::vector<LearningEngine::MarketDataPoint> LearningEngine::get_recent_market_d
     }
     
     const auto& data = it->second;
-    int64_t cutoff_time = std::chrono::duration_cast<std::chrono::milliseconds>(
-        std::chrono::system_clock::now().time_since_epoch()
-    ).count() - (minutes * 60 * 1000);
+    int64_t cutoff_time = options_.clock->now_ms() - (minutes * 60 * 1000);
     
     std::vector<MarketDataPoint> recent_data;
     for (const auto& point : data) {
@@ -1487,42 +2142,21 @@ std::vector<LearningEngine::MarketDataPoint> LearningEngine::get_recent_market_d
 }
 
 void LearningEngine::adapt_strategies_to_market_conditions() {
-    // Analyze current market conditions and update strategy parameters
-    for (auto& [pair, data] : latest_market_data) {
-        double current_volatility = calculate_real_time_volatility(pair);
-        int current_regime = detect_real_time_regime(pair);
-        
-        // Adjust strategy parameters based on market conditions
-        auto pattern_key = pair + "_adaptive";
-        auto it = pattern_database.find(pattern_key);
-        if (it != pattern_database.end()) {
-            auto& metrics = it->second;
-            
-            // Adjust take profit based on volatility
-            if (current_volatility > 2.0) {
-                // High volatility - tighter TP
-                metrics.total_pnl *= 0.95;  // Conservative adjustment
-            } else if (current_volatility < 0.5) {
-                // Low volatility - wider TP but longer hold time
-                metrics.total_pnl *= 1.02;  // Slight optimism
-            }
-            
-            // Adjust based on regime
-            if (current_regime == 0) {  // Consolidation
-                // Be more conservative in ranging markets
-                metrics.win_rate *= 0.98;
-            }
-        }
-    }
+    // Real-time volatility/regime adjustments are applied per request in
+    // get_adaptive_strategy(). Stored pattern metrics are derived from trade
+    // aggregates and are not nudged here (the old "<pair>_adaptive" entries
+    // this used to adjust were never created).
 }
 
 StrategyConfig LearningEngine::get_adaptive_strategy(const std::string& pair, const MarketDataPoint& current_data) {
     // Get base strategy
     StrategyConfig base_strategy = get_optimal_strategy(pair, current_data.volatility_pct);
     
-    // Adapt based on real-time conditions
+    // Adapt based on real-time conditions. Regime: the scan's estimate if the
+    // point came from a scan, else the pair's current one
     double real_time_volatility = calculate_real_time_volatility(pair);
-    int real_time_regime = detect_real_time_regime(pair);
+    const RegimeEstimate regime = current_data.regime.observations > 0 ? current_data.regime
+                                                                        : detect_real_time_regime(pair);
     
     // Adjust take profit based on current volatility
     if (real_time_volatility > current_data.volatility_pct * 1.5) {
@@ -1535,16 +2169,17 @@ StrategyConfig LearningEngine::get_adaptive_strategy(const std::string& pair, co
         base_strategy.timeframe_seconds *= 1.2;  // Longer hold time
     }
     
-    // Adjust based on regime
-    if (real_time_regime == 0) {  // Consolidation
-        base_strategy.take_profit_pct *= 0.9;  // More conservative
-        base_strategy.timeframe_seconds *= 0.8;  // Shorter hold time
-    } else if (real_time_regime == 1) {  // Uptrend
-        base_strategy.take_profit_pct *= 1.05;  // Slightly more aggressive
+    // Adjust by regime posterior: consolidation (quiet or ranging) is more
+    // conservative with a shorter hold, an uptrend slightly more aggressive
+    if (regime.observations > 0) {
+        double consolidation = regime.p(MarketRegime::QUIET) + regime.p(MarketRegime::RANGING);
+        double uptrend = regime.trend_up() ? regime.p(MarketRegime::TRENDING) : 0.0;
+        base_strategy.take_profit_pct *= 1.0 - 0.1 * consolidation + 0.05 * uptrend;
+        base_strategy.timeframe_seconds *= 1.0 - 0.2 * consolidation;
     }
 
     // If we have a direction model, use it to bias direction and leverage
-    if (direction_model_loaded) {
+    if (direction_model.current()) {
         double score = score_direction_model(current_data);
         double prob = 1.0 / (1.0 + std::exp(-score));
         // If model strongly favors one direction, set a suggested leverage and mark validated
@@ -1565,21 +2200,22 @@ StrategyConfig LearningEngine::get_adaptive_strategy(const std::string& pair, co
 
 // Simple direction model scoring: returns score (logit). Positive => LONG, Negative => SHORT
 double LearningEngine::score_direction_model(const MarketDataPoint& current_data) const {
-    if (!direction_model_loaded) return 0.0;
-    double s = direction_model_bias;
-    auto addw = [&](const std::string& k, double v) {
-        if (direction_model_weights.count(k)) s += direction_model_weights.at(k) * v;
-    };
-    addw("volatility_pct", current_data.volatility_pct);
-    addw("market_regime", (double)current_data.market_regime);
-    if (current_data.vwap > 0) {
-        double vdev = (current_data.last_price - current_data.vwap) / current_data.vwap * 100.0;
-        addw("vwap_dev", vdev);
-    }
-    addw("volume", current_data.volume);
-    addw("last_price", current_data.last_price);
-    addw("volatility_pct_sq", current_data.volatility_pct * current_data.volatility_pct);
-    return s;
+    DirectionModel::Ptr model = direction_model.current();
+    if (!model) return 0.0;
+    return model->score(direction_features_for(current_data));
+}
+
+DirectionFeatures LearningEngine::direction_features_for(const MarketDataPoint& data) {
+    DirectionFeatures x{};
+    x[(size_t)DirectionFeature::VOLATILITY_PCT] = data.volatility_pct;
+    x[(size_t)DirectionFeature::MARKET_REGIME] = (double)data.market_regime;
+    if (data.vwap > 0) {
+        x[(size_t)DirectionFeature::VWAP_DEV] = (data.last_price - data.vwap) / data.vwap * 100.0;
+    }
+    x[(size_t)DirectionFeature::VOLUME] = data.volume;
+    x[(size_t)DirectionFeature::LAST_PRICE] = data.last_price;
+    x[(size_t)DirectionFeature::VOLATILITY_PCT_SQ] = data.volatility_pct * data.volatility_pct;
+    return x;
 }
 
 double LearningEngine::calculate_real_time_volatility(const std::string& pair) const {
@@ -1607,140 +2243,152 @@ double LearningEngine::calculate_real_time_volatility(const std::string& pair) c
     return std::sqrt(variance) * 100.0;  // Return as percentage
 }
 
-int LearningEngine::detect_real_time_regime(const std::string& pair) const {
-    auto recent_data = get_recent_market_data(pair, 60);  // Last hour
-    
-    if (recent_data.size() < 20) {
-        return 0;  // Not enough data, assume consolidation
-    }
-    
-    // Simple regime detection based on trend and volatility
-    double start_price = recent_data.front().last_price;
-    double end_price = recent_data.back().last_price;
-    double price_change = (end_price - start_price) / start_price * 100.0;
-    
-    double volatility = calculate_real_time_volatility(pair);
-    
-    if (std::abs(price_change) > volatility * 2) {
-        return (price_change > 0) ? 1 : -1;  // Strong trend
-    } else if (volatility > 1.0) {
-        return 2;  // Volatile/consolidation
-    } else {
-        return 0;  // Quiet consolidation
-    }
+RegimeEstimate LearningEngine::detect_real_time_regime(const std::string& pair) const {
+    return market_regimes.estimate(pair);
+}
+
+void LearningEngine::reserve_pairs(size_t pair_count) {
+    std::lock_guard<std::mutex> lock(market_data_mutex);
+    price_history.reserve(pair_count);
+    volume_history.reserve(pair_count);
+    real_time_market_data.reserve(pair_count);
+    latest_market_data.reserve(pair_count);
+    if (!options_.regimes) own_regimes.reserve(pair_count);
 }
 
 void LearningEngine::perform_continuous_learning() {
     // Load latest market data directly from SQLite database
-    // Also attempt to reload direction model if updated by training script
-    try {
-        std::ifstream f("data/direction_model.json");
-        if (f.good()) {
-            nlohmann::json jm; f >> jm;
-            if (jm.contains("weights")) {
-                direction_model_weights.clear();
-                for (auto it = jm["weights"].begin(); it != jm["weights"].end(); ++it) {
-                    direction_model_weights[it.key()] = it.value().get<double>();
-                }
-                direction_model_bias = jm.value("bias", 0.0);
-                direction_model_loaded = true;
-                std::cout << "Reloaded direction model (continuous learning) with " << direction_model_weights.size() << " weights" << std::endl;
-            }
-        }
-    } catch (...) {}
-    load_market_data_from_sqlite();
+    // Also reload the direction model if the training script rewrote it
+    // (stat per cycle; parse only when the content changed)
+    if (direction_model.reload_if_changed(DIRECTION_MODEL_PATH)) {
+        std::cout << "Reloaded direction model (continuous learning) with "
+                  << direction_model.current()->weight_count << " weights" << std::endl;
+    }
+    if (options_.ingest_market_data) load_market_data_from_sqlite();
     
     // Update market condition analysis
     adapt_strategies_to_market_conditions();
     
-    // Analyze recent trades for patterns
-    if (trade_history.size() >= MIN_TRADES_FOR_ANALYSIS) {
-        analyze_patterns();
-    }
+    // Pattern metrics are maintained incrementally by record_trade();
+    // bring correlation rows of newly traded patterns up to date
+    refresh_pattern_correlations();
     
     // Update strategy database with new insights
     update_strategy_database();
 }
 
+void LearningEngine::close_market_db() {
+    if (market_data_stmt) sqlite3_finalize(market_data_stmt);
+    if (market_db_) sqlite3_close(market_db_);
+    market_data_stmt = nullptr;
+    market_db_ = nullptr;
+}
+
 void LearningEngine::load_market_data_from_sqlite(const std::string& db_path) {
-    sqlite3* market_db = nullptr;
-    
-    int rc = sqlite3_open(db_path.c_str(), &market_db);
-    if (rc != SQLITE_OK) {
-        std::cerr << "Warning: Could not open market data database: " << sqlite3_errmsg(market_db) << std::endl;
-        return;
+    CaptureSession& capture = CaptureSession::instance();
+    std::vector<MarketDataPoint> points;
+    if (capture.replaying()) {
+        auto payload = capture.next(CaptureKind::SQLITE, "market_data.db");
+        if (!payload) return;
+        CaptureDecoder in(*payload);
+        points = decode_market_points(in);
+    } else {
+        points = read_market_data(db_path);
+    }
+    if (capture.recording()) {
+        CaptureEncoder out;
+        encode_market_points(out, points);
+        capture.record(CaptureKind::SQLITE, "market_data.db", out.bytes);
     }
     
-    // Query for latest data for each pair (last 5 minutes)
-    int64_t cutoff_time = std::chrono::duration_cast<std::chrono::milliseconds>(
-        std::chrono::system_clock::now().time_since_epoch()
-    ).count() - (5 * 60 * 1000); // 5 minutes ago
-    
-    const char* sql = R"(
-        SELECT pair, ask, bid, last, volume, vwap, timestamp
-        FROM ticker_data 
-        WHERE timestamp > ?
-        ORDER BY timestamp DESC
-    )";
-    
-    sqlite3_stmt* stmt;
-    rc = sqlite3_prepare_v2(market_db, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
-        std::cerr << "Failed to prepare market data query: " << sqlite3_errmsg(market_db) << std::endl;
-        sqlite3_close(market_db);
-        return;
+    std::lock_guard<std::mutex> lock(market_data_mutex);
+    for (const MarketDataPoint& point : points) {
+        append_market_point(point);
+    }
+}
+
+std::vector<LearningEngine::MarketDataPoint> LearningEngine::read_market_data(const std::string& db_path) {
+    if (market_db_ && db_path != market_db_path_) {
+        close_market_db();
+        market_data_last_id = 0;
+    }
+    
+    if (!market_db_) {
+        // Read-only: the collector owns market_data.db
+        int rc = sqlite3_open_v2(db_path.c_str(), &market_db_, SQLITE_OPEN_READONLY, nullptr);
+        if (rc != SQLITE_OK) {
+            std::cerr << "Warning: Could not open market data database: " << sqlite3_errmsg(market_db_) << std::endl;
+            close_market_db();
+            return {};
+        }
+        sqlite3_busy_timeout(market_db_, 1000);
+        market_db_path_ = db_path;
+        
+        // id is AUTOINCREMENT (insertion order), so "id > watermark" is a
+        // primary-key range scan; the timestamp bound only matters on the
+        // first load, which starts from the last 5 minutes
+        const char* sql = R"(
+            SELECT id, pair, ask, bid, last, volume, vwap, timestamp
+            FROM ticker_data 
+            WHERE id > ? AND timestamp > ?
+            ORDER BY id ASC
+            LIMIT ?
+        )";
+        rc = sqlite3_prepare_v2(market_db_, sql, -1, &market_data_stmt, nullptr);
+        if (rc != SQLITE_OK) {
+            std::cerr << "Failed to prepare market data query: " << sqlite3_errmsg(market_db_) << std::endl;
+            close_market_db();
+            return {};
+        }
     }
     
-    sqlite3_bind_int64(stmt, 1, cutoff_time);
+    int64_t cutoff_time = 0;
+    int64_t max_id_before = 0;
+    if (market_data_last_id == 0) {
+        // The engine's clock, so a replayed run starts from the same rows
+        cutoff_time = options_.clock->now_ms() - (5 * 60 * 1000); // 5 minutes ago
+        
+        // If nothing is that recent, start after everything already there
+        // rather than rescanning the table every cycle
+        sqlite3_stmt* max_stmt;
+        if (sqlite3_prepare_v2(market_db_, "SELECT COALESCE(MAX(id), 0) FROM ticker_data", -1, &max_stmt, nullptr) == SQLITE_OK) {
+            if (sqlite3_step(max_stmt) == SQLITE_ROW) max_id_before = sqlite3_column_int64(max_stmt, 0);
+            sqlite3_finalize(max_stmt);
+        }
+    }
     
-    std::lock_guard<std::mutex> lock(market_data_mutex);
+    sqlite3_stmt* stmt = market_data_stmt;
+    sqlite3_reset(stmt);
+    sqlite3_bind_int64(stmt, 1, market_data_last_id);
+    sqlite3_bind_int64(stmt, 2, cutoff_time);
+    sqlite3_bind_int(stmt, 3, MARKET_DATA_ROWS_PER_LOAD);
     
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        std::string pair = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
-        double ask = sqlite3_column_double(stmt, 1);
-        double bid = sqlite3_column_double(stmt, 2);
-        double last = sqlite3_column_double(stmt, 3);
-        double volume = sqlite3_column_double(stmt, 4);
-        double vwap = sqlite3_column_double(stmt, 5);
-        int64_t timestamp = sqlite3_column_int64(stmt, 6);
+    // Read outside the lock; only the appends need market_data_mutex
+    std::vector<MarketDataPoint> points;
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        market_data_last_id = sqlite3_column_int64(stmt, 0);
+        const char* pair = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+        if (!pair) continue;
         
         MarketDataPoint point;
         point.pair = pair;
-        point.ask_price = ask;
-        point.bid_price = bid;
-        point.last_price = last;
-        point.volume = volume;
-        point.vwap = vwap;
-        point.timestamp = timestamp;
+        point.ask_price = sqlite3_column_double(stmt, 2);
+        point.bid_price = sqlite3_column_double(stmt, 3);
+        point.last_price = sqlite3_column_double(stmt, 4);
+        point.volume = sqlite3_column_double(stmt, 5);
+        point.vwap = sqlite3_column_double(stmt, 6);
+        point.timestamp = sqlite3_column_int64(stmt, 7);
         point.volatility_pct = 0.0; // Will be calculated
         point.market_regime = 0;    // Will be detected
-        
-        // Update latest data
-        latest_market_data[pair] = point;
-        
-        // Add to historical data if not already there
-        if (real_time_market_data[pair].empty() || 
-            real_time_market_data[pair].back().timestamp != timestamp) {
-            real_time_market_data[pair].push_back(point);
-            
-            // Maintain size limit
-            if (real_time_market_data[pair].size() > MAX_MARKET_DATA_SIZE) {
-                real_time_market_data[pair].pop_front();
-            }
-        }
-        
-        // Update price history for indicators
-        price_history[pair].push_back(last);
-        volume_history[pair].push_back(volume);
-        
-        if (price_history[pair].size() > MAX_HISTORY_SIZE) {
-            price_history[pair].pop_front();
-            volume_history[pair].pop_front();
-        }
+        points.push_back(std::move(point));
     }
-    
-    sqlite3_finalize(stmt);
-    sqlite3_close(market_db);
+    if (rc != SQLITE_DONE) {
+        std::cerr << "Market data query failed: " << sqlite3_errmsg(market_db_) << std::endl;
+    }
+    sqlite3_reset(stmt);  // End the read transaction so the collector can checkpoint
+    if (market_data_last_id == 0) market_data_last_id = max_id_before;
+    return points;
 }
 
 void LearningEngine::load_market_data_from_cache(const std::string& cache_file) {
@@ -1751,21 +2399,28 @@ void LearningEngine::load_market_data_from_cache(const std::string& cache_file)
         if (f.good()) {
             nlohmann::json j; f >> j;
             if (j.contains("data") && j["data"].is_array()) {
-                std::lock_guard<std::mutex> lock(market_data_mutex);
+                std::vector<MarketDataPoint> points;
+                points.reserve(j["data"].size());
                 for (const auto& item : j["data"]) {
-                    MarketDataPoint md;
+                    MarketDataPoint md{};
                     md.pair = item.value("pair", std::string());
                     md.last_price = item.value("last_price", 0.0);
                     md.volume = item.value("volume", 0.0);
                     md.vwap = item.value("vwap", 0.0);
-                    md.timestamp = item.value("timestamp", 0);
+                    md.timestamp = item.value("timestamp", (int64_t)0);
                     md.volatility_pct = item.value("volatility_pct", 0.0);
-                    latest_market_data[md.pair] = md;
-                    auto& dq = real_time_market_data[md.pair];
-                    dq.push_back(md);
-                    if (dq.size() > MAX_MARKET_DATA_SIZE) dq.pop_front();
+                    if (!md.pair.empty()) points.push_back(std::move(md));
                 }
-                std::cout << "Loaded market data cache for " << latest_market_data.size() << " pairs from " << json_file << std::endl;
+                // Same path as the SQLite loader: per-pair timestamp order and
+                // dedup, indicator history. The file need not be sorted.
+                std::stable_sort(points.begin(), points.end(), [](const MarketDataPoint& a, const MarketDataPoint& b) {
+                    return a.timestamp < b.timestamp;
+                });
+                std::lock_guard<std::mutex> lock(market_data_mutex);
+                size_t appended = 0;
+                for (const MarketDataPoint& point : points) appended += append_market_point(point);
+                std::cout << "Loaded market data cache for " << latest_market_data.size() << " pairs from " << json_file
+                          << " (" << appended << " points, " << points.size() - appended << " duplicate or stale)" << std::endl;
                 return;
             }
         }
@@ -4,8 +4,12 @@
 #include <numeric>
 #include <cmath>
 
-void MarketDataCache::updateMarketData(const MarketDataPoint& data) {
+void MarketDataCache::updateMarketData(const MarketDataPoint& point) {
+    MarketDataPoint data = point;
+
     std::lock_guard<std::mutex> lock(data_mutex_);
+    RegimeEstimate regime = regimes_ ? regimes_->estimate(data.pair) : RegimeEstimate{};
+    data.market_regime = regime_code(regime.regime, regime.trend_up());
 
     // Update latest data
     latest_data_[data.pair] = data;
@@ -89,26 +93,14 @@ double MarketDataCache::calculateVolatility(const std::string& pair, int minutes
     return std::sqrt(variance) * 100.0;
 }
 
-int MarketDataCache::detectRegime(const std::string& pair, int minutes) const {
-    auto recent_data = getRecentData(pair, minutes);
-
-    if (recent_data.size() < 20) {
-        return 0;  // Consolidation
-    }
-
-    double start_price = recent_data.front().last_price;
-    double end_price = recent_data.back().last_price;
-    double price_change = (end_price - start_price) / start_price * 100.0;
-
-    double volatility = calculateVolatility(pair, minutes);
+MarketRegime MarketDataCache::detectRegime(const std::string& pair) const {
+    std::lock_guard<std::mutex> lock(data_mutex_);
+    return regimes_ ? regimes_->estimate(pair).regime : MarketRegime::RANGING;
+}
 
-    if (std::abs(price_change) > volatility * 2) {
-        return (price_change > 0) ? 1 : -1;  // Strong trend
-    } else if (volatility > 1.0) {
-        return 2;  // Volatile
-    } else {
-        return 0;  // Consolidation
-    }
+void MarketDataCache::setRegimeEngine(const RegimeEngine* engine) {
+    std::lock_guard<std::mutex> lock(data_mutex_);
+    regimes_ = engine;
 }
 
 void MarketDataCache::initDatabase(const std::string& db_path) {
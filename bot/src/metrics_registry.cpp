@@ -0,0 +1,126 @@
+#include "metrics_registry.hpp"
+#include "latency_histogram.hpp"
+#include <sstream>
+
+namespace {
+
+struct MetricInfo {
+    const char* name;
+    const char* label;  // Optional {label} suffix, nullptr if none
+    const char* help;
+};
+
+MetricInfo counter_info(MetricCounter counter) {
+    switch (counter) {
+        case MetricCounter::SCANS: return {"kraken_scans_total", nullptr, "Scan cycles completed"};
+        case MetricCounter::PAIRS_SCANNED: return {"kraken_pairs_scanned_total", nullptr, "scan_pair calls"};
+        case MetricCounter::OPPORTUNITIES: return {"kraken_opportunities_total", nullptr, "Pairs that passed every filter"};
+        case MetricCounter::REJECT_BLACKLIST: return {"kraken_scan_rejections_total", "filter=\"blacklist\"", "Pairs rejected in scan_pair, by filter"};
+        case MetricCounter::REJECT_PAIR_WINRATE: return {"kraken_scan_rejections_total", "filter=\"pair_winrate\"", nullptr};
+        case MetricCounter::REJECT_SPREAD: return {"kraken_scan_rejections_total", "filter=\"spread\"", nullptr};
+        case MetricCounter::REJECT_VOLUME: return {"kraken_scan_rejections_total", "filter=\"volume\"", nullptr};
+        case MetricCounter::REJECT_MOMENTUM: return {"kraken_scan_rejections_total", "filter=\"momentum\"", nullptr};
+        case MetricCounter::REJECT_VOLATILITY_CEILING: return {"kraken_scan_rejections_total", "filter=\"volatility_ceiling\"", nullptr};
+        case MetricCounter::REJECT_NO_DIRECTION: return {"kraken_scan_rejections_total", "filter=\"no_direction\"", nullptr};
+        case MetricCounter::REJECT_CONFIDENCE: return {"kraken_scan_rejections_total", "filter=\"confidence\"", nullptr};
+        case MetricCounter::REJECT_MIN_VOLATILITY: return {"kraken_scan_rejections_total", "filter=\"min_volatility\"", nullptr};
+        case MetricCounter::REJECT_REGIME: return {"kraken_scan_rejections_total", "filter=\"regime\"", nullptr};
+        case MetricCounter::SCAN_ERRORS: return {"kraken_scan_errors_total", nullptr, "scan_pair calls that threw"};
+        case MetricCounter::PRICE_BARS_OUT_OF_ORDER: return {"kraken_price_bars_out_of_order_total", nullptr, "Scan prices older than the pair's newest indicator bar, dropped"};
+        case MetricCounter::TRADES_OPENED: return {"kraken_trades_opened_total", nullptr, "Entry orders placed"};
+        case MetricCounter::TRADES_CLOSED: return {"kraken_trades_closed_total", nullptr, "Positions closed"};
+        case MetricCounter::TRADES_WON: return {"kraken_trades_won_total", nullptr, "Closed trades with positive net P&L"};
+        case MetricCounter::TRADES_LOST: return {"kraken_trades_lost_total", nullptr, "Closed trades with zero or negative net P&L"};
+        case MetricCounter::EXIT_TAKE_PROFIT: return {"kraken_exits_total", "reason=\"take_profit\"", "Closed trades by exit reason"};
+        case MetricCounter::EXIT_STOP_LOSS: return {"kraken_exits_total", "reason=\"stop_loss\"", nullptr};
+        case MetricCounter::EXIT_TRAILING_STOP: return {"kraken_exits_total", "reason=\"trailing_stop\"", nullptr};
+        case MetricCounter::EXIT_TIMEOUT: return {"kraken_exits_total", "reason=\"timeout\"", nullptr};
+        case MetricCounter::CONFIG_RELOADS: return {"kraken_config_reloads_total", nullptr, "Config snapshots published by hot reload"};
+        case MetricCounter::TRADES_PERSISTED: return {"kraken_trades_persisted_total", nullptr, "Trades committed to trades.db"};
+        case MetricCounter::TRADE_WRITE_BATCHES: return {"kraken_trade_write_batches_total", nullptr, "Group commits by the trade writer"};
+        case MetricCounter::TRADE_WRITE_ERRORS: return {"kraken_trade_write_errors_total", nullptr, "Trade writes not committed after retries"};
+        case MetricCounter::REGIME_SHIFTS_DOWN: return {"kraken_regime_shifts_total", "direction=\"down\"", "Change points in trade returns, by direction"};
+        case MetricCounter::REGIME_SHIFTS_UP: return {"kraken_regime_shifts_total", "direction=\"up\"", nullptr};
+        default: return {"kraken_unknown_total", nullptr, ""};
+    }
+}
+
+MetricInfo gauge_info(MetricGauge gauge) {
+    switch (gauge) {
+        case MetricGauge::OPEN_POSITIONS: return {"kraken_open_positions", nullptr, "Positions currently being monitored"};
+        case MetricGauge::REALIZED_PNL_USD: return {"kraken_realized_pnl_usd", nullptr, "Net realized P&L since start"};
+        case MetricGauge::FEES_USD: return {"kraken_fees_usd", nullptr, "Fees paid since start"};
+        case MetricGauge::WIN_RATE: return {"kraken_win_rate", nullptr, "Win rate of closed trades since start"};
+        case MetricGauge::ACTIVE_PAIRS: return {"kraken_active_pairs", nullptr, "Pairs in the active scan set"};
+        case MetricGauge::UNIVERSE_PAIRS: return {"kraken_universe_pairs", nullptr, "Pairs known to the universe"};
+        case MetricGauge::SCAN_PENDING_PAIRS: return {"kraken_scan_pending_pairs", nullptr, "Pairs not yet scanned in the current cycle"};
+        case MetricGauge::SCAN_WORKERS: return {"kraken_scan_workers", nullptr, "Scan pool threads"};
+        case MetricGauge::PRICE_HISTORY_PAIRS: return {"kraken_price_history_pairs", nullptr, "Pairs held in the indicator price cache"};
+        case MetricGauge::LEARNING_TRADES: return {"kraken_learning_trades", nullptr, "Trades held by the learning engine"};
+        case MetricGauge::CONFIG_VERSION: return {"kraken_config_version", nullptr, "Version of the active config snapshot"};
+        case MetricGauge::TRADE_WRITE_QUEUE: return {"kraken_trade_write_queue", nullptr, "Writes queued for the trade writer"};
+        default: return {"kraken_unknown", nullptr, ""};
+    }
+}
+
+}  // namespace
+
+MetricsRegistry& MetricsRegistry::instance() {
+    // Leaked on purpose: thread_local counter shards may release after static teardown
+    static MetricsRegistry* registry = new MetricsRegistry();
+    return *registry;
+}
+
+uint64_t MetricsRegistry::counter_value(MetricCounter counter) const {
+    uint64_t total = 0;
+    counters.for_each([&total, counter](const CounterShard& shard) {
+        total += shard.values[(size_t)counter].load(std::memory_order_relaxed);
+    });
+    return total;
+}
+
+std::string MetricsRegistry::render_prometheus() const {
+    std::array<uint64_t, (size_t)MetricCounter::COUNT> totals{};
+    counters.for_each([&totals](const CounterShard& shard) {
+        for (size_t i = 0; i < totals.size(); i++) totals[i] += shard.values[i].load(std::memory_order_relaxed);
+    });
+
+    std::ostringstream out;
+    std::string last_name;
+    for (size_t i = 0; i < totals.size(); i++) {
+        MetricInfo info = counter_info((MetricCounter)i);
+        if (last_name != info.name) {
+            // Labeled series share one HELP/TYPE header
+            if (info.help) out << "# HELP " << info.name << " " << info.help << "\n";
+            out << "# TYPE " << info.name << " counter\n";
+            last_name = info.name;
+        }
+        out << info.name;
+        if (info.label) out << "{" << info.label << "}";
+        out << " " << totals[i] << "\n";
+    }
+
+    for (size_t i = 0; i < gauges.size(); i++) {
+        MetricInfo info = gauge_info((MetricGauge)i);
+        out << "# HELP " << info.name << " " << info.help << "\n";
+        out << "# TYPE " << info.name << " gauge\n";
+        out << info.name << " " << gauges[i].load(std::memory_order_relaxed) << "\n";
+    }
+
+    // API / DB latency: per-stage summaries from the latency histograms
+    auto stages = LatencyRegistry::instance().merge();
+    out << "# HELP kraken_stage_latency_us Pipeline stage latency in microseconds\n";
+    out << "# TYPE kraken_stage_latency_us summary\n";
+    for (size_t s = 0; s < stages.size(); s++) {
+        const auto& summary = stages[s];
+        if (summary.total == 0) continue;
+        const char* stage = latency_stage_name((LatencyStage)s);
+        for (double q : {0.5, 0.9, 0.99, 0.999}) {
+            out << "kraken_stage_latency_us{stage=\"" << stage << "\",quantile=\"" << q << "\"} "
+                << summary.percentile(q * 100.0) << "\n";
+        }
+        out << "kraken_stage_latency_us_sum{stage=\"" << stage << "\"} " << summary.sum << "\n";
+        out << "kraken_stage_latency_us_count{stage=\"" << stage << "\"} " << summary.total << "\n";
+    }
+    return out.str();
+}
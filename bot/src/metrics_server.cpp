@@ -0,0 +1,153 @@
+#include "metrics_server.hpp"
+#include <iostream>
+#include <cstring>
+#include <unistd.h>
+#include <poll.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0  // macOS: no per-call flag; SIGPIPE is ignored on the socket instead
+#endif
+
+namespace {
+
+const char* status_text(int status) {
+    switch (status) {
+        case 200: return "OK";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        default: return "Internal Server Error";
+    }
+}
+
+const int REQUEST_TIMEOUT_MS = 1000;
+const size_t MAX_REQUEST_BYTES = 8192;
+
+}  // namespace
+
+MetricsServer::MetricsServer(int port) : listen_port(port) {}
+
+MetricsServer::~MetricsServer() {
+    stop();
+}
+
+void MetricsServer::add_route(const std::string& path, Handler handler) {
+    routes[path] = std::move(handler);
+}
+
+bool MetricsServer::start() {
+    if (running) return true;
+
+    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        std::cerr << "❌ Metrics server: socket() failed: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    int reuse = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    // Local only - metrics and traces are not meant to leave the box
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons((uint16_t)listen_port);
+    if (bind(listen_fd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listen_fd, 16) != 0) {
+        std::cerr << "❌ Metrics server: cannot listen on 127.0.0.1:" << listen_port
+                  << ": " << std::strerror(errno) << std::endl;
+        close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+    if (pipe(wake_pipe) != 0) {
+        close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+
+    running = true;
+    server_thread = std::thread([this]() { serve_loop(); });
+    std::cout << "📊 Metrics endpoint: http://127.0.0.1:" << listen_port << "/metrics" << std::endl;
+    return true;
+}
+
+void MetricsServer::stop() {
+    if (!running.exchange(false)) return;
+    char c = 1;
+    ssize_t n = write(wake_pipe[1], &c, 1);
+    (void)n;
+    if (server_thread.joinable()) server_thread.join();
+    close(listen_fd);
+    close(wake_pipe[0]);
+    close(wake_pipe[1]);
+    listen_fd = wake_pipe[0] = wake_pipe[1] = -1;
+}
+
+void MetricsServer::serve_loop() {
+    while (running) {
+        pollfd fds[2] = {{listen_fd, POLLIN, 0}, {wake_pipe[0], POLLIN, 0}};
+        if (poll(fds, 2, -1) < 0) continue;
+        if (!running || (fds[1].revents & POLLIN)) break;
+        if (!(fds[0].revents & POLLIN)) continue;
+
+        int client_fd = accept(listen_fd, nullptr, nullptr);
+        if (client_fd < 0) continue;
+#ifdef SO_NOSIGPIPE
+        int no_sigpipe = 1;
+        setsockopt(client_fd, SOL_SOCKET, SO_NOSIGPIPE, &no_sigpipe, sizeof(no_sigpipe));
+#endif
+        try {
+            handle_connection(client_fd);
+        } catch (const std::exception& e) {
+            std::cerr << "⚠️ Metrics server: " << e.what() << std::endl;
+        }
+        close(client_fd);
+    }
+}
+
+void MetricsServer::handle_connection(int client_fd) {
+    // Read until end of headers (GET requests carry no body)
+    std::string request;
+    char buf[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < MAX_REQUEST_BYTES) {
+        pollfd pfd{client_fd, POLLIN, 0};
+        if (poll(&pfd, 1, REQUEST_TIMEOUT_MS) <= 0) break;
+        ssize_t n = read(client_fd, buf, sizeof(buf));
+        if (n <= 0) break;
+        request.append(buf, (size_t)n);
+    }
+
+    // Request line: METHOD SP TARGET SP VERSION
+    size_t method_end = request.find(' ');
+    size_t target_end = method_end == std::string::npos ? std::string::npos : request.find(' ', method_end + 1);
+    Response response;
+    if (target_end == std::string::npos) {
+        response = {405, "text/plain", "bad request\n"};
+    } else if (request.compare(0, method_end, "GET") != 0) {
+        response = {405, "text/plain", "only GET is supported\n"};
+    } else {
+        std::string target = request.substr(method_end + 1, target_end - method_end - 1);
+        size_t q = target.find('?');
+        std::string path = target.substr(0, q);
+        std::string query = q == std::string::npos ? "" : target.substr(q + 1);
+        auto route = routes.find(path);
+        if (route == routes.end()) {
+            response = {404, "text/plain", "not found\n"};
+        } else {
+            response = route->second(query);
+        }
+    }
+
+    std::string header = "HTTP/1.0 " + std::to_string(response.status) + " " + status_text(response.status) +
+                         "\r\nContent-Type: " + response.content_type +
+                         "\r\nContent-Length: " + std::to_string(response.body.size()) +
+                         "\r\nConnection: close\r\n\r\n";
+    std::string payload = header + response.body;
+    size_t sent = 0;
+    while (sent < payload.size()) {
+        ssize_t n = send(client_fd, payload.data() + sent, payload.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) break;
+        sent += (size_t)n;
+    }
+}
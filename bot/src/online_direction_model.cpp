@@ -0,0 +1,194 @@
+#include "online_direction_model.hpp"
+#include "learning_engine.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+constexpr double Z_CLIP = 5.0;
+constexpr double P_EPS = 1e-6;
+
+double sigmoid(double x) {
+    return 1.0 / (1.0 + std::exp(-std::clamp(x, -35.0, 35.0)));
+}
+
+}  // namespace
+
+const char* OnlineDirectionModel::feature_name(OnlineFeature feature) {
+    switch (feature) {
+        case OnlineFeature::BIAS: return "bias";
+        case OnlineFeature::VOLATILITY: return "volatility_pct";
+        case OnlineFeature::MARKET_REGIME: return "market_regime";
+        case OnlineFeature::RSI: return "rsi";
+        case OnlineFeature::MACD_HISTOGRAM: return "macd_histogram";
+        case OnlineFeature::MACD_SIGNAL: return "macd_signal";
+        case OnlineFeature::BB_POSITION: return "bb_position";
+        case OnlineFeature::VOLUME_RATIO: return "volume_ratio";
+        case OnlineFeature::MOMENTUM: return "momentum_score";
+        case OnlineFeature::ATR_PCT: return "atr_pct";
+        case OnlineFeature::TREND: return "trend_direction";
+        case OnlineFeature::SPREAD: return "bid_ask_spread";
+        case OnlineFeature::ORDER_FLOW: return "order_flow_imbalance";
+        case OnlineFeature::VWAP_DEVIATION: return "vwap_deviation";
+        default: return "unknown";
+    }
+}
+
+void OnlineDirectionModel::Score::add(double p, bool up) {
+    p = std::clamp(p, P_EPS, 1.0 - P_EPS);
+    count++;
+    log_loss_sum += up ? -std::log(p) : -std::log(1.0 - p);
+    correct += (p >= 0.5) == up;
+}
+
+bool OnlineDirectionModel::label(const TradeRecord& trade) {
+    return trade.exit_price > trade.entry_price;
+}
+
+OnlineDirectionModel::Features OnlineDirectionModel::raw_features(const TradeRecord& trade) {
+    Features x{};
+    x[(size_t)OnlineFeature::BIAS] = 1.0;
+    x[(size_t)OnlineFeature::VOLATILITY] = trade.volatility_at_entry;
+    x[(size_t)OnlineFeature::MARKET_REGIME] = trade.market_regime;
+    x[(size_t)OnlineFeature::RSI] = trade.rsi;
+    x[(size_t)OnlineFeature::MACD_HISTOGRAM] = trade.macd_histogram;
+    x[(size_t)OnlineFeature::MACD_SIGNAL] = trade.macd_signal;
+    x[(size_t)OnlineFeature::BB_POSITION] = trade.bb_position;
+    x[(size_t)OnlineFeature::VOLUME_RATIO] = trade.volume_ratio;
+    x[(size_t)OnlineFeature::MOMENTUM] = trade.momentum_score;
+    x[(size_t)OnlineFeature::ATR_PCT] = trade.atr_pct;
+    x[(size_t)OnlineFeature::TREND] = trade.trend_direction;
+    x[(size_t)OnlineFeature::SPREAD] = trade.bid_ask_spread;
+    x[(size_t)OnlineFeature::ORDER_FLOW] = trade.order_flow_imbalance;
+    x[(size_t)OnlineFeature::VWAP_DEVIATION] = trade.vwap_deviation;
+    for (double& v : x) {
+        if (!std::isfinite(v)) v = 0.0;
+    }
+    return x;
+}
+
+OnlineDirectionModel::Features OnlineDirectionModel::standardize(const Features& raw) const {
+    Features x{};
+    x[0] = 1.0;  // Bias is not standardized
+    for (size_t i = 1; i < N; i++) {
+        if (feature_count[i] < 2) continue;  // No scale yet: feature sits out
+        double sd = std::sqrt(feature_m2[i] / feature_count[i]);
+        if (sd <= 0) continue;
+        x[i] = std::clamp((raw[i] - feature_mean[i]) / sd, -Z_CLIP, Z_CLIP);
+    }
+    return x;
+}
+
+void OnlineDirectionModel::observe(const Features& raw) {
+    for (size_t i = 1; i < N; i++) {
+        feature_count[i]++;
+        double delta = raw[i] - feature_mean[i];
+        feature_mean[i] += delta / feature_count[i];
+        feature_m2[i] += delta * (raw[i] - feature_mean[i]);
+    }
+}
+
+void OnlineDirectionModel::refresh_weight(size_t i) {
+    double zi = z[i];
+    if (std::abs(zi) <= params.l1) {
+        weights[i] = 0.0;
+        return;
+    }
+    double sign = zi < 0 ? -1.0 : 1.0;
+    weights[i] = -(zi - sign * params.l1) / ((params.beta + std::sqrt(n[i])) / params.alpha + params.l2);
+}
+
+double OnlineDirectionModel::predict(const Features& raw) const {
+    Features x = standardize(raw);
+    double s = 0;
+    for (size_t i = 0; i < N; i++) s += weights[i] * x[i];
+    return sigmoid(s);
+}
+
+double OnlineDirectionModel::update(const TradeRecord& trade) {
+    Features raw = raw_features(trade);
+    bool up = label(trade);
+
+    // Progressive validation: score before learning from this trade
+    Features x = standardize(raw);
+    double s = 0;
+    for (size_t i = 0; i < N; i++) s += weights[i] * x[i];
+    double p = sigmoid(s);
+    online_score.add(p, up);
+
+    // FTRL-Proximal step on the log-loss gradient g_i = (p - y) x_i
+    double g_scale = p - (up ? 1.0 : 0.0);
+    for (size_t i = 0; i < N; i++) {
+        if (x[i] == 0.0) continue;
+        double g = g_scale * x[i];
+        double sigma = (std::sqrt(n[i] + g * g) - std::sqrt(n[i])) / params.alpha;
+        z[i] += g - sigma * weights[i];
+        n[i] += g * g;
+        refresh_weight(i);
+    }
+
+    observe(raw);
+    return p;
+}
+
+bool OnlineDirectionModel::save(const std::string& path) const {
+    json out;
+    out["model"] = "ftrl_logistic";
+    out["params"] = {{"alpha", params.alpha}, {"beta", params.beta}, {"l1", params.l1}, {"l2", params.l2}};
+    out["updates"] = online_score.count;
+    out["log_loss_sum"] = online_score.log_loss_sum;
+    out["correct"] = online_score.correct;
+    for (size_t i = 0; i < N; i++) {
+        json& f = out["features"][feature_name((OnlineFeature)i)];
+        f["weight"] = weights[i];
+        f["z"] = z[i];
+        f["n"] = n[i];
+        f["count"] = feature_count[i];
+        f["mean"] = feature_mean[i];
+        f["m2"] = feature_m2[i];
+    }
+
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream file(tmp);
+        if (!file.good()) return false;
+        file << out.dump(2);
+        if (!file.good()) return false;
+    }
+    return std::rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+bool OnlineDirectionModel::load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.good()) return false;
+    try {
+        json in;
+        file >> in;
+        if (in.value("model", "") != "ftrl_logistic" || !in.contains("features")) return false;
+
+        OnlineDirectionModel loaded(params);
+        loaded.online_score.count = in.value("updates", (uint64_t)0);
+        loaded.online_score.log_loss_sum = in.value("log_loss_sum", 0.0);
+        loaded.online_score.correct = in.value("correct", (uint64_t)0);
+        const json& features = in["features"];
+        for (size_t i = 0; i < N; i++) {
+            const char* name = feature_name((OnlineFeature)i);
+            if (!features.contains(name)) continue;  // Feature added since the checkpoint: starts fresh
+            const json& f = features[name];
+            loaded.z[i] = f.value("z", 0.0);
+            loaded.n[i] = f.value("n", 0.0);
+            loaded.feature_count[i] = f.value("count", (uint64_t)0);
+            loaded.feature_mean[i] = f.value("mean", 0.0);
+            loaded.feature_m2[i] = f.value("m2", 0.0);
+            loaded.refresh_weight(i);
+        }
+        *this = loaded;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "⚠️ Online direction model checkpoint unreadable (" << path << "): " << e.what() << std::endl;
+        return false;
+    }
+}
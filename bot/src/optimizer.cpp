@@ -0,0 +1,300 @@
+#include "optimizer.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <unordered_set>
+
+namespace {
+
+struct ParamDef {
+    const char* name;
+    void (*apply)(ConfigSnapshot& snapshot, double value);
+};
+
+const ParamDef PARAMS[] = {
+    {"volatile_take_profit_pct", [](ConfigSnapshot& s, double v) { s.bot.volatile_take_profit_pct = v; }},
+    {"volatile_stop_loss_pct", [](ConfigSnapshot& s, double v) { s.bot.volatile_stop_loss_pct = v; }},
+    {"volatile_hold_seconds", [](ConfigSnapshot& s, double v) { s.bot.volatile_hold_seconds = (int)v; }},
+    {"trailing_start_pct", [](ConfigSnapshot& s, double v) { s.bot.trailing_start_pct = v; }},
+    {"trailing_stop_pct", [](ConfigSnapshot& s, double v) { s.bot.trailing_stop_pct = v; }},
+    {"leverage", [](ConfigSnapshot& s, double v) { s.bot.leverage = std::max(1.0, v); }},
+    {"min_confidence_threshold", [](ConfigSnapshot& s, double v) { s.min_confidence_threshold = v; }},
+    {"tp_multiplier", [](ConfigSnapshot& s, double v) { s.tp_multiplier = v; }},
+    {"sl_multiplier", [](ConfigSnapshot& s, double v) { s.sl_multiplier = v; }},
+    {"min_volatility_gate_pct", [](ConfigSnapshot& s, double v) { s.min_volatility_gate_pct = v; }},
+    {"take_profit_pct", [](ConfigSnapshot& s, double v) { s.bot.take_profit_pct = v; }},
+    {"stop_loss_pct", [](ConfigSnapshot& s, double v) { s.bot.stop_loss_pct = v; }},
+    {"min_hold_seconds", [](ConfigSnapshot& s, double v) { s.bot.min_hold_seconds = (int)v; }},
+    {"max_hold_seconds", [](ConfigSnapshot& s, double v) { s.bot.max_hold_seconds = (int)v; }},
+    {"default_hold_seconds", [](ConfigSnapshot& s, double v) { s.bot.default_hold_seconds = (int)v; }},
+    {"max_spread_pct", [](ConfigSnapshot& s, double v) { s.bot.max_spread_pct = v; }},
+    {"min_momentum_pct", [](ConfigSnapshot& s, double v) { s.bot.min_momentum_pct = v; }},
+    {"min_volume_usd", [](ConfigSnapshot& s, double v) { s.bot.min_volume_usd = v; }},
+    {"min_pair_winrate", [](ConfigSnapshot& s, double v) { s.bot.min_pair_winrate = v; }},
+    {"regime_filter_enabled", [](ConfigSnapshot& s, double v) { s.bot.regime_filter_enabled = v != 0.0; }},
+    {"allow_volatile_regime", [](ConfigSnapshot& s, double v) { s.bot.allow_volatile_regime = v != 0.0; }},
+    {"allow_trending_regime", [](ConfigSnapshot& s, double v) { s.bot.allow_trending_regime = v != 0.0; }},
+    {"allow_ranging_regime", [](ConfigSnapshot& s, double v) { s.bot.allow_ranging_regime = v != 0.0; }},
+    {"allow_quiet_regime", [](ConfigSnapshot& s, double v) { s.bot.allow_quiet_regime = v != 0.0; }},
+};
+
+const ParamDef* find_param(const std::string& name) {
+    for (const auto& p : PARAMS) {
+        if (name == p.name) return &p;
+    }
+    return nullptr;
+}
+
+// splitmix64: counter-based, so sample i is the same whatever the thread count
+uint64_t mix(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+double score_of(const ConfigResult& r, RankObjective objective) {
+    switch (objective) {
+        case RankObjective::PNL_PER_DRAWDOWN: return r.stats.net_pnl / std::max(r.stats.max_drawdown, 1e-6);
+        case RankObjective::WINDOW_SHARPE: return r.window_sharpe();
+        case RankObjective::WIN_RATE: return r.stats.win_rate();
+        default: return r.stats.net_pnl;
+    }
+}
+
+// a outranks b on the objective (scores from the same windows) without a
+// larger drawdown, and b is not ranked ahead of a by the min_trades rule
+bool dominates(const ConfigResult& a, const ConfigResult& b, int min_trades) {
+    if (a.stats.trades < min_trades && b.stats.trades >= min_trades) return false;
+    return a.score > b.score && a.stats.max_drawdown <= b.stats.max_drawdown;
+}
+
+}  // namespace
+
+uint64_t ParamSpace::grid_size() const {
+    uint64_t n = 1;
+    for (const auto& axis : axes) n *= axis.values.size();
+    return axes.empty() ? 0 : n;
+}
+
+std::vector<double> ParamSpace::point(uint64_t index) const {
+    std::vector<double> values(axes.size());
+    for (size_t a = axes.size(); a-- > 0;) {
+        const auto& axis = axes[a].values;
+        values[a] = axis[index % axis.size()];
+        index /= axis.size();
+    }
+    return values;
+}
+
+bool parse_param_axis(const std::string& spec, ParamAxis& axis, std::string& error) {
+    size_t eq = spec.find('=');
+    if (eq == std::string::npos) {
+        error = "expected name=v1,v2,... or name=lo:hi:step, got " + spec;
+        return false;
+    }
+    axis.name = spec.substr(0, eq);
+    axis.values.clear();
+    if (!is_known_param(axis.name)) {
+        error = "unknown parameter " + axis.name;
+        return false;
+    }
+    std::string values = spec.substr(eq + 1);
+    try {
+        if (std::count(values.begin(), values.end(), ':') == 2) {
+            size_t c1 = values.find(':'), c2 = values.rfind(':');
+            double lo = std::stod(values.substr(0, c1));
+            double hi = std::stod(values.substr(c1 + 1, c2 - c1 - 1));
+            double step = std::stod(values.substr(c2 + 1));
+            if (step <= 0 || hi < lo) {
+                error = "bad range for " + axis.name;
+                return false;
+            }
+            // Index-based so rounding doesn't drop the last point
+            int steps = (int)std::floor((hi - lo) / step + 1e-9);
+            for (int i = 0; i <= steps; i++) axis.values.push_back(lo + i * step);
+        } else {
+            size_t start = 0;
+            while (start <= values.size()) {
+                size_t comma = values.find(',', start);
+                std::string item = values.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+                if (item == "true") axis.values.push_back(1.0);
+                else if (item == "false") axis.values.push_back(0.0);
+                else axis.values.push_back(std::stod(item));
+                if (comma == std::string::npos) break;
+                start = comma + 1;
+            }
+        }
+    } catch (const std::exception&) {
+        error = "bad value list for " + axis.name + ": " + values;
+        return false;
+    }
+    if (axis.values.empty()) {
+        error = "no values for " + axis.name;
+        return false;
+    }
+    return true;
+}
+
+bool is_known_param(const std::string& name) {
+    return find_param(name) != nullptr;
+}
+
+std::vector<std::string> known_params() {
+    std::vector<std::string> names;
+    for (const auto& p : PARAMS) names.push_back(p.name);
+    return names;
+}
+
+bool apply_param(ConfigSnapshot& snapshot, const std::string& name, double value) {
+    const ParamDef* p = find_param(name);
+    if (!p) return false;
+    p->apply(snapshot, value);
+    return true;
+}
+
+bool parse_rank_objective(const std::string& name, RankObjective& objective) {
+    if (name == "net_pnl") objective = RankObjective::NET_PNL;
+    else if (name == "pnl_per_drawdown") objective = RankObjective::PNL_PER_DRAWDOWN;
+    else if (name == "window_sharpe") objective = RankObjective::WINDOW_SHARPE;
+    else if (name == "win_rate") objective = RankObjective::WIN_RATE;
+    else return false;
+    return true;
+}
+
+const char* rank_objective_name(RankObjective objective) {
+    switch (objective) {
+        case RankObjective::PNL_PER_DRAWDOWN: return "pnl_per_drawdown";
+        case RankObjective::WINDOW_SHARPE: return "window_sharpe";
+        case RankObjective::WIN_RATE: return "win_rate";
+        default: return "net_pnl";
+    }
+}
+
+int ConfigResult::positive_windows() const {
+    int n = 0;
+    for (int w = 0; w < windows_evaluated; w++) n += window_pnl[w] > 0;
+    return n;
+}
+
+double ConfigResult::window_sharpe() const {
+    if (windows_evaluated < 2) return 0.0;
+    double mean = 0;
+    for (int w = 0; w < windows_evaluated; w++) mean += window_pnl[w];
+    mean /= windows_evaluated;
+    double var = 0;
+    for (int w = 0; w < windows_evaluated; w++) var += (window_pnl[w] - mean) * (window_pnl[w] - mean);
+    double sd = std::sqrt(var / (windows_evaluated - 1));
+    return sd > 0 ? mean / sd : 0.0;
+}
+
+OptimizerReport run_optimizer(const TickData& data, const ConfigSnapshot& base, const ParamSpace& space,
+                              const OptimizerOptions& options, ThreadPool& pool,
+                              const ResultCallback& on_result) {
+    OptimizerReport report;
+    report.grid_size = space.grid_size();
+    auto started = std::chrono::steady_clock::now();
+
+    // Candidate grid indices: the full grid, or distinct random samples of it
+    std::vector<uint64_t> ids;
+    if (options.random_samples == 0 || options.random_samples >= report.grid_size) {
+        for (uint64_t i = 0; i < report.grid_size; i++) ids.push_back(i);
+    } else {
+        std::unordered_set<uint64_t> seen;
+        for (uint64_t i = 0; ids.size() < options.random_samples; i++) {
+            uint64_t id = mix(options.seed * 0x100000001B3ULL + i) % report.grid_size;
+            if (seen.insert(id).second) ids.push_back(id);
+        }
+    }
+
+    const std::vector<WindowResult> windows = make_windows(data, options.backtest.windows);
+    const int window_count = (int)windows.size();
+    std::vector<ConfigResult> results(ids.size());
+    for (size_t i = 0; i < ids.size(); i++) {
+        results[i].id = ids[i];
+        results[i].params = space.point(ids[i]);
+        results[i].window_pnl.assign(window_count, 0.0);
+    }
+
+    std::vector<size_t> active(results.size());
+    for (size_t i = 0; i < active.size(); i++) active[i] = i;
+
+    const int rungs = std::clamp(options.rungs, 1, window_count);
+    for (int rung = 0; rung < rungs && !active.empty(); rung++) {
+        const int first_window = results[active[0]].windows_evaluated;
+        const int last_window = (int)(((int64_t)window_count * (rung + 1) + rungs - 1) / rungs);
+
+        pool.parallel_for(active.size(), [&](size_t k) {
+            ConfigResult& r = results[active[k]];
+            ConfigSnapshot snapshot = base;
+            for (size_t a = 0; a < space.axes.size(); a++) apply_param(snapshot, space.axes[a].name, r.params[a]);
+            for (int w = first_window; w < last_window; w++) {
+                for (const auto& series : data.series) {
+                    BacktestStats s = simulate_series(series, windows[w].start_ms, windows[w].end_ms,
+                                                      snapshot, options.backtest);
+                    r.window_pnl[w] += s.net_pnl;
+                    r.stats.merge(s);
+                }
+                r.stats.equity.settle();   // Later windows only add later trades
+            }
+            r.windows_evaluated = last_window;
+            r.score = score_of(r, options.rank_by);
+        });
+
+        if (rung == rungs - 1) break;
+
+        // Window Sharpe needs two windows before scores differ at all
+        if (options.rank_by == RankObjective::WINDOW_SHARPE && last_window < 2) continue;
+
+        // Prune configs dominated by at least `top` live ones. Sorted by
+        // score, only configs before c can dominate it.
+        std::vector<size_t> order = active;
+        std::sort(order.begin(), order.end(), [&results](size_t a, size_t b) {
+            return results[a].score > results[b].score;
+        });
+        std::vector<size_t> survivors;
+        for (size_t i = 0; i < order.size(); i++) {
+            ConfigResult& c = results[order[i]];
+            size_t dominated_by = 0;
+            for (size_t j = 0; j < order.size() && dominated_by < options.top; j++) {
+                const ConfigResult& other = results[order[j]];
+                if (other.score <= c.score) break;
+                if (dominates(other, c, options.min_trades)) dominated_by++;
+            }
+            if (dominated_by >= options.top) {
+                c.pruned = true;
+                c.pruned_at_rung = rung;
+                report.pruned++;
+                if (on_result) on_result(c);
+            } else {
+                survivors.push_back(order[i]);
+            }
+        }
+        std::sort(survivors.begin(), survivors.end());
+        active = std::move(survivors);
+    }
+
+    // Rank: enough trades first, then score, P&L, grid index
+    auto rank_less = [&options](const ConfigResult& a, const ConfigResult& b) {
+        if (a.pruned != b.pruned) return !a.pruned;
+        if (a.pruned && a.pruned_at_rung != b.pruned_at_rung) return a.pruned_at_rung > b.pruned_at_rung;
+        bool a_ok = a.stats.trades >= options.min_trades, b_ok = b.stats.trades >= options.min_trades;
+        if (a_ok != b_ok) return a_ok;
+        if (a.score != b.score) return a.score > b.score;
+        if (a.stats.net_pnl != b.stats.net_pnl) return a.stats.net_pnl > b.stats.net_pnl;
+        return a.id < b.id;
+    };
+    std::sort(results.begin(), results.end(), rank_less);
+    for (const auto& r : results) {
+        report.simulated_ticks += r.stats.ticks;
+        if (!r.pruned) {
+            report.evaluated++;
+            if (on_result) on_result(r);
+        }
+    }
+    report.evaluated += report.pruned;
+    report.ranked = std::move(results);
+    report.elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    return report;
+}
@@ -0,0 +1,252 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <memory>
+#include <string>
+#include "optimizer.hpp"
+#include "bot_config.hpp"
+#include "thread_pool.hpp"
+
+/*
+ * kraken_optimizer - parallel grid / random search of strategy parameters
+ * over recorded ticks (see optimizer.hpp). Runs from bot/build/ like
+ * kraken_bot. Replaces scripts/backtest/walk_forward_grid_search.js.
+ *
+ *   kraken_optimizer [--param name=v1,v2,... | --param name=lo:hi:step ...]
+ *                    [--random N] [--seed S] [--rungs R] [--top K]
+ *                    [--min-trades N] [--rank-by net_pnl|pnl_per_drawdown|window_sharpe|win_rate]
+ *                    [--stream PATH.csv] [--out PATH.csv|PATH.json] [--show N]
+ *                    [--market-db PATH] [--prices-db PATH] [--source both|market|prices]
+ *                    [--config PATH] [--set field=value ...]
+ *                    [--windows N] [--warmup-minutes M] [--poll-seconds S]
+ *                    [--scan-seconds S] [--threads N]
+ *
+ * Without --param the default grid covers the VOLATILE TP/SL, trailing
+ * start/stop and the confidence threshold.
+ */
+
+static const char* status_of(const ConfigResult& r) {
+    return r.pruned ? "pruned" : "finished";
+}
+
+static void write_csv_header(std::ostream& out, const ParamSpace& space) {
+    out << "rank,id";
+    for (const auto& axis : space.axes) out << "," << axis.name;
+    out << ",trades,wins,win_rate,net_pnl,gross_pnl,fees,max_drawdown,positive_windows,window_sharpe,score,windows,status\n";
+}
+
+static void write_csv_row(std::ostream& out, size_t rank, const ConfigResult& r) {
+    out << rank << "," << r.id;
+    for (double v : r.params) out << "," << v;
+    out << "," << r.stats.trades << "," << r.stats.wins << "," << r.stats.win_rate()
+        << "," << r.stats.net_pnl << "," << r.stats.gross_pnl << "," << r.stats.fees
+        << "," << r.stats.max_drawdown << "," << r.positive_windows() << "," << r.window_sharpe()
+        << "," << r.score << "," << r.windows_evaluated << "," << status_of(r) << "\n";
+}
+
+static json result_json(size_t rank, const ConfigResult& r, const ParamSpace& space) {
+    json params = json::object();
+    for (size_t a = 0; a < space.axes.size(); a++) params[space.axes[a].name] = r.params[a];
+    return {
+        {"rank", rank},
+        {"id", r.id},
+        {"params", params},
+        {"trades", r.stats.trades},
+        {"wins", r.stats.wins},
+        {"win_rate", r.stats.win_rate()},
+        {"net_pnl", r.stats.net_pnl},
+        {"gross_pnl", r.stats.gross_pnl},
+        {"fees", r.stats.fees},
+        {"max_drawdown", r.stats.max_drawdown},
+        {"positive_windows", r.positive_windows()},
+        {"window_sharpe", r.window_sharpe()},
+        {"window_pnl", std::vector<double>(r.window_pnl.begin(), r.window_pnl.begin() + r.windows_evaluated)},
+        {"score", r.score},
+        {"windows", r.windows_evaluated},
+        {"status", status_of(r)},
+        {"pruned_at_rung", r.pruned_at_rung}
+    };
+}
+
+static ParamSpace default_space() {
+    ParamSpace space;
+    space.axes = {
+        {"volatile_take_profit_pct", {0.3, 0.5, 0.8, 1.2}},
+        {"volatile_stop_loss_pct", {0.2, 0.3, 0.5}},
+        {"trailing_start_pct", {0.3, 0.5, 0.8}},
+        {"trailing_stop_pct", {0.1, 0.2, 0.3}},
+        {"min_confidence_threshold", {0.45, 0.55, 0.65}},
+    };
+    return space;
+}
+
+int main(int argc, char* argv[]) {
+    std::string market_db = "../../data/market_data.db";
+    std::string prices_db = "../../data/price_history.db";
+    std::string source = "both";
+    std::string config_path = "../../config/bot_config.json";
+    std::string stream_path;
+    std::string out_path;
+    json cli_overrides = json::object();
+    ParamSpace space;
+    OptimizerOptions options;
+    size_t threads = 0;
+    size_t show = 10;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--market-db" && i+1 < argc) market_db = argv[++i];
+        else if (arg == "--prices-db" && i+1 < argc) prices_db = argv[++i];
+        else if (arg == "--source" && i+1 < argc) source = argv[++i];
+        else if (arg == "--config" && i+1 < argc) config_path = argv[++i];
+        else if (arg == "--windows" && i+1 < argc) options.backtest.windows = std::stoi(argv[++i]);
+        else if (arg == "--warmup-minutes" && i+1 < argc) options.backtest.warmup_ms = std::stoll(argv[++i]) * 60 * 1000;
+        else if (arg == "--poll-seconds" && i+1 < argc) options.backtest.poll_seconds = std::stoi(argv[++i]);
+        else if (arg == "--scan-seconds" && i+1 < argc) options.backtest.scan_seconds = std::stoi(argv[++i]);
+        else if (arg == "--threads" && i+1 < argc) threads = std::stoul(argv[++i]);
+        else if (arg == "--random" && i+1 < argc) options.random_samples = std::stoull(argv[++i]);
+        else if (arg == "--seed" && i+1 < argc) options.seed = std::stoull(argv[++i]);
+        else if (arg == "--rungs" && i+1 < argc) options.rungs = std::stoi(argv[++i]);
+        else if (arg == "--top" && i+1 < argc) options.top = std::stoul(argv[++i]);
+        else if (arg == "--min-trades" && i+1 < argc) options.min_trades = std::stoi(argv[++i]);
+        else if (arg == "--show" && i+1 < argc) show = std::stoul(argv[++i]);
+        else if (arg == "--stream" && i+1 < argc) stream_path = argv[++i];
+        else if (arg == "--out" && i+1 < argc) out_path = argv[++i];
+        else if (arg == "--rank-by" && i+1 < argc) {
+            if (!parse_rank_objective(argv[++i], options.rank_by)) {
+                std::cerr << "❌ Unknown --rank-by " << argv[i] << std::endl;
+                return 2;
+            }
+        } else if (arg == "--param" && i+1 < argc) {
+            ParamAxis axis;
+            std::string error;
+            if (!parse_param_axis(argv[++i], axis, error)) {
+                std::cerr << "❌ --param: " << error << std::endl;
+                std::cerr << "   Known parameters:";
+                for (const auto& name : known_params()) std::cerr << " " << name;
+                std::cerr << std::endl;
+                return 2;
+            }
+            space.axes.push_back(axis);
+        } else if (arg == "--set" && i+1 < argc) {
+            std::string kv = argv[++i];
+            size_t eq = kv.find('=');
+            if (eq == std::string::npos) {
+                std::cerr << "❌ --set expects field=value, got " << kv << std::endl;
+                return 2;
+            }
+            std::string value = kv.substr(eq + 1);
+            json parsed = json::parse(value, nullptr, false);
+            cli_overrides[kv.substr(0, eq)] = parsed.is_discarded() ? json(value) : parsed;
+        } else {
+            std::cerr << "❌ Unknown argument: " << arg << std::endl;
+            return 2;
+        }
+    }
+    if (space.axes.empty()) space = default_space();
+
+    auto snapshot = ConfigStore::build(config_path, cli_overrides);
+    if (!snapshot) {
+        std::cerr << "❌ Could not build config from " << config_path << std::endl;
+        return 1;
+    }
+
+    TickData data;
+    bool loaded = false;
+    if (source == "both" || source == "market") loaded |= load_ticker_data(market_db, data);
+    if (source == "both" || source == "prices") loaded |= load_price_history(prices_db, data);
+    if (!loaded || data.tick_count() == 0) {
+        std::cerr << "❌ No ticks loaded" << std::endl;
+        return 1;
+    }
+
+    std::unique_ptr<ThreadPool> own_pool;
+    if (threads > 0) own_pool = std::make_unique<ThreadPool>(threads);
+    ThreadPool& pool = own_pool ? *own_pool : ThreadPool::shared();
+
+    std::ofstream stream;
+    if (!stream_path.empty()) {
+        stream.open(stream_path);
+        if (!stream) {
+            std::cerr << "❌ Could not open " << stream_path << std::endl;
+            return 1;
+        }
+        write_csv_header(stream, space);
+    }
+
+    uint64_t candidates = options.random_samples ? std::min(options.random_samples, space.grid_size())
+                                                 : space.grid_size();
+    std::cout << "🔎 Optimizer: " << candidates << " of " << space.grid_size() << " configs, "
+              << data.series.size() << " pairs, " << data.tick_count() << " ticks, "
+              << options.backtest.windows << " windows in " << options.rungs << " rungs, ranked by "
+              << rank_objective_name(options.rank_by) << std::endl;
+
+    // Stream rows as configs are decided: rank 0 until the final order is known
+    uint64_t decided = 0;
+    OptimizerReport report = run_optimizer(data, *snapshot, space, options, pool,
+        [&](const ConfigResult& r) {
+            decided++;
+            if (stream.is_open()) {
+                write_csv_row(stream, 0, r);
+                stream.flush();
+            }
+            if (decided % 1000 == 0) {
+                std::cout << "   ... " << decided << "/" << candidates << " configs decided" << std::endl;
+            }
+        });
+
+    if (!out_path.empty()) {
+        std::ofstream out(out_path);
+        if (!out) {
+            std::cerr << "❌ Could not open " << out_path << std::endl;
+            return 1;
+        }
+        bool as_json = out_path.size() >= 5 && out_path.compare(out_path.size() - 5, 5, ".json") == 0;
+        if (as_json) {
+            json doc;
+            doc["rank_by"] = rank_objective_name(options.rank_by);
+            doc["grid_size"] = report.grid_size;
+            doc["evaluated"] = report.evaluated;
+            doc["pruned"] = report.pruned;
+            doc["elapsed_seconds"] = report.elapsed_seconds;
+            doc["results"] = json::array();
+            for (size_t i = 0; i < report.ranked.size(); i++) {
+                doc["results"].push_back(result_json(i + 1, report.ranked[i], space));
+            }
+            out << doc.dump(2) << std::endl;
+        } else {
+            write_csv_header(out, space);
+            for (size_t i = 0; i < report.ranked.size(); i++) write_csv_row(out, i + 1, report.ranked[i]);
+        }
+    }
+
+    std::cout << std::string(78, '-') << std::endl;
+    std::cout << std::left << std::setw(5) << "#" << std::setw(40) << "Params" << std::right
+              << std::setw(7) << "Trades" << std::setw(7) << "WR%" << std::setw(10) << "Net P&L"
+              << std::setw(9) << "MaxDD" << std::endl;
+    for (size_t i = 0; i < report.ranked.size() && i < show; i++) {
+        const ConfigResult& r = report.ranked[i];
+        if (r.pruned) break;
+        std::ostringstream params;
+        for (size_t a = 0; a < space.axes.size(); a++) {
+            if (a) params << " ";
+            params << r.params[a];
+        }
+        std::cout << std::left << std::setw(5) << i + 1 << std::setw(40) << params.str() << std::right
+                  << std::setw(7) << r.stats.trades << std::setw(7) << std::fixed << std::setprecision(1)
+                  << r.stats.win_rate() * 100 << std::setw(10) << std::setprecision(2) << r.stats.net_pnl
+                  << std::setw(9) << r.stats.max_drawdown << std::endl;
+        std::cout.unsetf(std::ios::fixed);
+    }
+    std::cout << std::string(78, '-') << std::endl;
+    std::cout << "  Params:";
+    for (const auto& axis : space.axes) std::cout << " " << axis.name;
+    std::cout << std::endl;
+    std::cout << "  Evaluated " << report.evaluated << " (" << report.pruned << " pruned early) of "
+              << report.grid_size << " | " << std::fixed << std::setprecision(0)
+              << (report.elapsed_seconds > 0 ? report.simulated_ticks / report.elapsed_seconds : 0.0)
+              << " ticks/s, " << std::setprecision(2) << report.elapsed_seconds << "s on "
+              << pool.size() << " threads" << std::endl;
+    return 0;
+}
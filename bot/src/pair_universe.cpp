@@ -0,0 +1,266 @@
+#include "pair_universe.hpp"
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <set>
+
+namespace {
+
+json read_json_file(const std::string& path) {
+    std::ifstream f(path);
+    if (!f.good()) return json();
+    try {
+        json j;
+        f >> j;
+        return j;
+    } catch (const std::exception& e) {
+        std::cerr << "⚠️ Failed to parse " << path << ": " << e.what() << std::endl;
+        return json();
+    }
+}
+
+// Score pinned pairs far above anything the liquidity score can reach
+const double PINNED_SCORE = 1e9;
+// Score floor for pairs whose data feed has been missing for a while
+const double MISSING_DATA_PENALTY = 10.0;
+
+// The Kraken Futures linear perpetual for a spot altname
+std::string futures_symbol(const std::string& altname) {
+    return "PF_" + altname;
+}
+
+}  // namespace
+
+PairUniverse::PairUniverse(UniverseConfig cfg) : config(cfg) {}
+
+UniversePair& PairUniverse::get_or_add(const std::string& symbol) {
+    auto it = index.find(symbol);
+    if (it != index.end()) return pairs[it->second];
+    index[symbol] = pairs.size();
+    pairs.push_back(UniversePair{});
+    pairs.back().symbol = symbol;
+    return pairs.back();
+}
+
+size_t PairUniverse::load(const std::string& data_dir) {
+    std::lock_guard<std::mutex> lock(universe_mutex);
+    std::string dir = data_dir.empty() || data_dir.back() == '/' ? data_dir : data_dir + "/";
+
+    // Stablecoin / fiat pairs: no volatility to trade
+    std::set<std::string> excluded;
+    json stable = read_json_file(dir + "usd_pairs_filtered.json");
+    if (stable.is_array()) {
+        for (const auto& p : stable) excluded.insert(p.value("altname", p.value("pair", "")));
+    }
+
+    std::set<std::string> curated;
+    json top = read_json_file(dir + "usd_pairs_top_filtered.json");
+    if (top.is_array()) {
+        for (const auto& p : top) curated.insert(p.value("altname", p.value("pair", "")));
+    }
+
+    // Exchange metadata keyed by altname (leverage availability, status)
+    std::unordered_map<std::string, json> metadata;
+    json assetpairs = read_json_file(dir + "assetpairs.json");
+    if (assetpairs.contains("result") && assetpairs["result"].is_object()) {
+        for (const auto& [key, info] : assetpairs["result"].items()) {
+            std::string quote = info.value("quote", "");
+            if (quote != "ZUSD" && quote != "USD") continue;
+            metadata[info.value("altname", key)] = info;
+        }
+    }
+
+    auto add_pair = [&](const std::string& altname, const std::string& wsname) {
+        if (altname.empty() || excluded.count(altname)) return;
+        auto meta = metadata.find(altname);
+        if (meta != metadata.end() && meta->second.value("status", "online") != "online") return;
+        // Already scanned as a pinned inverse perpetual
+        if (index.count("PI_" + altname)) return;
+
+        UniversePair& p = get_or_add(futures_symbol(altname));
+        p.altname = altname;
+        p.wsname = wsname;
+
+        double prior = 1.0;
+        if (curated.count(altname)) prior += 1.0;
+        if (meta != metadata.end()) {
+            const auto& lev = meta->second.value("leverage_buy", json::array());
+            if (lev.is_array() && !lev.empty()) {
+                // Margin-enabled pairs are the deep books on Kraken
+                prior += 2.0 + 0.1 * lev.back().get<double>();
+            }
+        }
+        p.static_score = std::max(p.static_score, prior);
+    };
+
+    json details = read_json_file(dir + "usd_pairs_details.json");
+    if (details.is_array()) {
+        for (const auto& p : details) {
+            add_pair(p.value("altname", p.value("pair", "")), p.value("wsname", ""));
+        }
+    }
+    // assetpairs.json may list USD pairs missing from the details snapshot
+    for (const auto& [altname, info] : metadata) {
+        if (!index.count(futures_symbol(altname))) add_pair(altname, info.value("wsname", ""));
+    }
+
+    std::cout << "🌐 Pair universe: loaded " << pairs.size() << " USD pairs from " << dir
+              << " (" << excluded.size() << " stable/fiat excluded, " << curated.size() << " curated)" << std::endl;
+    return pairs.size();
+}
+
+void PairUniverse::pin(const std::vector<std::string>& symbols) {
+    std::lock_guard<std::mutex> lock(universe_mutex);
+    for (const auto& s : symbols) {
+        UniversePair& p = get_or_add(s);
+        p.pinned = true;
+    }
+}
+
+void PairUniverse::record_observation(const std::string& symbol, double volume_usd, bool has_data) {
+    std::lock_guard<std::mutex> lock(universe_mutex);
+    auto it = index.find(symbol);
+    if (it == index.end()) return;
+    UniversePair& p = pairs[it->second];
+
+    if (!has_data) {
+        p.missed_observations++;
+        // Never quoted at all: the API does not know the symbol
+        if (!p.pinned && !p.unresolved && p.observations == 0 &&
+            p.missed_observations >= config.max_unresolved_observations) {
+            p.unresolved = true;
+            unresolved_count++;
+            newly_unresolved.push_back(p.symbol);
+        }
+        return;
+    }
+    p.missed_observations = 0;
+    if (volume_usd > 0) {
+        p.volume_ewma_usd = p.observations == 0
+            ? volume_usd
+            : config.volume_ewma_alpha * volume_usd + (1.0 - config.volume_ewma_alpha) * p.volume_ewma_usd;
+    }
+    p.observations++;
+}
+
+double PairUniverse::compute_score(const UniversePair& p) const {
+    if (p.pinned) return PINNED_SCORE;
+    if (p.unresolved) return -PINNED_SCORE;
+
+    double score = p.static_score;
+    if (p.volume_ewma_usd > 0) score += std::log10(1.0 + p.volume_ewma_usd);
+
+    // Missing data decays the score linearly down to the penalty floor
+    if (p.missed_observations > 0) {
+        double frac = std::min(1.0, (double)p.missed_observations / std::max(1, config.max_missed_observations));
+        score -= frac * MISSING_DATA_PENALTY;
+    }
+    return score;
+}
+
+std::vector<std::string> PairUniverse::refresh() {
+    std::lock_guard<std::mutex> lock(universe_mutex);
+
+    for (auto& p : pairs) p.score = compute_score(p);
+
+    std::vector<size_t> order(pairs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+        if (pairs[a].score != pairs[b].score) return pairs[a].score > pairs[b].score;
+        return pairs[a].symbol < pairs[b].symbol;  // Deterministic tie-break
+    });
+
+    const size_t exit_rank = config.max_active + config.hysteresis_band;
+    size_t entered = 0, dropped = 0;
+    for (size_t r = 0; r < order.size(); r++) {
+        UniversePair& p = pairs[order[r]];
+        p.rank = r + 1;
+
+        if (p.pinned) {
+            p.active = true;
+            p.refreshes_outside = 0;
+        } else if (p.unresolved) {
+            if (p.active) dropped++;
+            p.active = false;
+        } else if (p.active) {
+            if (p.rank > exit_rank) {
+                if (++p.refreshes_outside >= config.drop_after_refreshes) {
+                    p.active = false;
+                    p.refreshes_outside = 0;
+                    dropped++;
+                }
+            } else {
+                p.refreshes_outside = 0;
+            }
+        } else if (p.rank <= config.max_active) {
+            p.active = true;
+            p.refreshes_outside = 0;
+            entered++;
+        }
+    }
+
+    // Hard cap at the exit band: shed the lowest-ranked non-pinned pairs
+    active.clear();
+    active.reserve(exit_rank);
+    for (size_t idx : order) {
+        UniversePair& p = pairs[idx];
+        if (!p.active) continue;
+        if (active.size() >= exit_rank && !p.pinned) {
+            p.active = false;
+            dropped++;
+            continue;
+        }
+        active.push_back(p.symbol);
+    }
+
+    if (!newly_unresolved.empty()) {
+        std::cerr << "⚠️ Pair universe: " << newly_unresolved.size() << " symbol(s) never quoted by the market API after "
+                  << config.max_unresolved_observations << " scans, no longer scanned (e.g. " << newly_unresolved.front()
+                  << "; " << unresolved_count << " in total)" << std::endl;
+        newly_unresolved.clear();
+    }
+    if (entered > 0 || dropped > 0) {
+        std::cout << "🌐 Pair universe refresh: " << active.size() << " active (+" << entered
+                  << " / -" << dropped << ")" << std::endl;
+    }
+    return active;
+}
+
+std::vector<std::string> PairUniverse::active_pairs() const {
+    std::lock_guard<std::mutex> lock(universe_mutex);
+    return active;
+}
+
+size_t PairUniverse::size() const {
+    std::lock_guard<std::mutex> lock(universe_mutex);
+    return pairs.size();
+}
+
+size_t PairUniverse::active_count() const {
+    std::lock_guard<std::mutex> lock(universe_mutex);
+    return active.size();
+}
+
+json PairUniverse::to_json(size_t top_n) const {
+    std::lock_guard<std::mutex> lock(universe_mutex);
+    json out;
+    out["total_pairs"] = pairs.size();
+    out["active_pairs"] = active.size();
+    out["unresolved_pairs"] = unresolved_count;
+    json top = json::array();
+    for (size_t i = 0; i < active.size() && i < top_n; i++) {
+        const auto& p = pairs[index.at(active[i])];
+        top.push_back({
+            {"symbol", p.symbol},
+            {"altname", p.altname},
+            {"rank", p.rank},
+            {"score", p.score},
+            {"volume_ewma_usd", p.volume_ewma_usd},
+            {"pinned", p.pinned}
+        });
+    }
+    out["top"] = top;
+    return out;
+}
@@ -0,0 +1,150 @@
+#include "pattern_correlation.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+
+void PatternCorrelations::clear() {
+    bits.clear();
+    base_bucket = -1;
+    members.clear();
+    row_of.clear();
+    matrix.clear();
+}
+
+void PatternCorrelations::slide_window(int64_t bucket) {
+    if (base_bucket < 0) {
+        base_bucket = bucket - bucket % 64;
+        return;
+    }
+    int64_t end = base_bucket + (int64_t)WINDOW_BUCKETS;
+    if (bucket < end) return;
+
+    // Drop whole words of the oldest buckets so the new bucket fits
+    size_t shift = (size_t)((bucket - end) / 64 + 1);
+    for (auto& [key, b] : bits) {
+        for (auto* words : {&b.wins, &b.losses}) {
+            for (size_t i = 0; i < WINDOW_WORDS; i++) {
+                (*words)[i] = i + shift < WINDOW_WORDS ? (*words)[i + shift] : 0;
+            }
+        }
+        b.dirty = true;
+    }
+    base_bucket += (int64_t)shift * 64;
+}
+
+void PatternCorrelations::add_trade(PatternKey key, std::chrono::system_clock::time_point timestamp, bool win) {
+    int64_t seconds = std::chrono::duration_cast<std::chrono::seconds>(timestamp.time_since_epoch()).count();
+    int64_t bucket = seconds / BUCKET_SECONDS;
+    slide_window(bucket);
+    if (bucket < base_bucket) return;  // Older than the window
+
+    size_t offset = (size_t)(bucket - base_bucket);
+    Bits& b = bits[key.bits];
+    auto& words = win ? b.wins : b.losses;
+    words[offset / 64] |= 1ULL << (offset % 64);
+    b.dirty = true;
+}
+
+float PatternCorrelations::phi(const Bits& p, const Bits& q) {
+    int n = 0, x = 0, y = 0, a = 0;
+    for (size_t i = 0; i < WINDOW_WORDS; i++) {
+        uint64_t shared = (p.wins[i] | p.losses[i]) & (q.wins[i] | q.losses[i]);
+        uint64_t w1 = p.wins[i] & shared;
+        uint64_t w2 = q.wins[i] & shared;
+        n += std::popcount(shared);
+        x += std::popcount(w1);
+        y += std::popcount(w2);
+        a += std::popcount(w1 & w2);
+    }
+    if (n < MIN_SHARED_BUCKETS) return std::numeric_limits<float>::quiet_NaN();
+    double den = (double)x * (n - x) * (double)y * (n - y);
+    if (den <= 0) return std::numeric_limits<float>::quiet_NaN();
+    return (float)(((double)n * a - (double)x * y) / std::sqrt(den));
+}
+
+void PatternCorrelations::update(const std::vector<PatternKey>& patterns, ThreadPool& pool) {
+    const size_t n = patterns.size();
+    std::vector<const Bits*> row_bits(n, nullptr);
+    std::vector<char> needs(n, 0);
+
+    bool same_members = patterns == members;
+    std::vector<float> next;
+    if (!same_members) next.assign(n * n, std::numeric_limits<float>::quiet_NaN());
+
+    std::vector<uint32_t> old_row(n, 0);
+    for (size_t i = 0; i < n; i++) {
+        row_bits[i] = bits.find(patterns[i].bits);
+        const uint32_t* row = row_of.find(patterns[i].bits);
+        old_row[i] = row ? *row : 0;
+        needs[i] = !row_bits[i] || row_bits[i]->dirty || !old_row[i];
+    }
+
+    // Carry over cached values between rows that did not change
+    if (!same_members) {
+        const size_t old_n = members.size();
+        for (size_t i = 0; i < n; i++) {
+            if (needs[i]) continue;
+            for (size_t j = 0; j < n; j++) {
+                if (needs[j]) continue;
+                next[i * n + j] = matrix[(old_row[i] - 1) * old_n + (old_row[j] - 1)];
+            }
+        }
+        matrix.swap(next);
+        members = patterns;
+        row_of.clear();
+        row_of.reserve(n);
+        for (size_t i = 0; i < n; i++) row_of[patterns[i].bits] = (uint32_t)(i + 1);
+    }
+
+    std::vector<size_t> dirty_rows;
+    for (size_t i = 0; i < n; i++) {
+        if (needs[i]) dirty_rows.push_back(i);
+    }
+
+    // Row i writes (i, j) for every j and mirrors into (j, i) only when row j
+    // is clean, so no two tasks ever write the same cell
+    static const Bits empty_bits;
+    pool.parallel_for(dirty_rows.size(), [&](size_t k) {
+        size_t i = dirty_rows[k];
+        const Bits& bi = row_bits[i] ? *row_bits[i] : empty_bits;
+        for (size_t j = 0; j < n; j++) {
+            float c = j == i ? 1.0f : phi(bi, row_bits[j] ? *row_bits[j] : empty_bits);
+            matrix[i * n + j] = c;
+            if (!needs[j]) matrix[j * n + i] = c;
+        }
+    });
+
+    for (size_t i : dirty_rows) {
+        if (Bits* b = bits.find(patterns[i].bits)) b->dirty = false;
+    }
+}
+
+double PatternCorrelations::correlation(PatternKey a, PatternKey b) const {
+    const uint32_t* ra = row_of.find(a.bits);
+    const uint32_t* rb = row_of.find(b.bits);
+    if (!ra || !rb) return std::numeric_limits<double>::quiet_NaN();
+    return matrix[(*ra - 1) * members.size() + (*rb - 1)];
+}
+
+std::vector<PatternCorrelations::Entry> PatternCorrelations::top(size_t limit, double min_abs) const {
+    std::vector<Entry> entries;
+    const size_t n = members.size();
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = i + 1; j < n; j++) {
+            float c = matrix[i * n + j];
+            if (!std::isnan(c) && std::abs(c) >= min_abs) {
+                entries.push_back({members[i], members[j], c});
+            }
+        }
+    }
+    auto by_strength = [](const Entry& x, const Entry& y) { return std::abs(x.correlation) > std::abs(y.correlation); };
+    if (entries.size() > limit) {
+        std::partial_sort(entries.begin(), entries.begin() + limit, entries.end(), by_strength);
+        entries.resize(limit);
+    } else {
+        std::sort(entries.begin(), entries.end(), by_strength);
+    }
+    return entries;
+}
@@ -0,0 +1,80 @@
+#include "pattern_key.hpp"
+#include "regime_engine.hpp"
+#include <algorithm>
+
+uint32_t PairRegistry::intern(const std::string& pair) {
+    auto it = ids.find(pair);
+    if (it != ids.end()) return it->second;
+    names.push_back(pair);
+    uint32_t id = (uint32_t)names.size();
+    ids.emplace(pair, id);
+    return id;
+}
+
+uint32_t PairRegistry::find(const std::string& pair) const {
+    auto it = ids.find(pair);
+    return it != ids.end() ? it->second : 0;
+}
+
+const std::string& PairRegistry::name(uint32_t id) const {
+    static const std::string unknown = "UNKNOWN";
+    if (id == 0 || id > names.size()) return unknown;
+    return names[id - 1];
+}
+
+static uint64_t pack(uint32_t pair_id, bool is_short, double leverage, int timeframe_bucket,
+                     uint32_t volatility_bucket, uint32_t regime_code) {
+    uint64_t lev = (uint64_t)std::clamp((int)leverage, 0, 255);
+    uint64_t tf = (uint64_t)std::clamp(timeframe_bucket, 0, 7);
+    return (uint64_t)pair_id
+         | ((uint64_t)(is_short ? 1 : 0) << 32)
+         | (lev << 34)
+         | (tf << 42)
+         | ((uint64_t)(volatility_bucket & 0x7) << 45)
+         | ((uint64_t)(regime_code & 0x7) << 48);
+}
+
+PatternKey PatternKey::basic(uint32_t pair_id, bool is_short, double leverage, int timeframe_bucket) {
+    return PatternKey(pack(pair_id, is_short, leverage, timeframe_bucket, ANY, ANY));
+}
+
+PatternKey PatternKey::enhanced(uint32_t pair_id, bool is_short, double leverage, int timeframe_bucket,
+                                int volatility_bucket, int regime_code) {
+    return PatternKey(pack(pair_id, is_short, leverage, timeframe_bucket,
+                           (uint32_t)volatility_bucket, (uint32_t)regime_code));
+}
+
+PatternKey PatternKey::basic_key() const {
+    return PatternKey(bits | ((uint64_t)ANY << 45) | ((uint64_t)ANY << 48));
+}
+
+std::string PatternKey::to_string(const PairRegistry& pairs) const {
+    std::string s = pairs.name(pair_id());
+    s += '_';
+    s += direction();
+    s += '_';
+    s += std::to_string(leverage());
+    s += "x_";
+    s += std::to_string(timeframe_bucket());
+    if (is_enhanced()) {
+        static const char regime_chars[] = {'Q', 'R', 'T', 'V', 'U'};
+        int regime = regime_code();
+        s += "_V";
+        s += std::to_string(volatility_bucket());
+        s += '_';
+        s += regime >= 0 && regime < 5 ? regime_chars[regime] : 'U';
+    }
+    return s;
+}
+
+int PatternKey::volatility_bucket_for(double volatility_pct) {
+    if (volatility_pct < 2.0) return 0;
+    if (volatility_pct < 5.0) return 1;
+    if (volatility_pct < 10.0) return 2;
+    return 3;
+}
+
+int PatternKey::regime_code_for(int market_regime) {
+    // Trending up and down share a pattern; the trade's direction splits them
+    return market_regime >= -2 && market_regime <= 2 ? (int)regime_from_code(market_regime) : 4;
+}
@@ -0,0 +1,286 @@
+#include "perf.hpp"
+#include "bot_config.hpp"
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+
+namespace {
+
+const char* const STAGE_FIELDS[] = {"count", "mean_us", "p50_us", "p90_us", "p99_us", "p999_us", "max_us"};
+// Compared against the baseline; the rest are reported only
+const char* const CHECKED_STAGE_FIELDS[] = {"mean_us", "p99_us"};
+
+double median(std::vector<double> values) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    size_t mid = values.size() / 2;
+    return values.size() % 2 ? values[mid] : (values[mid - 1] + values[mid]) / 2.0;
+}
+
+// Run the bot in cwd with stdout/stderr to log_path and no config
+// environment overrides; exit status and peak RSS
+bool run_child(const std::vector<std::string>& args, const std::string& cwd, const std::string& log_path,
+               int& exit_status, uint64_t& peak_rss_kb, std::string& error) {
+    std::vector<char*> argv;
+    for (const auto& a : args) argv.push_back(const_cast<char*>(a.c_str()));
+    argv.push_back(nullptr);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        error = std::string("fork: ") + std::strerror(errno);
+        return false;
+    }
+    if (pid == 0) {
+        int fd = open(log_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd >= 0) {
+            dup2(fd, STDOUT_FILENO);
+            dup2(fd, STDERR_FILENO);
+            close(fd);
+        }
+        for (const char* name : BOT_ENV_OVERRIDES) unsetenv(name);
+        if (chdir(cwd.c_str()) != 0) _exit(127);
+        execv(argv[0], argv.data());
+        _exit(127);
+    }
+
+    int status = 0;
+    struct rusage usage {};
+    if (wait4(pid, &status, 0, &usage) < 0) {
+        error = std::string("wait4: ") + std::strerror(errno);
+        return false;
+    }
+    exit_status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    peak_rss_kb = (uint64_t)usage.ru_maxrss;   // Kilobytes on Linux
+    if (exit_status == 127) {
+        error = "cannot run " + args[0] + " in " + cwd;
+        return false;
+    }
+    return true;
+}
+
+std::string resolve(const std::filesystem::path& base, const std::string& path) {
+    if (path.empty()) return path;
+    return std::filesystem::absolute(base / path).lexically_normal().string();
+}
+
+}  // namespace
+
+bool PerfTolerances::set(const std::string& name, double value) {
+    if (name == "ticks_per_second") ticks_per_second = value;
+    else if (name == "allocations") allocations = value;
+    else if (name == "allocated_bytes") allocated_bytes = value;
+    else if (name == "peak_rss_kb") peak_rss_kb = value;
+    else if (name == "stage") stage = value;
+    else if (name == "stage_floor_us") stage_floor_us = value;
+    else return false;
+    return true;
+}
+
+void PerfTolerances::merge(const json& tolerances) {
+    if (!tolerances.is_object()) return;
+    for (auto it = tolerances.begin(); it != tolerances.end(); ++it) {
+        if (it.value().is_number()) set(it.key(), it.value().get<double>());
+    }
+}
+
+json PerfTolerances::to_json() const {
+    return {
+        {"ticks_per_second", ticks_per_second},
+        {"allocations", allocations},
+        {"allocated_bytes", allocated_bytes},
+        {"peak_rss_kb", peak_rss_kb},
+        {"stage", stage},
+        {"stage_floor_us", stage_floor_us}
+    };
+}
+
+bool load_perf_sessions(const std::string& manifest_path, std::vector<PerfSession>& sessions, std::string& error) {
+    std::ifstream f(manifest_path);
+    if (!f.good()) {
+        error = "cannot read " + manifest_path;
+        return false;
+    }
+    json manifest = json::parse(f, nullptr, false);
+    if (manifest.is_discarded() || !manifest.contains("sessions") || !manifest["sessions"].is_array()) {
+        error = manifest_path + " has no \"sessions\" array";
+        return false;
+    }
+    const std::filesystem::path base = std::filesystem::path(manifest_path).parent_path();
+    for (const auto& entry : manifest["sessions"]) {
+        PerfSession session;
+        session.name = entry.value("name", std::string());
+        session.capture = resolve(base, entry.value("capture", std::string()));
+        session.ticks = resolve(base, entry.value("ticks", std::string()));
+        session.config = resolve(base, entry.value("config", std::string()));
+        session.cwd = resolve(base, entry.value("cwd", std::string()));
+        if (session.name.empty() || session.capture.empty() == session.ticks.empty()) {
+            error = "each session needs a name and exactly one of \"capture\" or \"ticks\": " + entry.dump();
+            return false;
+        }
+        // Pinned, or the run would depend on where kraken_perf is started
+        if (session.cwd.empty() || (!session.ticks.empty() && session.config.empty())) {
+            error = "each session needs a \"cwd\", and a ticks session a \"config\": " + entry.dump();
+            return false;
+        }
+        if (!std::filesystem::is_directory(session.cwd) ||
+            (!session.config.empty() && !std::filesystem::is_regular_file(session.config))) {
+            error = "session " + session.name + ": missing " +
+                    (std::filesystem::is_directory(session.cwd) ? session.config : session.cwd);
+            return false;
+        }
+        sessions.push_back(std::move(session));
+    }
+    return true;
+}
+
+bool run_perf_session(const PerfSession& session, const PerfRunOptions& options,
+                      PerfSample& sample, std::string& error) {
+    const std::string prefix = options.work_dir + "/" + session.name;
+    const std::string report_path = prefix + ".report.json";
+    const std::string log_path = prefix + ".log";
+    std::vector<std::string> args = {std::filesystem::absolute(options.bot_path).string()};
+    if (!session.capture.empty()) {
+        args.insert(args.end(), {"--replay-capture", session.capture});
+    } else {
+        args.insert(args.end(), {"--replay", session.ticks, "--speed", "max", "--config", session.config});
+    }
+    args.insert(args.end(), {"--replay-trades-db", prefix + ".trades.db", "--perf-report", report_path});
+
+    std::vector<json> reports;
+    std::vector<uint64_t> rss;
+    for (int run = 0; run < options.warmup + options.repeat; run++) {
+        std::remove(report_path.c_str());
+        int status = 0;
+        uint64_t peak_rss_kb = 0;
+        if (!run_child(args, session.cwd, log_path, status, peak_rss_kb, error)) return false;
+        std::ifstream f(report_path);
+        json report = f.good() ? json::parse(f, nullptr, false) : json();
+        if (!report.is_object()) {
+            error = "exit status " + std::to_string(status) + " and no perf report (see " + log_path + ")";
+            return false;
+        }
+        // A diverged capture replay exits 1 but still reports
+        if (status != 0 && report.value("capture_misses", 0) == 0) {
+            error = "exit status " + std::to_string(status) + " (see " + log_path + ")";
+            return false;
+        }
+        if (run < options.warmup) continue;
+        reports.push_back(std::move(report));
+        rss.push_back(peak_rss_kb);
+    }
+
+    auto median_of = [&reports](const char* key) {
+        std::vector<double> values;
+        for (const auto& r : reports) values.push_back(r.value(key, 0.0));
+        return median(values);
+    };
+    sample = PerfSample{};
+    sample.wall_seconds = median_of("wall_seconds");
+    sample.ticks_per_second = median_of("ticks_per_second");
+    sample.ticks = (uint64_t)median_of("ticks");
+    sample.allocations = (uint64_t)median_of("allocations");
+    sample.allocated_bytes = (uint64_t)median_of("allocated_bytes");
+    sample.peak_rss_kb = (uint64_t)median(std::vector<double>(rss.begin(), rss.end()));
+    sample.scans = (uint64_t)median_of("scans");
+    sample.trades = (uint64_t)median_of("trades");
+    sample.diverged = median_of("capture_misses") > 0;
+
+    std::map<std::string, std::map<std::string, std::vector<double>>> stage_values;
+    for (const auto& r : reports) {
+        if (!r.contains("stages") || !r["stages"].is_object()) continue;
+        for (auto it = r["stages"].begin(); it != r["stages"].end(); ++it) {
+            for (const char* field : STAGE_FIELDS) {
+                if (it.value().contains(field)) stage_values[it.key()][field].push_back(it.value()[field].get<double>());
+            }
+        }
+    }
+    for (const auto& [stage, fields] : stage_values) {
+        for (const auto& [field, values] : fields) sample.stages[stage][field] = median(values);
+    }
+
+    if (!options.keep_logs) {
+        std::remove(log_path.c_str());
+        std::remove(report_path.c_str());
+        for (const char* suffix : {"", "-wal", "-shm"}) std::remove((prefix + ".trades.db" + suffix).c_str());
+    }
+    return true;
+}
+
+json perf_sample_json(const PerfSample& sample) {
+    return {
+        {"wall_seconds", sample.wall_seconds},
+        {"ticks", sample.ticks},
+        {"ticks_per_second", sample.ticks_per_second},
+        {"allocations", sample.allocations},
+        {"allocated_bytes", sample.allocated_bytes},
+        {"peak_rss_kb", sample.peak_rss_kb},
+        {"scans", sample.scans},
+        {"trades", sample.trades},
+        {"diverged", sample.diverged},
+        {"stages", sample.stages}
+    };
+}
+
+PerfSample perf_sample_from_json(const json& j) {
+    PerfSample sample;
+    sample.wall_seconds = j.value("wall_seconds", 0.0);
+    sample.ticks = j.value("ticks", (uint64_t)0);
+    sample.ticks_per_second = j.value("ticks_per_second", 0.0);
+    sample.allocations = j.value("allocations", (uint64_t)0);
+    sample.allocated_bytes = j.value("allocated_bytes", (uint64_t)0);
+    sample.peak_rss_kb = j.value("peak_rss_kb", (uint64_t)0);
+    sample.scans = j.value("scans", (uint64_t)0);
+    sample.trades = j.value("trades", (uint64_t)0);
+    sample.diverged = j.value("diverged", false);
+    sample.stages = j.value("stages", json::object());
+    return sample;
+}
+
+std::vector<PerfCheck> compare_perf_sample(const std::string& session, const PerfSample& measured,
+                                           const PerfSample& baseline, const PerfTolerances& tolerances) {
+    std::vector<PerfCheck> checks;
+    // Higher is worse unless lower_is_worse; a zero baseline has nothing to compare
+    auto check = [&](const std::string& metric, double base, double value, double limit, bool lower_is_worse) {
+        if (base <= 0.0) return;
+        PerfCheck c{session, metric, base, value, limit, lower_is_worse ? value < limit : value > limit};
+        checks.push_back(std::move(c));
+    };
+    check("ticks_per_second", baseline.ticks_per_second, measured.ticks_per_second,
+          baseline.ticks_per_second * (1.0 - tolerances.ticks_per_second), true);
+    check("allocations", (double)baseline.allocations, (double)measured.allocations,
+          baseline.allocations * (1.0 + tolerances.allocations), false);
+    check("allocated_bytes", (double)baseline.allocated_bytes, (double)measured.allocated_bytes,
+          baseline.allocated_bytes * (1.0 + tolerances.allocated_bytes), false);
+    check("peak_rss_kb", (double)baseline.peak_rss_kb, (double)measured.peak_rss_kb,
+          baseline.peak_rss_kb * (1.0 + tolerances.peak_rss_kb), false);
+
+    for (auto it = baseline.stages.begin(); it != baseline.stages.end(); ++it) {
+        if (!measured.stages.contains(it.key())) continue;
+        const json& now = measured.stages[it.key()];
+        for (const char* field : CHECKED_STAGE_FIELDS) {
+            if (!it.value().contains(field) || !now.contains(field)) continue;
+            double base = it.value()[field].get<double>();
+            double limit = std::max(base * (1.0 + tolerances.stage), base + tolerances.stage_floor_us);
+            check("stages." + it.key() + "." + field, base, now[field].get<double>(), limit, false);
+        }
+    }
+    return checks;
+}
+
+json perf_check_json(const PerfCheck& check) {
+    return {
+        {"session", check.session},
+        {"metric", check.metric},
+        {"baseline", check.baseline},
+        {"measured", check.measured},
+        {"limit", check.limit},
+        {"regression", check.regression}
+    };
+}
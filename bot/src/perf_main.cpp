@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <chrono>
+#include <filesystem>
+#include <set>
+#include <string>
+#include <cstdlib>
+#include "perf.hpp"
+
+/*
+ * kraken_perf - replay the checked-in sessions through kraken_bot and fail
+ * on performance regressions against a baseline (see perf.hpp). Runs from
+ * bot/build/ like kraken_bot.
+ *
+ *   kraken_perf [--sessions PATH] [--baseline PATH] [--bot PATH]
+ *               [--repeat N] [--warmup N] [--only NAME ...]
+ *               [--tolerance name=fraction ...] [--update-baseline]
+ *               [--label TEXT] [--append PATH.jsonl] [--keep-logs]
+ *
+ * The result document (samples, checks, status) goes to stdout as JSON and
+ * the human summary to stderr; --append adds it as one line to a history
+ * file for tracking trends across commits. Exit status: 0 pass (or no
+ * baseline yet), 1 regression, 2 a session could not run.
+ */
+
+static std::string default_bot_path() {
+    std::error_code ec;
+    auto self = std::filesystem::read_symlink("/proc/self/exe", ec);
+    return ec ? std::string("./kraken_bot") : (self.parent_path() / "kraken_bot").string();
+}
+
+int main(int argc, char* argv[]) {
+    std::string sessions_path = "../perf/sessions.json";
+    std::string baseline_path = "../perf/baseline.json";
+    std::string label;
+    std::string append_path;
+    std::set<std::string> only;
+    json cli_tolerances = json::object();
+    bool update_baseline = false;
+    PerfRunOptions options;
+    options.bot_path = default_bot_path();
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--sessions" && i+1 < argc) sessions_path = argv[++i];
+        else if (arg == "--baseline" && i+1 < argc) baseline_path = argv[++i];
+        else if (arg == "--bot" && i+1 < argc) options.bot_path = argv[++i];
+        else if (arg == "--repeat" && i+1 < argc) options.repeat = std::max(1, std::stoi(argv[++i]));
+        else if (arg == "--warmup" && i+1 < argc) options.warmup = std::max(0, std::stoi(argv[++i]));
+        else if (arg == "--only" && i+1 < argc) only.insert(argv[++i]);
+        else if (arg == "--label" && i+1 < argc) label = argv[++i];
+        else if (arg == "--append" && i+1 < argc) append_path = argv[++i];
+        else if (arg == "--update-baseline") update_baseline = true;
+        else if (arg == "--keep-logs") options.keep_logs = true;
+        else if (arg == "--tolerance" && i+1 < argc) {
+            std::string kv = argv[++i];
+            size_t eq = kv.find('=');
+            PerfTolerances probe;
+            if (eq == std::string::npos || !probe.set(kv.substr(0, eq), 0.0)) {
+                const json names = probe.to_json();
+                std::cerr << "❌ --tolerance expects name=fraction with name one of:";
+                for (auto it = names.begin(); it != names.end(); ++it) std::cerr << " " << it.key();
+                std::cerr << std::endl;
+                return 2;
+            }
+            cli_tolerances[kv.substr(0, eq)] = std::stod(kv.substr(eq + 1));
+        } else {
+            std::cerr << "❌ Unknown argument: " << arg << std::endl;
+            return 2;
+        }
+    }
+
+    std::vector<PerfSession> sessions;
+    std::string error;
+    if (!load_perf_sessions(sessions_path, sessions, error)) {
+        std::cerr << "❌ " << error << std::endl;
+        return 2;
+    }
+    if (!only.empty()) {
+        sessions.erase(std::remove_if(sessions.begin(), sessions.end(),
+                                      [&only](const PerfSession& s) { return !only.count(s.name); }),
+                       sessions.end());
+    }
+
+    json baseline = json::object();
+    {
+        std::ifstream f(baseline_path);
+        if (f.good()) baseline = json::parse(f, nullptr, false);
+        if (!baseline.is_object()) {
+            std::cerr << "❌ " << baseline_path << " is not valid JSON" << std::endl;
+            return 2;
+        }
+    }
+    PerfTolerances tolerances;
+    tolerances.merge(baseline.value("tolerances", json::object()));
+    tolerances.merge(cli_tolerances);
+    const json baseline_sessions = baseline.value("sessions", json::object());
+
+    char work_template[] = "/tmp/kraken_perf.XXXXXX";
+    if (!mkdtemp(work_template)) {
+        std::cerr << "❌ Cannot create a scratch directory in /tmp" << std::endl;
+        return 2;
+    }
+    options.work_dir = work_template;
+
+    std::cerr << "⏱️ kraken_perf: " << sessions.size() << " sessions x " << options.repeat << " runs (+"
+              << options.warmup << " warmup) with " << options.bot_path << std::endl;
+
+    json results = json::object();
+    json checks = json::array();
+    int regressions = 0;
+    bool failed = false;
+    for (const PerfSession& session : sessions) {
+        PerfSample sample;
+        if (!run_perf_session(session, options, sample, error)) {
+            std::cerr << "❌ " << session.name << ": " << error << std::endl;
+            results[session.name] = {{"error", error}};
+            failed = true;
+            continue;
+        }
+        json entry = perf_sample_json(sample);
+        std::cerr << "  " << std::left << std::setw(24) << session.name << std::right << std::fixed
+                  << std::setprecision(0) << std::setw(10) << sample.ticks_per_second << " ticks/s"
+                  << std::setw(10) << sample.allocations << " allocs" << std::setw(8) << sample.peak_rss_kb / 1024
+                  << " MB RSS" << std::setprecision(3) << std::setw(8) << sample.wall_seconds << "s"
+                  << std::setprecision(0) << "  (" << sample.scans << " scans, " << sample.trades << " trades)"
+                  << std::endl;
+
+        if (sample.diverged) {
+            std::cerr << "  ⚠️ " << session.name << " no longer replays as recorded; not compared. Re-record it with"
+                      << " kraken_bot --capture" << std::endl;
+        } else if (baseline_sessions.contains(session.name)) {
+            PerfSample base = perf_sample_from_json(baseline_sessions[session.name]);
+            if (base.scans != sample.scans || base.trades != sample.trades) {
+                entry["work_changed"] = true;
+                std::cerr << "  ⚠️ " << session.name << " did different work than the baseline (" << base.scans
+                          << " scans, " << base.trades << " trades); numbers may not be comparable" << std::endl;
+            }
+            for (const PerfCheck& c : compare_perf_sample(session.name, sample, base, tolerances)) {
+                checks.push_back(perf_check_json(c));
+                if (!c.regression) continue;
+                regressions++;
+                std::cerr << "  ❌ " << c.metric << ": " << std::setprecision(1) << c.measured << " vs baseline "
+                          << c.baseline << " (limit " << c.limit << ")" << std::endl;
+            }
+        }
+        results[session.name] = std::move(entry);
+    }
+    if (!options.keep_logs) {
+        std::error_code ec;
+        std::filesystem::remove_all(options.work_dir, ec);
+    } else {
+        std::cerr << "  Logs kept in " << options.work_dir << std::endl;
+    }
+
+    if (update_baseline && !failed) {
+        json updated = {{"tolerances", tolerances.to_json()}, {"sessions", baseline_sessions}};
+        for (auto it = results.begin(); it != results.end(); ++it) {
+            json entry = it.value();
+            entry.erase("work_changed");
+            updated["sessions"][it.key()] = entry;
+        }
+        std::ofstream out(baseline_path);
+        out << updated.dump(2) << std::endl;
+        std::cerr << "💾 Baseline written to " << baseline_path << std::endl;
+    }
+
+    const char* status = failed ? "error" : regressions > 0 ? "regression"
+                       : baseline_sessions.empty() ? "no_baseline" : "pass";
+    json doc = {
+        {"label", label},
+        {"timestamp", std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count()},
+        {"repeat", options.repeat},
+        {"warmup", options.warmup},
+        {"tolerances", tolerances.to_json()},
+        {"sessions", results},
+        {"checks", checks},
+        {"regressions", regressions},
+        {"status", status}
+    };
+    std::cout << doc.dump(2) << std::endl;
+    if (!append_path.empty()) {
+        std::ofstream history(append_path, std::ios::app);
+        history << doc.dump() << "\n";
+    }
+    std::cerr << (regressions > 0 ? "❌ " : "✅ ") << regressions << " regressions in " << checks.size()
+              << " checks (" << status << ")" << std::endl;
+    if (failed) return 2;
+    return regressions > 0 ? 1 : 0;
+}
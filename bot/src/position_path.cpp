@@ -0,0 +1,166 @@
+#include "position_path.hpp"
+#include "counterfactual.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr uint8_t PATH_FORMAT = 1;
+
+void put_varint(std::vector<uint8_t>& out, uint32_t v) {
+    while (v >= 0x80) {
+        out.push_back((uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((uint8_t)v);
+}
+
+void put_zigzag(std::vector<uint8_t>& out, int32_t v) {
+    put_varint(out, ((uint32_t)v << 1) ^ (uint32_t)(v >> 31));
+}
+
+bool get_varint(const uint8_t*& p, const uint8_t* end, uint32_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 35 && p < end; shift += 7) {
+        uint8_t byte = *p++;
+        v |= (uint32_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+bool get_zigzag(const uint8_t*& p, const uint8_t* end, int32_t& v) {
+    uint32_t u;
+    if (!get_varint(p, end, u)) return false;
+    v = (int32_t)(u >> 1) ^ -(int32_t)(u & 1);
+    return true;
+}
+
+}  // namespace
+
+PathPool& PathPool::instance() {
+    static PathPool pool;
+    return pool;
+}
+
+PathPool::PathPool() {
+    add_slab();
+}
+
+void PathPool::add_slab() {
+    slabs.push_back(std::make_unique<PathSample[]>(SLAB_SLOTS * SLOT_SAMPLES));
+    PathSample* slab = slabs.back().get();
+    for (size_t i = SLAB_SLOTS; i-- > 0;) free_slots.push_back(slab + i * SLOT_SAMPLES);
+}
+
+PathSample* PathPool::acquire() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (free_slots.empty()) add_slab();
+    PathSample* slot = free_slots.back();
+    free_slots.pop_back();
+    return slot;
+}
+
+void PathPool::release(PathSample* slot) {
+    if (!slot) return;
+    std::lock_guard<std::mutex> lock(mutex);
+    free_slots.push_back(slot);
+}
+
+size_t PathPool::capacity() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return slabs.size() * SLAB_SLOTS;
+}
+
+size_t PathPool::in_use() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return slabs.size() * SLAB_SLOTS - free_slots.size();
+}
+
+PositionPath::PositionPath(bool is_short, double entry_price)
+    : is_short(is_short), entry_price(entry_price), samples(PathPool::instance().acquire()) {}
+
+PositionPath::~PositionPath() {
+    PathPool::instance().release(samples);
+}
+
+PathSample PositionPath::quantize(double price, double entry_price, long elapsed_seconds) {
+    double bp = entry_price > 0 ? std::round((price / entry_price - 1.0) * 10000.0) : 0.0;
+    PathSample s;
+    s.elapsed_s = (uint16_t)std::clamp<long>(elapsed_seconds, 0, UINT16_MAX);
+    s.move_bp = (int16_t)std::clamp(bp, (double)INT16_MIN, (double)INT16_MAX);
+    return s;
+}
+
+void PositionPath::on_price(double price, long elapsed_seconds) {
+    if (price <= 0 || entry_price <= 0) return;
+    observed++;
+
+    double move_pct = (price / entry_price - 1.0) * 100.0;
+    double favorable = is_short ? -move_pct : move_pct;
+    if (favorable > mfe_pct) {
+        mfe_pct = favorable;
+        mfe_bar = observed;
+    }
+    if (favorable < mae_pct) {
+        mae_pct = favorable;
+        mae_bar = observed;
+    }
+
+    last = quantize(price, entry_price, elapsed_seconds);
+    if ((observed - 1) % stride != 0) return;
+    if (count == PathPool::SLOT_SAMPLES) {
+        // Full: keep every other sample at twice the stride
+        for (size_t i = 0; 2 * i < count; i++) samples[i] = samples[2 * i];
+        count = (count + 1) / 2;
+        stride *= 2;
+        if ((observed - 1) % stride != 0) return;
+    }
+    samples[count++] = last;
+}
+
+std::vector<uint8_t> PositionPath::compress() const {
+    std::vector<uint8_t> out;
+    if (size() == 0) return out;
+    out.reserve(8 + size() * 3);
+    out.push_back(PATH_FORMAT);
+    put_varint(out, (uint32_t)size());
+    int32_t prev_elapsed = 0, prev_move = 0;
+    auto put = [&](const PathSample& s) {
+        put_zigzag(out, (int32_t)s.elapsed_s - prev_elapsed);
+        put_zigzag(out, (int32_t)s.move_bp - prev_move);
+        prev_elapsed = s.elapsed_s;
+        prev_move = s.move_bp;
+    };
+    for (size_t i = 0; i < count; i++) put(samples[i]);
+    if (has_tail()) put(last);
+    return out;
+}
+
+bool decode_price_path(const uint8_t* data, size_t size, bool is_short, PricePath& out) {
+    out.is_short = is_short;
+    out.elapsed_s.clear();
+    out.move_pct.clear();
+    const uint8_t* p = data;
+    const uint8_t* end = data + size;
+    uint32_t n;
+    if (size == 0 || *p++ != PATH_FORMAT || !get_varint(p, end, n) || n > (size_t)(end - p)) return false;
+
+    out.elapsed_s.reserve(n);
+    out.move_pct.reserve(n);
+    int32_t elapsed = 0, move = 0;
+    const float side = is_short ? -0.01f : 0.01f;   // bp -> favorable %
+    for (uint32_t i = 0; i < n; i++) {
+        int32_t d_elapsed, d_move;
+        if (!get_zigzag(p, end, d_elapsed) || !get_zigzag(p, end, d_move)) {
+            out.elapsed_s.clear();
+            out.move_pct.clear();
+            return false;
+        }
+        elapsed += d_elapsed;
+        move += d_move;
+        out.elapsed_s.push_back(elapsed);
+        out.move_pct.push_back(side * (float)move);
+    }
+    return true;
+}
@@ -0,0 +1,164 @@
+#include "regime_engine.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// Std-dev of |r| for a zero-mean normal r is sqrt(1 - 2/pi) sigma: puts the
+// filter's own estimate on the realized_volatility_pct scale
+const double ABS_RETURN_STD = std::sqrt(1.0 - 2.0 / M_PI);
+constexpr double MIN_VOLATILITY_PCT = 1e-6;   // Flat prices: deep QUIET, not log(0)
+constexpr double TREND_CLAMP = 8.0;
+constexpr double STAY_PROBABILITY = 0.95;     // Mean regime length ~20 observations
+
+RegimeModel make_default_model() {
+    RegimeModel model;
+    // Volatility centres 0.0025% / 0.01% / 0.04% (x4 apart): boundaries at
+    // 0.005% and 0.02%
+    using Emission = RegimeModel::Emission;
+    model.emission[(size_t)MarketRegime::QUIET] = Emission::gaussian(std::log(0.0025), 0.5, 0.8, 0.6);
+    model.emission[(size_t)MarketRegime::RANGING] = Emission::gaussian(std::log(0.01), 0.5, 0.8, 0.6);
+    model.emission[(size_t)MarketRegime::TRENDING] = Emission::gaussian(std::log(0.01), 0.5, 2.5, 1.0);
+    model.emission[(size_t)MarketRegime::VOLATILE] = Emission::gaussian(std::log(0.04), 0.5, 0.8, 1.0);
+    for (size_t i = 0; i < REGIME_COUNT; i++) {
+        for (size_t j = 0; j < REGIME_COUNT; j++) {
+            model.transition[i][j] = i == j ? STAY_PROBABILITY : (1.0 - STAY_PROBABILITY) / (REGIME_COUNT - 1);
+        }
+    }
+    return model;
+}
+
+}  // namespace
+
+std::string regime_to_string(MarketRegime regime) {
+    switch (regime) {
+        case MarketRegime::QUIET: return "QUIET";
+        case MarketRegime::RANGING: return "RANGING";
+        case MarketRegime::TRENDING: return "TRENDING";
+        case MarketRegime::VOLATILE: return "VOLATILE";
+        default: return "UNKNOWN";
+    }
+}
+
+int regime_code(MarketRegime regime, bool trend_up) {
+    switch (regime) {
+        case MarketRegime::QUIET: return -2;
+        case MarketRegime::TRENDING: return trend_up ? 1 : -1;
+        case MarketRegime::VOLATILE: return 2;
+        default: return 0;
+    }
+}
+
+MarketRegime regime_from_code(int code) {
+    switch (code) {
+        case -2: return MarketRegime::QUIET;
+        case -1:
+        case 1: return MarketRegime::TRENDING;
+        case 2: return MarketRegime::VOLATILE;
+        default: return MarketRegime::RANGING;
+    }
+}
+
+RegimeModel::Emission RegimeModel::Emission::gaussian(double log_vol_mean, double log_vol_std,
+                                                     double trend_mean, double trend_std) {
+    return {log_vol_mean, 1.0 / log_vol_std, trend_mean, 1.0 / trend_std, -std::log(log_vol_std), -std::log(trend_std)};
+}
+
+const RegimeModel& RegimeModel::defaults() {
+    static const RegimeModel model = make_default_model();
+    return model;
+}
+
+RegimeFilter::RegimeFilter(const RegimeModel& model) : model(&model) {
+    posterior.fill(1.0 / REGIME_COUNT);
+}
+
+const RegimeEstimate& RegimeFilter::update(double price, double volatility_pct) {
+    if (!(price > 0.0)) return current;
+    const RegimeModel& m = *model;
+    const double alpha = 2.0 / (m.trend_span + 1.0);
+    if (last_price > 0.0) {
+        const double r = std::log(price / last_price);
+        drift += alpha * (r - drift);
+        power = returns == 0 ? r * r : power + alpha * (r * r - power);
+        returns++;
+    }
+    last_price = price;
+
+    double vol = volatility_pct;
+    if (!(vol > 0.0)) {
+        if (returns == 0) return current;   // First price: nothing to go on
+        vol = ABS_RETURN_STD * std::sqrt(power) * 100.0;
+    }
+    const double log_vol = std::log(std::max(vol, MIN_VOLATILITY_PCT));
+
+    // Drift in standard errors of an EWMA mean: var = alpha / (2 - alpha) * E[r^2]
+    const bool has_trend = returns >= MIN_TREND_RETURNS && power > 0.0;
+    double trend = 0.0;
+    if (has_trend) {
+        trend = std::clamp(drift / std::sqrt(power * alpha / (2.0 - alpha)), -TREND_CLAMP, TREND_CLAMP);
+    }
+
+    std::array<double, REGIME_COUNT> log_likelihood;
+    double best = -std::numeric_limits<double>::infinity();
+    for (size_t s = 0; s < REGIME_COUNT; s++) {
+        const RegimeModel::Emission& e = m.emission[s];
+        const double zv = (log_vol - e.log_vol_mean) * e.log_vol_precision;
+        double ll = e.log_vol_norm - 0.5 * zv * zv;
+        if (has_trend) {
+            const double zt = (std::abs(trend) - e.trend_mean) * e.trend_precision;
+            ll += e.trend_norm - 0.5 * zt * zt;
+        }
+        log_likelihood[s] = ll;
+        best = std::max(best, ll);
+    }
+
+    // Predict through the transition matrix, weigh by the (max-shifted)
+    // likelihood, normalize
+    std::array<double, REGIME_COUNT> next;
+    double total = 0.0;
+    for (size_t s = 0; s < REGIME_COUNT; s++) {
+        double predicted = 0.0;
+        for (size_t i = 0; i < REGIME_COUNT; i++) predicted += posterior[i] * m.transition[i][s];
+        next[s] = predicted * std::exp(log_likelihood[s] - best);
+        total += next[s];
+    }
+    if (!(total > 0.0) || !std::isfinite(total)) return current;
+
+    size_t argmax = 0;
+    for (size_t s = 0; s < REGIME_COUNT; s++) {
+        posterior[s] = next[s] / total;
+        current.probability[s] = (float)posterior[s];
+        if (posterior[s] > posterior[argmax]) argmax = s;
+    }
+    current.regime = (MarketRegime)argmax;
+    current.trend = (float)trend;
+    current.observations++;
+    return current;
+}
+
+RegimeEstimate RegimeEngine::update(const std::string& pair, double price, double volatility_pct) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = filters.find(pair);
+    if (it == filters.end()) it = filters.emplace(pair, RegimeFilter(model)).first;
+    return it->second.update(price, volatility_pct);
+}
+
+RegimeEstimate RegimeEngine::estimate(const std::string& pair) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = filters.find(pair);
+    return it != filters.end() ? it->second.estimate() : RegimeEstimate{};
+}
+
+std::array<size_t, REGIME_COUNT> RegimeEngine::pair_counts() const {
+    std::array<size_t, REGIME_COUNT> counts{};
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& [pair, filter] : filters) counts[(size_t)filter.estimate().regime]++;
+    return counts;
+}
+
+void RegimeEngine::reserve(size_t pairs) {
+    std::lock_guard<std::mutex> lock(mutex);
+    filters.reserve(pairs);
+}
@@ -0,0 +1,126 @@
+#include "replay_market_data.hpp"
+#include <sqlite3.h>
+#include <algorithm>
+#include <iostream>
+
+namespace {
+
+constexpr size_t REPLAY_CANDLES = 8;
+
+bool has_table(const std::string& db_path, const char* table) {
+    sqlite3* db = nullptr;
+    if (sqlite3_open_v2(db_path.c_str(), &db, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+        sqlite3_close(db);
+        return false;
+    }
+    bool found = false;
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, "SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = ?", -1, &stmt, nullptr) == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, table, -1, SQLITE_STATIC);
+        found = sqlite3_step(stmt) == SQLITE_ROW;
+        sqlite3_finalize(stmt);
+    }
+    sqlite3_close(db);
+    return found;
+}
+
+}  // namespace
+
+ReplayMarketData::ReplayMarketData(TickData data, Clock& clock) : data_(std::move(data)), clock_(clock) {}
+
+bool ReplayMarketData::load(const std::string& db_path, TickData& data) {
+    if (has_table(db_path, "ticker_data")) return load_ticker_data(db_path, data);
+    if (has_table(db_path, "price_history")) return load_price_history(db_path, data);
+    std::cerr << "❌ Replay: " << db_path << " has neither ticker_data nor price_history" << std::endl;
+    return false;
+}
+
+const TickSeries* ReplayMarketData::find(const std::string& pair) const {
+    auto it = std::lower_bound(data_.series.begin(), data_.series.end(), pair,
+                               [](const TickSeries& s, const std::string& p) { return s.pair < p; });
+    return it != data_.series.end() && it->pair == pair ? &*it : nullptr;
+}
+
+long ReplayMarketData::current_index(const TickSeries& series) const {
+    int64_t now = clock_.now_ms();
+    auto it = std::upper_bound(series.timestamp_ms.begin(), series.timestamp_ms.end(), now);
+    return (long)(it - series.timestamp_ms.begin()) - 1;
+}
+
+std::vector<std::string> ReplayMarketData::get_trading_pairs() {
+    std::vector<std::string> pairs;
+    for (const auto& s : data_.series) pairs.push_back(s.pair);
+    return pairs;
+}
+
+json ReplayMarketData::get_ticker(const std::string& pair) {
+    const TickSeries* s = find(pair);
+    long i = s ? current_index(*s) : -1;
+    if (i < 0) return json::object();
+    return {
+        {"last", s->last[i]},
+        {"bid", s->bid[i]},
+        {"ask", s->ask[i]},
+        {"volumeQuote", s->volume[i]},
+        {"high", s->high[i]},
+        {"low", s->low[i]},
+        {"open", s->open[i]}
+    };
+}
+
+double ReplayMarketData::get_latest_price(const std::string& pair) {
+    const TickSeries* s = find(pair);
+    long i = s ? current_index(*s) : -1;
+    return i < 0 ? 0.0 : s->last[i];
+}
+
+double ReplayMarketData::get_volatility(const std::string& pair, int /*minutes*/) {
+    const TickSeries* s = find(pair);
+    long i = s ? current_index(*s) : -1;
+    return i < 0 ? 0.0 : s->volatility_pct[i];
+}
+
+std::vector<OHLC> ReplayMarketData::get_ohlc(const std::string& pair, int interval) {
+    std::vector<OHLC> candles;
+    const TickSeries* s = find(pair);
+    long last = s ? current_index(*s) : -1;
+    if (last < 0) return candles;
+
+    // The last REPLAY_CANDLES buckets up to now; the newest is still forming
+    const int64_t bucket_ms = std::max(1, interval) * 60LL * 1000;
+    const int64_t first_bucket = s->timestamp_ms[last] / bucket_ms - (int64_t)REPLAY_CANDLES + 1;
+    auto begin = std::lower_bound(s->timestamp_ms.begin(), s->timestamp_ms.begin() + last + 1,
+                                  first_bucket * bucket_ms);
+    int64_t bucket = -1;
+    for (long i = (long)(begin - s->timestamp_ms.begin()); i <= last; i++) {
+        int64_t b = s->timestamp_ms[i] / bucket_ms;
+        double price = s->last[i];
+        if (b != bucket) {
+            candles.push_back({(long)(b * bucket_ms / 1000), price, price, price, price, 0.0});
+            bucket = b;
+            continue;
+        }
+        OHLC& c = candles.back();
+        c.high = std::max(c.high, price);
+        c.low = std::min(c.low, price);
+        c.close = price;
+    }
+    return candles;
+}
+
+Order ReplayMarketData::place_market_order(const std::string& pair, const std::string& side,
+                                           double volume, double /*leverage*/) {
+    Order order;
+    order.order_id = "REPLAY-" + std::to_string(orders_.fetch_add(1, std::memory_order_relaxed) + 1);
+    order.pair = pair;
+    order.side = side;
+    order.price = get_latest_price(pair);
+    order.volume = volume;
+    order.filled = volume;
+    order.status = order.price > 0 ? "filled" : "error";
+    return order;
+}
+
+bool ReplayMarketData::exhausted() {
+    return clock_.now_ms() > data_.last_ms;
+}
@@ -0,0 +1,422 @@
+#include "strategy_core.hpp"
+#include "learning_engine.hpp"
+#include <limits>
+
+int regime_code(const ScanResult& opp) {
+    return regime_code(opp.regime, opp.regime_estimate.trend_up());
+}
+
+void apply_regime(ScanResult& result, const RegimeEstimate& estimate) {
+    result.regime_estimate = estimate;
+    result.regime = estimate.regime;
+}
+
+BarAppend append_realtime_bar(std::deque<PriceBar>& history, double price, long timestamp) {
+    // Bars arrive in time order, so checking the newest bar is enough - O(1)
+    // per pair per scan
+    if (!history.empty() && history.back().timestamp >= timestamp) {
+        PriceBar& last = history.back();
+        if (last.timestamp > timestamp) return BarAppend::OUT_OF_ORDER;
+        last.high = std::max(last.high, price);
+        last.low = std::min(last.low, price);
+        last.close = price;
+        return BarAppend::MERGED;
+    }
+
+    // Create a synthetic OHLC bar from the current price (all OHLC = current price)
+    // This gives us much more frequent updates than 15-minute candles
+    PriceBar bar;
+    bar.open = price;
+    bar.high = price;
+    bar.low = price;
+    bar.close = price;
+    bar.volume = 1.0;  // Placeholder volume
+    bar.timestamp = timestamp;
+    history.push_back(bar);
+
+    // Keep only the most recent bars
+    while (history.size() > MAX_PRICE_HISTORY_BARS) {
+        history.pop_front();
+    }
+    return BarAppend::APPENDED;
+}
+
+void calculate_indicators(ScanResult& result, const std::deque<PriceBar>& history) {
+    if (history.size() < 15) {
+        // Not enough data for meaningful indicators
+        return;
+    }
+
+    // RSI (14-period)
+    result.rsi = TechnicalIndicators::calculate_rsi(history, 14);
+
+    // MACD (12, 26, 9)
+    auto [macd_line, signal_line, histogram] = TechnicalIndicators::calculate_macd(history, 12, 26, 9);
+    result.macd_line = macd_line;
+    result.macd_signal = signal_line;
+    result.macd_histogram = histogram;
+
+    // Moving averages
+    result.sma_20 = TechnicalIndicators::calculate_sma(history, std::min((size_t)20, history.size()));
+    result.sma_50 = TechnicalIndicators::calculate_sma(history, std::min((size_t)50, history.size()));
+    result.ema_12 = TechnicalIndicators::calculate_ema(history, std::min((size_t)12, history.size()));
+    result.ema_26 = TechnicalIndicators::calculate_ema(history, std::min((size_t)26, history.size()));
+
+    // ATR
+    result.atr = TechnicalIndicators::calculate_atr(history, std::min((size_t)14, history.size() - 1));
+    if (result.current_price > 0) {
+        result.atr_pct = (result.atr / result.current_price) * 100.0;
+    }
+
+    // Bollinger Band position (updates range_position with more accurate value)
+    double bb_pos = TechnicalIndicators::calculate_bb_position(history, 20, 2.0);
+    if (history.size() >= 20) {
+        result.range_position = bb_pos;  // Use BB position if we have enough data
+    }
+}
+
+TickerQuote TickerQuote::from_json(const json& ticker) {
+    // Futures API format: direct field access
+    TickerQuote q;
+    q.price = ticker.contains("last") ? ticker["last"].get<double>() : 0.0;
+    q.bid = ticker.contains("bid") ? ticker["bid"].get<double>() : 0.0;
+    q.ask = ticker.contains("ask") ? ticker["ask"].get<double>() : 0.0;
+    q.volume = ticker.contains("volumeQuote") ? ticker["volumeQuote"].get<double>() : 0.0;
+
+    q.high = ticker.contains("high") ? ticker["high"].get<double>() :
+             (ticker.contains("high24h") ? ticker["high24h"].get<double>() : q.price);
+    q.low = ticker.contains("low") ? ticker["low"].get<double>() :
+            (ticker.contains("low24h") ? ticker["low24h"].get<double>() : q.price);
+    q.open = ticker.contains("open") ? ticker["open"].get<double>() :
+             (ticker.contains("open24h") ? ticker["open24h"].get<double>() : q.price);
+    return q;
+}
+
+double range_volatility_pct(const TickerQuote& quote) {
+    return ((quote.high - quote.low) / quote.open) * 100.0;
+}
+
+double realized_volatility_pct(const double* prices, size_t count) {
+    if (count < 2) return 0.0;
+    // Two passes over the returns instead of materializing them
+    size_t n = count - 1;
+    double sum = 0.0;
+    for (size_t i = 1; i < count; ++i) sum += std::abs(std::log(prices[i] / prices[i-1]));
+    double mean = sum / n;
+    double variance = 0.0;
+    for (size_t i = 1; i < count; ++i) {
+        double d = std::abs(std::log(prices[i] / prices[i-1])) - mean;
+        variance += d * d;
+    }
+    variance /= n;
+    return std::sqrt(variance) * 100.0;  // percent
+}
+
+bool PairTradeStats::rejected_by_winrate(const BotConfig& config) const {
+    return trades >= config.min_pair_trades_for_stats && win_rate < config.min_pair_winrate;
+}
+
+double PairTradeStats::history_bonus() const {
+    return trades >= 3 ? (win_rate - 0.5) * 0.5 : 0.0;
+}
+
+bool PairTradeStats::record(bool is_win, const BotConfig& config) {
+    trades++;
+    double n = trades;
+    win_rate = win_rate * ((n-1)/n) + (is_win ? 1.0/n : 0.0);
+
+    // Consecutive loss counter for dynamic auto-direction
+    consecutive_losses = is_win ? 0 : consecutive_losses + 1;
+
+    if (!blacklisted && trades >= config.min_pair_trades_for_stats &&
+        win_rate < config.min_pair_winrate * 0.5) {
+        blacklisted = true;
+        return true;
+    }
+    return false;
+}
+
+std::optional<MetricCounter> screen_quote(const BotConfig& config, const TickerQuote& quote, ScanResult& result) {
+    double price = quote.price;
+    result.current_price = price;
+    result.spread_pct = ((quote.ask - quote.bid) / price) * 100.0;
+    if (result.spread_pct > config.max_spread_pct) return MetricCounter::REJECT_SPREAD;
+
+    result.volume_usd = quote.volume * price;
+    if (result.volume_usd < config.min_volume_usd) return MetricCounter::REJECT_VOLUME;
+
+    result.momentum_pct = ((price - quote.open) / quote.open) * 100.0;
+    result.range_position = (quote.high > quote.low) ? (price - quote.low) / (quote.high - quote.low) : 0.5;
+
+    if (std::abs(result.momentum_pct) < config.min_momentum_pct) return MetricCounter::REJECT_MOMENTUM;
+    return std::nullopt;
+}
+
+// VOLATILITY CEILING
+// Based on historical data analysis (Jan 21, 2026):
+// CRITICAL FINDING: 0-4% volatility had 100% WR (49 TP, 0 timeout)
+//                   4-7% volatility had 35-55% WR (death zone)
+//                   7%+ volatility had 52-54% WR
+// The sweet spot is LOWER volatility where 1.5% TP is achievable
+// (Regime classification is the HMM filter in regime_engine.cpp)
+static const double MAX_VOL_THRESHOLD = 10.0;    // >10% = too chaotic
+static const double LEARNING_MAX_VOL = 8.0;     // Learning mode cap (lowered from 15%)
+
+double volatility_ceiling(const BotConfig& config) {
+    // Historical data shows 6-7% vol = 31% WR (worst), so cap at 6%
+    return config.learning_mode ? LEARNING_MAX_VOL : MAX_VOL_THRESHOLD;
+}
+
+std::optional<MetricCounter> evaluate_signal(const ConfigSnapshot& snapshot, const CandleTrend& trend,
+                                             double history_bonus, ScanResult& result) {
+    const BotConfig& config = snapshot.bot;
+
+    // Volatility ceiling - skip pairs that are TOO volatile
+    if (result.volatility_pct > volatility_ceiling(config)) return MetricCounter::REJECT_VOLATILITY_CEILING;
+
+    // ENTRY CRITERIA: Must have momentum and not be overextended
+    // Bullish (LONG): upward momentum, not at extreme highs
+    bool bullish = (result.momentum_pct > config.min_momentum_pct &&
+                   result.range_position > 0.25 &&   // Not at lows (bounce zone)
+                   result.range_position < 0.85);    // Not at extreme highs
+
+    // Bearish (SHORT): downward momentum, not at extreme lows
+    // Mirror the long criteria but inverted
+    bool bearish = (result.momentum_pct < -config.min_momentum_pct &&  // Negative momentum
+                   result.range_position < 0.75 &&   // Not at extreme highs (bounce zone)
+                   result.range_position > 0.15);    // Not at extreme lows (potential reversal)
+
+    if (!bullish && !bearish) return MetricCounter::REJECT_NO_DIRECTION;
+    result.is_bullish = bullish;
+    result.is_bearish = bearish;
+    result.direction = bullish ? "LONG" : "SHORT";
+
+    // Scoring - momentum weighted heavily (use absolute value for both directions)
+    double mom_score = std::min(1.0, std::abs(result.momentum_pct) / 2.0);  // Scale to 2% for max (was 4%)
+
+    // Volatility scoring: PENALIZE high volatility based on historical data
+    // 0-4% vol = 100% WR, 4-7% vol = 31-55% WR, so PREFER lower volatility
+    double vol_score;
+    if (result.volatility_pct <= 4.0) {
+        vol_score = 1.0;  // Perfect score for sweet spot
+    } else if (result.volatility_pct <= 6.0) {
+        vol_score = 0.5;  // Acceptable but not great
+    } else {
+        vol_score = 0.2;  // Penalize high volatility
+    }
+
+    double spread_score = 1.0 - (result.spread_pct / config.max_spread_pct);
+    double volume_score = std::min(1.0, result.volume_usd / 200000.0);      // Lowered (was 500k)
+
+    // For shorts, adjust trend score (negative trend is good)
+    double trend_score = bearish ? -trend.score : trend.score;
+
+    // Reweighted: momentum 40%, volume 20%, trend 15%, spread 10%, volatility 10%, history 5%
+    result.signal_strength = mom_score * 0.40 + volume_score * 0.20 + trend_score + spread_score * 0.10 + vol_score * 0.10 + history_bonus * 0.05;
+
+    // MINIMUM CONFIDENCE THRESHOLD - increased to reduce overtrading
+    // Was 0.35, now 0.55 to only take high-confidence trades
+    // Allow lower confidence threshold in paper-mode experiments via PAPER_MIN_CONFIDENCE
+    if (result.signal_strength < snapshot.min_confidence_threshold) return MetricCounter::REJECT_CONFIDENCE;
+
+    // Adjusted TP/SL based on volatility - aim for 2:1 R:R minimum
+    if (result.volatility_pct > 10) {
+        result.suggested_hold_seconds = config.min_hold_seconds;
+        result.suggested_tp_pct = result.volatility_pct * 0.20;  // 20% of volatility
+        result.suggested_sl_pct = result.volatility_pct * 0.08;  // 8% of volatility (2.5:1 R:R)
+    } else if (result.volatility_pct > 5) {
+        result.suggested_hold_seconds = config.default_hold_seconds;
+        result.suggested_tp_pct = result.volatility_pct * 0.25;  // 25% of volatility
+        result.suggested_sl_pct = result.volatility_pct * 0.10;  // 10% of volatility (2.5:1 R:R)
+    } else {
+        result.suggested_hold_seconds = config.max_hold_seconds / 2;
+        result.suggested_tp_pct = std::max(1.5, result.volatility_pct * 0.35);
+        result.suggested_sl_pct = std::max(0.6, result.volatility_pct * 0.15);
+    }
+
+    result.suggested_tp_pct = std::max(result.suggested_tp_pct, 1.2);  // Min 1.2% TP
+    result.suggested_sl_pct = std::max(result.suggested_sl_pct, 0.6);  // Min 0.6% SL
+
+    // Allow dynamic override multipliers for TP/SL via environment (aggressive experiments)
+    if (snapshot.tp_multiplier) {
+        result.suggested_tp_pct = std::max(0.01, result.volatility_pct * *snapshot.tp_multiplier);
+    }
+    if (snapshot.sl_multiplier) {
+        result.suggested_sl_pct = std::max(0.01, result.volatility_pct * *snapshot.sl_multiplier);
+    }
+
+    // Global min volatility gate via env for aggressive experiments
+    if (snapshot.min_volatility_gate_pct && result.volatility_pct < *snapshot.min_volatility_gate_pct) {
+        return MetricCounter::REJECT_MIN_VOLATILITY;  // block opportunity
+    }
+
+    // REGIME FILTER: Data shows VOLATILE regime has 70% WR, RANGING loses money
+    if (config.regime_filter_enabled) {
+        bool regime_allowed = false;
+        switch (result.regime) {
+            case MarketRegime::VOLATILE:
+                regime_allowed = config.allow_volatile_regime;
+                break;
+            case MarketRegime::TRENDING:
+                regime_allowed = config.allow_trending_regime;
+                break;
+            case MarketRegime::RANGING:
+                regime_allowed = config.allow_ranging_regime;
+                break;
+            case MarketRegime::QUIET:
+                regime_allowed = config.allow_quiet_regime;
+                break;
+        }
+        if (!regime_allowed) return MetricCounter::REJECT_REGIME;
+    }
+
+    result.valid = true;
+    return std::nullopt;
+}
+
+TradePlan plan_trade(const BotConfig& config, const ScanResult& opp, const StrategyConfig& learned) {
+    TradePlan plan;
+
+    // LEARNING ENGINE: Override TP/SL with learned values if available
+    plan.tp_pct = learned.take_profit_pct > 0 ? learned.take_profit_pct * 100.0 :
+                  (opp.suggested_tp_pct > 0 ? opp.suggested_tp_pct : config.take_profit_pct);
+    plan.sl_pct = learned.stop_loss_pct > 0 ? learned.stop_loss_pct * 100.0 :
+                  (opp.suggested_sl_pct > 0 ? opp.suggested_sl_pct : config.stop_loss_pct);
+
+    // Strategies with counterfactually learned exits bring their own
+    // leverage and trailing stop; everything else uses the config
+    plan.leverage = learned.exits_learned ? learned.leverage : config.leverage;
+    plan.trailing_start_pct = !learned.exits_learned ? config.trailing_start_pct :
+                              learned.use_trailing_stop ? learned.trailing_start_pct :
+                              std::numeric_limits<double>::infinity();
+    plan.trailing_stop_pct = learned.exits_learned ? learned.trailing_stop_pct : config.trailing_stop_pct;
+
+    // LIQUIDATION PROTECTION: Ensure SL is at least as wide as liquidation distance
+    double min_sl_for_liquidation = (1.0 / plan.leverage) * 100.0;  // Convert to percentage
+    if (plan.sl_pct < min_sl_for_liquidation) {
+        plan.sl_pct = min_sl_for_liquidation;
+        plan.sl_liquidation_floor = true;
+    }
+    int hold_time = learned.timeframe_seconds > 0 ? learned.timeframe_seconds :
+                    (opp.suggested_hold_seconds > 0 ? opp.suggested_hold_seconds : config.default_hold_seconds);
+    plan.hold_seconds = std::max(config.min_hold_seconds, std::min(hold_time, config.max_hold_seconds));
+
+    // REGIME-BASED STRATEGY ADJUSTMENT
+    // CRITICAL DATA (Jan 21, 2026): 0-4% vol had 100% WR with fixed 1.5% TP
+    //                               4-7% vol had 31-55% WR (death zone)
+    //                               Dynamic scaling hurt performance
+    switch (opp.regime) {
+        case MarketRegime::VOLATILE:
+            // Current market is QUIET - reduce targets and increase hold time
+            // (defaults: 0.5% TP, 0.3% SL, 15 min hold - see BotConfig)
+            plan.tp_pct = config.volatile_take_profit_pct;
+            plan.sl_pct = config.volatile_stop_loss_pct;
+            plan.hold_seconds = config.volatile_hold_seconds;
+            break;
+        case MarketRegime::QUIET:
+            // In quiet markets, skip trading (low opportunity)
+            plan.skip_quiet_regime = true;
+            plan.skip = true;
+            return plan;
+        case MarketRegime::TRENDING:
+            // Momentum strategy with trailing stops: hold longer
+            plan.hold_seconds = std::min(plan.hold_seconds * 2, config.max_hold_seconds);
+            break;
+        case MarketRegime::RANGING:
+            // Mean reversion with tighter targets
+            plan.tp_pct *= 0.8;
+            break;
+    }
+
+    // FEE-AWARE TRADING: Only trade if expected profit > fees
+    // Round-trip: 0.40% with limit orders (maker-or-cancel)
+    // Old rate was 0.8% (Kraken taker) — 2x too high, killed all profits
+    const double MIN_PROFIT_BUFFER = 0.001;  // 0.1% buffer above fees
+    plan.expected_fees_pct = ROUND_TRIP_FEE_RATE * 100.0;
+    plan.min_required_tp_pct = plan.expected_fees_pct + (MIN_PROFIT_BUFFER * 100.0);
+
+    // Also check if expected profit (TP * win_rate - SL * loss_rate) > fees
+    double estimated_win_rate = learned.is_validated ? 0.55 : 0.50;  // Conservative estimate
+    plan.expected_profit_pct = (plan.tp_pct * estimated_win_rate) - (plan.sl_pct * (1.0 - estimated_win_rate));
+
+    plan.passes_fee_filter = (plan.tp_pct >= plan.min_required_tp_pct) &&
+                             (plan.expected_profit_pct >= plan.expected_fees_pct);
+    // Learning mode trades anyway (the caller logs it)
+    plan.skip = !plan.passes_fee_filter && !config.learning_mode;
+    return plan;
+}
+
+const char* exit_reason_name(ExitReason reason) {
+    switch (reason) {
+        case ExitReason::TAKE_PROFIT: return "take_profit";
+        case ExitReason::STOP_LOSS: return "stop_loss";
+        case ExitReason::TRAILING_STOP: return "trailing_stop";
+        default: return "timeout";
+    }
+}
+
+// TP/SL prices are different for LONG vs SHORT
+// LONG: TP is above entry, SL is below entry
+// SHORT: TP is below entry (price drops = profit), SL is above entry (price rises = loss)
+PositionTracker::PositionTracker(bool is_short, double entry_price, double tp_pct, double sl_pct,
+                                 double trailing_start_pct, double trailing_stop_pct, int hold_seconds)
+    : is_short(is_short), entry_price(entry_price), trailing_stop_pct(trailing_stop_pct),
+      hold_seconds(hold_seconds), best_price(entry_price) {
+    if (is_short) {
+        tp_price = entry_price * (1.0 - tp_pct / 100.0);  // TP when price drops
+        sl_price = entry_price * (1.0 + sl_pct / 100.0);  // SL when price rises
+        trailing_start = entry_price * (1.0 - trailing_start_pct / 100.0);  // Trailing starts on drop
+    } else {
+        tp_price = entry_price * (1.0 + tp_pct / 100.0);  // TP when price rises
+        sl_price = entry_price * (1.0 - sl_pct / 100.0);  // SL when price drops
+        trailing_start = entry_price * (1.0 + trailing_start_pct / 100.0);  // Trailing starts on rise
+    }
+}
+
+PositionTracker::Update PositionTracker::on_price(double current, long elapsed_seconds) {
+    Update update;
+    if (is_short) {
+        // For SHORT: track lowest price (best for us)
+        if (current < best_price) {
+            best_price = current;
+            if (trailing_active) trailing_stop = best_price * (1.0 + trailing_stop_pct / 100.0);
+        }
+        // Activate trailing when price drops enough
+        if (!trailing_active && current <= trailing_start) {
+            trailing_active = true;
+            trailing_stop = current * (1.0 + trailing_stop_pct / 100.0);
+            update.trailing_activated = true;
+        }
+        if (current <= tp_price) update.exit = ExitReason::TAKE_PROFIT;       // Price dropped to target
+        else if (current >= sl_price) update.exit = ExitReason::STOP_LOSS;    // Price rose against us
+        else if (trailing_active && current >= trailing_stop) update.exit = ExitReason::TRAILING_STOP;  // Bounced from best
+    } else {
+        // For LONG: track highest price (best for us)
+        if (current > best_price) {
+            best_price = current;
+            if (trailing_active) trailing_stop = best_price * (1.0 - trailing_stop_pct / 100.0);
+        }
+        if (!trailing_active && current >= trailing_start) {
+            trailing_active = true;
+            trailing_stop = current * (1.0 - trailing_stop_pct / 100.0);
+            update.trailing_activated = true;
+        }
+        if (current >= tp_price) update.exit = ExitReason::TAKE_PROFIT;
+        else if (current <= sl_price) update.exit = ExitReason::STOP_LOSS;
+        else if (trailing_active && current <= trailing_stop) update.exit = ExitReason::TRAILING_STOP;
+    }
+    if (update.exit == ExitReason::NONE && elapsed_seconds >= hold_seconds) update.exit = ExitReason::TIMEOUT;
+    return update;
+}
+
+TradePnl trade_pnl(bool is_short, double entry_price, double exit_price, double position_usd) {
+    // LONG profits when price goes up, SHORT profits when price goes down
+    TradePnl p;
+    p.pnl_pct = is_short ? ((entry_price - exit_price) / entry_price) * 100.0
+                         : ((exit_price - entry_price) / entry_price) * 100.0;
+    p.gross_usd = position_usd * (p.pnl_pct / 100.0);
+    p.fees_usd = position_usd * ROUND_TRIP_FEE_RATE;
+    p.net_usd = p.gross_usd - p.fees_usd;
+    p.is_win = p.net_usd > 0;
+    return p;
+}
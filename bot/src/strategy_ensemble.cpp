@@ -0,0 +1,69 @@
+#include "strategy_ensemble.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+
+namespace {
+
+// Floor on the variance of a bagged mean (%^2): a sample of identical
+// returns would otherwise take the whole weight
+constexpr double VARIANCE_FLOOR = 1e-4;
+
+uint64_t splitmix64(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+BaggedScore bag_one(const std::vector<double>& sample, uint64_t seed, const BaggingOptions& options) {
+    BaggedScore score;
+    const uint32_t n = (uint32_t)sample.size();
+    score.sample_size = n;
+    if (n == 0) return score;
+
+    const uint32_t replicates = std::clamp<uint32_t>(options.max_draws / n, options.min_replicates,
+                                                     options.max_replicates);
+    double sum = 0.0, sum_sq = 0.0;
+    for (uint32_t r = 0; r < replicates; r++) {
+        uint64_t state = seed ^ ((uint64_t)r << 32);
+        double total = 0.0;
+        for (uint32_t k = 0; k < n; k++) {
+            // Lemire's multiply-shift: uniform index in [0, n)
+            total += sample[((splitmix64(state) & 0xFFFFFFFFULL) * n) >> 32];
+        }
+        double mean = total / n;
+        sum += mean;
+        sum_sq += mean * mean;
+    }
+    score.replicates = replicates;
+    score.mean = sum / replicates;
+    score.variance = std::max(0.0, sum_sq / replicates - score.mean * score.mean);
+    return score;
+}
+
+}  // namespace
+
+std::vector<BaggedScore> bag_sample_means(const std::vector<const std::vector<double>*>& samples,
+                                          const std::vector<uint64_t>& seeds, const BaggingOptions& options,
+                                          ThreadPool& pool) {
+    std::vector<BaggedScore> scores(samples.size());
+    pool.parallel_for(samples.size(), [&](size_t i) {
+        scores[i] = bag_one(*samples[i], seeds[i], options);
+    });
+    return scores;
+}
+
+std::vector<double> ensemble_weights(const std::vector<BaggedScore>& scores, const BaggingOptions& options) {
+    std::vector<double> weights(scores.size(), 0.0);
+    double total = 0.0;
+    for (size_t i = 0; i < scores.size(); i++) {
+        const BaggedScore& s = scores[i];
+        if (s.sample_size < options.min_sample || s.mean <= 0.0) continue;
+        weights[i] = s.mean / std::max(s.variance, VARIANCE_FLOOR);
+        total += weights[i];
+    }
+    if (total > 0.0) {
+        for (double& w : weights) w /= total;
+    }
+    return weights;
+}
@@ -0,0 +1,98 @@
+#include "thread_pool.hpp"
+#include <algorithm>
+
+namespace {
+// Pool that owns the current thread (nullptr for non-worker threads)
+thread_local const ThreadPool* current_pool = nullptr;
+}
+
+ThreadPool::ThreadPool(size_t num_threads) {
+    if (num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    workers.reserve(num_threads);
+    for (size_t i = 0; i < num_threads; i++) {
+        workers.emplace_back([this]() { worker_loop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(jobs_mutex);
+        stopping = true;
+    }
+    jobs_cv.notify_all();
+    for (auto& w : workers) {
+        if (w.joinable()) w.join();
+    }
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::enqueue(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(jobs_mutex);
+        jobs.push_back(std::move(job));
+    }
+    jobs_cv.notify_one();
+}
+
+size_t ThreadPool::queue_depth() const {
+    std::lock_guard<std::mutex> lock(jobs_mutex);
+    return jobs.size();
+}
+
+bool ThreadPool::in_worker_thread() const {
+    return current_pool == this;
+}
+
+void ThreadPool::worker_loop() {
+    current_pool = this;
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(jobs_mutex);
+            jobs_cv.wait(lock, [this]() { return stopping || !jobs.empty(); });
+            if (stopping && jobs.empty()) return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        job();
+    }
+}
+
+void ThreadPool::parallel_for(size_t count, const std::function<void(size_t)>& fn) {
+    if (count == 0) return;
+
+    // Nested call from a worker (or trivially small work): run inline
+    if (in_worker_thread() || count == 1 || workers.size() == 1) {
+        for (size_t i = 0; i < count; i++) fn(i);
+        return;
+    }
+
+    // Hand out indices dynamically so uneven work items balance across workers
+    size_t num_tasks = std::min(count, workers.size());
+    auto next = std::make_shared<std::atomic<size_t>>(0);
+    std::vector<std::future<void>> pending;
+    pending.reserve(num_tasks);
+    for (size_t t = 0; t < num_tasks; t++) {
+        pending.push_back(submit([next, count, &fn]() {
+            for (size_t i = next->fetch_add(1); i < count; i = next->fetch_add(1)) {
+                fn(i);
+            }
+        }));
+    }
+    // Wait for every task before rethrowing - tasks hold a reference to fn
+    std::exception_ptr first_error;
+    for (auto& f : pending) {
+        try {
+            f.get();
+        } catch (...) {
+            if (!first_error) first_error = std::current_exception();
+        }
+    }
+    if (first_error) std::rethrow_exception(first_error);
+}
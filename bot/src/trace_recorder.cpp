@@ -0,0 +1,158 @@
+#include "trace_recorder.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <vector>
+
+namespace {
+
+const auto process_start = std::chrono::steady_clock::now();
+std::atomic<uint64_t> correlation_counter{0};
+std::atomic<uint32_t> ring_counter{0};
+
+thread_local uint64_t current_correlation_id = 0;
+thread_local const char* current_trace_pair = "";
+
+void copy_pair(char* dst, size_t size, const char* src) {
+    std::strncpy(dst, src, size - 1);
+    dst[size - 1] = '\0';
+}
+
+}  // namespace
+
+TraceRecorder::Ring::Ring() : tid(ring_counter.fetch_add(1) + 1) {}
+
+TraceRecorder& TraceRecorder::instance() {
+    // Leaked on purpose: thread_local ring handles may release after static teardown
+    static TraceRecorder* recorder = new TraceRecorder();
+    return *recorder;
+}
+
+uint64_t TraceRecorder::next_correlation_id() {
+    return correlation_counter.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+uint64_t TraceRecorder::to_trace_ns(std::chrono::steady_clock::time_point t) {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(t - process_start).count();
+}
+
+uint64_t TraceRecorder::now_ns() {
+    return to_trace_ns(std::chrono::steady_clock::now());
+}
+
+uint64_t TraceRecorder::current_id() {
+    return current_correlation_id;
+}
+
+const char* TraceRecorder::current_pair() {
+    return current_trace_pair;
+}
+
+void TraceRecorder::record(const char* name, uint64_t start_ns, uint64_t end_ns) {
+    if (current_correlation_id == 0) return;
+    record(current_correlation_id, current_trace_pair, name, start_ns, end_ns);
+}
+
+void TraceRecorder::record(uint64_t correlation_id, const char* pair, const char* name,
+                           uint64_t start_ns, uint64_t end_ns) {
+    Ring& ring = rings.local();
+    uint64_t head = ring.head.load(std::memory_order_relaxed);
+    Slot& slot = ring.slots[head % RING_CAPACITY];
+
+    // Per-slot seqlock: odd sequence while the payload is being rewritten
+    uint64_t seq = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.event.correlation_id = correlation_id;
+    slot.event.start_ns = start_ns;
+    slot.event.duration_ns = end_ns > start_ns ? end_ns - start_ns : 0;
+    slot.event.name = name;
+    copy_pair(slot.event.pair, sizeof(slot.event.pair), pair ? pair : "");
+    slot.sequence.store(seq + 2, std::memory_order_release);
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+json TraceRecorder::export_chrome_json(uint64_t correlation_id) const {
+    struct Collected {
+        uint32_t tid;
+        TraceEvent event;
+    };
+    std::vector<Collected> spans;
+    rings.for_each([&spans, correlation_id](const Ring& ring) {
+        uint64_t head = ring.head.load(std::memory_order_acquire);
+        uint64_t count = std::min<uint64_t>(head, RING_CAPACITY);
+        for (uint64_t i = head - count; i < head; i++) {
+            const Slot& slot = ring.slots[i % RING_CAPACITY];
+            uint64_t before = slot.sequence.load(std::memory_order_acquire);
+            if (before & 1) continue;  // Being written right now
+            TraceEvent copy = slot.event;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) != before) continue;  // Overwritten
+            if (correlation_id != 0 && copy.correlation_id != correlation_id) continue;
+            spans.push_back({ring.tid, copy});
+        }
+    });
+    std::sort(spans.begin(), spans.end(), [](const Collected& a, const Collected& b) {
+        return a.event.start_ns < b.event.start_ns;
+    });
+
+    json events = json::array();
+    struct Decision {
+        uint64_t start_ns = UINT64_MAX;
+        uint64_t end_ns = 0;
+        std::string pair;
+    };
+    std::map<uint64_t, Decision> decisions;
+    for (const auto& s : spans) {
+        const TraceEvent& e = s.event;
+        events.push_back({
+            {"name", e.name ? e.name : "span"},
+            {"cat", "pipeline"},
+            {"ph", "X"},
+            {"ts", e.start_ns / 1000.0},
+            {"dur", e.duration_ns / 1000.0},
+            {"pid", 1},
+            {"tid", s.tid},
+            {"args", {{"correlation_id", e.correlation_id}, {"pair", e.pair}}}
+        });
+        Decision& d = decisions[e.correlation_id];
+        d.start_ns = std::min(d.start_ns, e.start_ns);
+        d.end_ns = std::max(d.end_ns, e.start_ns + e.duration_ns);
+        if (d.pair.empty()) d.pair = e.pair;
+    }
+
+    // One async slice per decision groups its spans across threads
+    for (const auto& [id, d] : decisions) {
+        std::string name = "decision " + d.pair;
+        events.push_back({{"name", name}, {"cat", "decision"}, {"ph", "b"}, {"id", id},
+                          {"ts", d.start_ns / 1000.0}, {"pid", 1}, {"tid", 0}});
+        events.push_back({{"name", name}, {"cat", "decision"}, {"ph", "e"}, {"id", id},
+                          {"ts", d.end_ns / 1000.0}, {"pid", 1}, {"tid", 0}});
+    }
+
+    return {{"traceEvents", events}, {"displayTimeUnit", "ms"}};
+}
+
+bool TraceRecorder::write_chrome_json(const std::string& path, uint64_t correlation_id) const {
+    std::ofstream out(path);
+    if (!out.good()) {
+        std::cerr << "⚠️ Cannot write trace to " << path << std::endl;
+        return false;
+    }
+    out << export_chrome_json(correlation_id).dump();
+    return true;
+}
+
+TraceContext::TraceContext(uint64_t correlation_id, const std::string& pair)
+    : previous_id(current_correlation_id), previous_pair(current_trace_pair) {
+    copy_pair(pair_buf, sizeof(pair_buf), pair.c_str());
+    current_correlation_id = correlation_id;
+    current_trace_pair = pair_buf;
+}
+
+TraceContext::~TraceContext() {
+    current_correlation_id = previous_id;
+    current_trace_pair = previous_pair;
+}
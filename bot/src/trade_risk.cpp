@@ -0,0 +1,144 @@
+#include "trade_risk.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr uint32_t LANES = 16;              // Paths advanced together
+constexpr uint32_t PATHS_PER_TASK = LANES * 64;
+
+// Philox4x32-10 (Salmon et al., SC'11) across LANES counters at once
+constexpr uint32_t PHILOX_M0 = 0xD2511F53u;
+constexpr uint32_t PHILOX_M1 = 0xCD9E8D57u;
+constexpr uint32_t PHILOX_W0 = 0x9E3779B9u;
+constexpr uint32_t PHILOX_W1 = 0xBB67AE85u;
+
+struct PhiloxLanes {
+    uint32_t c0[LANES], c1[LANES], c2[LANES], c3[LANES];
+};
+
+void philox_rounds(PhiloxLanes& x, uint32_t k0, uint32_t k1) {
+    for (int round = 0; round < 10; round++) {
+        for (uint32_t l = 0; l < LANES; l++) {
+            uint64_t p0 = (uint64_t)PHILOX_M0 * x.c0[l];
+            uint64_t p1 = (uint64_t)PHILOX_M1 * x.c2[l];
+            uint32_t n0 = (uint32_t)(p1 >> 32) ^ x.c1[l] ^ k0;
+            uint32_t n2 = (uint32_t)(p0 >> 32) ^ x.c3[l] ^ k1;
+            x.c1[l] = (uint32_t)p1;
+            x.c3[l] = (uint32_t)p0;
+            x.c0[l] = n0;
+            x.c2[l] = n2;
+        }
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+}
+
+// Quantile of values (reorders them)
+double quantile(std::vector<double>& values, double q) {
+    if (values.empty()) return 0.0;
+    size_t k = std::min(values.size() - 1, (size_t)(q * (values.size() - 1) + 0.5));
+    std::nth_element(values.begin(), values.begin() + k, values.end());
+    return values[k];
+}
+
+}  // namespace
+
+double RiskProfile::win_rate_at_confidence(double confidence) const {
+    if (empty() || horizon == 0 || paths == 0) return 0.0;
+    const double needed = std::clamp(confidence, 0.0, 1.0) * paths;
+    uint64_t at_least = 0;
+    for (size_t k = win_histogram.size(); k-- > 0;) {
+        at_least += win_histogram[k];
+        if ((double)at_least >= needed) return (double)k / horizon;
+    }
+    return 0.0;
+}
+
+json RiskProfile::to_json() const {
+    return {
+        {"sample_size", sample_size},
+        {"paths", paths},
+        {"horizon", horizon},
+        {"drawdown_mean", drawdown_mean},
+        {"drawdown_p50", drawdown_p50},
+        {"drawdown_p90", drawdown_p90},
+        {"drawdown_p95", drawdown_p95},
+        {"drawdown_p99", drawdown_p99},
+        {"return_p05", return_p05},
+        {"return_p50", return_p50},
+        {"win_rate_p90", win_rate_at_confidence(0.90)},
+        {"win_rate_p95", win_rate_at_confidence(0.95)}
+    };
+}
+
+RiskProfile simulate_trade_risk(const std::vector<double>& roi_pct, const RiskOptions& options, ThreadPool& pool) {
+    RiskProfile profile;
+    if (roi_pct.empty() || options.paths == 0 || options.horizon == 0) return profile;
+
+    const uint32_t n = (uint32_t)std::min<size_t>(roi_pct.size(), UINT32_MAX);
+    const uint32_t horizon = std::min<uint32_t>(options.horizon, UINT16_MAX);
+    const uint32_t paths = (options.paths + LANES - 1) / LANES * LANES;
+    const uint32_t k0 = (uint32_t)options.seed;
+    const uint32_t k1 = (uint32_t)(options.seed >> 32);
+    const double* sample = roi_pct.data();
+
+    std::vector<double> drawdown(paths);
+    std::vector<double> final_return(paths);
+    std::vector<uint16_t> wins(paths);
+
+    const size_t tasks = (paths + PATHS_PER_TASK - 1) / PATHS_PER_TASK;
+    pool.parallel_for(tasks, [&](size_t task) {
+        const uint32_t task_end = std::min<uint32_t>(paths, (uint32_t)(task + 1) * PATHS_PER_TASK);
+        for (uint32_t first = (uint32_t)task * PATHS_PER_TASK; first < task_end; first += LANES) {
+            double cum[LANES] = {}, peak[LANES] = {}, dd[LANES] = {};
+            uint32_t won[LANES] = {};
+            PhiloxLanes rng;
+
+            for (uint32_t step = 0; step < horizon; step += 4) {
+                for (uint32_t l = 0; l < LANES; l++) {
+                    rng.c0[l] = first + l;
+                    rng.c1[l] = step / 4;
+                    rng.c2[l] = 0;
+                    rng.c3[l] = 0;
+                }
+                philox_rounds(rng, k0, k1);
+                const uint32_t* words[4] = {rng.c0, rng.c1, rng.c2, rng.c3};
+                const uint32_t steps = std::min<uint32_t>(4, horizon - step);
+                for (uint32_t s = 0; s < steps; s++) {
+                    const uint32_t* r = words[s];
+                    for (uint32_t l = 0; l < LANES; l++) {
+                        // Lemire's multiply-shift: uniform index in [0, n) without a division
+                        double x = sample[((uint64_t)r[l] * n) >> 32];
+                        cum[l] += x;
+                        peak[l] = std::max(peak[l], cum[l]);
+                        dd[l] = std::max(dd[l], peak[l] - cum[l]);
+                        won[l] += x > 0.0;
+                    }
+                }
+            }
+            for (uint32_t l = 0; l < LANES; l++) {
+                drawdown[first + l] = dd[l];
+                final_return[first + l] = cum[l];
+                wins[first + l] = (uint16_t)won[l];
+            }
+        }
+    });
+
+    profile.sample_size = n;
+    profile.paths = paths;
+    profile.horizon = horizon;
+    double total = 0.0;
+    for (double d : drawdown) total += d;
+    profile.drawdown_mean = total / paths;
+    profile.drawdown_p50 = quantile(drawdown, 0.50);
+    profile.drawdown_p90 = quantile(drawdown, 0.90);
+    profile.drawdown_p95 = quantile(drawdown, 0.95);
+    profile.drawdown_p99 = quantile(drawdown, 0.99);
+    profile.return_p05 = quantile(final_return, 0.05);
+    profile.return_p50 = quantile(final_return, 0.50);
+    profile.win_histogram.assign(horizon + 1, 0);
+    for (uint16_t w : wins) profile.win_histogram[w]++;
+    return profile;
+}
@@ -0,0 +1,113 @@
+#include "trade_store.hpp"
+#include "learning_engine.hpp"
+
+uint8_t TradeStore::exit_reason_code(const std::string& reason) {
+    for (size_t i = 0; i < exit_reason_names.size(); i++) {
+        if (exit_reason_names[i] == reason) return (uint8_t)i;
+    }
+    if (exit_reason_names.size() >= 255) return 255;  // Table full: "unknown"
+    exit_reason_names.push_back(reason);
+    return (uint8_t)(exit_reason_names.size() - 1);
+}
+
+const std::string& TradeStore::exit_reason_name(uint8_t code) const {
+    static const std::string unknown = "unknown";
+    return code < exit_reason_names.size() ? exit_reason_names[code] : unknown;
+}
+
+uint32_t TradeStore::append(const TradeRecord& t) {
+    uint32_t index = (uint32_t)size();
+
+    pair_id.push_back(pairs.intern(t.pair));
+    is_short.push_back(t.direction == "SHORT" ? 1 : 0);
+    exit_reason.push_back(exit_reason_code(t.exit_reason));
+
+    timestamp_ms.push_back(std::chrono::duration_cast<std::chrono::milliseconds>(
+        t.timestamp.time_since_epoch()).count());
+    entry_price.push_back(t.entry_price);
+    exit_price.push_back(t.exit_price);
+    leverage.push_back(t.leverage);
+    timeframe_seconds.push_back(t.timeframe_seconds);
+    position_size.push_back(t.position_size);
+    pnl.push_back(t.pnl);
+    gross_pnl.push_back(t.gross_pnl);
+    fees_paid.push_back(t.fees_paid);
+    volatility_at_entry.push_back(t.volatility_at_entry);
+    bid_ask_spread.push_back(t.bid_ask_spread);
+    bars_high.push_back(t.bars_high);
+    bars_low.push_back(t.bars_low);
+    max_profit.push_back(t.max_profit);
+    max_loss.push_back(t.max_loss);
+    trend_direction.push_back(t.trend_direction);
+    rsi.push_back(t.rsi);
+    macd_histogram.push_back(t.macd_histogram);
+    macd_signal.push_back(t.macd_signal);
+    bb_position.push_back(t.bb_position);
+    volume_ratio.push_back(t.volume_ratio);
+    momentum_score.push_back(t.momentum_score);
+    order_flow_imbalance.push_back(t.order_flow_imbalance);
+    atr_pct.push_back(t.atr_pct);
+    vwap_deviation.push_back(t.vwap_deviation);
+    market_regime.push_back(t.market_regime);
+    path_offset.push_back((uint32_t)path_bytes.size());
+    path_bytes.insert(path_bytes.end(), t.price_path.begin(), t.price_path.end());
+
+    return index;
+}
+
+TradeRecord TradeStore::get(size_t i) const {
+    TradeRecord t{};
+    t.pair = pairs.name(pair_id[i]);
+    t.direction = is_short[i] ? "SHORT" : "LONG";
+    t.exit_reason = exit_reason_name(exit_reason[i]);
+
+    t.timestamp = std::chrono::system_clock::time_point(std::chrono::milliseconds(timestamp_ms[i]));
+    t.entry_price = entry_price[i];
+    t.exit_price = exit_price[i];
+    t.leverage = leverage[i];
+    t.timeframe_seconds = timeframe_seconds[i];
+    t.position_size = position_size[i];
+    t.pnl = pnl[i];
+    t.gross_pnl = gross_pnl[i];
+    t.fees_paid = fees_paid[i];
+    t.volatility_at_entry = volatility_at_entry[i];
+    t.bid_ask_spread = bid_ask_spread[i];
+    t.bars_high = bars_high[i];
+    t.bars_low = bars_low[i];
+    t.max_profit = max_profit[i];
+    t.max_loss = max_loss[i];
+    t.trend_direction = trend_direction[i];
+    t.rsi = rsi[i];
+    t.macd_histogram = macd_histogram[i];
+    t.macd_signal = macd_signal[i];
+    t.bb_position = bb_position[i];
+    t.volume_ratio = volume_ratio[i];
+    t.momentum_score = momentum_score[i];
+    t.order_flow_imbalance = order_flow_imbalance[i];
+    t.atr_pct = atr_pct[i];
+    t.vwap_deviation = vwap_deviation[i];
+    t.market_regime = market_regime[i];
+    t.price_path.assign(path_data(i), path_data(i) + path_size(i));
+    return t;
+}
+
+template<typename Func>
+static void for_each_column(TradeStore& s, Func&& fn) {
+    fn(s.pair_id); fn(s.is_short); fn(s.exit_reason);
+    fn(s.timestamp_ms); fn(s.entry_price); fn(s.exit_price); fn(s.leverage);
+    fn(s.timeframe_seconds); fn(s.position_size); fn(s.pnl); fn(s.gross_pnl);
+    fn(s.fees_paid); fn(s.volatility_at_entry); fn(s.bid_ask_spread);
+    fn(s.bars_high); fn(s.bars_low); fn(s.max_profit); fn(s.max_loss);
+    fn(s.trend_direction); fn(s.rsi); fn(s.macd_histogram); fn(s.macd_signal);
+    fn(s.bb_position); fn(s.volume_ratio); fn(s.momentum_score);
+    fn(s.order_flow_imbalance); fn(s.atr_pct); fn(s.vwap_deviation);
+    fn(s.market_regime); fn(s.path_offset); fn(s.path_bytes);
+}
+
+void TradeStore::reserve(size_t n) {
+    for_each_column(*this, [n](auto& column) { column.reserve(n); });
+}
+
+void TradeStore::clear() {
+    for_each_column(*this, [](auto& column) { column.clear(); });
+}
@@ -0,0 +1,401 @@
+#include "trade_writer.hpp"
+#include "metrics_registry.hpp"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+namespace {
+
+// Worth another attempt: the same statements may well succeed in a moment
+bool transient(int rc) {
+    switch (rc & 0xff) {
+        case SQLITE_BUSY:
+        case SQLITE_LOCKED:
+        case SQLITE_IOERR:
+        case SQLITE_FULL:
+            return true;
+        default:
+            return false;
+    }
+}
+
+}  // namespace
+
+TradeWriter::TradeWriter(const std::string& db_path) {
+    if (sqlite3_open_v2(db_path.c_str(), &db_, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr) != SQLITE_OK) {
+        std::cerr << "❌ Trade writer failed to open " << db_path << ": " << sqlite3_errmsg(db_) << std::endl;
+        sqlite3_close(db_);
+        db_ = nullptr;
+        return;
+    }
+    sqlite3_busy_timeout(db_, 5000);
+    sqlite3_exec(db_, "PRAGMA journal_mode=WAL; PRAGMA synchronous=NORMAL;", nullptr, nullptr, nullptr);
+
+    insert_trade_stmt = prepare(R"(
+        INSERT OR IGNORE INTO trades (
+            pair, direction, entry_price, exit_price, position_size, leverage,
+            pnl, gross_pnl, fees_paid, exit_reason, timestamp, entry_time, hold_time,
+            timeframe_seconds, volatility_pct, bid_ask_spread, rsi, macd_histogram,
+            macd_signal, bb_position, volume_ratio, momentum_score, atr_pct,
+            market_regime, trend_direction, max_profit, max_loss, bars_high, bars_low, price_path
+        ) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
+    )");
+    upsert_pattern_stmt = prepare(R"(
+        INSERT INTO pattern_stats (
+            pattern_key, pair, direction, volatility_bucket, regime_bucket,
+            total_trades, winning_trades, losing_trades, total_pnl, total_fees,
+            avg_pnl, avg_win, avg_loss, win_rate, profit_factor, sharpe_ratio, last_updated,
+            leverage, timeframe_bucket, volatility_code, regime_code,
+            gross_wins, gross_losses, return_mean, return_m2, downside_sq_sum,
+            return_peak, max_drawdown, sortino_ratio
+        ) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
+        ON CONFLICT(pattern_key) DO UPDATE SET
+            total_trades = excluded.total_trades, winning_trades = excluded.winning_trades,
+            losing_trades = excluded.losing_trades, total_pnl = excluded.total_pnl,
+            total_fees = excluded.total_fees, avg_pnl = excluded.avg_pnl,
+            avg_win = excluded.avg_win, avg_loss = excluded.avg_loss,
+            win_rate = excluded.win_rate, profit_factor = excluded.profit_factor,
+            sharpe_ratio = excluded.sharpe_ratio, last_updated = excluded.last_updated,
+            leverage = excluded.leverage, timeframe_bucket = excluded.timeframe_bucket,
+            volatility_code = excluded.volatility_code, regime_code = excluded.regime_code,
+            gross_wins = excluded.gross_wins, gross_losses = excluded.gross_losses,
+            return_mean = excluded.return_mean, return_m2 = excluded.return_m2,
+            downside_sq_sum = excluded.downside_sq_sum, return_peak = excluded.return_peak,
+            max_drawdown = excluded.max_drawdown, sortino_ratio = excluded.sortino_ratio
+    )");
+    upsert_indicator_stmt = prepare(R"(
+        INSERT INTO indicator_stats (indicator, bucket, total_trades, winning_trades, total_pnl, avg_pnl, win_rate)
+        VALUES (?, ?, ?, ?, ?, ?, ?)
+        ON CONFLICT(indicator, bucket) DO UPDATE SET
+            total_trades = excluded.total_trades, winning_trades = excluded.winning_trades,
+            total_pnl = excluded.total_pnl, avg_pnl = excluded.avg_pnl, win_rate = excluded.win_rate
+    )");
+
+    if (!insert_trade_stmt || !upsert_pattern_stmt || !upsert_indicator_stmt) {
+        sqlite3_finalize(insert_trade_stmt);
+        sqlite3_finalize(upsert_pattern_stmt);
+        sqlite3_finalize(upsert_indicator_stmt);
+        insert_trade_stmt = upsert_pattern_stmt = upsert_indicator_stmt = nullptr;
+        sqlite3_close(db_);
+        db_ = nullptr;
+        return;
+    }
+
+    worker = std::thread([this] { writer_loop(); });
+}
+
+TradeWriter::~TradeWriter() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        stopping = true;
+    }
+    queue_cv.notify_all();
+    if (worker.joinable()) worker.join();
+
+    sqlite3_finalize(insert_trade_stmt);
+    sqlite3_finalize(upsert_pattern_stmt);
+    sqlite3_finalize(upsert_indicator_stmt);
+    if (db_) sqlite3_close(db_);
+}
+
+sqlite3_stmt* TradeWriter::prepare(const char* sql) {
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "❌ Trade writer failed to prepare statement: " << sqlite3_errmsg(db_) << std::endl;
+        return nullptr;
+    }
+    return stmt;
+}
+
+void TradeWriter::submit(TradeWrite write) {
+    if (!ok()) {
+        std::cerr << "⚠️ Database not initialized, cannot save trade" << std::endl;
+        if (write.on_durable) write.on_durable(false);
+        return;
+    }
+    std::unique_lock<std::mutex> lock(queue_mutex);
+    if (queue.size() >= QUEUE_CAPACITY) {
+        std::cerr << "⚠️ Trade writer queue full (" << QUEUE_CAPACITY << "), waiting on disk" << std::endl;
+        space_cv.wait(lock, [this] { return queue.size() < QUEUE_CAPACITY; });
+    }
+    queue.push_back(std::move(write));
+    submitted++;
+    MetricsRegistry::instance().set(MetricGauge::TRADE_WRITE_QUEUE, (double)queue.size());
+    lock.unlock();
+    queue_cv.notify_one();
+}
+
+void TradeWriter::flush() {
+    if (!ok()) return;
+    std::unique_lock<std::mutex> lock(queue_mutex);
+    uint64_t target = submitted;
+    done_cv.wait(lock, [this, target] { return completed >= target; });
+}
+
+size_t TradeWriter::queue_depth() const {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    return queue.size();
+}
+
+void TradeWriter::writer_loop() {
+    std::vector<TradeWrite> batch;
+    batch.reserve(MAX_BATCH);
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            queue_cv.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (queue.empty()) return;  // Stopping and drained
+
+            // Group commit: everything that queued up while the last batch was on disk
+            while (!queue.empty() && batch.size() < MAX_BATCH) {
+                batch.push_back(std::move(queue.front()));
+                queue.pop_front();
+            }
+            MetricsRegistry::instance().set(MetricGauge::TRADE_WRITE_QUEUE, (double)queue.size());
+        }
+        space_cv.notify_all();
+
+        // Whole batch first; if it cannot commit, one write per transaction
+        // so a bad row only fails itself
+        stored.assign(batch.size(), 0);
+        std::vector<char> durable(batch.size(), 0);
+        if (commit_writes(batch, 0, batch.size())) {
+            durable.assign(batch.size(), 1);
+        } else {
+            const bool isolate = batch.size() > 1;
+            if (isolate) {
+                std::cerr << "⚠️ Trade writer batch of " << batch.size() << " failed, retrying writes one by one" << std::endl;
+            }
+            for (size_t i = 0; i < batch.size(); i++) {
+                if (isolate) durable[i] = commit_writes(batch, i, i + 1);
+                // Its trade is in the engine's aggregates but not the table,
+                // and so in every later stats row
+                if (!durable[i] && batch[i].trade && batch[i].learned) mark_stats_stale();
+            }
+        }
+
+        MetricsRegistry& stats = MetricsRegistry::instance();
+        stats.increment(MetricCounter::TRADE_WRITE_BATCHES);
+
+        for (size_t i = 0; i < batch.size(); i++) {
+            TradeWrite& write = batch[i];
+            if (!durable[i]) stats.increment(MetricCounter::TRADE_WRITE_ERRORS);
+            const bool saved = durable[i] && (!write.trade || stored[i]);
+            if (write.trade && saved) {
+                stats.increment(MetricCounter::TRADES_PERSISTED);
+                std::cout << "💾 Trade saved to SQLite: " << write.trade->pair << " "
+                          << (write.trade->pnl > 0 ? "+" : "") << "$" << std::fixed << std::setprecision(2)
+                          << write.trade->pnl << std::endl;
+            }
+            if (write.on_durable) write.on_durable(saved);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            completed += batch.size();
+        }
+        done_cv.notify_all();
+        batch.clear();
+    }
+}
+
+bool TradeWriter::commit_writes(std::vector<TradeWrite>& batch, size_t begin, size_t end) {
+    for (int attempt = 1;; attempt++) {
+        int rc = try_commit(batch, begin, end);
+        if (rc == SQLITE_OK) return true;
+        if (!transient(rc) || attempt >= MAX_ATTEMPTS) {
+            std::cerr << "❌ Trade writer rolled back " << (end - begin) << " write(s) after " << attempt
+                      << " attempt(s): " << sqlite3_errstr(rc) << std::endl;
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(RETRY_BACKOFF_MS << (attempt - 1)));
+    }
+}
+
+int TradeWriter::try_commit(std::vector<TradeWrite>& batch, size_t begin, size_t end) {
+    if (sqlite3_exec(db_, "BEGIN IMMEDIATE", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        return sqlite3_extended_errcode(db_);
+    }
+
+    int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    // Stats rows hold absolute state, so later writes in the batch simply win.
+    // Stale state and inserted flags only take effect if this commits.
+    bool stale = stats_stale;
+    std::vector<char> inserted(end - begin, 0);
+    bool ok = true;
+    for (size_t i = begin; i < end && ok; i++) {
+        bool row_inserted = false;
+        ok = apply_write(batch[i], now_ms, stale, row_inserted);
+        inserted[i - begin] = row_inserted;
+    }
+    // Stats no longer match trades: the next load rebuilds them
+    if (ok && stale) ok = sqlite3_exec(db_, "PRAGMA user_version = 0", nullptr, nullptr, nullptr) == SQLITE_OK;
+
+    if (ok && sqlite3_exec(db_, "COMMIT", nullptr, nullptr, nullptr) == SQLITE_OK) {
+        stats_stale = stale;
+        std::copy(inserted.begin(), inserted.end(), stored.begin() + begin);
+        return SQLITE_OK;
+    }
+
+    // The failing statement logged its own message; commit_writes reports the outcome
+    int rc = sqlite3_extended_errcode(db_);
+    sqlite3_exec(db_, "ROLLBACK", nullptr, nullptr, nullptr);
+    return rc != SQLITE_OK ? rc : SQLITE_ERROR;
+}
+
+bool TradeWriter::apply_write(const TradeWrite& write, int64_t now_ms, bool& stale, bool& inserted) {
+    if (write.replace_stats) {
+        // Full rebuild from the trades table: stats match it again
+        if (sqlite3_exec(db_, "DELETE FROM pattern_stats; DELETE FROM indicator_stats;",
+                         nullptr, nullptr, nullptr) != SQLITE_OK) return false;
+        stale = false;
+    }
+    if (write.trade) {
+        if (!insert_trade(*write.trade)) return false;
+        inserted = sqlite3_changes(db_) > 0;
+        if (!inserted) {
+            std::cerr << "⚠️ Trade on " << write.trade->pair << " duplicates a stored trade (same pair and "
+                      << "timestamp), not saved" << std::endl;
+            stale |= write.learned;
+        }
+    }
+    if (stale) return true;
+    if (write.stats_version >= 0) {
+        std::string stamp = "PRAGMA user_version = " + std::to_string(write.stats_version);
+        if (sqlite3_exec(db_, stamp.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK) return false;
+    }
+    for (const PatternStatsRow& row : write.patterns) {
+        if (!upsert_pattern_stats(row, now_ms)) return false;
+    }
+    for (const IndicatorStatsRow& row : write.indicators) {
+        if (!upsert_indicator_stats(row)) return false;
+    }
+    return true;
+}
+
+void TradeWriter::mark_stats_stale() {
+    if (!stats_stale) {
+        std::cerr << "⚠️ Trade writer: pattern_stats no longer matches trades, rebuilt on the next load" << std::endl;
+    }
+    stats_stale = true;
+    // Best effort now; every later commit also stamps it while stale
+    sqlite3_exec(db_, "PRAGMA user_version = 0", nullptr, nullptr, nullptr);
+}
+
+bool TradeWriter::insert_trade(const TradeRecord& trade) {
+    sqlite3_stmt* stmt = insert_trade_stmt;
+    sqlite3_reset(stmt);
+
+    auto timestamp_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        trade.timestamp.time_since_epoch()).count();
+
+    sqlite3_bind_text(stmt, 1, trade.pair.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, trade.direction.empty() ? "LONG" : trade.direction.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_double(stmt, 3, trade.entry_price);
+    sqlite3_bind_double(stmt, 4, trade.exit_price);
+    sqlite3_bind_double(stmt, 5, trade.position_size);
+    sqlite3_bind_int(stmt, 6, static_cast<int>(trade.leverage));
+    sqlite3_bind_double(stmt, 7, trade.pnl);
+    sqlite3_bind_double(stmt, 8, trade.gross_pnl);
+    sqlite3_bind_double(stmt, 9, trade.fees_paid);
+    sqlite3_bind_text(stmt, 10, trade.exit_reason.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 11, timestamp_ms);
+    sqlite3_bind_int64(stmt, 12, timestamp_ms);  // entry_time same as timestamp for now
+    sqlite3_bind_int(stmt, 13, trade.timeframe_seconds);
+    sqlite3_bind_int(stmt, 14, trade.timeframe_seconds);
+    sqlite3_bind_double(stmt, 15, trade.volatility_at_entry);
+    sqlite3_bind_double(stmt, 16, trade.bid_ask_spread);
+    sqlite3_bind_double(stmt, 17, trade.rsi);
+    sqlite3_bind_double(stmt, 18, trade.macd_histogram);
+    sqlite3_bind_double(stmt, 19, trade.macd_signal);
+    sqlite3_bind_double(stmt, 20, trade.bb_position);
+    sqlite3_bind_double(stmt, 21, trade.volume_ratio);
+    sqlite3_bind_double(stmt, 22, trade.momentum_score);
+    sqlite3_bind_double(stmt, 23, trade.atr_pct);
+    sqlite3_bind_int(stmt, 24, trade.market_regime);
+    sqlite3_bind_double(stmt, 25, trade.trend_direction);
+    sqlite3_bind_double(stmt, 26, trade.max_profit);
+    sqlite3_bind_double(stmt, 27, trade.max_loss);
+    sqlite3_bind_int(stmt, 28, trade.bars_high);
+    sqlite3_bind_int(stmt, 29, trade.bars_low);
+    if (trade.price_path.empty()) sqlite3_bind_null(stmt, 30);
+    else sqlite3_bind_blob(stmt, 30, trade.price_path.data(), (int)trade.price_path.size(), SQLITE_STATIC);
+
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        std::cerr << "❌ Failed to insert trade: " << sqlite3_errmsg(db_) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool TradeWriter::upsert_pattern_stats(const PatternStatsRow& row, int64_t now_ms) {
+    const PatternAggregate& agg = row.agg;
+    const PatternMetrics& metrics = row.metrics;
+    std::string volatility = "V" + std::to_string(agg.key.volatility_bucket());
+    std::string regime = row.pattern_key.substr(row.pattern_key.size() - 1);  // Q/R/T/V/U suffix
+
+    sqlite3_stmt* stmt = upsert_pattern_stmt;
+    sqlite3_reset(stmt);
+    sqlite3_bind_text(stmt, 1, row.pattern_key.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, metrics.pair.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 3, agg.key.direction(), -1, SQLITE_STATIC);
+    if (agg.key.is_enhanced()) {
+        sqlite3_bind_text(stmt, 4, volatility.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 5, regime.c_str(), -1, SQLITE_TRANSIENT);
+    } else {
+        sqlite3_bind_null(stmt, 4);
+        sqlite3_bind_null(stmt, 5);
+    }
+    sqlite3_bind_int(stmt, 6, agg.total_trades);
+    sqlite3_bind_int(stmt, 7, agg.winning_trades);
+    sqlite3_bind_int(stmt, 8, agg.losing_trades);
+    sqlite3_bind_double(stmt, 9, agg.total_pnl);
+    sqlite3_bind_double(stmt, 10, agg.total_fees);
+    sqlite3_bind_double(stmt, 11, agg.total_trades > 0 ? agg.total_pnl / agg.total_trades : 0);
+    sqlite3_bind_double(stmt, 12, metrics.avg_win);
+    sqlite3_bind_double(stmt, 13, metrics.avg_loss);
+    sqlite3_bind_double(stmt, 14, metrics.win_rate);
+    sqlite3_bind_double(stmt, 15, metrics.profit_factor);
+    sqlite3_bind_double(stmt, 16, metrics.sharpe_ratio);
+    sqlite3_bind_int64(stmt, 17, now_ms);
+    sqlite3_bind_int(stmt, 18, agg.key.leverage());
+    sqlite3_bind_int(stmt, 19, agg.key.timeframe_bucket());
+    sqlite3_bind_int(stmt, 20, agg.key.volatility_bucket());
+    sqlite3_bind_int(stmt, 21, agg.key.regime_code());
+    sqlite3_bind_double(stmt, 22, agg.gross_wins);
+    sqlite3_bind_double(stmt, 23, agg.gross_losses);
+    sqlite3_bind_double(stmt, 24, agg.return_mean);
+    sqlite3_bind_double(stmt, 25, agg.return_m2);
+    sqlite3_bind_double(stmt, 26, agg.downside_sq_sum);
+    sqlite3_bind_double(stmt, 27, agg.return_peak);
+    sqlite3_bind_double(stmt, 28, agg.max_drawdown);
+    sqlite3_bind_double(stmt, 29, metrics.sortino_ratio);
+
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        std::cerr << "❌ Failed to upsert pattern_stats: " << sqlite3_errmsg(db_) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool TradeWriter::upsert_indicator_stats(const IndicatorStatsRow& row) {
+    const IndicatorAggregate& agg = row.agg;
+    sqlite3_stmt* stmt = upsert_indicator_stmt;
+    sqlite3_reset(stmt);
+    sqlite3_bind_text(stmt, 1, row.indicator, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, row.bucket, -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 3, agg.total_trades);
+    sqlite3_bind_int(stmt, 4, agg.winning_trades);
+    sqlite3_bind_double(stmt, 5, agg.total_pnl);
+    sqlite3_bind_double(stmt, 6, agg.total_trades > 0 ? agg.total_pnl / agg.total_trades : 0);
+    sqlite3_bind_double(stmt, 7, agg.total_trades > 0 ? (double)agg.winning_trades / agg.total_trades : 0);
+
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        std::cerr << "❌ Failed to upsert indicator_stats: " << sqlite3_errmsg(db_) << std::endl;
+        return false;
+    }
+    return true;
+}
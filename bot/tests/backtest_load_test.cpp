@@ -0,0 +1,140 @@
+#include "backtest.hpp"
+#include "test_check.hpp"
+#include <sqlite3.h>
+#include <filesystem>
+#include <string>
+#include <unistd.h>
+
+// sort_by_time / load_price_history: columns stay aligned and in bounds,
+// and the derived 24h columns match a brute-force trailing window
+
+namespace {
+
+void test_sort_by_time_raw_columns() {
+    // As load_price_history sees it: high/low/open not derived yet
+    TickSeries s;
+    s.timestamp_ms = {3000, 1000, 2000, 1000};
+    s.last = {3.0, 1.0, 2.0, 1.5};
+    s.bid = {2.9, 0.9, 1.9, 1.4};
+    s.ask = {3.1, 1.1, 2.1, 1.6};
+    s.volume = {30, 10, 20, 15};
+    sort_by_time(s);
+
+    CHECK((s.timestamp_ms == std::vector<int64_t>{1000, 1000, 2000, 3000}));
+    CHECK((s.last == std::vector<double>{1.0, 1.5, 2.0, 3.0}));   // Stable: equal timestamps keep row order
+    CHECK((s.bid == std::vector<double>{0.9, 1.4, 1.9, 2.9}));
+    CHECK((s.ask == std::vector<double>{1.1, 1.6, 2.1, 3.1}));
+    CHECK((s.volume == std::vector<double>{10, 15, 20, 30}));
+    CHECK(s.high.empty());
+    CHECK(s.low.empty());
+    CHECK(s.open.empty());
+}
+
+void test_sort_by_time_full_columns() {
+    TickSeries s;
+    s.timestamp_ms = {2000, 1000};
+    s.last = {2.0, 1.0};
+    s.bid = {2.0, 1.0};
+    s.ask = {2.0, 1.0};
+    s.volume = {2.0, 1.0};
+    s.high = {2.5, 1.5};
+    s.low = {1.9, 0.9};
+    s.open = {2.1, 1.1};
+    sort_by_time(s);
+
+    CHECK((s.timestamp_ms == std::vector<int64_t>{1000, 2000}));
+    CHECK((s.high == std::vector<double>{1.5, 2.5}));
+    CHECK((s.low == std::vector<double>{0.9, 1.9}));
+    CHECK((s.open == std::vector<double>{1.1, 2.1}));
+}
+
+struct Row {
+    const char* pair;
+    int64_t timestamp;
+    double price;
+};
+
+std::string write_price_history(const std::vector<Row>& rows) {
+    std::string path = (std::filesystem::temp_directory_path() /
+                        ("backtest_load_test_" + std::to_string(getpid()) + ".db")).string();
+    std::filesystem::remove(path);
+    sqlite3* db = nullptr;
+    sqlite3_open(path.c_str(), &db);
+    sqlite3_exec(db,
+                 "CREATE TABLE price_history (id INTEGER PRIMARY KEY AUTOINCREMENT, pair TEXT NOT NULL, "
+                 "price REAL NOT NULL, timestamp INTEGER NOT NULL, volume REAL DEFAULT 0, bid REAL, ask REAL)",
+                 nullptr, nullptr, nullptr);
+    sqlite3_stmt* stmt = nullptr;
+    sqlite3_prepare_v2(db, "INSERT INTO price_history (pair, price, timestamp, volume, bid, ask) VALUES (?, ?, ?, 1, NULL, ?)",
+                       -1, &stmt, nullptr);
+    for (const Row& row : rows) {
+        sqlite3_bind_text(stmt, 1, row.pair, -1, SQLITE_STATIC);
+        sqlite3_bind_double(stmt, 2, row.price);
+        sqlite3_bind_int64(stmt, 3, row.timestamp);
+        sqlite3_bind_double(stmt, 4, row.price * 1.001);
+        sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+    return path;
+}
+
+void test_load_price_history() {
+    // Rows inserted out of time order and interleaved across pairs; one bad price
+    std::vector<Row> rows = {
+        {"XBTUSD", 5000, 105.0}, {"ETHUSD", 2000, 12.0}, {"XBTUSD", 1000, 101.0},
+        {"XBTUSD", 3000, 99.0},  {"ETHUSD", 1000, 11.0}, {"XBTUSD", 2000, 103.0},
+        {"XBTUSD", 4000, 0.0},   {"XBTUSD", 4000, 100.0}, {"ETHUSD", 3000, 10.0},
+    };
+    std::string path = write_price_history(rows);
+
+    const int64_t window_ms = 2000;
+    TickData data;
+    CHECK(load_price_history(path, data, window_ms));
+    std::filesystem::remove(path);
+
+    CHECK(data.series.size() == 2);
+    if (data.series.size() != 2) return;
+    CHECK(data.series[0].pair == "ETHUSD");
+    CHECK(data.series[1].pair == "XBTUSD");
+    CHECK(data.first_ms == 1000);
+    CHECK(data.last_ms == 5000);
+    CHECK(data.tick_count() == 8);
+
+    const TickSeries& xbt = data.series[1];
+    CHECK((xbt.timestamp_ms == std::vector<int64_t>{1000, 2000, 3000, 4000, 5000}));
+    CHECK((xbt.last == std::vector<double>{101.0, 103.0, 99.0, 100.0, 105.0}));
+    CHECK_NEAR(xbt.ask[2], 99.0 * 1.001, 1e-9);
+    CHECK(xbt.bid[2] == 99.0);   // NULL bid falls back to the price
+
+    for (const TickSeries& s : data.series) {
+        size_t n = s.size();
+        CHECK(s.last.size() == n && s.bid.size() == n && s.ask.size() == n && s.volume.size() == n);
+        CHECK(s.high.size() == n && s.low.size() == n && s.open.size() == n);
+        CHECK(s.volatility_pct.size() == n);
+        for (size_t i = 0; i < n; i++) {
+            if (i > 0) CHECK(s.timestamp_ms[i - 1] <= s.timestamp_ms[i]);
+            // Brute force: ticks within window_ms before tick i
+            size_t start = 0;
+            while (s.timestamp_ms[i] - s.timestamp_ms[start] > window_ms) start++;
+            double high = s.last[start], low = s.last[start];
+            for (size_t j = start; j <= i; j++) {
+                high = std::max(high, s.last[j]);
+                low = std::min(low, s.last[j]);
+            }
+            CHECK(s.high[i] == high);
+            CHECK(s.low[i] == low);
+            CHECK(s.open[i] == s.last[start]);
+        }
+    }
+}
+
+}  // namespace
+
+int main() {
+    test_sort_by_time_raw_columns();
+    test_sort_by_time_full_columns();
+    test_load_price_history();
+    return test_result("backtest_load_test");
+}
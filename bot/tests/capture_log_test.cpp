@@ -0,0 +1,186 @@
+#include "capture_log.hpp"
+#include "bot_config.hpp"
+#include "test_check.hpp"
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Capture log: encoder/decoder round trip, record then replay per channel,
+// a truncated tail, and replayed lock order across threads
+
+namespace {
+
+std::string temp_path(const char* name) {
+    return (std::filesystem::temp_directory_path() /
+            ("capture_log_test_" + std::to_string(getpid()) + "_" + name)).string();
+}
+
+uint64_t bits_of(double v) {
+    uint64_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    return bits;
+}
+
+void test_encoding_round_trip() {
+    const std::vector<uint64_t> varints = {0, 1, 127, 128, 300, (1ULL << 35) + 5, UINT64_MAX};
+    const std::vector<int64_t> ints = {0, -1, 1, -64, 64, INT64_MIN, INT64_MAX};
+    const std::vector<double> doubles = {0.0, -0.0, 1.0 / 3.0, -2.5e-310, std::numeric_limits<double>::infinity(),
+                                         std::nan("0x7ff123"), 48123.456789};
+    const std::string binary("a\0b\xff", 4);
+
+    CaptureEncoder out;
+    for (uint64_t v : varints) out.varint(v);
+    for (int64_t v : ints) out.i64(v);
+    for (double v : doubles) out.f64(v);
+    out.str(binary);
+    out.str("");
+    out.u8(0xab);
+    // Small magnitudes stay small either side of zero (zigzag)
+    CaptureEncoder small;
+    small.i64(-64);
+    CHECK(small.bytes.size() == 1);
+
+    CaptureDecoder in(out.bytes);
+    for (uint64_t v : varints) CHECK(in.varint() == v);
+    for (int64_t v : ints) CHECK(in.i64() == v);
+    // Bit-exact: signed zero, denormals and NaN payloads survive
+    for (double v : doubles) CHECK(bits_of(in.f64()) == bits_of(v));
+    CHECK(in.str() == binary);
+    CHECK(in.str().empty());
+    CHECK(in.u8() == 0xab);
+    CHECK(in.ok());
+    CHECK(in.at_end());
+
+    // Reading past the end fails instead of running off the buffer
+    CHECK(in.u8() == 0);
+    CHECK(!in.ok());
+    CaptureEncoder long_str;
+    long_str.str("truncated");
+    CaptureDecoder short_in(std::string_view(long_str.bytes).substr(0, 4));
+    CHECK(short_in.str().empty());
+    CHECK(!short_in.ok());
+}
+
+void test_session_round_trip() {
+    CaptureSession& capture = CaptureSession::instance();
+    const std::string path = temp_path("session.kcap");
+    const char* env_name = BOT_ENV_OVERRIDES[0];
+
+    setenv(env_name, "0.65", 1);
+    CHECK(capture.open_record(path));
+    CHECK(capture.recording());
+    capture.snapshot_env();
+    // Channels interleave while recording
+    for (int i = 0; i < 5; i++) {
+        capture.record(CaptureKind::CLOCK, "ETHUSD", "eth" + std::to_string(i));
+        capture.record(CaptureKind::CLOCK, "", "main" + std::to_string(i));
+    }
+    // Same name, different kind: a separate channel
+    capture.record(CaptureKind::MARKET, "ETHUSD", "ticker");
+    CHECK(capture.file_update("bot_config.json", std::string("{\"leverage\": 3}")) == "{\"leverage\": 3}");
+    CHECK(!capture.file_update("direction_model.json", std::nullopt));
+    CHECK((capture.string_list("pairs", {"XBTUSD", "ETHUSD"}) == std::vector<std::string>{"XBTUSD", "ETHUSD"}));
+    capture.close();
+    CHECK(capture.mode() == CaptureSession::Mode::OFF);
+
+    unsetenv(env_name);
+    CHECK(capture.open_replay(path));
+    CHECK(capture.replaying());
+    CHECK(capture.records() == std::size(BOT_ENV_OVERRIDES) + 14);
+    capture.restore_env();
+    CHECK(std::getenv(env_name) && std::string(std::getenv(env_name)) == "0.65");
+
+    // Each channel replays in its own order, whatever order it is read in
+    CHECK(capture.remaining(CaptureKind::CLOCK, "") == 5);
+    for (int i = 0; i < 5; i++) CHECK(capture.next(CaptureKind::CLOCK, "") == "main" + std::to_string(i));
+    for (int i = 0; i < 5; i++) CHECK(capture.next(CaptureKind::CLOCK, "ETHUSD") == "eth" + std::to_string(i));
+    CHECK(capture.next(CaptureKind::MARKET, "ETHUSD") == "ticker");
+    CHECK(capture.misses() == 0);
+
+    // Recorded content wins over what the replay sees live
+    CHECK(capture.file_update("bot_config.json", std::string("changed")) == "{\"leverage\": 3}");
+    CHECK(!capture.file_update("direction_model.json", std::string("new model")));
+    CHECK((capture.string_list("pairs", {"SOLUSD"}) == std::vector<std::string>{"XBTUSD", "ETHUSD"}));
+
+    // Past the recording, or a channel never recorded: a miss, not a value
+    CHECK(!capture.next(CaptureKind::CLOCK, ""));
+    CHECK(!capture.next(CaptureKind::MARKET, "XBTUSD"));
+    CHECK(capture.misses() == 2);
+    capture.close();
+    unsetenv(env_name);
+    std::filesystem::remove(path);
+}
+
+void test_truncated_tail() {
+    CaptureSession& capture = CaptureSession::instance();
+    const std::string path = temp_path("truncated.kcap");
+    CHECK(capture.open_record(path));
+    for (int i = 0; i < 10; i++) capture.record(CaptureKind::MARKET, "price:XBTUSD", std::string(20, (char)('a' + i)));
+    capture.close();
+
+    // A killed run: the last record is cut short
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 5);
+    CHECK(capture.open_replay(path));
+    CHECK(capture.records() == 9);
+    for (int i = 0; i < 9; i++) CHECK(capture.next(CaptureKind::MARKET, "price:XBTUSD") == std::string(20, (char)('a' + i)));
+    CHECK(!capture.next(CaptureKind::MARKET, "price:XBTUSD"));
+    capture.close();
+
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << "KCAP";
+    CHECK(!capture.open_replay(path));
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << "KCAP\x7f";
+    CHECK(!capture.open_replay(path));
+    std::filesystem::remove(path);
+}
+
+void test_turn_order_replays() {
+    CaptureSession& capture = CaptureSession::instance();
+    const std::string path = temp_path("turns.kcap");
+    const std::vector<std::string> recorded = {"ETHUSD", "XBTUSD", "ETHUSD", "SOLUSD", "XBTUSD", "ETHUSD"};
+    CHECK(capture.open_record(path));
+    for (const std::string& who : recorded) capture.take_turn("learning_lock", who);
+    capture.close();
+
+    CHECK(capture.open_replay(path));
+    std::mutex lock;
+    std::vector<std::string> order;
+    auto trade_thread = [&](const std::string& who, int turns) {
+        for (int i = 0; i < turns; i++) {
+            capture.wait_turn("learning_lock", who);
+            std::lock_guard<std::mutex> guard(lock);
+            capture.take_turn("learning_lock", who);
+            order.push_back(who);
+        }
+    };
+    // Started in the opposite order to the recording
+    std::thread sol(trade_thread, "SOLUSD", 1);
+    std::thread xbt(trade_thread, "XBTUSD", 2);
+    std::thread eth(trade_thread, "ETHUSD", 3);
+    sol.join();
+    xbt.join();
+    eth.join();
+    CHECK(order == recorded);
+    CHECK(capture.misses() == 0);
+    CHECK(capture.remaining(CaptureKind::META, "learning_lock") == 0);
+    capture.close();
+    std::filesystem::remove(path);
+}
+
+}  // namespace
+
+int main() {
+    test_encoding_round_trip();
+    test_session_round_trip();
+    test_truncated_tail();
+    test_turn_order_replays();
+    return test_result("capture_log_test");
+}
@@ -0,0 +1,112 @@
+#include "change_point.hpp"
+#include "test_check.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+// PageHinkley: false-alarm rate on a stable win rate, detection delay and
+// onset estimate after a step change, restart after an alarm
+
+namespace {
+
+struct Outcomes {
+    uint64_t state;
+    double uniform() {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return (double)(state >> 11) / (double)(1ULL << 53);
+    }
+    double trade(double win_rate) { return uniform() < win_rate ? 1.0 : -1.0; }
+};
+
+void test_false_alarm_rate() {
+    // Header: a stable 55% win rate false-alarms about once in 900 trades
+    Outcomes outcomes{11};
+    PageHinkley detector;
+    const int trades = 200000;
+    int alarms = 0;
+    for (int i = 0; i < trades; i++)
+        alarms += detector.update(outcomes.trade(0.55)).direction != ShiftDirection::NONE;
+    CHECK(alarms * 400 < trades);
+}
+
+void test_quiet_until_armed() {
+    ChangePointOptions options;
+    PageHinkley detector;
+    // A loss streak inside the warm-up window is learned, not flagged
+    for (uint32_t i = 0; i < options.min_trades; i++) {
+        double x = i < options.min_trades / 2 ? 1.0 : -1.0;
+        CHECK(detector.update(x, options).direction == ShiftDirection::NONE);
+    }
+    CHECK(detector.count() == options.min_trades);
+    CHECK_NEAR(detector.mean(), 0.0, 1e-12);
+}
+
+// 60% -> 35% wins (DOWN) or 35% -> 60% (UP) after `onset` trades
+void test_step_change(ShiftDirection expected) {
+    const bool down = expected == ShiftDirection::DOWN;
+    const double before = down ? 0.60 : 0.35, after = down ? 0.35 : 0.60;
+    const uint32_t onset = 200;
+    const int runs = 200;
+    std::vector<uint32_t> delays, onset_errors;
+    int clean = 0;
+    for (int run = 0; run < runs; run++) {
+        Outcomes outcomes{1000u + (uint64_t)run};
+        PageHinkley detector;
+        uint32_t restart = 0;   // Onsets count from the last restart
+        for (uint32_t i = 0; i < onset + 300; i++) {
+            if (i == onset && restart > 0) break;
+            clean += i == onset;
+            ChangePoint cp = detector.update(outcomes.trade(i < onset ? before : after));
+            if (cp.direction == ShiftDirection::NONE) continue;
+            if (i < onset || cp.direction != expected) {
+                restart = i + 1;
+                continue;
+            }
+            CHECK(cp.trades_before + cp.trades_after == i + 1 - restart);
+            CHECK(down ? cp.mean_after < cp.mean_before : cp.mean_after > cp.mean_before);
+            delays.push_back(i + 1 - onset);
+            onset_errors.push_back((uint32_t)std::abs((int)(restart + cp.trades_before) - (int)onset));
+            break;
+        }
+    }
+    // Only runs with no false alarm before the shift: a restart shortly
+    // before it leaves too little of the old regime to compare against
+    CHECK(clean >= runs * 2 / 3);
+    CHECK(delays.size() >= (size_t)clean * 85 / 100);
+    if (delays.empty()) return;
+    auto median = [](std::vector<uint32_t> v) {
+        std::nth_element(v.begin(), v.begin() + v.size() / 2, v.end());
+        return v[v.size() / 2];
+    };
+    // Half a standard deviation: flagged after ~40 trades, and the onset
+    // lands within a few trades of the true change
+    CHECK(median(delays) <= 40);
+    CHECK(median(onset_errors) <= 20);
+}
+
+void test_restarts_after_alarm() {
+    PageHinkley detector;
+    uint32_t seen = 0;
+    ChangePoint cp;
+    for (int i = 0; i < 100; i++) detector.update(i % 2 ? 1.0 : 0.0);
+    for (int i = 0; i < 200 && cp.direction == ShiftDirection::NONE; i++, seen++) cp = detector.update(-3.0);
+    CHECK(cp.direction == ShiftDirection::DOWN);
+    CHECK(cp.trades_before + cp.trades_after == 100 + seen);
+    CHECK_NEAR(cp.mean_before, 0.5, 0.05);
+    CHECK_NEAR(cp.mean_after, -3.0, 1e-9);
+    CHECK(detector.count() == 0);
+    CHECK(detector.mean() == 0.0);
+}
+
+}  // namespace
+
+int main() {
+    test_false_alarm_rate();
+    test_quiet_until_armed();
+    test_step_change(ShiftDirection::DOWN);
+    test_step_change(ShiftDirection::UP);
+    test_restarts_after_alarm();
+    return test_result("change_point_test");
+}
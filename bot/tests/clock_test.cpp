@@ -0,0 +1,95 @@
+#include "clock.hpp"
+#include "test_check.hpp"
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+// VirtualClock: sleeping advances virtual time without waiting, clock
+// threads take turns in wake-up order (ties in the order they slept), and
+// only one of them runs at a time
+
+namespace {
+
+using std::chrono::milliseconds;
+using std::chrono::seconds;
+
+const Clock::time_point START = Clock::time_point(seconds(1700000000));
+
+long elapsed_s(Clock& clock) {
+    return clock.now_seconds() - std::chrono::duration_cast<seconds>(START.time_since_epoch()).count();
+}
+
+void test_sleep_advances_time() {
+    VirtualClock clock(START);
+    CHECK(clock.now() == START);
+    auto real_start = std::chrono::steady_clock::now();
+    // A day of 5s position-monitor polls
+    for (int i = 0; i < 17280; i++) clock.sleep_for(seconds(5));
+    CHECK(elapsed_s(clock) == 86400);
+    CHECK(clock.wakeups() == 17280);
+    CHECK(std::chrono::steady_clock::now() - real_start < seconds(5));
+}
+
+struct Event {
+    std::string who;
+    long at_s;
+    bool operator==(const Event& other) const { return who == other.who && at_s == other.at_s; }
+};
+
+std::vector<Event> run_schedule() {
+    VirtualClock clock(START);
+    std::vector<Event> events;   // Only the thread holding the turn touches it
+    std::atomic<int> active{0};
+    std::atomic<bool> overlapped{false};
+    auto poller = [&](std::string who, int period_s, int polls) {
+        return [&, who, period_s, polls] {
+            for (int i = 0; i < polls; i++) {
+                clock.sleep_for(seconds(period_s));
+                if (active.fetch_add(1) != 0) overlapped = true;
+                events.push_back({who, elapsed_s(clock)});
+                std::this_thread::yield();
+                active.fetch_sub(1);
+            }
+        };
+    };
+    std::vector<std::thread> threads;
+    threads.push_back(clock.start_thread(poller("A", 5, 4)));
+    threads.push_back(clock.start_thread(poller("B", 7, 3)));
+    threads.push_back(clock.start_thread(poller("C", 5, 2)));
+    clock.join(threads);
+    CHECK(!overlapped);
+    // The joining thread resumes once the last clock thread is done
+    CHECK(elapsed_s(clock) == 21);
+    events.push_back({"main", elapsed_s(clock)});
+    return events;
+}
+
+void test_turn_order() {
+    std::vector<Event> expected = {
+        {"A", 5}, {"C", 5}, {"B", 7}, {"A", 10}, {"C", 10}, {"B", 14},
+        {"A", 15}, {"A", 20}, {"B", 21}, {"main", 21},
+    };
+    CHECK(run_schedule() == expected);
+    // Same schedule, same order, every time
+    for (int run = 0; run < 20; run++) CHECK(run_schedule() == expected);
+}
+
+void test_paced_replay() {
+    // 1000 virtual seconds per real second: 20s of sleeps take >= 20ms
+    VirtualClock clock(START, 1000.0);
+    auto real_start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 4; i++) clock.sleep_for(seconds(5));
+    CHECK(elapsed_s(clock) == 20);
+    CHECK(std::chrono::steady_clock::now() - real_start >= milliseconds(20));
+}
+
+}  // namespace
+
+int main() {
+    test_sleep_advances_time();
+    test_turn_order();
+    test_paced_replay();
+    return test_result("clock_test");
+}
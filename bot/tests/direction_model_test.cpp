@@ -0,0 +1,141 @@
+#include "direction_model.hpp"
+#include "test_check.hpp"
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// DirectionModel: JSON compiled to the dense vector scores like the named
+// weights, reloads only on real changes, keeps the last good model, and
+// readers never see a model mixed from two files
+
+namespace {
+
+std::string model_path() {
+    return (std::filesystem::temp_directory_path() /
+            ("direction_model_test_" + std::to_string(getpid()) + ".json")).string();
+}
+
+// Every write gets a new mtime, so the size/mtime check can't miss it
+void write_model(const std::string& path, const std::string& content) {
+    static int generation = 0;
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << content;
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now() +
+                                           std::chrono::seconds(++generation));
+}
+
+DirectionFeatures features(double vol, double regime, double vwap, double volume, double last) {
+    DirectionFeatures f{};
+    f[(size_t)DirectionFeature::VOLATILITY_PCT] = vol;
+    f[(size_t)DirectionFeature::MARKET_REGIME] = regime;
+    f[(size_t)DirectionFeature::VWAP_DEV] = vwap;
+    f[(size_t)DirectionFeature::VOLUME] = volume;
+    f[(size_t)DirectionFeature::LAST_PRICE] = last;
+    f[(size_t)DirectionFeature::VOLATILITY_PCT_SQ] = vol * vol;
+    return f;
+}
+
+void test_compiles_and_scores() {
+    const std::string path = model_path();
+    DirectionModel model;
+    CHECK(!model.reload_if_changed(path));   // No file yet
+    CHECK(model.current() == nullptr);
+
+    write_model(path, R"({"bias": -0.25, "weights": {"volatility_pct": 0.5, "vwap_dev": -1.5,
+        "last_price": 0.001, "volatility_pct_sq": 2.0, "spread_bps": 9.0, "volume": "n/a"}})");
+    CHECK(model.reload_if_changed(path));
+    DirectionModel::Ptr m = model.current();
+    CHECK(m != nullptr);
+    CHECK(m->weight_count == 4);   // spread_bps unknown, volume not a number
+    CHECK(m->weights[(size_t)DirectionFeature::MARKET_REGIME] == 0.0);
+    CHECK(m->weights[6] == 0.0 && m->weights[7] == 0.0);   // Padding
+
+    DirectionFeatures f = features(1.2, -1.0, 0.3, 5000.0, 42000.0);
+    double expected = -0.25 + 0.5 * 1.2 - 1.5 * 0.3 + 0.001 * 42000.0 + 2.0 * 1.2 * 1.2;
+    CHECK_NEAR(m->score(f), expected, 1e-12);
+    CHECK(m->score(DirectionFeatures{}) == -0.25);
+
+    CHECK(std::string(DirectionModel::feature_name(DirectionFeature::VWAP_DEV)) == "vwap_dev");
+    CHECK(DirectionModel::feature_name(DirectionFeature::COUNT) == nullptr);
+    std::filesystem::remove(path);
+}
+
+void test_reload_only_on_change() {
+    const std::string path = model_path();
+    const std::string v1 = R"({"bias": 1.0, "weights": {"volume": 0.5}})";
+    const std::string v2 = R"({"bias": 2.0, "weights": {"volume": 0.5}})";
+    DirectionModel model;
+    write_model(path, v1);
+    CHECK(model.reload_if_changed(path));
+    DirectionModel::Ptr first = model.current();
+    CHECK(!model.reload_if_changed(path));   // Untouched
+
+    write_model(path, v1);                    // Touched, same content
+    CHECK(!model.reload_if_changed(path));
+    CHECK(model.current() == first);
+
+    write_model(path, v2);
+    CHECK(model.reload_if_changed(path));
+    CHECK(model.current()->bias == 2.0);
+    CHECK(first->bias == 1.0);                // Old holders keep their model
+
+    // Half-written or malformed files keep the last good model
+    write_model(path, R"({"bias": 3.0, "weig)");
+    CHECK(!model.reload_if_changed(path));
+    write_model(path, R"({"bias": 3.0})");
+    CHECK(!model.reload_if_changed(path));
+    CHECK(model.current()->bias == 2.0);
+    write_model(path, R"({"bias": 3.0, "weights": {}})");
+    CHECK(model.reload_if_changed(path));
+    CHECK(model.current()->bias == 3.0 && model.current()->weight_count == 0);
+    std::filesystem::remove(path);
+}
+
+void test_readers_see_whole_models() {
+    // Model k has bias k and every weight k: any mix of two shows up as a
+    // score that isn't 7k for unit features
+    const std::string path = model_path();
+    DirectionModel model;
+    write_model(path, R"({"bias": 0, "weights": {}})");
+    CHECK(model.reload_if_changed(path));
+
+    std::atomic<bool> done{false};
+    std::atomic<int> torn{0}, reads{0};
+    std::vector<std::thread> readers;
+    const DirectionFeatures ones = features(1.0, 1.0, 1.0, 1.0, 1.0);
+    for (int r = 0; r < 3; r++) {
+        readers.emplace_back([&] {
+            while (!done.load()) {
+                DirectionModel::Ptr m = model.current();
+                if (m->score(ones) != 7.0 * m->bias) torn++;
+                reads++;
+            }
+        });
+    }
+    for (int k = 1; k <= 200; k++) {
+        std::string w = std::to_string(k);
+        write_model(path, "{\"bias\": " + w + ", \"weights\": {\"volatility_pct\": " + w +
+                          ", \"market_regime\": " + w + ", \"vwap_dev\": " + w + ", \"volume\": " + w +
+                          ", \"last_price\": " + w + ", \"volatility_pct_sq\": " + w + "}}");
+        CHECK(model.reload_if_changed(path));
+    }
+    done = true;
+    for (auto& t : readers) t.join();
+    CHECK(torn.load() == 0);
+    CHECK(reads.load() > 0);
+    CHECK(model.current()->bias == 200.0);
+    std::filesystem::remove(path);
+}
+
+}  // namespace
+
+int main() {
+    test_compiles_and_scores();
+    test_reload_only_on_change();
+    test_readers_see_whole_models();
+    return test_result("direction_model_test");
+}
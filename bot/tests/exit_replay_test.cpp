@@ -0,0 +1,139 @@
+#include "counterfactual.hpp"
+#include "strategy_core.hpp"
+#include "thread_pool.hpp"
+#include "test_check.hpp"
+#include <cstdint>
+#include <vector>
+
+// The counterfactual replay must exit every candidate where PositionTracker
+// (the live monitor loop and the backtest) would, on the same prices
+
+namespace {
+
+constexpr int POLL_SECONDS = 5;
+constexpr float LEVERAGE = 1000.0f;   // Liquidation floor 0.1%, below every SL in the grid
+
+struct Trade {
+    bool is_short;
+    double entry;
+    std::vector<double> prices;   // One per poll, from POLL_SECONDS after entry
+};
+
+// Deterministic random walk, ~0.15% per poll
+std::vector<Trade> make_trades(size_t count, size_t polls) {
+    std::vector<Trade> trades;
+    uint64_t state = 42;
+    auto uniform = [&state]() {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return (double)(state >> 11) / (double)(1ULL << 53);
+    };
+    for (size_t t = 0; t < count; t++) {
+        Trade trade{t % 2 == 1, 100.0 + t, {}};
+        double drift = (uniform() - 0.5) * 0.001;
+        double price = trade.entry;
+        for (size_t k = 0; k < polls; k++) {
+            price *= 1.0 + drift + (uniform() - 0.5) * 0.003;
+            trade.prices.push_back(price);
+        }
+        trades.push_back(std::move(trade));
+    }
+    return trades;
+}
+
+// Favorable move % at PositionTracker's exit (the last price if it never exits)
+double tracker_exit_move(const Trade& trade, const ExitGrid& grid, size_t c, ExitReason& reason) {
+    PositionTracker tracker(trade.is_short, trade.entry, grid.tp_pct[c], grid.sl_pct[c],
+                            grid.trailing_start_pct[c], grid.trailing_stop_pct[c], grid.hold_s[c]);
+    double exit_price = trade.prices.back();
+    reason = ExitReason::NONE;
+    for (size_t k = 0; k < trade.prices.size(); k++) {
+        reason = tracker.on_price(trade.prices[k], (long)(k + 1) * POLL_SECONDS).exit;
+        if (reason != ExitReason::NONE) {
+            exit_price = trade.prices[k];
+            break;
+        }
+    }
+    double move = (exit_price / trade.entry - 1.0) * 100.0;
+    return trade.is_short ? -move : move;
+}
+
+ExitGrid make_grid() {
+    ExitGrid grid;
+    for (float tp : {0.5f, 1.0f, 3.0f})
+        for (float sl : {0.3f, 0.8f, 2.0f})
+            for (float trailing_start : {0.4f, 1.5f, ExitGrid::NO_TRAILING})
+                for (int32_t hold : {60, 600})
+                    grid.add(tp, sl, trailing_start, 0.25f, hold, LEVERAGE);
+    return grid;
+}
+
+void test_replay_matches_tracker() {
+    std::vector<Trade> trades = make_trades(24, 150);
+    std::vector<PricePath> paths(trades.size());
+    std::vector<const PricePath*> path_ptrs;
+    for (size_t i = 0; i < trades.size(); i++) {
+        paths[i].is_short = trades[i].is_short;
+        for (size_t k = 0; k < trades[i].prices.size(); k++)
+            paths[i].add((int32_t)(k + 1) * POLL_SECONDS, trades[i].prices[k], trades[i].entry);
+        path_ptrs.push_back(&paths[i]);
+    }
+
+    ExitGrid grid = make_grid();
+    const double fee_pct = 0.4;
+    ThreadPool pool(3);
+    std::vector<ExitScore> scores = score_exit_grid(path_ptrs, grid, fee_pct, pool);
+    CHECK(scores.size() == grid.size());
+
+    int reasons[5] = {};
+    for (size_t c = 0; c < grid.size(); c++) {
+        std::vector<ExitOutcome> outcomes = replay_exit(path_ptrs, grid, c, fee_pct);
+        CHECK(outcomes.size() == trades.size());
+        double sum = 0.0;
+        int wins = 0;
+        for (size_t i = 0; i < trades.size(); i++) {
+            ExitReason reason;
+            double net = tracker_exit_move(trades[i], grid, c, reason) - fee_pct;
+            reasons[(int)reason]++;
+            CHECK_NEAR(outcomes[i].net_pct, net, 1e-4);
+            sum += net;
+            wins += net > 0.0;
+        }
+        CHECK(scores[c].trades == (int)trades.size());
+        CHECK(scores[c].wins == wins);
+        CHECK_NEAR(scores[c].mean_net_pct, sum / trades.size(), 1e-4);
+    }
+    // The grid must reach every exit path, or the comparison proves little
+    CHECK(reasons[(int)ExitReason::TAKE_PROFIT] > 0);
+    CHECK(reasons[(int)ExitReason::STOP_LOSS] > 0);
+    CHECK(reasons[(int)ExitReason::TRAILING_STOP] > 0);
+    CHECK(reasons[(int)ExitReason::TIMEOUT] > 0);
+}
+
+void test_scores_independent_of_threads() {
+    std::vector<Trade> trades = make_trades(37, 60);
+    std::vector<PricePath> paths(trades.size());
+    std::vector<const PricePath*> path_ptrs;
+    for (size_t i = 0; i < trades.size(); i++) {
+        paths[i].is_short = trades[i].is_short;
+        for (size_t k = 0; k < trades[i].prices.size(); k++)
+            paths[i].add((int32_t)(k + 1) * POLL_SECONDS, trades[i].prices[k], trades[i].entry);
+        path_ptrs.push_back(&paths[i]);
+    }
+    ExitGrid grid = make_grid();
+    ThreadPool one(1), four(4);
+    std::vector<ExitScore> a = score_exit_grid(path_ptrs, grid, 0.4, one);
+    std::vector<ExitScore> b = score_exit_grid(path_ptrs, grid, 0.4, four);
+    for (size_t c = 0; c < grid.size(); c++) {
+        CHECK(a[c].wins == b[c].wins);
+        CHECK(a[c].mean_net_pct == b[c].mean_net_pct);
+        CHECK(a[c].std_net_pct == b[c].std_net_pct);
+    }
+}
+
+}  // namespace
+
+int main() {
+    test_replay_matches_tracker();
+    test_scores_independent_of_threads();
+    return test_result("exit_replay_test");
+}
@@ -0,0 +1,339 @@
+#include "learning_engine.hpp"
+#include "clock.hpp"
+#include "test_check.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <sqlite3.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// PatternAggregate add/merge against brute force, LearningEngine's
+// incrementally folded pattern metrics against a full re-analysis, the same
+// metrics after a restart from pattern_stats or from the trades table, and
+// ticker_data ingestion past the id watermark
+
+namespace {
+
+struct Walk {
+    uint64_t state;
+    double uniform() {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return (double)(state >> 11) / (double)(1ULL << 53);
+    }
+};
+
+std::vector<double> make_returns(size_t count, uint64_t seed) {
+    Walk walk{seed};
+    std::vector<double> roi;
+    for (size_t i = 0; i < count; i++) roi.push_back((walk.uniform() - 0.45) * 4.0);
+    return roi;
+}
+
+// Fold ROI (%) on a 100-unit position: pnl = roi, fees 0.1 per trade
+PatternAggregate fold(const std::vector<double>& roi, size_t begin, size_t end) {
+    PatternAggregate agg;
+    for (size_t i = begin; i < end; i++) agg.add(roi[i], roi[i] + 0.1, 0.1, roi[i]);
+    return agg;
+}
+
+void test_aggregate_matches_brute_force() {
+    std::vector<double> roi = make_returns(500, 3);
+    PatternAggregate agg = fold(roi, 0, roi.size());
+
+    int wins = 0;
+    double sum = 0.0, downside = 0.0, gross_wins = 0.0, gross_losses = 0.0;
+    double peak = roi[0], drawdown = 0.0;
+    for (double r : roi) {
+        wins += r > 0;
+        sum += r;
+        if (r < 0) downside += r * r;
+        (r > 0 ? gross_wins : gross_losses) += std::abs(r + 0.1);
+        peak = std::max(peak, r);
+        drawdown = std::max(drawdown, peak - r);
+    }
+    const double mean = sum / roi.size();
+    double m2 = 0.0;
+    for (double r : roi) m2 += (r - mean) * (r - mean);
+
+    CHECK(agg.total_trades == (int)roi.size());
+    CHECK(agg.winning_trades == wins);
+    CHECK(agg.losing_trades == (int)roi.size() - wins);
+    CHECK_NEAR(agg.total_pnl, sum, 1e-9);
+    CHECK_NEAR(agg.total_fees, 0.1 * roi.size(), 1e-9);
+    CHECK_NEAR(agg.gross_wins, gross_wins, 1e-9);
+    CHECK_NEAR(agg.gross_losses, gross_losses, 1e-9);
+    CHECK_NEAR(agg.return_mean, mean, 1e-12);
+    CHECK_NEAR(agg.return_m2, m2, 1e-9);
+    CHECK_NEAR(agg.return_std_dev(), std::sqrt(m2 / roi.size()), 1e-12);
+    CHECK_NEAR(agg.downside_sq_sum, downside, 1e-9);
+    CHECK(agg.return_peak == peak);
+    CHECK_NEAR(agg.max_drawdown, drawdown, 1e-12);
+}
+
+void test_merge_matches_single_pass() {
+    std::vector<double> roi = make_returns(301, 8);
+    PatternAggregate all = fold(roi, 0, roi.size());
+    PatternAggregate merged = fold(roi, 0, 120);
+    merged.merge(fold(roi, 120, roi.size()));
+
+    CHECK(merged.total_trades == all.total_trades);
+    CHECK(merged.winning_trades == all.winning_trades);
+    CHECK_NEAR(merged.total_pnl, all.total_pnl, 1e-9);
+    CHECK_NEAR(merged.gross_losses, all.gross_losses, 1e-9);
+    CHECK_NEAR(merged.return_mean, all.return_mean, 1e-12);
+    CHECK_NEAR(merged.return_m2, all.return_m2, 1e-9);
+    CHECK_NEAR(merged.downside_sq_sum, all.downside_sq_sum, 1e-9);
+    CHECK(merged.return_peak == all.return_peak);
+    // Interleaving unknown: the merged drawdown only bounds the real one
+    CHECK(merged.max_drawdown <= all.max_drawdown);
+
+    // Merging into an empty aggregate keeps its key
+    PatternAggregate empty;
+    empty.key = PatternKey::basic(4, true, 5.0, 2);
+    empty.merge(all);
+    CHECK(empty.key == PatternKey::basic(4, true, 5.0, 2));
+    CHECK(empty.total_trades == all.total_trades);
+    CHECK(empty.return_m2 == all.return_m2);
+}
+
+std::string db_path() {
+    return (std::filesystem::temp_directory_path() /
+            ("learning_engine_test_" + std::to_string(getpid()) + ".db")).string();
+}
+
+void remove_db(const std::string& path) {
+    for (const char* suffix : {"", "-wal", "-shm"}) std::filesystem::remove(path + suffix);
+}
+
+LearningEngineOptions engine_options(const std::string& path) {
+    LearningEngineOptions options;
+    options.trades_db_path = path;
+    options.persist_models = false;
+    options.ingest_market_data = false;
+    options.online_model_path = "";
+    return options;
+}
+
+TradeRecord make_trade(int i, const char* pair, const char* direction, double roi) {
+    TradeRecord trade{};
+    trade.pair = pair;
+    trade.direction = direction;
+    trade.entry_price = 100.0;
+    trade.exit_price = 100.0 * (1.0 + roi / 100.0);
+    trade.leverage = 3;
+    trade.timeframe_seconds = 45;
+    trade.position_size = 100.0;
+    trade.pnl = roi;
+    trade.gross_pnl = roi + 0.1;
+    trade.fees_paid = 0.1;
+    trade.volatility_at_entry = 3.0;
+    trade.timestamp = system_clock::time_point(std::chrono::milliseconds(1700000000000LL + i * 60000LL));
+    trade.exit_reason = roi > 0 ? "take_profit" : "stop_loss";
+    return trade;
+}
+
+struct Expected {
+    int trades = 0, wins = 0;
+    double pnl = 0.0;
+};
+
+void check_metrics(const PatternMetrics& m, const Expected& e) {
+    CHECK(m.total_trades == e.trades);
+    CHECK(m.winning_trades == e.wins);
+    CHECK_NEAR(m.total_pnl, e.pnl, 1e-9);
+    CHECK_NEAR(m.win_rate, (double)e.wins / e.trades, 1e-12);
+}
+
+void test_incremental_matches_rebuild() {
+    const std::string path = db_path();
+    remove_db(path);
+    std::vector<double> roi = make_returns(90, 21);
+    Expected xbt_long, eth_short;
+    LearningEngine engine(engine_options(path));
+    for (size_t i = 0; i < roi.size(); i++) {
+        const bool xbt = i % 3 != 0;
+        engine.record_trade(make_trade((int)i, xbt ? "PI_XBTUSD" : "PI_ETHUSD", xbt ? "LONG" : "SHORT", roi[i]));
+        Expected& e = xbt ? xbt_long : eth_short;
+        e.trades++;
+        e.wins += roi[i] > 0;
+        e.pnl += roi[i];
+    }
+    engine.flush_writes();
+    CHECK(engine.get_trade_count() == (int)roi.size());
+
+    PatternMetrics xbt = engine.get_pattern_metrics("PI_XBTUSD", "LONG", 3.0, 1);
+    PatternMetrics eth = engine.get_pattern_metrics("PI_ETHUSD", "SHORT", 3.0, 1);
+    check_metrics(xbt, xbt_long);
+    check_metrics(eth, eth_short);
+    CHECK(engine.get_pattern_metrics("PI_ETHUSD", "LONG", 3.0, 1).total_trades == 0);
+
+    // The offline re-analysis rebuilds the same aggregates from history
+    engine.analyze_patterns();
+    PatternMetrics rebuilt = engine.get_pattern_metrics("PI_XBTUSD", "LONG", 3.0, 1);
+    check_metrics(rebuilt, xbt_long);
+    CHECK_NEAR(rebuilt.sharpe_ratio, xbt.sharpe_ratio, 1e-9);
+    CHECK_NEAR(rebuilt.profit_factor, xbt.profit_factor, 1e-9);
+    CHECK_NEAR(rebuilt.max_drawdown, xbt.max_drawdown, 1e-9);
+    remove_db(path);
+}
+
+void check_same_metrics(const PatternMetrics& a, const PatternMetrics& b) {
+    CHECK(a.total_trades == b.total_trades);
+    CHECK(a.winning_trades == b.winning_trades);
+    CHECK_NEAR(a.total_pnl, b.total_pnl, 1e-9);
+    CHECK_NEAR(a.sharpe_ratio, b.sharpe_ratio, 1e-9);
+    CHECK_NEAR(a.profit_factor, b.profit_factor, 1e-9);
+    CHECK_NEAR(a.max_drawdown, b.max_drawdown, 1e-9);
+}
+
+void set_user_version(const std::string& path, int version) {
+    sqlite3* db = nullptr;
+    CHECK(sqlite3_open(path.c_str(), &db) == SQLITE_OK);
+    CHECK(sqlite3_exec(db, ("PRAGMA user_version = " + std::to_string(version)).c_str(),
+                       nullptr, nullptr, nullptr) == SQLITE_OK);
+    sqlite3_close(db);
+}
+
+void test_restart_matches_live() {
+    const std::string path = db_path();
+    remove_db(path);
+    std::vector<double> roi = make_returns(120, 34);
+    PatternMetrics live_xbt, live_eth;
+    int learned = 0;
+    {
+        LearningEngine engine(engine_options(path));
+        for (size_t i = 0; i < roi.size(); i++) {
+            TradeRecord trade = make_trade((int)i, i % 2 ? "PI_XBTUSD" : "PI_ETHUSD", "LONG", roi[i]);
+            if (i % 10 == 0) trade.leverage = 1;   // Stored, never learned
+            learned += LearningEngine::is_learned(trade);
+            engine.record_trade(trade);
+        }
+        engine.flush_writes();
+        CHECK(engine.get_trade_count() == learned);
+        live_xbt = engine.get_pattern_metrics("PI_XBTUSD", "LONG", 3.0, 1);
+        live_eth = engine.get_pattern_metrics("PI_ETHUSD", "LONG", 3.0, 1);
+    }
+
+    // Restart from the persisted aggregates
+    {
+        LearningEngine engine(engine_options(path));
+        CHECK(engine.get_trade_count() == learned);
+        check_same_metrics(engine.get_pattern_metrics("PI_XBTUSD", "LONG", 3.0, 1), live_xbt);
+        check_same_metrics(engine.get_pattern_metrics("PI_ETHUSD", "LONG", 3.0, 1), live_eth);
+    }
+
+    // An outdated stats version forces the full scan of trades instead
+    set_user_version(path, 0);
+    {
+        LearningEngine engine(engine_options(path));
+        CHECK(engine.get_trade_count() == learned);
+        check_same_metrics(engine.get_pattern_metrics("PI_XBTUSD", "LONG", 3.0, 1), live_xbt);
+        check_same_metrics(engine.get_pattern_metrics("PI_ETHUSD", "LONG", 3.0, 1), live_eth);
+    }
+    remove_db(path);
+}
+
+// ticker_data as the collector writes it: ms timestamps, AUTOINCREMENT ids
+struct MarketDb {
+    std::string path;
+    sqlite3* db = nullptr;
+
+    explicit MarketDb(const std::string& p) : path(p) {
+        remove_db(path);
+        CHECK(sqlite3_open(path.c_str(), &db) == SQLITE_OK);
+        exec(R"(CREATE TABLE ticker_data (
+                    id INTEGER PRIMARY KEY AUTOINCREMENT, pair TEXT NOT NULL, timestamp INTEGER NOT NULL,
+                    ask REAL, bid REAL, last REAL, volume REAL, vwap REAL,
+                    trades INTEGER, low REAL, high REAL, open REAL))");
+    }
+    ~MarketDb() {
+        sqlite3_close(db);
+        remove_db(path);
+    }
+    void exec(const std::string& sql) { CHECK(sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr) == SQLITE_OK); }
+    void insert(const std::string& pair, int64_t timestamp_ms, double last) {
+        exec("INSERT INTO ticker_data (pair, timestamp, ask, bid, last, volume, vwap) VALUES ('" + pair + "', " +
+             std::to_string(timestamp_ms) + ", " + std::to_string(last + 0.5) + ", " + std::to_string(last - 0.5) +
+             ", " + std::to_string(last) + ", 10, " + std::to_string(last) + ")");
+    }
+};
+
+size_t loaded(LearningEngine& engine, const std::string& pair) {
+    return engine.get_recent_market_data(pair, 24 * 60).size();
+}
+
+void test_market_data_watermark() {
+    const int64_t now_ms = 1700000000000LL;
+    VirtualClock clock{system_clock::time_point(std::chrono::milliseconds(now_ms))};
+    const std::string trades_path = db_path();
+    remove_db(trades_path);
+    LearningEngineOptions options = engine_options(trades_path);
+    options.clock = &clock;
+
+    {
+        // First load: only the last 5 minutes; later loads: only new ids
+        MarketDb market(db_path() + ".market");
+        market.exec("BEGIN");
+        for (int i = 0; i < 50; i++) market.insert("PI_XBTUSD", now_ms - 600000 + i * 1000, 100.0 + i);
+        for (int i = 0; i < 30; i++) {
+            market.insert("PI_XBTUSD", now_ms - 240000 + i * 1000, 200.0 + i);
+            market.insert("PI_ETHUSD", now_ms - 240000 + i * 1000, 50.0 + i);
+        }
+        market.exec("COMMIT");
+        LearningEngine engine(options);
+        engine.load_market_data_from_sqlite(market.path);
+        CHECK(loaded(engine, "PI_XBTUSD") == 30);
+        CHECK(loaded(engine, "PI_ETHUSD") == 30);
+        CHECK(engine.get_latest_market_data("PI_XBTUSD").last_price == 229.0);
+
+        for (int i = 0; i < 10; i++) market.insert("PI_XBTUSD", now_ms - 100000 + i * 1000, 300.0 + i);
+        market.insert("PI_ETHUSD", now_ms - 500000, 1.0);   // New id, stale timestamp: dropped
+        engine.load_market_data_from_sqlite(market.path);
+        CHECK(loaded(engine, "PI_XBTUSD") == 40);
+        CHECK(loaded(engine, "PI_ETHUSD") == 30);
+        CHECK(engine.get_latest_market_data("PI_XBTUSD").last_price == 309.0);
+        CHECK(engine.get_latest_market_data("PI_ETHUSD").last_price == 79.0);
+        engine.load_market_data_from_sqlite(market.path);   // Nothing new
+        CHECK(loaded(engine, "PI_XBTUSD") == 40);
+    }
+    {
+        // Nothing recent: start after the existing rows instead of rescanning them
+        MarketDb market(db_path() + ".market");
+        for (int i = 0; i < 20; i++) market.insert("PI_XBTUSD", now_ms - 900000 + i * 1000, 100.0);
+        LearningEngine engine(options);
+        engine.load_market_data_from_sqlite(market.path);
+        CHECK(loaded(engine, "PI_XBTUSD") == 0);
+        for (int i = 0; i < 5; i++) market.insert("PI_XBTUSD", now_ms - 800000 + i * 1000, 100.0 + i);
+        engine.load_market_data_from_sqlite(market.path);
+        CHECK(loaded(engine, "PI_XBTUSD") == 5);
+    }
+    {
+        // A backlog past the per-load row limit continues on the next load
+        MarketDb market(db_path() + ".market");
+        market.exec("BEGIN");
+        for (int i = 0; i < 25000; i++) {
+            market.insert("P" + std::to_string(i % 50), now_ms - 250000 + i * 10, 100.0);
+        }
+        market.exec("COMMIT");
+        LearningEngine engine(options);
+        engine.load_market_data_from_sqlite(market.path);
+        CHECK(loaded(engine, "P0") == 400 && loaded(engine, "P49") == 400);
+        engine.load_market_data_from_sqlite(market.path);
+        CHECK(loaded(engine, "P0") == 500 && loaded(engine, "P49") == 500);
+    }
+    remove_db(trades_path);
+}
+
+}  // namespace
+
+int main() {
+    test_aggregate_matches_brute_force();
+    test_merge_matches_single_pass();
+    test_incremental_matches_rebuild();
+    test_restart_matches_live();
+    test_market_data_watermark();
+    return test_result("learning_engine_test");
+}
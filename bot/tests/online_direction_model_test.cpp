@@ -0,0 +1,131 @@
+#include "online_direction_model.hpp"
+#include "learning_engine.hpp"
+#include "test_check.hpp"
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <unistd.h>
+
+// OnlineDirectionModel (FTRL): learns a direction signal from closed trades,
+// ignores noise features, scores progressively and checkpoints exactly
+
+namespace {
+
+struct Market {
+    uint64_t state;
+    double uniform() {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return (double)(state >> 11) / (double)(1ULL << 53);
+    }
+    double normal() {
+        double u = std::max(uniform(), 1e-300);
+        return std::sqrt(-2.0 * std::log(u)) * std::cos(6.283185307179586 * uniform());
+    }
+
+    // Momentum predicts the move (flipped 10% of the time when `signal`);
+    // RSI and volume ratio are noise on their own scales
+    TradeRecord trade(bool signal) {
+        TradeRecord t{};
+        t.entry_price = 100.0;
+        t.momentum_score = normal() * 0.3;
+        t.rsi = 50.0 + normal() * 15.0;
+        t.volume_ratio = 1.0 + std::abs(normal());
+        t.volatility_at_entry = 2.0 + uniform();
+        bool up = signal ? (t.momentum_score > 0) != (uniform() < 0.1) : uniform() < 0.5;
+        t.exit_price = up ? 101.0 : 99.0;
+        return t;
+    }
+};
+
+void test_learns_signal() {
+    OnlineDirectionModel model;
+    Market market{5};
+    for (int i = 0; i < 3000; i++) model.update(market.trade(true));
+    CHECK(model.updates() == 3000);
+    // Progressive validation over the whole stream, warm-up included
+    CHECK(model.score().accuracy() > 0.8);
+    CHECK(model.score().log_loss() < std::log(2.0) * 0.75);
+    CHECK(model.weight(OnlineFeature::MOMENTUM) > 0.5);
+    // L1 keeps noise features at or near zero
+    CHECK(std::abs(model.weight(OnlineFeature::RSI)) < model.weight(OnlineFeature::MOMENTUM) / 10);
+    CHECK(std::abs(model.weight(OnlineFeature::VOLUME_RATIO)) < model.weight(OnlineFeature::MOMENTUM) / 10);
+    CHECK(model.weight(OnlineFeature::ORDER_FLOW) == 0.0);   // Constant: never standardized in
+
+    TradeRecord strong_up{};
+    strong_up.momentum_score = 0.6;
+    strong_up.rsi = 50.0;
+    strong_up.volume_ratio = 1.5;
+    strong_up.volatility_at_entry = 2.5;
+    CHECK(model.predict(OnlineDirectionModel::raw_features(strong_up)) > 0.8);
+    strong_up.momentum_score = -0.6;
+    CHECK(model.predict(OnlineDirectionModel::raw_features(strong_up)) < 0.2);
+}
+
+void test_no_signal_stays_uncertain() {
+    OnlineDirectionModel model;
+    Market market{9};
+    for (int i = 0; i < 3000; i++) model.update(market.trade(false));
+    CHECK_NEAR(model.score().accuracy(), 0.5, 0.05);
+    CHECK(model.score().log_loss() < std::log(2.0) + 0.02);
+}
+
+void test_predict_then_learn() {
+    OnlineDirectionModel model;
+    Market market{17};
+    for (int i = 0; i < 200; i++) {
+        TradeRecord t = market.trade(true);
+        double before = model.predict(OnlineDirectionModel::raw_features(t));
+        CHECK(model.update(t) == before);
+    }
+    // Non-finite inputs sit out instead of poisoning the weights
+    TradeRecord bad = market.trade(true);
+    bad.rsi = std::numeric_limits<double>::quiet_NaN();
+    bad.atr_pct = std::numeric_limits<double>::infinity();
+    OnlineDirectionModel::Features x = OnlineDirectionModel::raw_features(bad);
+    CHECK(x[(size_t)OnlineFeature::RSI] == 0.0);
+    CHECK(x[(size_t)OnlineFeature::ATR_PCT] == 0.0);
+    CHECK(std::isfinite(model.update(bad)));
+    CHECK(std::isfinite(model.weight(OnlineFeature::RSI)));
+}
+
+void test_checkpoint_round_trip() {
+    const std::string path = (std::filesystem::temp_directory_path() /
+                              ("online_direction_model_test_" + std::to_string(getpid()) + ".json")).string();
+    OnlineDirectionModel model;
+    Market market{23};
+    for (int i = 0; i < 500; i++) model.update(market.trade(true));
+    CHECK(model.save(path));
+
+    OnlineDirectionModel restored;
+    CHECK(restored.load(path));
+    CHECK(restored.updates() == model.updates());
+    CHECK(restored.score().correct == model.score().correct);
+    for (size_t i = 0; i < OnlineDirectionModel::N; i++)
+        CHECK(restored.weight((OnlineFeature)i) == model.weight((OnlineFeature)i));
+    // Both carry on identically
+    for (int i = 0; i < 100; i++) {
+        TradeRecord t = market.trade(true);
+        CHECK(restored.update(t) == model.update(t));
+    }
+
+    CHECK(!restored.load(path + ".missing"));
+    std::ofstream(path) << "{\"model\": \"something_else\"}";
+    CHECK(!restored.load(path));
+    std::ofstream(path) << "not json";
+    CHECK(!restored.load(path));
+    CHECK(restored.updates() == model.updates());   // A failed load changes nothing
+    std::filesystem::remove(path);
+}
+
+}  // namespace
+
+int main() {
+    test_learns_signal();
+    test_no_signal_stays_uncertain();
+    test_predict_then_learn();
+    test_checkpoint_round_trip();
+    return test_result("online_direction_model_test");
+}
@@ -0,0 +1,229 @@
+#include "optimizer.hpp"
+#include "thread_pool.hpp"
+#include "test_check.hpp"
+#include <sqlite3.h>
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <set>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// run_optimizer: grid decoding and axis parsing, configs that survive
+// pruning match a full run exactly, and results don't depend on the thread
+// count; random search draws distinct, seeded grid points
+
+namespace {
+
+void test_param_space() {
+    ParamAxis a, b, c;
+    std::string error;
+    CHECK(parse_param_axis("take_profit_pct=0.1:0.5:0.1", a, error));
+    CHECK(a.values.size() == 5);   // Rounding keeps the last point
+    CHECK_NEAR(a.values.back(), 0.5, 1e-12);
+    CHECK(parse_param_axis("allow_quiet_regime=true,false", b, error));
+    CHECK((b.values == std::vector<double>{1.0, 0.0}));
+    CHECK(parse_param_axis("leverage=2,5,10", c, error));
+
+    ParamSpace space;
+    CHECK(space.grid_size() == 0);
+    space.axes = {a, b, c};
+    CHECK(space.grid_size() == 30);
+    // First axis slowest: index = (a * 2 + b) * 3 + c
+    std::set<std::vector<double>> seen;
+    for (uint64_t i = 0; i < space.grid_size(); i++) {
+        std::vector<double> p = space.point(i);
+        CHECK(p[0] == a.values[i / 6] && p[1] == b.values[(i / 3) % 2] && p[2] == c.values[i % 3]);
+        seen.insert(p);
+    }
+    CHECK(seen.size() == 30);
+
+    ParamAxis bad;
+    CHECK(!parse_param_axis("leverage", bad, error));
+    CHECK(!parse_param_axis("no_such_param=1,2", bad, error) && error.find("no_such_param") != std::string::npos);
+    CHECK(!parse_param_axis("leverage=5:1:1", bad, error));
+    CHECK(!parse_param_axis("leverage=1:5:0", bad, error));
+    CHECK(!parse_param_axis("leverage=2,x", bad, error));
+
+    ConfigSnapshot snapshot;
+    CHECK(apply_param(snapshot, "leverage", 0.5) && snapshot.bot.leverage == 1.0);   // Floored at 1x
+    CHECK(apply_param(snapshot, "allow_quiet_regime", 1.0) && snapshot.bot.allow_quiet_regime);
+    CHECK(!apply_param(snapshot, "no_such_param", 1.0));
+    for (const std::string& name : known_params()) CHECK(is_known_param(name));
+
+    RankObjective objective;
+    for (RankObjective o : {RankObjective::NET_PNL, RankObjective::PNL_PER_DRAWDOWN, RankObjective::WINDOW_SHARPE,
+                            RankObjective::WIN_RATE}) {
+        CHECK(parse_rank_objective(rank_objective_name(o), objective) && objective == o);
+    }
+    CHECK(!parse_rank_objective("sortino", objective));
+}
+
+// Random walks with slowly changing drift, 5 s ticks, as price_history rows
+TickData make_ticks() {
+    std::string path = (std::filesystem::temp_directory_path() /
+                        ("optimizer_test_" + std::to_string(getpid()) + ".db")).string();
+    std::filesystem::remove(path);
+    sqlite3* db = nullptr;
+    sqlite3_open(path.c_str(), &db);
+    sqlite3_exec(db,
+                 "CREATE TABLE price_history (id INTEGER PRIMARY KEY AUTOINCREMENT, pair TEXT NOT NULL, "
+                 "price REAL NOT NULL, timestamp INTEGER NOT NULL, volume REAL DEFAULT 0, bid REAL, ask REAL); BEGIN",
+                 nullptr, nullptr, nullptr);
+    sqlite3_stmt* stmt = nullptr;
+    sqlite3_prepare_v2(db, "INSERT INTO price_history (pair, price, timestamp, volume, bid, ask) VALUES (?, ?, ?, ?, ?, ?)",
+                       -1, &stmt, nullptr);
+    uint64_t state = 5;
+    auto uniform = [&state] {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return (double)(state >> 11) / (double)(1ULL << 53);
+    };
+    for (const char* pair : {"PI_XBTUSD", "PI_ETHUSD", "PF_SOLUSD"}) {
+        double price = 100.0, drift = 0.0;
+        for (int i = 0; i < 4 * 3600 / 5; i++) {
+            if (i % 200 == 0) drift = (uniform() - 0.5) * 0.0012;
+            price *= 1.0 + drift + 0.002 * (2.0 * uniform() - 1.0);
+            sqlite3_bind_text(stmt, 1, pair, -1, SQLITE_STATIC);
+            sqlite3_bind_double(stmt, 2, price);
+            sqlite3_bind_int64(stmt, 3, 1700000000000LL + i * 5000LL);
+            sqlite3_bind_double(stmt, 4, 1e6);
+            sqlite3_bind_double(stmt, 5, price * 0.9999);
+            sqlite3_bind_double(stmt, 6, price * 1.0001);
+            sqlite3_step(stmt);
+            sqlite3_reset(stmt);
+        }
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_exec(db, "COMMIT", nullptr, nullptr, nullptr);
+    sqlite3_close(db);
+
+    TickData data;
+    CHECK(load_price_history(path, data));
+    std::filesystem::remove(path);
+    return data;
+}
+
+ParamSpace make_space() {
+    ParamSpace space;
+    std::string error;
+    for (const char* spec : {"min_confidence_threshold=0.5:0.75:0.05", "trailing_start_pct=0.2,0.5,1",
+                             "volatile_take_profit_pct=0.3,1.5"}) {
+        ParamAxis axis;
+        CHECK(parse_param_axis(spec, axis, error));
+        space.axes.push_back(axis);
+    }
+    return space;
+}
+
+// Fee filter off (learning mode), so every parameter moves the results
+ConfigSnapshot make_base() {
+    ConfigSnapshot base;
+    base.bot.learning_mode = true;
+    return base;
+}
+
+bool same_result(const ConfigResult& a, const ConfigResult& b) {
+    return a.id == b.id && a.params == b.params && a.pruned == b.pruned && a.pruned_at_rung == b.pruned_at_rung &&
+           a.windows_evaluated == b.windows_evaluated && a.window_pnl == b.window_pnl &&
+           a.stats.trades == b.stats.trades && a.stats.wins == b.stats.wins && a.stats.ticks == b.stats.ticks &&
+           a.stats.net_pnl == b.stats.net_pnl && a.stats.max_drawdown == b.stats.max_drawdown && a.score == b.score;
+}
+
+void test_pruned_run_matches_full_run() {
+    const TickData data = make_ticks();
+    const ParamSpace space = make_space();
+    const ConfigSnapshot base = make_base();
+    OptimizerOptions options;
+    options.backtest.windows = 6;
+    options.top = 3;
+
+    options.rungs = 1;
+    ThreadPool one(1), four(4);
+    OptimizerReport full = run_optimizer(data, base, space, options, one);
+    CHECK(full.grid_size == 36 && full.evaluated == 36 && full.pruned == 0);
+    std::map<uint64_t, ConfigResult> by_id;
+    for (const ConfigResult& r : full.ranked) by_id[r.id] = r;
+    CHECK(by_id.size() == 36);
+    int traded = 0;
+    for (const auto& [id, r] : by_id) traded += r.stats.trades > 0;
+    CHECK(traded == 36);
+    CHECK(full.ranked.front().stats.net_pnl != full.ranked.back().stats.net_pnl);
+    for (size_t i = 1; i < full.ranked.size(); i++) CHECK(full.ranked[i].score <= full.ranked[i - 1].score);
+
+    options.rungs = 3;
+    std::map<uint64_t, int> reported;
+    OptimizerReport pruned = run_optimizer(data, base, space, options, four,
+                                           [&reported](const ConfigResult& r) { reported[r.id]++; });
+    CHECK(pruned.pruned > 0 && pruned.pruned <= 36 - options.top);
+    CHECK(pruned.evaluated == 36);   // Pruned configs were evaluated too, on fewer windows
+    CHECK(pruned.simulated_ticks < full.simulated_ticks);
+    CHECK(reported.size() == 36);
+    for (const auto& [id, count] : reported) CHECK(count == 1);
+
+    bool seen_pruned = false;
+    for (size_t i = 0; i < pruned.ranked.size(); i++) {
+        const ConfigResult& r = pruned.ranked[i];
+        if (r.pruned) {
+            seen_pruned = true;
+            CHECK(r.windows_evaluated < options.backtest.windows);
+            if (i > 0 && pruned.ranked[i - 1].pruned) CHECK(r.pruned_at_rung <= pruned.ranked[i - 1].pruned_at_rung);
+            continue;
+        }
+        // Survivors: finished first, and numbers identical to the full run
+        CHECK(!seen_pruned);
+        const ConfigResult& reference = by_id[r.id];
+        CHECK(r.windows_evaluated == options.backtest.windows);
+        CHECK(r.window_pnl == reference.window_pnl);
+        CHECK(r.stats.trades == reference.stats.trades);
+        CHECK(r.stats.net_pnl == reference.stats.net_pnl);
+        CHECK(r.stats.max_drawdown == reference.stats.max_drawdown);
+    }
+    // The best finished config is the full run's best
+    CHECK(pruned.ranked.front().id == full.ranked.front().id);
+
+    // Same results on one thread
+    OptimizerReport serial = run_optimizer(data, base, space, options, one);
+    CHECK(serial.ranked.size() == pruned.ranked.size());
+    for (size_t i = 0; i < serial.ranked.size() && i < pruned.ranked.size(); i++) {
+        CHECK(same_result(serial.ranked[i], pruned.ranked[i]));
+    }
+}
+
+void test_random_search() {
+    TickData data;   // No ticks: only the sampling is under test
+    ParamSpace space = make_space();
+    OptimizerOptions options;
+    options.random_samples = 10;
+    options.rungs = 1;
+    ThreadPool pool(2);
+
+    auto sampled = [&](uint64_t seed) {
+        options.seed = seed;
+        std::set<uint64_t> ids;
+        for (const ConfigResult& r : run_optimizer(data, make_base(), space, options, pool).ranked) {
+            CHECK(r.id < space.grid_size());
+            CHECK(r.params == space.point(r.id));
+            ids.insert(r.id);
+        }
+        return ids;
+    };
+    std::set<uint64_t> a = sampled(1);
+    CHECK(a.size() == 10);
+    CHECK(sampled(1) == a);
+    CHECK(sampled(2) != a);
+
+    // More samples than grid points: the whole grid, once each
+    options.random_samples = 100;
+    CHECK(sampled(1).size() == 36);
+}
+
+}  // namespace
+
+int main() {
+    test_param_space();
+    test_pruned_run_matches_full_run();
+    test_random_search();
+    return test_result("optimizer_test");
+}
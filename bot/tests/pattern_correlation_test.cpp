@@ -0,0 +1,193 @@
+#include "pattern_correlation.hpp"
+#include "thread_pool.hpp"
+#include "test_check.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// PatternCorrelations: phi over shared hours against brute force, cached
+// rows updated incrementally match a full rebuild, top() and the window
+
+namespace {
+
+using std::chrono::hours;
+using time_point = std::chrono::system_clock::time_point;
+
+const time_point START = time_point(hours(480000));   // Whole hour, 64-bucket aligned
+
+struct Trade {
+    PatternKey key;
+    int hour;
+    bool win;
+};
+
+std::vector<PatternKey> make_keys(size_t count) {
+    std::vector<PatternKey> keys;
+    for (size_t i = 0; i < count; i++) keys.push_back(PatternKey::basic((uint32_t)(i / 2 + 1), i % 2 == 1, 3.0, 1));
+    return keys;
+}
+
+// Patterns trade in ~60% of hours; pattern k follows a shared coin with
+// probability that falls with k, so correlations span strong to none
+std::vector<Trade> make_trades(const std::vector<PatternKey>& keys, int hours_count, uint64_t seed) {
+    uint64_t state = seed;
+    auto uniform = [&state] {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return (double)(state >> 11) / (double)(1ULL << 53);
+    };
+    std::vector<Trade> trades;
+    for (int h = 0; h < hours_count; h++) {
+        bool market_up = uniform() < 0.5;
+        for (size_t k = 0; k < keys.size(); k++) {
+            if (uniform() > 0.6) continue;
+            bool follow = uniform() < 1.0 - (double)k / keys.size();
+            bool win = follow ? (k % 3 == 2 ? !market_up : market_up) : uniform() < 0.5;
+            trades.push_back({keys[k], h, win});
+            if (uniform() < 0.2) trades.push_back({keys[k], h, !win});   // Mixed hour: counts as a win
+        }
+    }
+    return trades;
+}
+
+void add_all(PatternCorrelations& c, const std::vector<Trade>& trades, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) c.add_trade(trades[i].key, START + hours(trades[i].hour), trades[i].win);
+}
+
+double brute_force_phi(const std::vector<Trade>& trades, PatternKey a, PatternKey b) {
+    std::map<int, bool> won_a, won_b;   // hour -> any win that hour
+    for (const Trade& t : trades) {
+        if (t.key == a) won_a[t.hour] = won_a[t.hour] || t.win;
+        if (t.key == b) won_b[t.hour] = won_b[t.hour] || t.win;
+    }
+    double n = 0, x = 0, y = 0, both = 0;
+    for (const auto& [hour, wa] : won_a) {
+        auto it = won_b.find(hour);
+        if (it == won_b.end()) continue;
+        n++;
+        x += wa;
+        y += it->second;
+        both += wa && it->second;
+    }
+    if (n < PatternCorrelations::MIN_SHARED_BUCKETS) return NAN;
+    double den = x * (n - x) * y * (n - y);
+    return den > 0 ? (n * both - x * y) / std::sqrt(den) : NAN;
+}
+
+void test_matches_brute_force() {
+    std::vector<PatternKey> keys = make_keys(8);
+    std::vector<Trade> trades = make_trades(keys, 400, 3);
+    PatternCorrelations c;
+    ThreadPool pool(2);
+    add_all(c, trades, 0, trades.size());
+    c.update(keys, pool);
+    CHECK(c.tracked() == keys.size());
+
+    bool strong = false, weak = false, negative = false;
+    for (PatternKey a : keys) {
+        CHECK(c.correlation(a, a) == 1.0);
+        for (PatternKey b : keys) {
+            if (a == b) continue;
+            double expected = brute_force_phi(trades, a, b);
+            double got = c.correlation(a, b);
+            CHECK(std::isnan(expected) == std::isnan(got));
+            if (!std::isnan(expected)) CHECK_NEAR(got, expected, 1e-6);
+            CHECK(got == c.correlation(b, a) || std::isnan(got));
+            strong |= got > 0.5;
+            weak |= std::abs(got) < 0.1;
+            negative |= got < -0.3;
+        }
+    }
+    // The generator must reach the whole range, or the comparison proves little
+    CHECK(strong && weak && negative);
+
+    PatternKey untracked = PatternKey::basic(99, false, 3.0, 1);
+    CHECK(std::isnan(c.correlation(keys[0], untracked)));
+}
+
+void test_too_few_shared_hours() {
+    PatternCorrelations c;
+    ThreadPool pool(1);
+    std::vector<PatternKey> keys = make_keys(2);
+    for (int h = 0; h < PatternCorrelations::MIN_SHARED_BUCKETS - 1; h++) {
+        c.add_trade(keys[0], START + hours(h), h % 2 == 0);
+        c.add_trade(keys[1], START + hours(h), h % 2 == 0);
+    }
+    c.add_trade(keys[0], START + hours(50), true);   // Not shared
+    c.update(keys, pool);
+    CHECK(std::isnan(c.correlation(keys[0], keys[1])));
+    c.add_trade(keys[0], START + hours(60), false);
+    c.add_trade(keys[1], START + hours(60), false);
+    c.update(keys, pool);
+    CHECK_NEAR(c.correlation(keys[0], keys[1]), 1.0, 1e-6);
+}
+
+void test_incremental_matches_rebuild() {
+    std::vector<PatternKey> keys = make_keys(10);
+    std::vector<Trade> trades = make_trades(keys, 300, 11);
+    ThreadPool one(1), three(3);
+
+    // Trades arrive a few at a time; membership changes part way
+    PatternCorrelations live;
+    std::vector<PatternKey> first(keys.begin(), keys.begin() + 6);
+    size_t step = trades.size() / 7;
+    for (size_t begin = 0; begin < trades.size(); begin += step) {
+        add_all(live, trades, begin, std::min(trades.size(), begin + step));
+        live.update(begin < trades.size() / 2 ? first : keys, three);
+    }
+
+    PatternCorrelations rebuilt;
+    add_all(rebuilt, trades, 0, trades.size());
+    rebuilt.update(keys, one);
+    for (PatternKey a : keys) {
+        for (PatternKey b : keys) {
+            double x = live.correlation(a, b), y = rebuilt.correlation(a, b);
+            CHECK((std::isnan(x) && std::isnan(y)) || x == y);
+        }
+    }
+
+    std::vector<PatternCorrelations::Entry> top = rebuilt.top(5, 0.2);
+    CHECK(!top.empty() && top.size() <= 5);
+    for (size_t i = 0; i < top.size(); i++) {
+        CHECK(std::abs(top[i].correlation) >= 0.2);
+        CHECK(top[i].correlation == rebuilt.correlation(top[i].a, top[i].b));
+        if (i > 0) CHECK(std::abs(top[i].correlation) <= std::abs(top[i - 1].correlation));
+    }
+    CHECK(rebuilt.top(100, 2.0).empty());
+}
+
+void test_window_slides() {
+    PatternCorrelations c;
+    ThreadPool pool(1);
+    std::vector<PatternKey> keys = make_keys(2);
+    for (int h = 0; h < 20; h++) {
+        c.add_trade(keys[0], START + hours(h), h % 3 == 0);
+        c.add_trade(keys[1], START + hours(h), h % 3 == 0);
+    }
+    c.update(keys, pool);
+    CHECK_NEAR(c.correlation(keys[0], keys[1]), 1.0, 1e-6);
+
+    // A trade a full window later pushes every shared hour out
+    c.add_trade(keys[0], START + hours((int)PatternCorrelations::WINDOW_BUCKETS + 64), true);
+    c.update(keys, pool);
+    CHECK(std::isnan(c.correlation(keys[0], keys[1])));
+    // Trades older than the window are ignored
+    for (int h = 0; h < 20; h++) c.add_trade(keys[1], START + hours(h), true);
+    c.update(keys, pool);
+    CHECK(std::isnan(c.correlation(keys[0], keys[1])));
+
+    c.clear();
+    CHECK(c.tracked() == 0);
+    CHECK(std::isnan(c.correlation(keys[0], keys[1])));
+}
+
+}  // namespace
+
+int main() {
+    test_matches_brute_force();
+    test_too_few_shared_hours();
+    test_incremental_matches_rebuild();
+    test_window_slides();
+    return test_result("pattern_correlation_test");
+}
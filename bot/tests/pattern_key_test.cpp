@@ -0,0 +1,140 @@
+#include "pattern_key.hpp"
+#include "flat_hash_map.hpp"
+#include "test_check.hpp"
+#include <set>
+#include <unordered_map>
+
+// PatternKey packing round trip and FlatHashMap against std::unordered_map
+
+namespace {
+
+void test_pack_round_trip() {
+    std::set<uint64_t> seen;
+    size_t keys = 0;
+    for (uint32_t pair : {1u, 2u, 77u, 0xFFFFFFFFu}) {
+        for (bool is_short : {false, true}) {
+            for (double leverage : {1.0, 3.0, 50.0, 255.0}) {
+                for (int tf = 0; tf < 4; tf++) {
+                    PatternKey basic = PatternKey::basic(pair, is_short, leverage, tf);
+                    CHECK(basic.pair_id() == pair);
+                    CHECK(basic.is_short() == is_short);
+                    CHECK(basic.leverage() == (int)leverage);
+                    CHECK(basic.timeframe_bucket() == tf);
+                    CHECK(!basic.is_enhanced());
+                    CHECK(basic.basic_key() == basic);
+                    seen.insert(basic.bits);
+                    keys++;
+                    for (int vol = 0; vol < 4; vol++) {
+                        for (int regime = 0; regime < 5; regime++) {
+                            PatternKey key = PatternKey::enhanced(pair, is_short, leverage, tf, vol, regime);
+                            CHECK(key.pair_id() == pair);
+                            CHECK(key.is_short() == is_short);
+                            CHECK(key.leverage() == (int)leverage);
+                            CHECK(key.timeframe_bucket() == tf);
+                            CHECK(key.volatility_bucket() == vol);
+                            CHECK(key.regime_code() == regime);
+                            CHECK(key.is_enhanced());
+                            CHECK(key.basic_key() == basic);
+                            seen.insert(key.bits);
+                            keys++;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    // Every field combination packs to its own key
+    CHECK(seen.size() == keys);
+    CHECK(!seen.count(0));
+}
+
+void test_clamping() {
+    CHECK(PatternKey::basic(1, false, 400.0, 0).leverage() == 255);
+    CHECK(PatternKey::basic(1, false, -2.0, 0).leverage() == 0);
+    CHECK(PatternKey::basic(1, false, 2.9, 0).leverage() == 2);
+    // Out-of-range fields never spill into their neighbours
+    PatternKey key = PatternKey::basic(5, true, 1000.0, 99);
+    CHECK(key.pair_id() == 5);
+    CHECK(key.is_short());
+    CHECK(key.timeframe_bucket() == 7);
+    CHECK(!key.is_enhanced());
+}
+
+void test_to_string() {
+    PairRegistry pairs;
+    uint32_t xbt = pairs.intern("PI_XBTUSD");
+    CHECK(pairs.intern("PI_ETHUSD") == xbt + 1);
+    CHECK(pairs.intern("PI_XBTUSD") == xbt);
+    CHECK(pairs.find("PI_SOLUSD") == 0);
+    CHECK(pairs.name(0) == "UNKNOWN");
+
+    CHECK(PatternKey::basic(xbt, false, 3.0, 2).to_string(pairs) == "PI_XBTUSD_LONG_3x_2");
+    CHECK(PatternKey::enhanced(xbt, false, 3.0, 2, 1, 2).to_string(pairs) == "PI_XBTUSD_LONG_3x_2_V1_T");
+    CHECK(PatternKey::enhanced(xbt + 1, true, 10.0, 0, 3, 4).to_string(pairs) == "PI_ETHUSD_SHORT_10x_0_V3_U");
+}
+
+void test_buckets() {
+    CHECK(PatternKey::volatility_bucket_for(0.5) == 0);
+    CHECK(PatternKey::volatility_bucket_for(2.0) == 1);
+    CHECK(PatternKey::volatility_bucket_for(7.5) == 2);
+    CHECK(PatternKey::volatility_bucket_for(25.0) == 3);
+    // Persisted regime codes: -2 quiet, 0 ranging, +/-1 trending, 2 volatile
+    CHECK(PatternKey::regime_code_for(-2) == 0);
+    CHECK(PatternKey::regime_code_for(0) == 1);
+    CHECK(PatternKey::regime_code_for(1) == 2);
+    CHECK(PatternKey::regime_code_for(-1) == 2);
+    CHECK(PatternKey::regime_code_for(2) == 3);
+    CHECK(PatternKey::regime_code_for(9) == 4);
+}
+
+void test_flat_hash_map() {
+    FlatHashMap<int> table;
+    std::unordered_map<uint64_t, int> reference;
+    CHECK(table.find(42) == nullptr);
+
+    // Packed keys (through several rehashes) plus a dense run of small ones
+    uint64_t state = 7;
+    for (int i = 0; i < 5000; i++) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        uint64_t key = i % 3 == 0 ? (uint64_t)(i / 3 + 1) : (state | 1);
+        auto [value, inserted] = table.try_emplace(key);
+        CHECK(inserted == !reference.count(key));
+        *value += i;
+        reference[key] += i;
+    }
+    CHECK(table.size() == reference.size());
+    for (const auto& [key, value] : reference) {
+        const int* found = table.find(key);
+        CHECK(found && *found == value);
+    }
+    CHECK(table.find(0xdeadbeefULL << 1) == nullptr);
+
+    size_t visited = 0;
+    for (const auto& [key, value] : table) {
+        CHECK(key != 0);
+        auto it = reference.find(key);
+        CHECK(it != reference.end() && it->second == value);
+        visited++;
+    }
+    CHECK(visited == reference.size());
+
+    table.reserve(100000);
+    CHECK(table.size() == reference.size());
+    CHECK(table.contains(1));
+    table.clear();
+    CHECK(table.empty());
+    CHECK(!table.contains(1));
+    table[3] = 9;
+    CHECK(table.size() == 1 && *table.find(3) == 9);
+}
+
+}  // namespace
+
+int main() {
+    test_pack_round_trip();
+    test_clamping();
+    test_to_string();
+    test_buckets();
+    test_flat_hash_map();
+    return test_result("pattern_key_test");
+}
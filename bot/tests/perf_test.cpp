@@ -0,0 +1,189 @@
+#include "perf.hpp"
+#include "test_check.hpp"
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// Perf suite: regression limits per metric, the session manifest, and a
+// session run against a stand-in bot (medians, pinned cwd, clean env)
+
+namespace {
+
+namespace fs = std::filesystem;
+
+fs::path scratch_dir() {
+    fs::path dir = fs::temp_directory_path() / ("perf_test_" + std::to_string(getpid()));
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    return dir;
+}
+
+void write_file(const fs::path& path, const std::string& content) {
+    std::ofstream(path) << content;
+}
+
+const PerfCheck* find_check(const std::vector<PerfCheck>& checks, const std::string& metric) {
+    for (const PerfCheck& c : checks) {
+        if (c.metric == metric) return &c;
+    }
+    return nullptr;
+}
+
+void test_compare() {
+    PerfSample baseline;
+    baseline.ticks_per_second = 1000.0;
+    baseline.allocations = 10000;
+    baseline.allocated_bytes = 0;   // Not measured: no check
+    baseline.peak_rss_kb = 50000;
+    baseline.stages = {{"SCAN_PAIR", {{"mean_us", 40.0}, {"p99_us", 400.0}, {"max_us", 900.0}}},
+                       {"GONE", {{"mean_us", 10.0}}}};
+
+    PerfSample measured = baseline;
+    measured.ticks_per_second = 760.0;   // -24%: within 25%
+    measured.allocations = 10600;        // +6%: over 5%
+    measured.allocated_bytes = 99999;
+    measured.peak_rss_kb = 59000;
+    measured.stages = {{"SCAN_PAIR", {{"mean_us", 85.0}, {"p99_us", 620.0}, {"max_us", 5000.0}}}};
+
+    PerfTolerances tolerances;
+    std::vector<PerfCheck> checks = compare_perf_sample("s", measured, baseline, tolerances);
+    CHECK(checks.size() == 5);
+    CHECK(!find_check(checks, "allocated_bytes"));
+    CHECK(!find_check(checks, "stages.GONE.mean_us"));   // Stage not in the run
+    CHECK(!find_check(checks, "stages.SCAN_PAIR.max_us"));   // Reported only
+
+    const PerfCheck* tps = find_check(checks, "ticks_per_second");
+    CHECK(tps && !tps->regression && tps->limit == 750.0 && tps->session == "s");
+    CHECK(perf_check_json(*tps)["limit"] == 750.0);
+    const PerfCheck* allocs = find_check(checks, "allocations");
+    CHECK(allocs && allocs->regression);
+    CHECK_NEAR(allocs->limit, 10500.0, 1e-9);
+    CHECK(!find_check(checks, "peak_rss_kb")->regression);
+    // Cheap stage: +112% but within the 50 us floor
+    const PerfCheck* mean = find_check(checks, "stages.SCAN_PAIR.mean_us");
+    CHECK(mean && !mean->regression && mean->limit == 90.0);
+    // Expensive stage: the relative tolerance decides
+    const PerfCheck* p99 = find_check(checks, "stages.SCAN_PAIR.p99_us");
+    CHECK(p99 && p99->regression && p99->limit == 600.0);
+
+    measured.ticks_per_second = 740.0;
+    CHECK(find_check(compare_perf_sample("s", measured, baseline, tolerances), "ticks_per_second")->regression);
+
+    // Tolerances by name, from the baseline file or flags
+    CHECK(tolerances.set("allocations", 0.1));
+    CHECK(!tolerances.set("latency", 0.1));
+    tolerances.merge({{"stage", 0.6}, {"stage_floor_us", "x"}, {"peak_rss_kb", 0.05}});
+    CHECK(tolerances.stage == 0.6 && tolerances.stage_floor_us == 50.0 && tolerances.peak_rss_kb == 0.05);
+    PerfTolerances copy;
+    copy.merge(tolerances.to_json());
+    CHECK(copy.to_json() == tolerances.to_json());
+    checks = compare_perf_sample("s", measured, baseline, tolerances);
+    CHECK(!find_check(checks, "allocations")->regression);
+    CHECK(find_check(checks, "peak_rss_kb")->regression);
+    CHECK(!find_check(checks, "stages.SCAN_PAIR.p99_us")->regression);
+
+    PerfSample parsed = perf_sample_from_json(perf_sample_json(measured));
+    CHECK(perf_sample_json(parsed) == perf_sample_json(measured));
+}
+
+void test_load_sessions() {
+    const fs::path dir = scratch_dir();
+    fs::create_directories(dir / "run");
+    write_file(dir / "bot_config.json", "{}");
+    write_file(dir / "ok.json", R"({"sessions": [
+        {"name": "cap", "capture": "sessions/a.kcap", "cwd": "run"},
+        {"name": "tick", "ticks": "/data/t.db", "config": "bot_config.json", "cwd": "run/../run"}]})");
+
+    std::vector<PerfSession> sessions;
+    std::string error;
+    CHECK(load_perf_sessions((dir / "ok.json").string(), sessions, error));
+    CHECK(sessions.size() == 2);
+    if (sessions.size() == 2) {
+        CHECK(sessions[0].capture == (dir / "sessions/a.kcap").string());
+        CHECK(sessions[0].ticks.empty() && sessions[0].config.empty());
+        CHECK(sessions[0].cwd == (dir / "run").string());
+        CHECK(sessions[1].ticks == "/data/t.db");
+        CHECK(sessions[1].config == (dir / "bot_config.json").string());
+        CHECK(sessions[1].cwd == (dir / "run").string());
+    }
+
+    const std::vector<std::string> bad = {
+        R"({"runs": []})",
+        R"({"sessions": [{"capture": "a.kcap", "cwd": "run"}]})",
+        R"({"sessions": [{"name": "x", "capture": "a.kcap", "ticks": "t.db", "cwd": "run"}]})",
+        R"({"sessions": [{"name": "x", "capture": "a.kcap"}]})",
+        R"({"sessions": [{"name": "x", "ticks": "t.db", "cwd": "run"}]})",
+        R"({"sessions": [{"name": "x", "capture": "a.kcap", "cwd": "missing"}]})",
+        R"({"sessions": [{"name": "x", "ticks": "t.db", "config": "missing.json", "cwd": "run"}]})",
+    };
+    for (const std::string& manifest : bad) {
+        write_file(dir / "bad.json", manifest);
+        std::vector<PerfSession> none;
+        error.clear();
+        CHECK(!load_perf_sessions((dir / "bad.json").string(), none, error));
+        CHECK(!error.empty());
+    }
+    CHECK(!load_perf_sessions((dir / "absent.json").string(), sessions, error));
+    fs::remove_all(dir);
+}
+
+void test_run_session() {
+    const fs::path dir = scratch_dir();
+    fs::create_directories(dir / "run");
+    fs::create_directories(dir / "work");
+    // Stand-in bot: run k of the session reports k allocations; it fails
+    // unless started in the session's cwd with the overrides unset
+    const fs::path bot = dir / "fake_bot.sh";
+    write_file(bot, R"sh(#!/bin/sh
+[ "$(pwd)" = ")sh" + (dir / "run").string() + R"sh(" ] || exit 3
+[ -z "$TRADES_DB" ] || exit 4
+while [ $# -gt 0 ]; do [ "$1" = "--perf-report" ] && report="$2"; shift; done
+n=$(($(cat runs 2>/dev/null || echo 0) + 1))
+echo $n > runs
+echo "{\"ticks\": 100, \"ticks_per_second\": $((n * 10)), \"allocations\": $n, \"scans\": 7, \"stages\": {\"SCAN_PAIR\": {\"mean_us\": $n, \"p99_us\": 9}}}" > "$report"
+)sh");
+    fs::permissions(bot, fs::perms::owner_all);
+    setenv("TRADES_DB", "/elsewhere/trades.db", 1);
+
+    PerfSession session;
+    session.name = "fake";
+    session.capture = (dir / "a.kcap").string();
+    session.cwd = (dir / "run").string();
+    PerfRunOptions options;
+    options.bot_path = bot.string();
+    options.work_dir = (dir / "work").string();
+    options.warmup = 1;
+    options.repeat = 4;
+
+    PerfSample sample;
+    std::string error;
+    CHECK(run_perf_session(session, options, sample, error));
+    CHECK(error.empty());
+    // Measured runs 2..5: median 3.5; the warm-up run is dropped
+    CHECK(sample.allocations == 3);
+    CHECK(sample.ticks_per_second == 35.0);
+    CHECK(sample.ticks == 100 && sample.scans == 7 && !sample.diverged);
+    CHECK(sample.stages["SCAN_PAIR"]["mean_us"] == 3.5);
+    CHECK(sample.peak_rss_kb > 0);
+    CHECK(fs::is_empty(dir / "work"));   // Logs and reports removed
+
+    // A child that exits without a report is an error, not a sample
+    write_file(bot, "#!/bin/sh\nexit 2\n");
+    fs::permissions(bot, fs::perms::owner_all);
+    CHECK(!run_perf_session(session, options, sample, error));
+    CHECK(error.find("no perf report") != std::string::npos);
+    unsetenv("TRADES_DB");
+    fs::remove_all(dir);
+}
+
+}  // namespace
+
+int main() {
+    test_compare();
+    test_load_sessions();
+    test_run_session();
+    return test_result("perf_test");
+}
@@ -0,0 +1,126 @@
+#include "position_path.hpp"
+#include "counterfactual.hpp"
+#include "test_check.hpp"
+#include <cmath>
+#include <vector>
+
+// PositionPath::compress / decode_price_path round trip, slot downsampling,
+// MFE/MAE and rejection of malformed bytes
+
+namespace {
+
+double favorable_pct(bool is_short, double price, double entry) {
+    double move = (price / entry - 1.0) * 100.0;
+    return is_short ? -move : move;
+}
+
+void test_round_trip(bool is_short) {
+    const double entry = 250.0;
+    std::vector<double> prices = {250.0, 251.3, 249.1, 247.75, 252.6, 250.02, 255.0, 244.4};
+    PositionPath path(is_short, entry);
+    CHECK(path.compress().empty());
+    for (size_t k = 0; k < prices.size(); k++) path.on_price(prices[k], (long)(k + 1) * 5);
+    CHECK(path.size() == prices.size());
+    CHECK(path.observations() == (int)prices.size());
+
+    std::vector<uint8_t> bytes = path.compress();
+    PricePath decoded;
+    CHECK(decode_price_path(bytes.data(), bytes.size(), is_short, decoded));
+    CHECK(decoded.is_short == is_short);
+    CHECK(decoded.size() == prices.size());
+    if (decoded.size() != prices.size()) return;
+    for (size_t k = 0; k < prices.size(); k++) {
+        CHECK(decoded.elapsed_s[k] == (int32_t)(k + 1) * 5);
+        // Stored in whole basis points: within half a bp of the real move
+        CHECK_NEAR(decoded.move_pct[k], favorable_pct(is_short, prices[k], entry), 0.005 + 1e-6);
+    }
+
+    // MFE / MAE come from the unquantized prices, in the trade's favor
+    double best = 0.0, worst = 0.0;
+    int best_bar = 0, worst_bar = 0;
+    for (size_t k = 0; k < prices.size(); k++) {
+        double r = favorable_pct(is_short, prices[k], entry);
+        if (r > best) { best = r; best_bar = (int)k + 1; }
+        if (r < worst) { worst = r; worst_bar = (int)k + 1; }
+    }
+    CHECK_NEAR(path.max_profit_pct(), best, 1e-12);
+    CHECK_NEAR(path.max_loss_pct(), worst, 1e-12);
+    CHECK(path.bars_high() == best_bar);
+    CHECK(path.bars_low() == worst_bar);
+}
+
+void test_long_hold_downsamples() {
+    const double entry = 100.0;
+    const int observations = (int)PathPool::SLOT_SAMPLES * 3 + 7;
+    PositionPath path(false, entry);
+    for (int k = 1; k <= observations; k++) path.on_price(entry * (1.0 + 0.01 * std::sin(k * 0.01)), k * 5L);
+
+    CHECK(path.observations() == observations);
+    CHECK(path.size() <= PathPool::SLOT_SAMPLES + 1);
+    CHECK(path.size() > PathPool::SLOT_SAMPLES / 2);
+
+    std::vector<uint8_t> bytes = path.compress();
+    PricePath decoded;
+    CHECK(decode_price_path(bytes.data(), bytes.size(), false, decoded));
+    CHECK(decoded.size() == path.size());
+    if (decoded.size() == 0) return;
+    CHECK(decoded.elapsed_s.front() == 5);
+    for (size_t k = 1; k < decoded.size(); k++) CHECK(decoded.elapsed_s[k] > decoded.elapsed_s[k - 1]);
+    // The path always ends at the last observation (the exit price)
+    CHECK(decoded.elapsed_s.back() == observations * 5);
+    CHECK_NEAR(decoded.move_pct.back(), std::sin(observations * 0.01), 0.005 + 1e-6);
+}
+
+void test_elapsed_saturates() {
+    PositionPath path(false, 100.0);
+    path.on_price(101.0, 10);
+    path.on_price(102.0, 100000);   // Past uint16_t seconds
+    std::vector<uint8_t> bytes = path.compress();
+    PricePath decoded;
+    CHECK(decode_price_path(bytes.data(), bytes.size(), false, decoded));
+    CHECK(decoded.size() == 2);
+    if (decoded.size() == 2) CHECK(decoded.elapsed_s[1] == UINT16_MAX);
+}
+
+void test_rejects_malformed() {
+    PositionPath path(true, 100.0);
+    for (int k = 1; k <= 20; k++) path.on_price(100.0 + k * 0.37, k * 5L);
+    std::vector<uint8_t> bytes = path.compress();
+    PricePath decoded;
+
+    CHECK(!decode_price_path(bytes.data(), 0, true, decoded));
+    CHECK(decoded.size() == 0);
+
+    std::vector<uint8_t> wrong_format = bytes;
+    wrong_format[0] ^= 0xff;
+    CHECK(!decode_price_path(wrong_format.data(), wrong_format.size(), true, decoded));
+    CHECK(decoded.size() == 0);
+
+    CHECK(!decode_price_path(bytes.data(), bytes.size() - 1, true, decoded));   // Truncated
+    CHECK(decoded.size() == 0);
+    CHECK(decoded.elapsed_s.empty());
+}
+
+void test_pool_slots_returned() {
+    size_t before = PathPool::instance().in_use();
+    {
+        std::vector<std::unique_ptr<PositionPath>> open;
+        for (size_t i = 0; i < PathPool::SLAB_SLOTS * 2 + 1; i++)
+            open.push_back(std::make_unique<PositionPath>(false, 1.0));
+        CHECK(PathPool::instance().in_use() == before + PathPool::SLAB_SLOTS * 2 + 1);
+        CHECK(PathPool::instance().capacity() >= PathPool::instance().in_use());
+    }
+    CHECK(PathPool::instance().in_use() == before);
+}
+
+}  // namespace
+
+int main() {
+    test_round_trip(false);
+    test_round_trip(true);
+    test_long_hold_downsamples();
+    test_elapsed_saturates();
+    test_rejects_malformed();
+    test_pool_slots_returned();
+    return test_result("position_path_test");
+}
@@ -0,0 +1,160 @@
+#include "regime_engine.hpp"
+#include "test_check.hpp"
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+// RegimeFilter / RegimeEngine: each regime recognized on a synthetic series,
+// posterior normalized, one odd tick absorbed, per-pair counts
+
+namespace {
+
+struct Prices {
+    uint64_t state;
+    double price = 100.0;
+    double normal() {
+        auto uniform = [this] {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            return std::max((double)(state >> 11) / (double)(1ULL << 53), 1e-300);
+        };
+        double u = uniform();
+        return std::sqrt(-2.0 * std::log(u)) * std::cos(6.283185307179586 * uniform());
+    }
+    // drift and noise per observation, as fractions of the price
+    double next(double drift, double noise) {
+        price *= 1.0 + drift + noise * normal();
+        return price;
+    }
+};
+
+RegimeEstimate run(RegimeFilter& filter, Prices& prices, int steps, double drift, double noise, double volatility_pct) {
+    RegimeEstimate last;
+    for (int i = 0; i < steps; i++) last = filter.update(prices.next(drift, noise), volatility_pct);
+    return last;
+}
+
+void check_posterior(const RegimeEstimate& e) {
+    double sum = 0.0;
+    MarketRegime best = MarketRegime::QUIET;
+    for (size_t r = 0; r < REGIME_COUNT; r++) {
+        CHECK(e.probability[r] >= 0.0f);
+        sum += e.probability[r];
+        if (e.probability[r] > e.probability[(size_t)best]) best = (MarketRegime)r;
+    }
+    CHECK_NEAR(sum, 1.0, 1e-5);
+    CHECK(e.regime == best);
+}
+
+void test_codes() {
+    for (MarketRegime r : {MarketRegime::QUIET, MarketRegime::RANGING, MarketRegime::TRENDING, MarketRegime::VOLATILE}) {
+        CHECK(regime_from_code(regime_code(r, true)) == r);
+        CHECK(regime_from_code(regime_code(r, false)) == r);
+    }
+    CHECK(regime_code(MarketRegime::QUIET, true) == -2);
+    CHECK(regime_code(MarketRegime::TRENDING, true) == 1);
+    CHECK(regime_code(MarketRegime::TRENDING, false) == -1);
+    CHECK(regime_code(MarketRegime::VOLATILE, false) == 2);
+    CHECK(regime_from_code(7) == MarketRegime::RANGING);
+    CHECK(regime_to_string(MarketRegime::VOLATILE) == "VOLATILE");
+}
+
+void test_classifies_series() {
+    {
+        RegimeFilter filter;
+        CHECK(filter.estimate().observations == 0);
+        Prices prices{1};
+        RegimeEstimate e = run(filter, prices, 200, 0.0, 0.00002, 0.002);
+        CHECK(e.regime == MarketRegime::QUIET);
+        CHECK(e.observations == 200);
+        check_posterior(e);
+    }
+    {
+        RegimeFilter filter;
+        Prices prices{2};
+        RegimeEstimate e = run(filter, prices, 200, 0.0, 0.0005, 0.08);
+        CHECK(e.regime == MarketRegime::VOLATILE);
+        check_posterior(e);
+    }
+    {
+        RegimeFilter filter;
+        Prices prices{3};
+        RegimeEstimate e = run(filter, prices, 200, 0.0, 0.0001, 0.01);
+        CHECK(e.regime == MarketRegime::RANGING);
+        check_posterior(e);
+    }
+    for (double drift : {0.0002, -0.0002}) {
+        RegimeFilter filter;
+        Prices prices{4};
+        RegimeEstimate e = run(filter, prices, 200, drift, 0.0001, 0.01);
+        CHECK(e.regime == MarketRegime::TRENDING);
+        CHECK(e.trend_up() == (drift > 0));
+        CHECK(std::abs(e.trend) > 1.8f);
+        CHECK(regime_code(e.regime, e.trend_up()) == (drift > 0 ? 1 : -1));
+        check_posterior(e);
+    }
+}
+
+void test_estimates_volatility_from_prices() {
+    // No volatility passed: the filter's own estimate from the returns
+    RegimeFilter quiet, wild;
+    Prices a{5}, b{6};
+    CHECK(run(quiet, a, 300, 0.0, 0.00001, 0.0).regime == MarketRegime::QUIET);
+    CHECK(run(wild, b, 300, 0.0, 0.003, 0.0).regime == MarketRegime::VOLATILE);
+}
+
+void test_one_tick_does_not_flip() {
+    RegimeFilter filter;
+    Prices prices{7};
+    run(filter, prices, 300, 0.0, 0.00002, 0.0025);
+    CHECK(filter.estimate().regime == MarketRegime::QUIET);
+    // Past the 0.005% QUIET/RANGING boundary, but only once
+    filter.update(prices.next(0.0, 0.00002), 0.007);
+    CHECK(filter.estimate().regime == MarketRegime::QUIET);
+    // A sustained change does get through
+    RegimeEstimate e = run(filter, prices, 30, 0.0, 0.00002, 0.007);
+    CHECK(e.regime == MarketRegime::RANGING);
+}
+
+void test_engine_pair_counts() {
+    RegimeEngine engine;
+    engine.reserve(8);
+    CHECK(engine.estimate("XBTUSD").observations == 0);
+    const std::vector<std::string> quiet = {"Q1", "Q2", "Q3"};
+    const std::vector<std::string> volatile_pairs = {"V1", "V2"};
+    std::vector<std::thread> threads;
+    // One feeder per pair, as from the scan threads
+    for (size_t i = 0; i < quiet.size(); i++) {
+        threads.emplace_back([&engine, &quiet, i] {
+            Prices prices{10 + i};
+            for (int k = 0; k < 200; k++) engine.update(quiet[i], prices.next(0.0, 0.00002), 0.002);
+        });
+    }
+    for (size_t i = 0; i < volatile_pairs.size(); i++) {
+        threads.emplace_back([&engine, &volatile_pairs, i] {
+            Prices prices{20 + i};
+            for (int k = 0; k < 200; k++) engine.update(volatile_pairs[i], prices.next(0.0, 0.0005), 0.08);
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    auto counts = engine.pair_counts();
+    CHECK(counts[(size_t)MarketRegime::QUIET] == 3);
+    CHECK(counts[(size_t)MarketRegime::VOLATILE] == 2);
+    CHECK(counts[(size_t)MarketRegime::RANGING] == 0);
+    CHECK(counts[(size_t)MarketRegime::TRENDING] == 0);
+    CHECK(engine.estimate("Q2").observations == 200);
+    CHECK(engine.estimate("V1").regime == MarketRegime::VOLATILE);
+}
+
+}  // namespace
+
+int main() {
+    test_codes();
+    test_classifies_series();
+    test_estimates_volatility_from_prices();
+    test_one_tick_does_not_flip();
+    test_engine_pair_counts();
+    return test_result("regime_engine_test");
+}
@@ -0,0 +1,129 @@
+#include "strategy_ensemble.hpp"
+#include "thread_pool.hpp"
+#include "test_check.hpp"
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+// Bagged strategy scores: independent of the thread count, bootstrap mean and
+// variance near the analytic values, bounded replicates, and mean / variance
+// ensemble weights
+
+namespace {
+
+std::vector<double> make_sample(size_t count, double mean, double spread, uint64_t seed) {
+    uint64_t state = seed;
+    std::vector<double> sample;
+    for (size_t i = 0; i < count; i++) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        double u = (double)(state >> 11) / (double)(1ULL << 53);
+        sample.push_back(mean + spread * (2.0 * u - 1.0));
+    }
+    return sample;
+}
+
+bool same_score(const BaggedScore& a, const BaggedScore& b) {
+    return a.sample_size == b.sample_size && a.replicates == b.replicates && a.mean == b.mean &&
+           a.variance == b.variance;
+}
+
+void test_independent_of_threads() {
+    std::vector<std::vector<double>> owned;
+    std::vector<const std::vector<double>*> samples;
+    std::vector<uint64_t> seeds;
+    for (size_t i = 0; i < 12; i++) owned.push_back(make_sample(20 + i * 37, 0.1 * i - 0.4, 2.0, i + 1));
+    for (size_t i = 0; i < owned.size(); i++) {
+        samples.push_back(&owned[i]);
+        seeds.push_back(1000 + i);
+    }
+    BaggingOptions options;
+    ThreadPool one(1), four(4);
+    std::vector<BaggedScore> a = bag_sample_means(samples, seeds, options, one);
+    std::vector<BaggedScore> b = bag_sample_means(samples, seeds, options, four);
+    CHECK(a.size() == samples.size());
+    for (size_t i = 0; i < a.size(); i++) CHECK(same_score(a[i], b[i]));
+
+    seeds[0]++;
+    std::vector<BaggedScore> c = bag_sample_means(samples, seeds, options, four);
+    CHECK(!same_score(a[0], c[0]));
+    CHECK(same_score(a[1], c[1]));
+}
+
+void test_bootstrap_statistics() {
+    ThreadPool pool(2);
+    BaggingOptions options;
+    std::vector<double> sample = make_sample(200, 0.3, 1.5, 7);
+    const double n = (double)sample.size();
+    const double mean = std::accumulate(sample.begin(), sample.end(), 0.0) / n;
+    double var = 0.0;
+    for (double x : sample) var += (x - mean) * (x - mean);
+    var /= n;
+
+    // Many replicates for a tight check of the bootstrap moments
+    options.max_draws = 200 * 4000;
+    options.max_replicates = 4000;
+    BaggedScore s = bag_sample_means({&sample}, {3}, options, pool)[0];
+    CHECK(s.sample_size == 200 && s.replicates == 4000);
+    // Replicate means: mean of the sample, variance of the sample / n
+    CHECK_NEAR(s.mean, mean, 4.0 * std::sqrt(var / n / s.replicates));
+    CHECK_NEAR(s.variance, var / n, 0.1 * var / n);
+
+    std::vector<double> flat(50, 0.8);
+    BaggedScore f = bag_sample_means({&flat}, {3}, BaggingOptions{}, pool)[0];
+    CHECK_NEAR(f.mean, 0.8, 1e-12);
+    CHECK(f.variance < 1e-20);
+}
+
+void test_replicate_budget() {
+    ThreadPool pool(1);
+    BaggingOptions options;   // 65536 draws, 32..256 replicates
+    std::vector<double> empty, small = make_sample(10, 0.0, 1.0, 1), mid = make_sample(1000, 0.0, 1.0, 2),
+                               large = make_sample(5000, 0.0, 1.0, 3);
+    std::vector<BaggedScore> s = bag_sample_means({&empty, &small, &mid, &large}, {1, 2, 3, 4}, options, pool);
+    CHECK(s[0].sample_size == 0 && s[0].replicates == 0 && s[0].mean == 0.0);
+    CHECK(s[1].replicates == 256);
+    CHECK(s[2].replicates == 65);
+    CHECK(s[3].replicates == 32);
+}
+
+void test_weights() {
+    BaggingOptions options;
+    auto score = [](uint32_t n, double mean, double variance) {
+        BaggedScore s;
+        s.sample_size = n;
+        s.replicates = 100;
+        s.mean = mean;
+        s.variance = variance;
+        return s;
+    };
+    std::vector<BaggedScore> scores = {
+        score(40, 0.5, 0.01),    // Steady
+        score(40, 0.5, 0.04),    // Same edge, noisier
+        score(40, -0.2, 0.01),   // No edge
+        score(4, 2.0, 0.01),     // Too few trades
+        score(40, 0.3, 0.0),     // Identical returns: variance floored
+    };
+    std::vector<double> w = ensemble_weights(scores, options);
+    CHECK(w.size() == scores.size());
+    CHECK_NEAR(std::accumulate(w.begin(), w.end(), 0.0), 1.0, 1e-12);
+    CHECK(w[2] == 0.0 && w[3] == 0.0);
+    CHECK_NEAR(w[0], 4.0 * w[1], 1e-12);
+    CHECK(w[4] > w[0]);
+    const double total = 0.5 / 0.01 + 0.5 / 0.04 + 0.3 / 1e-4;
+    CHECK_NEAR(w[4], (0.3 / 1e-4) / total, 1e-12);
+
+    std::vector<double> none = ensemble_weights({score(40, -0.1, 0.01), score(40, 0.0, 0.01)}, options);
+    CHECK(none[0] == 0.0 && none[1] == 0.0);
+    CHECK(ensemble_weights({}, options).empty());
+}
+
+}  // namespace
+
+int main() {
+    test_independent_of_threads();
+    test_bootstrap_statistics();
+    test_replicate_budget();
+    test_weights();
+    return test_result("strategy_ensemble_test");
+}
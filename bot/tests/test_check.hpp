@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cmath>
+#include <iostream>
+
+/*
+ * MINIMAL TEST HARNESS
+ *
+ * Each test is a plain executable registered with ctest. CHECK / CHECK_NEAR
+ * log a failure with its location and keep going, so one run reports every
+ * broken expectation; main() returns test_result(), non-zero on any failure.
+ */
+
+inline int& test_failures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(cond)                                                                       \
+    do {                                                                                  \
+        if (!(cond)) {                                                                    \
+            std::cerr << "❌ " << __FILE__ << ":" << __LINE__ << ": CHECK(" #cond ")" << std::endl; \
+            test_failures()++;                                                            \
+        }                                                                                 \
+    } while (0)
+
+#define CHECK_NEAR(a, b, tol)                                                             \
+    do {                                                                                  \
+        double a_ = (a), b_ = (b);                                                        \
+        if (!(std::abs(a_ - b_) <= (tol))) {                                              \
+            std::cerr << "❌ " << __FILE__ << ":" << __LINE__ << ": CHECK_NEAR(" #a ", " #b \
+                      << "): " << a_ << " vs " << b_ << std::endl;                        \
+            test_failures()++;                                                            \
+        }                                                                                 \
+    } while (0)
+
+inline int test_result(const char* name) {
+    if (test_failures() == 0) {
+        std::cout << "✅ " << name << ": all checks passed" << std::endl;
+        return 0;
+    }
+    std::cerr << "❌ " << name << ": " << test_failures() << " check(s) failed" << std::endl;
+    return 1;
+}
@@ -0,0 +1,102 @@
+#include "trade_risk.hpp"
+#include "thread_pool.hpp"
+#include "test_check.hpp"
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+// simulate_trade_risk: the same profile for any thread count, a different
+// one per seed, exact results on degenerate samples, binomial win counts
+
+namespace {
+
+bool same_profile(const RiskProfile& a, const RiskProfile& b) {
+    return a.sample_size == b.sample_size && a.paths == b.paths && a.horizon == b.horizon &&
+           a.drawdown_mean == b.drawdown_mean && a.drawdown_p50 == b.drawdown_p50 &&
+           a.drawdown_p90 == b.drawdown_p90 && a.drawdown_p95 == b.drawdown_p95 &&
+           a.drawdown_p99 == b.drawdown_p99 && a.return_p05 == b.return_p05 &&
+           a.return_p50 == b.return_p50 && a.win_histogram == b.win_histogram;
+}
+
+std::vector<double> sample_roi() {
+    std::vector<double> roi;
+    for (int i = 0; i < 57; i++) roi.push_back(std::sin(i * 1.7) * 3.0 + 0.2);
+    return roi;
+}
+
+void test_independent_of_threads() {
+    const std::vector<double> roi = sample_roi();
+    RiskOptions options;
+    options.paths = 20011;   // Not a multiple of the lane block
+    options.horizon = 50;
+    ThreadPool one(1), four(4);
+    RiskProfile a = simulate_trade_risk(roi, options, one);
+    RiskProfile b = simulate_trade_risk(roi, options, four);
+    RiskProfile c = simulate_trade_risk(roi, options, four);
+    CHECK(same_profile(a, b));
+    CHECK(same_profile(b, c));
+    // Rounded up to whole 16-path lane blocks
+    CHECK(a.paths >= options.paths && a.paths < options.paths + 16);
+    CHECK(a.win_histogram.size() == options.horizon + 1);
+    CHECK(std::accumulate(a.win_histogram.begin(), a.win_histogram.end(), 0u) == a.paths);
+
+    options.seed++;
+    RiskProfile other = simulate_trade_risk(roi, options, four);
+    CHECK(!same_profile(a, other));
+    // A different draw of the same distribution: close, not equal
+    CHECK_NEAR(other.drawdown_mean, a.drawdown_mean, a.drawdown_mean * 0.05);
+}
+
+void test_degenerate_samples() {
+    ThreadPool pool(2);
+    RiskOptions options;
+    options.paths = 1000;
+    options.horizon = 40;
+
+    CHECK(simulate_trade_risk({}, options, pool).empty());
+
+    RiskProfile wins = simulate_trade_risk({1.5}, options, pool);
+    CHECK(wins.sample_size == 1);
+    CHECK(wins.drawdown_p99 == 0.0);
+    CHECK_NEAR(wins.return_p05, 60.0, 1e-9);
+    CHECK(wins.win_histogram[40] == wins.paths);
+    CHECK(wins.win_rate_at_confidence(0.99) == 1.0);
+
+    // Every trade loses: the drawdown is the whole cumulative loss
+    RiskProfile losses = simulate_trade_risk({-2.0}, options, pool);
+    CHECK_NEAR(losses.drawdown_mean, 80.0, 1e-9);
+    CHECK_NEAR(losses.return_p50, -80.0, 1e-9);
+    CHECK(losses.win_histogram[0] == losses.paths);
+    CHECK(losses.win_rate_at_confidence(0.5) == 0.0);
+}
+
+void test_coin_flip() {
+    ThreadPool pool(3);
+    RiskOptions options;
+    options.paths = 50000;
+    options.horizon = 100;
+    RiskProfile p = simulate_trade_risk({1.0, -1.0}, options, pool);
+
+    double mean_wins = 0.0;
+    for (size_t k = 0; k < p.win_histogram.size(); k++) mean_wins += (double)k * p.win_histogram[k];
+    mean_wins /= p.paths;
+    CHECK_NEAR(mean_wins, 50.0, 0.2);
+    CHECK_NEAR(p.return_p50, 0.0, 2.0 + 1e-9);
+    CHECK_NEAR(p.win_rate_at_confidence(0.5), 0.5, 0.01 + 1e-9);
+    // Binomial(100, 0.5): 95% of paths win at least ~42%
+    CHECK_NEAR(p.win_rate_at_confidence(0.95), 0.42, 0.02 + 1e-9);
+    CHECK(p.win_rate_at_confidence(0.99) <= p.win_rate_at_confidence(0.95));
+    // Max drawdown of a +-1 walk over 100 steps: mean ~ 10 (sqrt(pi n / 2) - ...)
+    CHECK(p.drawdown_p50 > 5.0 && p.drawdown_p50 < 15.0);
+    CHECK(p.drawdown_p50 <= p.drawdown_p90 && p.drawdown_p90 <= p.drawdown_p95 && p.drawdown_p95 <= p.drawdown_p99);
+}
+
+}  // namespace
+
+int main() {
+    test_independent_of_threads();
+    test_degenerate_samples();
+    test_coin_flip();
+    return test_result("trade_risk_test");
+}
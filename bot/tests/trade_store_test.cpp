@@ -0,0 +1,122 @@
+#include "trade_store.hpp"
+#include "learning_engine.hpp"
+#include "test_check.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// TradeStore: every field survives append/get, price paths slice the shared
+// arena, coded strings, and pair ids that outlive clear()
+
+namespace {
+
+TradeRecord make_trade(int i) {
+    static const char* pairs[] = {"PI_XBTUSD", "PI_ETHUSD", "PF_SOLUSD"};
+    static const char* reasons[] = {"take_profit", "stop_loss", "timeout", "trailing_stop"};
+    TradeRecord t{};
+    t.pair = pairs[i % 3];
+    t.direction = i % 4 == 3 ? "" : (i % 2 ? "SHORT" : "LONG");   // "" = legacy LONG
+    t.entry_price = 100.0 + i * 0.25;
+    t.exit_price = 100.0 + i * 0.3;
+    t.leverage = 1 + i % 10;
+    t.timeframe_seconds = 15 * (i % 12);
+    t.position_size = 50.0 + i;
+    t.pnl = (i % 5 - 2) * 1.25;
+    t.gross_pnl = t.pnl + 0.2;
+    t.fees_paid = 0.2;
+    t.timestamp = system_clock::time_point(std::chrono::milliseconds(1700000000123LL + i * 5000LL));
+    t.exit_reason = reasons[i % 4];
+    t.volatility_at_entry = 0.1 * i;
+    t.bid_ask_spread = 0.01 * (i % 7);
+    t.bars_high = i % 9;
+    t.bars_low = i % 11;
+    t.max_profit = 0.05 * i;
+    t.max_loss = -0.04 * i;
+    t.trend_direction = i % 3 - 1.0;
+    t.rsi = 20.0 + i;
+    t.macd_histogram = -0.5 + 0.01 * i;
+    t.macd_signal = 0.02 * i;
+    t.bb_position = (i % 10) / 10.0;
+    t.volume_ratio = 0.5 + 0.1 * i;
+    t.momentum_score = -1.0 + 0.02 * i;
+    t.order_flow_imbalance = 0.3 - 0.01 * i;
+    t.atr_pct = 0.001 * i;
+    t.vwap_deviation = -0.002 * i;
+    t.market_regime = i % 5 - 2;
+    for (int k = 0; k < (i % 4) * 7; k++) t.price_path.push_back((uint8_t)(i * 31 + k));
+    return t;
+}
+
+void check_same(const TradeRecord& a, const TradeRecord& b) {
+    CHECK(a.pair == b.pair);
+    CHECK(a.direction == (b.direction == "SHORT" ? "SHORT" : "LONG"));
+    CHECK(a.exit_reason == b.exit_reason);
+    CHECK(a.timestamp == b.timestamp);
+    CHECK(a.entry_price == b.entry_price && a.exit_price == b.exit_price);
+    CHECK(a.leverage == b.leverage && a.timeframe_seconds == b.timeframe_seconds);
+    CHECK(a.position_size == b.position_size);
+    CHECK(a.pnl == b.pnl && a.gross_pnl == b.gross_pnl && a.fees_paid == b.fees_paid);
+    CHECK(a.volatility_at_entry == b.volatility_at_entry && a.bid_ask_spread == b.bid_ask_spread);
+    CHECK(a.bars_high == b.bars_high && a.bars_low == b.bars_low);
+    CHECK(a.max_profit == b.max_profit && a.max_loss == b.max_loss);
+    CHECK(a.trend_direction == b.trend_direction);
+    CHECK(a.rsi == b.rsi && a.macd_histogram == b.macd_histogram && a.macd_signal == b.macd_signal);
+    CHECK(a.bb_position == b.bb_position && a.volume_ratio == b.volume_ratio);
+    CHECK(a.momentum_score == b.momentum_score && a.order_flow_imbalance == b.order_flow_imbalance);
+    CHECK(a.atr_pct == b.atr_pct && a.vwap_deviation == b.vwap_deviation);
+    CHECK(a.market_regime == b.market_regime);
+    CHECK(a.price_path == b.price_path);
+}
+
+void test_round_trip() {
+    TradeStore store;
+    store.reserve(64);
+    CHECK(store.empty());
+    std::vector<TradeRecord> trades;
+    for (int i = 0; i < 40; i++) {
+        trades.push_back(make_trade(i));
+        CHECK(store.append(trades.back()) == (uint32_t)i);
+    }
+    CHECK(store.size() == trades.size());
+    for (size_t i = 0; i < trades.size(); i++) {
+        check_same(store.get(i), trades[i]);
+        CHECK(store.path_size(i) == trades[i].price_path.size());
+        CHECK(store.is_win(i) == trades[i].is_win());
+        CHECK(store.roi(i) == trades[i].roi());
+        CHECK(store.is_short[i] == (trades[i].direction == "SHORT"));
+    }
+    // Coded strings: one id per distinct value
+    CHECK(store.pairs.size() == 3);
+    CHECK(store.pair_id[0] == store.pair_id[3]);
+    CHECK(store.exit_reason[0] == store.exit_reason[4]);
+    CHECK(store.exit_reason[0] != store.exit_reason[1]);
+    CHECK(store.exit_reason_name(200) == "unknown");
+}
+
+void test_clear_keeps_pair_ids() {
+    TradeStore store;
+    for (int i = 0; i < 6; i++) store.append(make_trade(i));
+    uint32_t eth = store.pairs.find("PI_ETHUSD");
+    PatternKey key = PatternKey::basic(eth, true, 3.0, 1);
+    CHECK(eth != 0);
+
+    store.clear();
+    CHECK(store.empty());
+    CHECK(store.path_bytes.empty() && store.path_offset.empty() && store.timestamp_ms.empty());
+    CHECK(store.pairs.find("PI_ETHUSD") == eth);
+    CHECK(key.to_string(store.pairs) == "PI_ETHUSD_SHORT_3x_1");
+
+    // Rebuilt rows reuse the ids, and paths start from an empty arena
+    CHECK(store.append(make_trade(1)) == 0);
+    CHECK(store.pair_id[0] == eth);
+    check_same(store.get(0), make_trade(1));
+    CHECK(store.path_size(0) == make_trade(1).price_path.size());
+}
+
+}  // namespace
+
+int main() {
+    test_round_trip();
+    test_clear_keeps_pair_ids();
+    return test_result("trade_store_test");
+}
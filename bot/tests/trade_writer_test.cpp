@@ -0,0 +1,190 @@
+#include "trade_writer.hpp"
+#include "learning_engine.hpp"
+#include "metrics_registry.hpp"
+#include "test_check.hpp"
+#include <sqlite3.h>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+// TradeWriter: group commit behind a held lock, flush() durability, a bad
+// row failing only itself, duplicates and failures marking stats stale
+
+namespace {
+
+std::string db_path() {
+    return (std::filesystem::temp_directory_path() /
+            ("trade_writer_test_" + std::to_string(getpid()) + ".db")).string();
+}
+
+// Fresh trades.db with the schema LearningEngine creates
+void create_db(const std::string& path) {
+    for (const char* suffix : {"", "-wal", "-shm"}) std::filesystem::remove(path + suffix);
+    LearningEngineOptions options;
+    options.trades_db_path = path;
+    options.persist_models = false;
+    options.ingest_market_data = false;
+    options.online_model_path = "";
+    LearningEngine engine(options);
+}
+
+int64_t query_int(const std::string& path, const char* sql) {
+    sqlite3* db = nullptr;
+    sqlite3_open(path.c_str(), &db);
+    sqlite3_stmt* stmt = nullptr;
+    int64_t value = -1;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW)
+        value = sqlite3_column_int64(stmt, 0);
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+    return value;
+}
+
+TradeRecord make_trade(int i, double pnl) {
+    TradeRecord trade{};
+    trade.pair = "PI_XBTUSD";
+    trade.direction = "LONG";
+    trade.entry_price = 100.0;
+    trade.exit_price = 100.0 + pnl;
+    trade.leverage = 3;
+    trade.timeframe_seconds = 60;
+    trade.position_size = 100.0;
+    trade.pnl = pnl;
+    trade.gross_pnl = pnl;
+    trade.timestamp = system_clock::time_point(std::chrono::milliseconds(1700000000000LL + i * 1000LL));
+    trade.exit_reason = "take_profit";
+    return trade;
+}
+
+// Trade i plus the absolute pattern_stats row it produced (i + 1 trades)
+TradeWrite make_write(int i, double pnl, std::atomic<int>& saved, std::atomic<int>& failed) {
+    TradeWrite write;
+    write.trade = make_trade(i, pnl);
+    PatternStatsRow row;
+    row.agg.key = PatternKey::basic(1, false, 3.0, 1);
+    row.agg.total_trades = i + 1;
+    row.metrics.pair = "PI_XBTUSD";
+    row.pattern_key = "PI_XBTUSD_LONG_3x_1";
+    write.patterns.push_back(row);
+    write.on_durable = [&saved, &failed](bool ok) { ok ? saved++ : failed++; };
+    return write;
+}
+
+void test_group_commit_behind_lock() {
+    const std::string path = db_path();
+    create_db(path);
+    std::atomic<int> saved{0}, failed{0};
+    const int writes = 300;
+    uint64_t batches_before = MetricsRegistry::instance().counter_value(MetricCounter::TRADE_WRITE_BATCHES);
+    {
+        TradeWriter writer(path);
+        CHECK(writer.ok());
+
+        // Another connection holds the write lock: the writer waits on it
+        // while the rest of the burst queues up behind the first write
+        sqlite3* other = nullptr;
+        sqlite3_open(path.c_str(), &other);
+        CHECK(sqlite3_exec(other, "BEGIN IMMEDIATE", nullptr, nullptr, nullptr) == SQLITE_OK);
+        for (int i = 0; i < writes; i++) writer.submit(make_write(i, i % 3 ? 1.0 : -1.0, saved, failed));
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        CHECK(saved == 0);
+        CHECK(writer.queue_depth() > 0);
+        sqlite3_exec(other, "COMMIT", nullptr, nullptr, nullptr);
+        sqlite3_close(other);
+
+        writer.flush();
+        // Durable once flush() returns, before the writer is destroyed
+        CHECK(saved == writes);
+        CHECK(failed == 0);
+        CHECK(writer.queue_depth() == 0);
+        CHECK(query_int(path, "SELECT COUNT(*) FROM trades") == writes);
+        CHECK(query_int(path, "SELECT total_trades FROM pattern_stats WHERE pattern_key = 'PI_XBTUSD_LONG_3x_1'") == writes);
+    }
+    uint64_t batches = MetricsRegistry::instance().counter_value(MetricCounter::TRADE_WRITE_BATCHES) - batches_before;
+    // First write alone, the rest in MAX_BATCH groups
+    CHECK(batches >= 2);
+    CHECK(batches <= 1 + (writes - 1 + TradeWriter::MAX_BATCH - 1) / TradeWriter::MAX_BATCH + 1);
+    CHECK(query_int(path, "PRAGMA user_version") != 0);
+    for (const char* suffix : {"", "-wal", "-shm"}) std::filesystem::remove(path + suffix);
+}
+
+void test_bad_row_fails_alone() {
+    const std::string path = db_path();
+    create_db(path);
+    sqlite3* db = nullptr;
+    sqlite3_open(path.c_str(), &db);
+    sqlite3_exec(db, "PRAGMA user_version = 7; CREATE TRIGGER reject BEFORE INSERT ON trades "
+                     "WHEN NEW.pnl = 5 BEGIN SELECT RAISE(ABORT, 'rejected'); END",
+                 nullptr, nullptr, nullptr);
+    sqlite3_close(db);
+
+    std::atomic<int> saved{0}, failed{0};
+    const int writes = 40;
+    {
+        TradeWriter writer(path);
+        for (int i = 0; i < writes; i++) writer.submit(make_write(i, i == 20 ? 5.0 : 1.0, saved, failed));
+        writer.flush();
+        CHECK(saved == writes - 1);
+        CHECK(failed == 1);
+    }
+    CHECK(query_int(path, "SELECT COUNT(*) FROM trades") == writes - 1);
+    CHECK(query_int(path, "SELECT COUNT(*) FROM trades WHERE pnl = 5") == 0);
+    // The failed trade is still in the engine's aggregates: stats no longer
+    // match trades and are rebuilt on the next load
+    CHECK(query_int(path, "PRAGMA user_version") == 0);
+    CHECK(query_int(path, "SELECT total_trades FROM pattern_stats") < 21);
+    for (const char* suffix : {"", "-wal", "-shm"}) std::filesystem::remove(path + suffix);
+}
+
+void test_duplicate_marks_stale_until_rebuild() {
+    const std::string path = db_path();
+    create_db(path);
+    std::atomic<int> saved{0}, failed{0};
+    {
+        TradeWriter writer(path);
+        writer.submit(make_write(0, 1.0, saved, failed));
+        writer.flush();
+        CHECK(saved == 1);
+
+        // Same pair and timestamp: INSERT OR IGNORE skips it, not durable
+        writer.submit(make_write(0, 1.0, saved, failed));
+        writer.submit(make_write(1, 1.0, saved, failed));
+        writer.flush();
+        CHECK(saved == 2);
+        CHECK(failed == 1);
+        CHECK(query_int(path, "PRAGMA user_version") == 0);
+        // Stats rows are skipped while stale
+        CHECK(query_int(path, "SELECT total_trades FROM pattern_stats") == 1);
+
+        // A full rebuild stamps the version and writes stats again
+        TradeWrite rebuild;
+        rebuild.replace_stats = true;
+        rebuild.stats_version = 9;
+        PatternStatsRow row;
+        row.agg.key = PatternKey::basic(1, false, 3.0, 1);
+        row.agg.total_trades = 2;
+        row.metrics.pair = "PI_XBTUSD";
+        row.pattern_key = "PI_XBTUSD_LONG_3x_1";
+        rebuild.patterns.push_back(row);
+        writer.submit(std::move(rebuild));
+        writer.submit(make_write(2, -1.0, saved, failed));
+        writer.flush();
+        CHECK(saved == 3);
+    }
+    CHECK(query_int(path, "SELECT COUNT(*) FROM trades") == 3);
+    CHECK(query_int(path, "PRAGMA user_version") == 9);
+    CHECK(query_int(path, "SELECT total_trades FROM pattern_stats") == 3);
+    for (const char* suffix : {"", "-wal", "-shm"}) std::filesystem::remove(path + suffix);
+}
+
+}  // namespace
+
+int main() {
+    test_group_commit_behind_lock();
+    test_bad_row_fails_alone();
+    test_duplicate_marks_stale_until_rebuild();
+    return test_result("trade_writer_test");
+}